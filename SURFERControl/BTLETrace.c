@@ -0,0 +1,198 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: BTLETrace.c                                                               //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module records every characteristic notification received from the reader  //
+//  into a trace file with a high resolution timestamp, and reads traces back so    //
+//  that they can be replayed without the hardware.                                 //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <string.h>
+
+#include "BTLETrace.h"
+#include "MonotonicClock.h"
+
+static const char *btleTraceChannelNames[BTLE_TRACE_NUM_CHANNELS] =
+{
+    "target EPC", "new EPC", "read state", "PKT1", "PKT2", "waveform", "log message", "hardware revision"
+};
+
+const char *btleTraceChannelName(uint8_t channel)
+{
+    return channel < BTLE_TRACE_NUM_CHANNELS ? btleTraceChannelNames[channel] : "unknown";
+}
+
+static void btleTracePutLE(uint8_t *bytes, uint64_t value, int numBytes)
+{
+    for(int i=0; i<numBytes; i++){
+        bytes[i] = (uint8_t)(value >> (8*i));
+    }
+}
+
+static uint64_t btleTraceGetLE(const uint8_t *bytes, int numBytes)
+{
+    uint64_t value = 0;
+    
+    for(int i=0; i<numBytes; i++){
+        value |= (uint64_t)bytes[i] << (8*i);
+    }
+    return value;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Writing
+
+bool btleTraceWriterOpen(BTLETraceWriter *writer, const char *path)
+{
+    uint8_t header[BTLE_TRACE_HEADER_BYTES] = {0};
+    
+    memset(writer, 0, sizeof(BTLETraceWriter));
+    
+    writer->file = fopen(path, "wb");
+    if(!writer->file){
+        return false;
+    }
+    
+    memcpy(header, BTLE_TRACE_MAGIC, 8);
+    btleTracePutLE(header+8, BTLE_TRACE_VERSION, 2);
+    btleTracePutLE(header+10, BTLE_TRACE_HEADER_BYTES, 2);
+    
+    writer->failed  = fwrite(header, 1, sizeof(header), writer->file) != sizeof(header);
+    writer->startNs = monotonicClockNs();
+    
+    return !writer->failed;
+}
+
+bool btleTraceWriterAppend(BTLETraceWriter *writer, BTLETraceChannel channel, const uint8_t *bytes, size_t length)
+{
+    return btleTraceWriterAppendAt(writer, monotonicClockNs()-writer->startNs, channel, bytes, length);
+}
+
+bool btleTraceWriterAppendAt(BTLETraceWriter *writer, uint64_t timestampNs, BTLETraceChannel channel, const uint8_t *bytes, size_t length)
+{
+    uint8_t recordHeader[BTLE_TRACE_RECORD_BYTES];
+    
+    if(!writer->file || writer->failed){
+        return false;
+    }
+    if(length > BTLE_TRACE_MAX_DATA_BYTES){
+        length = BTLE_TRACE_MAX_DATA_BYTES;
+    }
+    
+    btleTracePutLE(recordHeader, timestampNs, 8);
+    recordHeader[8] = (uint8_t)channel;
+    btleTracePutLE(recordHeader+9, length, 2);
+    
+    //stdio buffers these, so a notification doesn't cost a write to disk.
+    if(fwrite(recordHeader, 1, sizeof(recordHeader), writer->file) != sizeof(recordHeader)
+       || fwrite(bytes, 1, length, writer->file) != length){
+        writer->failed = true;
+        return false;
+    }
+    writer->numRecords++;
+    
+    return true;
+}
+
+bool btleTraceWriterClose(BTLETraceWriter *writer)
+{
+    bool succeeded;
+    
+    if(!writer->file){
+        return false;
+    }
+    
+    succeeded       = fclose(writer->file) == 0 && !writer->failed;
+    writer->file    = NULL;
+    
+    return succeeded;
+}
+
+bool btleTraceWriterIsOpen(const BTLETraceWriter *writer)
+{
+    return writer->file != NULL;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Reading
+
+bool btleTraceReaderOpen(BTLETraceReader *reader, const char *path)
+{
+    uint8_t header[BTLE_TRACE_HEADER_BYTES];
+    
+    memset(reader, 0, sizeof(BTLETraceReader));
+    
+    reader->file = fopen(path, "rb");
+    if(!reader->file){
+        return false;
+    }
+    
+    if(fread(header, 1, sizeof(header), reader->file) != sizeof(header) || memcmp(header, BTLE_TRACE_MAGIC, 8) != 0
+       || btleTraceGetLE(header+8, 2) < 1 || btleTraceGetLE(header+10, 2) < BTLE_TRACE_HEADER_BYTES
+       || fseek(reader->file, (long)btleTraceGetLE(header+10, 2), SEEK_SET) != 0){
+        fclose(reader->file);
+        reader->file = NULL;
+        return false;
+    }
+    
+    return true;
+}
+
+bool btleTraceReaderNext(BTLETraceReader *reader, BTLETraceRecord *record)
+{
+    uint8_t recordHeader[BTLE_TRACE_RECORD_BYTES];
+    size_t  numRead;
+    
+    if(!reader->file){
+        return false;
+    }
+    
+    numRead = fread(recordHeader, 1, sizeof(recordHeader), reader->file);
+    if(numRead != sizeof(recordHeader)){
+        reader->truncated = numRead != 0;
+        return false;
+    }
+    
+    record->timestampNs = btleTraceGetLE(recordHeader, 8);
+    record->channel     = recordHeader[8];
+    record->length      = (uint16_t)btleTraceGetLE(recordHeader+9, 2);
+    
+    if(record->length > BTLE_TRACE_MAX_DATA_BYTES || fread(record->data, 1, record->length, reader->file) != record->length){
+        reader->truncated = true;
+        return false;
+    }
+    reader->numRecords++;
+    
+    return true;
+}
+
+void btleTraceReaderClose(BTLETraceReader *reader)
+{
+    if(reader->file){
+        fclose(reader->file);
+    }
+    reader->file = NULL;
+}
@@ -0,0 +1,113 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: BTLETrace.h                                                               //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module records every characteristic notification received from the reader  //
+//  into a trace file with a high resolution timestamp, and reads traces back so    //
+//  that they can be replayed without the hardware.                                 //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BTLETrace_h
+#define BTLETrace_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+//File layout, all integers little-endian:
+//
+//  Header, BTLE_TRACE_HEADER_BYTES long
+//  0       8       Magic, "SURFTRCE"
+//  8       2       Format version, BTLE_TRACE_VERSION
+//  10      2       Header size in bytes, so that later versions can grow the header
+//  12      4       Reserved, 0
+//
+//  Then one record per notification
+//  0       8       Time since the trace was started, in nanoseconds
+//  8       1       Channel, one of BTLETraceChannel
+//  9       2       Number of data bytes
+//  11      ...     The notification data exactly as received
+
+#define BTLE_TRACE_MAGIC            "SURFTRCE"
+#define BTLE_TRACE_VERSION          1
+#define BTLE_TRACE_HEADER_BYTES     16
+#define BTLE_TRACE_RECORD_BYTES     11      //Record header, not counting the data.
+#define BTLE_TRACE_MAX_DATA_BYTES   512     //The longest a BTLE attribute value can be.
+
+//One channel for each characteristic the reader sends data back on.
+typedef enum
+{
+    BTLE_TRACE_TARGET_EPC   =   0,
+    BTLE_TRACE_NEW_EPC      =   1,
+    BTLE_TRACE_READ_STATE   =   2,
+    BTLE_TRACE_PKT1         =   3,
+    BTLE_TRACE_PKT2         =   4,
+    BTLE_TRACE_WAVEFORM     =   5,
+    BTLE_TRACE_LOG_MESSAGE  =   6,
+    BTLE_TRACE_HW_REVISION  =   7,
+    BTLE_TRACE_NUM_CHANNELS =   8
+} BTLETraceChannel;
+
+typedef struct
+{
+    uint64_t    timestampNs;
+    uint8_t     channel;
+    uint16_t    length;
+    uint8_t     data[BTLE_TRACE_MAX_DATA_BYTES];
+} BTLETraceRecord;
+
+typedef struct
+{
+    FILE        *file;
+    uint64_t    startNs;
+    uint64_t    numRecords;
+    bool        failed;     //Set on the first write error, after which records are dropped.
+} BTLETraceWriter;
+
+typedef struct
+{
+    FILE        *file;
+    uint64_t    numRecords;
+    bool        truncated;  //Set if the file ended partway through a record.
+} BTLETraceReader;
+
+const char  *btleTraceChannelName(uint8_t channel);
+
+//Writing. Append stamps the record with the time since the trace was opened.
+//AppendAt takes the timestamp from the caller, for writing made-up traces.
+bool        btleTraceWriterOpen(BTLETraceWriter *writer, const char *path);
+bool        btleTraceWriterAppend(BTLETraceWriter *writer, BTLETraceChannel channel, const uint8_t *bytes, size_t length);
+bool        btleTraceWriterAppendAt(BTLETraceWriter *writer, uint64_t timestampNs, BTLETraceChannel channel, const uint8_t *bytes, size_t length);
+bool        btleTraceWriterClose(BTLETraceWriter *writer);
+bool        btleTraceWriterIsOpen(const BTLETraceWriter *writer);
+
+//Reading. Next returns false at the end of the trace, or if the rest of the file isn't a valid record.
+bool        btleTraceReaderOpen(BTLETraceReader *reader, const char *path);
+bool        btleTraceReaderNext(BTLETraceReader *reader, BTLETraceRecord *record);
+void        btleTraceReaderClose(BTLETraceReader *reader);
+
+#endif /* BTLETrace_h */
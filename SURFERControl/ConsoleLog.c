@@ -0,0 +1,174 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: ConsoleLog.c                                                              //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module is a fixed-size store for console log lines. Any thread can add     //
+//  a line in constant time, and the console view copies out the most recent        //
+//  lines when it redraws, so a long session never grows the log or slows it down.  //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "ConsoleLog.h"
+#include "MonotonicClock.h"
+
+bool consoleLogInit(ConsoleLog *log, uint32_t capacity)
+{
+    memset(log, 0, sizeof(ConsoleLog));
+    
+    log->records = calloc(capacity, sizeof(ConsoleLogRecord));
+    if(!log->records || pthread_mutex_init(&log->lock, NULL) != 0){
+        free(log->records);
+        log->records = NULL;
+        return false;
+    }
+    log->capacity = capacity;
+    
+    return true;
+}
+
+void consoleLogFree(ConsoleLog *log)
+{
+    if(log->records){
+        pthread_mutex_destroy(&log->lock);
+        free(log->records);
+    }
+    memset(log, 0, sizeof(ConsoleLog));
+}
+
+void consoleLogClear(ConsoleLog *log)
+{
+    pthread_mutex_lock(&log->lock);
+    log->firstKept = log->numAppended;
+    pthread_mutex_unlock(&log->lock);
+}
+
+//The length of text, less any character at its end that has been cut short.
+static size_t consoleLogWholeCharacters(const char *text, size_t length)
+{
+    size_t  start   =   length;
+    uint8_t lead;
+    size_t  needed;
+    
+    //Step back over the continuation bytes, at most three, to the byte that starts the last character.
+    while(start && length-start < 3 && ((uint8_t)text[start-1] & 0xC0) == 0x80){
+        start--;
+    }
+    if(!start){
+        return length;
+    }
+    lead    =   (uint8_t)text[start-1];
+    needed  =   lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    
+    return length-(start-1) < needed ? start-1 : length;
+}
+
+void consoleLogAppend(ConsoleLog *log, ConsoleLogSeverity severity, ConsoleLogSource source, const char *text)
+{
+    size_t      length  =   consoleLogWholeCharacters(text, strnlen(text, CONSOLE_LOG_MAX_LINE_BYTES-1));
+    size_t      offset  =   0;
+    uint64_t    timestampNs;
+    
+    pthread_mutex_lock(&log->lock);
+    
+    //The time is read under the lock so that lines are in time order as well as sequence order.
+    timestampNs = monotonicClockNs();
+    do{
+        ConsoleLogRecord    *record         =   &log->records[log->numAppended % log->capacity];
+        size_t              pieceLength     =   length-offset;
+        
+        //When a line goes on into another record, don't leave half of a UTF-8 character at the end of this one.
+        if(pieceLength > CONSOLE_LOG_TEXT_BYTES-1){
+            pieceLength = consoleLogWholeCharacters(text+offset, CONSOLE_LOG_TEXT_BYTES-1);
+        }
+        
+        record->sequence    =   log->numAppended++;
+        record->timestampNs =   timestampNs;
+        record->severity    =   (uint8_t)severity;
+        record->source      =   (uint8_t)source;
+        record->continued   =   offset != 0;
+        record->length      =   (uint16_t)pieceLength;
+        memcpy(record->text, text+offset, pieceLength);
+        record->text[pieceLength] = 0;
+        offset             +=   pieceLength;
+    } while(offset < length);
+    
+    pthread_mutex_unlock(&log->lock);
+}
+
+void consoleLogAppendf(ConsoleLog *log, ConsoleLogSeverity severity, ConsoleLogSource source, const char *format, ...)
+{
+    char    text[CONSOLE_LOG_MAX_LINE_BYTES];
+    va_list args;
+    
+    //Format before taking the lock, so that other threads aren't held up by it.
+    //A line that doesn't fit may be cut partway through a character, which consoleLogAppend trims off.
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    
+    consoleLogAppend(log, severity, source, text);
+}
+
+uint64_t consoleLogNumAppended(ConsoleLog *log)
+{
+    uint64_t numAppended;
+    
+    pthread_mutex_lock(&log->lock);
+    numAppended = log->numAppended;
+    pthread_mutex_unlock(&log->lock);
+    
+    return numAppended;
+}
+
+uint32_t consoleLogCopyTail(ConsoleLog *log, ConsoleLogRecord *records, uint32_t maxRecords)
+{
+    uint64_t    first;
+    uint32_t    numRecords;
+    
+    pthread_mutex_lock(&log->lock);
+    
+    //Only lines that are still in the ring and haven't been cleared.
+    first = log->numAppended > log->capacity ? log->numAppended - log->capacity : 0;
+    if(first < log->firstKept){
+        first = log->firstKept;
+    }
+    if(log->numAppended - first > maxRecords){
+        first = log->numAppended - maxRecords;
+    }
+    
+    numRecords = (uint32_t)(log->numAppended - first);
+    for(uint32_t i=0; i<numRecords; i++){
+        records[i] = log->records[(first+i) % log->capacity];
+    }
+    
+    pthread_mutex_unlock(&log->lock);
+    
+    return numRecords;
+}
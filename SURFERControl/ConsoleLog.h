@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: ConsoleLog.h                                                              //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module is a fixed-size store for console log lines. Any thread can add     //
+//  a line in constant time, and the console view copies out the most recent        //
+//  lines when it redraws, so a long session never grows the log or slows it down.  //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef ConsoleLog_h
+#define ConsoleLog_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define CONSOLE_LOG_TEXT_BYTES          120     //Text held by one record. Includes the NUL.
+#define CONSOLE_LOG_MAX_LINE_BYTES      1024    //Longer lines are cut short. Includes the NUL. A line takes as many records as it needs.
+#define CONSOLE_LOG_DEFAULT_CAPACITY    2048    //Number of records kept. Older records are overwritten.
+
+typedef enum
+{
+    CONSOLE_LOG_INFO        =   0,
+    CONSOLE_LOG_WARNING     =   1,
+    CONSOLE_LOG_ERROR       =   2
+} ConsoleLogSeverity;
+
+typedef enum
+{
+    CONSOLE_LOG_SOURCE_APP      =   0,  //The iOS app itself.
+    CONSOLE_LOG_SOURCE_FIRMWARE =   1,  //Log messages sent by the SURFER reader firmware.
+    CONSOLE_LOG_SOURCE_DECODER  =   2   //The tag packet decoder.
+} ConsoleLogSource;
+
+typedef struct
+{
+    uint64_t    sequence;       //Counts up from 0 over the life of the log, including cleared lines.
+    uint64_t    timestampNs;    //From monotonicClockNs.
+    uint8_t     severity;
+    uint8_t     source;
+    uint8_t     continued;      //Set on the records after the first of a line too long for one. Its text follows on.
+    uint16_t    length;
+    char        text[CONSOLE_LOG_TEXT_BYTES];   //Never ends partway through a UTF-8 character.
+} ConsoleLogRecord;
+
+//All of the records are allocated up front. The lock is only held to copy a record in or out.
+typedef struct
+{
+    pthread_mutex_t     lock;
+    ConsoleLogRecord    *records;
+    uint32_t            capacity;
+    uint64_t            numAppended;
+    uint64_t            firstKept;      //Sequence number of the oldest line not cleared.
+} ConsoleLog;
+
+bool        consoleLogInit(ConsoleLog *log, uint32_t capacity);
+void        consoleLogFree(ConsoleLog *log);
+void        consoleLogClear(ConsoleLog *log);
+
+//Safe to call from any thread. A line is split across records at UTF-8 character boundaries, and the records of one
+//line are always next to each other.
+void        consoleLogAppend(ConsoleLog *log, ConsoleLogSeverity severity, ConsoleLogSource source, const char *text);
+void        consoleLogAppendf(ConsoleLog *log, ConsoleLogSeverity severity, ConsoleLogSource source, const char *format, ...)
+                __attribute__((format(printf, 4, 5)));
+
+//Number of records ever appended. A reader can compare this against the last value it saw to skip redrawing.
+uint64_t    consoleLogNumAppended(ConsoleLog *log);
+//Copies up to maxRecords of the most recent records, oldest first, and returns how many were copied.
+//The first may be the continuation of a line whose start has already been overwritten.
+uint32_t    consoleLogCopyTail(ConsoleLog *log, ConsoleLogRecord *records, uint32_t maxRecords);
+
+#endif /* ConsoleLog_h */
@@ -0,0 +1,162 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: EPCIndex.c                                                                //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module maps 96-bit binary EPCs to the row at which the tag was first       //
+//  inserted into the RFID tag list. It is an open-addressing hash table keyed on   //
+//  the EPC held as two machine words.                                              //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "EPCIndex.h"
+
+static void epcIndexSplitEPC(const uint8_t *epc, uint64_t *epcHi, uint32_t *epcLo)
+{
+    memcpy(epcHi, &epc[0], sizeof(*epcHi));
+    memcpy(epcLo, &epc[8], sizeof(*epcLo));
+}
+
+//EPCs are often sequential, so mix the bits well before masking down to a slot.
+static uint32_t epcIndexHash(uint64_t epcHi, uint32_t epcLo)
+{
+    uint64_t h = epcHi ^ ((uint64_t)epcLo * 0x9E3779B97F4A7C15ULL);
+    
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    
+    return (uint32_t)h;
+}
+
+//Linear probe for the EPC. Returns the slot holding it, or the empty slot where it would go.
+static EPCIndexSlot *epcIndexProbe(EPCIndexSlot *slots, uint32_t capacity, uint64_t epcHi, uint32_t epcLo)
+{
+    uint32_t mask   =   capacity-1;
+    uint32_t i      =   epcIndexHash(epcHi, epcLo) & mask;
+    
+    while(slots[i].rowPlusOne != 0){
+        if(slots[i].epcHi == epcHi && slots[i].epcLo == epcLo){
+            break;
+        }
+        i = (i+1) & mask;
+    }
+    
+    return &slots[i];
+}
+
+static bool epcIndexGrow(EPCIndex *index)
+{
+    uint32_t        newCapacity =   2*index->capacity;
+    EPCIndexSlot    *newSlots   =   calloc(newCapacity, sizeof(EPCIndexSlot));
+    
+    if(!newSlots){
+        return false;
+    }
+    
+    for(uint32_t i=0; i<index->capacity; i++){
+        if(index->slots[i].rowPlusOne != 0){
+            *epcIndexProbe(newSlots, newCapacity, index->slots[i].epcHi, index->slots[i].epcLo) = index->slots[i];
+        }
+    }
+    
+    free(index->slots);
+    index->slots    =   newSlots;
+    index->capacity =   newCapacity;
+    
+    return true;
+}
+
+bool epcIndexInit(EPCIndex *index)
+{
+    index->slots    =   calloc(EPC_INDEX_INITIAL_CAPACITY, sizeof(EPCIndexSlot));
+    index->capacity =   index->slots ? EPC_INDEX_INITIAL_CAPACITY : 0;
+    index->count    =   0;
+    
+    return index->slots != NULL;
+}
+
+void epcIndexFree(EPCIndex *index)
+{
+    free(index->slots);
+    index->slots    =   NULL;
+    index->capacity =   0;
+    index->count    =   0;
+}
+
+void epcIndexClear(EPCIndex *index)
+{
+    if(index->slots){
+        memset(index->slots, 0, index->capacity*sizeof(EPCIndexSlot));
+    }
+    index->count    =   0;
+}
+
+int32_t epcIndexFind(const EPCIndex *index, const uint8_t *epc)
+{
+    uint64_t        epcHi;
+    uint32_t        epcLo;
+    EPCIndexSlot    *slot;
+    
+    if(!index->slots){
+        return EPC_INDEX_NOT_FOUND;
+    }
+    
+    epcIndexSplitEPC(epc, &epcHi, &epcLo);
+    slot = epcIndexProbe(index->slots, index->capacity, epcHi, epcLo);
+    
+    return slot->rowPlusOne != 0 ? (int32_t)(slot->rowPlusOne-1) : EPC_INDEX_NOT_FOUND;
+}
+
+int32_t epcIndexFindOrInsert(EPCIndex *index, const uint8_t *epc, bool *inserted)
+{
+    uint64_t        epcHi;
+    uint32_t        epcLo;
+    EPCIndexSlot    *slot;
+    
+    *inserted = false;
+    
+    //Keep the load factor at or below one half so that probe sequences stay short.
+    if(2*(index->count+1) > index->capacity){
+        if(!(index->slots ? epcIndexGrow(index) : epcIndexInit(index))){
+            return EPC_INDEX_NOT_FOUND;
+        }
+    }
+    
+    epcIndexSplitEPC(epc, &epcHi, &epcLo);
+    slot = epcIndexProbe(index->slots, index->capacity, epcHi, epcLo);
+    
+    if(slot->rowPlusOne == 0){
+        slot->epcHi         =   epcHi;
+        slot->epcLo         =   epcLo;
+        slot->rowPlusOne    =   ++index->count;
+        *inserted           =   true;
+    }
+    
+    return (int32_t)(slot->rowPlusOne-1);
+}
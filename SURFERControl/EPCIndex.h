@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: EPCIndex.h                                                                //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module maps 96-bit binary EPCs to the row at which the tag was first       //
+//  inserted into the RFID tag list. It is an open-addressing hash table keyed on   //
+//  the EPC held as two machine words.                                              //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef EPCIndex_h
+#define EPCIndex_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EPC_INDEX_INITIAL_CAPACITY  1024    //Must be a power of 2.
+#define EPC_INDEX_NOT_FOUND         (-1)
+
+//The EPC is split into the first 8 bytes and the last 4 bytes.
+//A row of 0 marks an empty slot, so rows are stored plus one.
+typedef struct
+{
+    uint64_t    epcHi;
+    uint32_t    epcLo;
+    uint32_t    rowPlusOne;
+} EPCIndexSlot;
+
+typedef struct
+{
+    EPCIndexSlot    *slots;
+    uint32_t        capacity;
+    uint32_t        count;
+} EPCIndex;
+
+//Returns false if the slot storage could not be allocated.
+bool        epcIndexInit(EPCIndex *index);
+void        epcIndexFree(EPCIndex *index);
+void        epcIndexClear(EPCIndex *index);
+
+//Returns the row of the EPC, or EPC_INDEX_NOT_FOUND.
+int32_t     epcIndexFind(const EPCIndex *index, const uint8_t *epc);
+
+//Returns the row of the EPC. If the EPC was not present it is given the next row (rows count up in insertion order)
+//and *inserted is set. Returns EPC_INDEX_NOT_FOUND only if the table could not grow.
+int32_t     epcIndexFindOrInsert(EPCIndex *index, const uint8_t *epc, bool *inserted);
+
+#endif /* EPCIndex_h */
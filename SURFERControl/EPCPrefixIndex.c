@@ -0,0 +1,287 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: EPCPrefixIndex.c                                                          //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module answers questions about groups of tags that share the leading bits  //
+//  of their EPC, like those a variable-length target EPC selects. It is a crit-bit //
+//  trie over the 96-bit binary EPCs, with the number of tags under each node, so   //
+//  counting the tags with a prefix or finding the shortest prefix that picks out a //
+//  single tag only walks as many nodes as the prefix has bits.                     //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "EPCPrefixIndex.h"
+
+#define EPC_PREFIX_INDEX_NONE   0xFFFFFFFFu
+
+static inline uint32_t epcPrefixIndexBit(const uint8_t *epc, uint32_t bit)
+{
+    return (epc[bit >> 3] >> (7-(bit & 7))) & 1;
+}
+
+static inline uint32_t epcPrefixIndexClampBits(uint32_t prefixBits)
+{
+    return prefixBits < EPC_PREFIX_INDEX_MAX_BITS ? prefixBits : EPC_PREFIX_INDEX_MAX_BITS;
+}
+
+static inline bool epcPrefixIndexIsLeaf(uint32_t ref)
+{
+    return (ref & EPC_PREFIX_INDEX_LEAF) != 0;
+}
+
+static inline uint32_t epcPrefixIndexRefCount(const EPCPrefixIndex *index, uint32_t ref)
+{
+    return epcPrefixIndexIsLeaf(ref) ? 1 : index->nodes[ref].count;
+}
+
+//Whether the first prefixBits bits of the EPC are those of the prefix.
+static bool epcPrefixIndexHasPrefix(const uint8_t *epc, const uint8_t *prefix, uint32_t prefixBits)
+{
+    uint32_t    wholeBytes  =   prefixBits >> 3;
+    uint32_t    extraBits   =   prefixBits & 7;
+    
+    if(wholeBytes > 0 && memcmp(epc, prefix, wholeBytes) != 0){
+        return false;
+    }
+    if(extraBits == 0){
+        return true;
+    }
+    
+    return ((epc[wholeBytes] ^ prefix[wholeBytes]) & (uint8_t)(0xFF << (8-extraBits))) == 0;
+}
+
+//The first bit at which the two EPCs differ, or EPC_PREFIX_INDEX_MAX_BITS if they are the same.
+static uint32_t epcPrefixIndexCritBit(const uint8_t *a, const uint8_t *b)
+{
+    for(uint32_t i=0; i<TAG_EPC_NUM_BYTES; i++){
+        uint32_t diff = a[i] ^ b[i];
+        
+        if(diff){
+            uint32_t bit = 0;
+            
+            while(!(diff & 0x80)){
+                diff <<= 1;
+                bit++;
+            }
+            return 8*i + bit;
+        }
+    }
+    
+    return EPC_PREFIX_INDEX_MAX_BITS;
+}
+
+//The top of the subtree holding every tag with the prefix, or EPC_PREFIX_INDEX_NONE if there are none.
+//Bits only increase on the way down, so at most prefixBits nodes are visited.
+static uint32_t epcPrefixIndexFindPrefix(const EPCPrefixIndex *index, const uint8_t *prefix, uint32_t prefixBits)
+{
+    uint32_t    ref;
+    uint32_t    leaf;
+    
+    if(index->numLeaves == 0){
+        return EPC_PREFIX_INDEX_NONE;
+    }
+    
+    ref = index->root;
+    while(!epcPrefixIndexIsLeaf(ref) && index->nodes[ref].bit < prefixBits){
+        ref = index->nodes[ref].child[epcPrefixIndexBit(prefix, index->nodes[ref].bit)];
+    }
+    
+    //All of the tags below agree up to the node's bit, so checking one of them checks them all.
+    leaf = epcPrefixIndexIsLeaf(ref) ? (ref & ~EPC_PREFIX_INDEX_LEAF) : index->nodes[ref].anyLeaf;
+    
+    return epcPrefixIndexHasPrefix(index->leaves[leaf].epc, prefix, prefixBits) ? ref : EPC_PREFIX_INDEX_NONE;
+}
+
+bool epcPrefixIndexInit(EPCPrefixIndex *index)
+{
+    memset(index, 0, sizeof(EPCPrefixIndex));
+    
+    index->nodes    =   malloc(EPC_PREFIX_INDEX_INITIAL_CAPACITY*sizeof(EPCPrefixIndexNode));
+    index->leaves   =   malloc(EPC_PREFIX_INDEX_INITIAL_CAPACITY*sizeof(EPCPrefixIndexLeaf));
+    if(!index->nodes || !index->leaves){
+        epcPrefixIndexFree(index);
+        return false;
+    }
+    index->capacity =   EPC_PREFIX_INDEX_INITIAL_CAPACITY;
+    
+    return true;
+}
+
+void epcPrefixIndexFree(EPCPrefixIndex *index)
+{
+    free(index->nodes);
+    free(index->leaves);
+    memset(index, 0, sizeof(EPCPrefixIndex));
+}
+
+void epcPrefixIndexClear(EPCPrefixIndex *index)
+{
+    index->numLeaves = 0;
+}
+
+bool epcPrefixIndexReserve(EPCPrefixIndex *index)
+{
+    uint32_t            newCapacity;
+    EPCPrefixIndexNode  *nodes;
+    EPCPrefixIndexLeaf  *leaves;
+    
+    if(index->numLeaves < index->capacity){
+        return true;
+    }
+    
+    newCapacity = index->capacity ? 2*index->capacity : EPC_PREFIX_INDEX_INITIAL_CAPACITY;
+    if(newCapacity > EPC_PREFIX_INDEX_LEAF){
+        return false;
+    }
+    //The nodes are only ever reached through the root, so each pool can move on its own.
+    nodes = realloc(index->nodes, newCapacity*sizeof(EPCPrefixIndexNode));
+    if(!nodes){
+        return false;
+    }
+    index->nodes = nodes;
+    leaves = realloc(index->leaves, newCapacity*sizeof(EPCPrefixIndexLeaf));
+    if(!leaves){
+        return false;
+    }
+    index->leaves   =   leaves;
+    index->capacity =   newCapacity;
+    
+    return true;
+}
+
+//The new tag hangs off a new node at the first bit where it differs from its nearest tag already in the trie.
+//That is the nearest tag of any of them, so one walk down finds it, and a second finds where the new node goes.
+bool epcPrefixIndexInsert(EPCPrefixIndex *index, const uint8_t *epc, uint32_t row)
+{
+    uint32_t    ref;
+    uint32_t    *link;
+    uint32_t    critBit;
+    uint32_t    leaf;
+    uint32_t    node;
+    uint32_t    side;
+    
+    if(!epcPrefixIndexReserve(index)){
+        return false;
+    }
+    
+    if(index->numLeaves > 0){
+        ref = index->root;
+        while(!epcPrefixIndexIsLeaf(ref)){
+            ref = index->nodes[ref].child[epcPrefixIndexBit(epc, index->nodes[ref].bit)];
+        }
+        critBit = epcPrefixIndexCritBit(epc, index->leaves[ref & ~EPC_PREFIX_INDEX_LEAF].epc);
+        if(critBit == EPC_PREFIX_INDEX_MAX_BITS){
+            return true;
+        }
+    }
+    
+    leaf = index->numLeaves++;
+    memcpy(index->leaves[leaf].epc, epc, TAG_EPC_NUM_BYTES);
+    index->leaves[leaf].row = row;
+    
+    if(leaf == 0){
+        index->root = leaf | EPC_PREFIX_INDEX_LEAF;
+        return true;
+    }
+    
+    //Every node above the new one gets one more tag under it.
+    link = &index->root;
+    while(!epcPrefixIndexIsLeaf(*link) && index->nodes[*link].bit < critBit){
+        index->nodes[*link].count++;
+        link = &index->nodes[*link].child[epcPrefixIndexBit(epc, index->nodes[*link].bit)];
+    }
+    
+    node = leaf-1;
+    side = epcPrefixIndexBit(epc, critBit);
+    index->nodes[node].child[side]  =   leaf | EPC_PREFIX_INDEX_LEAF;
+    index->nodes[node].child[!side] =   *link;
+    index->nodes[node].count        =   epcPrefixIndexRefCount(index, *link) + 1;
+    index->nodes[node].anyLeaf      =   leaf;
+    index->nodes[node].bit          =   critBit;
+    *link                           =   node;
+    
+    return true;
+}
+
+uint32_t epcPrefixIndexCount(const EPCPrefixIndex *index, const uint8_t *prefix, uint32_t prefixBits)
+{
+    uint32_t ref = epcPrefixIndexFindPrefix(index, prefix, epcPrefixIndexClampBits(prefixBits));
+    
+    return ref == EPC_PREFIX_INDEX_NONE ? 0 : epcPrefixIndexRefCount(index, ref);
+}
+
+//The trie is at most EPC_PREFIX_INDEX_MAX_BITS nodes deep, so the walk needs no more stack than that.
+uint32_t epcPrefixIndexMatch(const EPCPrefixIndex *index, const uint8_t *prefix, uint32_t prefixBits,
+                             uint32_t *rows, uint32_t maxRows)
+{
+    uint32_t    stack[EPC_PREFIX_INDEX_MAX_BITS+1];
+    uint32_t    depth       =   0;
+    uint32_t    numRows     =   0;
+    uint32_t    top         =   epcPrefixIndexFindPrefix(index, prefix, epcPrefixIndexClampBits(prefixBits));
+    uint32_t    ref;
+    
+    if(top == EPC_PREFIX_INDEX_NONE){
+        return 0;
+    }
+    
+    stack[depth++] = top;
+    while(depth > 0 && numRows < maxRows){
+        ref = stack[--depth];
+        if(epcPrefixIndexIsLeaf(ref)){
+            rows[numRows++] = index->leaves[ref & ~EPC_PREFIX_INDEX_LEAF].row;
+        } else {
+            stack[depth++] = index->nodes[ref].child[1];
+            stack[depth++] = index->nodes[ref].child[0];
+        }
+    }
+    
+    return epcPrefixIndexRefCount(index, top);
+}
+
+//The last node on the way down is where the nearest other tags branch off.
+int32_t epcPrefixIndexShortestUniquePrefix(const EPCPrefixIndex *index, const uint8_t *epc)
+{
+    uint32_t    ref;
+    int32_t     uniqueBits  =   0;
+    
+    if(index->numLeaves == 0){
+        return EPC_PREFIX_INDEX_NOT_FOUND;
+    }
+    
+    ref = index->root;
+    while(!epcPrefixIndexIsLeaf(ref)){
+        uniqueBits  =   (int32_t)index->nodes[ref].bit + 1;
+        ref         =   index->nodes[ref].child[epcPrefixIndexBit(epc, index->nodes[ref].bit)];
+    }
+    
+    if(memcmp(index->leaves[ref & ~EPC_PREFIX_INDEX_LEAF].epc, epc, TAG_EPC_NUM_BYTES) != 0){
+        return EPC_PREFIX_INDEX_NOT_FOUND;
+    }
+    
+    return uniqueBits;
+}
@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: EPCPrefixIndex.h                                                          //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module answers questions about groups of tags that share the leading bits  //
+//  of their EPC, like those a variable-length target EPC selects. It is a crit-bit //
+//  trie over the 96-bit binary EPCs, with the number of tags under each node, so   //
+//  counting the tags with a prefix or finding the shortest prefix that picks out a //
+//  single tag only walks as many nodes as the prefix has bits.                     //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EPCPrefixIndex_h
+#define EPCPrefixIndex_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "TagPacketDecoder.h"
+
+#define EPC_PREFIX_INDEX_INITIAL_CAPACITY   1024    //Tags, before the pools first have to grow.
+#define EPC_PREFIX_INDEX_MAX_BITS           (8*TAG_EPC_NUM_BYTES)
+#define EPC_PREFIX_INDEX_NOT_FOUND          (-1)
+
+//A reference to a node or a leaf. Leaves have the top bit set.
+#define EPC_PREFIX_INDEX_LEAF               0x80000000u
+
+//Bits are numbered from the most significant bit of the first EPC byte, the order the reader compares them in.
+//Every node has both children, and the tags under child[b] have bit b of their EPC equal to b.
+typedef struct
+{
+    uint32_t    child[2];
+    uint32_t    count;          //Tags under this node.
+    uint32_t    anyLeaf;        //One of them, to check a prefix against.
+    uint32_t    bit;            //The first bit at which the tags under this node differ.
+} EPCPrefixIndexNode;
+
+typedef struct
+{
+    uint8_t     epc[TAG_EPC_NUM_BYTES];
+    uint32_t    row;
+} EPCPrefixIndexLeaf;
+
+//A trie of n tags has n-1 nodes, so the two pools share a capacity.
+typedef struct
+{
+    EPCPrefixIndexNode  *nodes;
+    EPCPrefixIndexLeaf  *leaves;
+    uint32_t            capacity;
+    uint32_t            numLeaves;
+    uint32_t            root;           //Only meaningful if there are leaves.
+} EPCPrefixIndex;
+
+//Returns false if the pools could not be allocated.
+bool        epcPrefixIndexInit(EPCPrefixIndex *index);
+void        epcPrefixIndexFree(EPCPrefixIndex *index);
+//Forgets all of the tags, but keeps the memory.
+void        epcPrefixIndexClear(EPCPrefixIndex *index);
+
+//Makes room for one more tag, so that the next insert can't fail. Returns false if the pools could not grow.
+bool        epcPrefixIndexReserve(EPCPrefixIndex *index);
+//Adds the tag with this EPC, found at the row given. An EPC already in the index keeps its row.
+//Returns false if the pools could not grow.
+bool        epcPrefixIndexInsert(EPCPrefixIndex *index, const uint8_t *epc, uint32_t row);
+
+//The prefix is the first prefixBits bits of the bytes given, so only the first (prefixBits+7)/8 bytes are read.
+//A prefix of 0 bits matches every tag, and one of more than EPC_PREFIX_INDEX_MAX_BITS is cut down to that.
+
+//Number of tags whose EPC starts with the prefix.
+uint32_t    epcPrefixIndexCount(const EPCPrefixIndex *index, const uint8_t *prefix, uint32_t prefixBits);
+//Writes the rows of up to maxRows of the tags whose EPC starts with the prefix, in EPC order, and returns how many
+//tags there are in all. rows may be NULL if maxRows is 0.
+uint32_t    epcPrefixIndexMatch(const EPCPrefixIndex *index, const uint8_t *prefix, uint32_t prefixBits,
+                                uint32_t *rows, uint32_t maxRows);
+//Returns the number of leading bits of the EPC that no other tag shares, or EPC_PREFIX_INDEX_NOT_FOUND if the EPC
+//is not in the index. It is 0 if this is the only tag.
+int32_t     epcPrefixIndexShortestUniquePrefix(const EPCPrefixIndex *index, const uint8_t *epc);
+
+static inline uint32_t epcPrefixIndexNumTags(const EPCPrefixIndex *index)
+{
+    return index->numLeaves;
+}
+
+#endif /* EPCPrefixIndex_h */
@@ -0,0 +1,257 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: LatencyProbe.c                                                            //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module times tag reads through the app, from the BTLE notification to the  //
+//  tag list update, with fixed-size histograms so that the cost per read stays     //
+//  constant. It also counts reads per app state for throughput figures.            //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "LatencyProbe.h"
+
+#define LATENCY_HISTOGRAM_SUB_BUCKETS   (1 << LATENCY_HISTOGRAM_SUB_BITS)
+
+static const char *latencyStageNames[LATENCY_NUM_STAGES] = {"notify to decoded", "notify to saved", "notify to UI"};
+
+//------------------------------------------------------------------------------------------------------------------
+//Histogram
+
+//Values below LATENCY_HISTOGRAM_SUB_BUCKETS get a bucket each. Above that, the bucket comes from the position of the
+//top bit and the LATENCY_HISTOGRAM_SUB_BITS bits below it.
+static uint32_t latencyHistogramBucket(uint64_t ns)
+{
+    int topBit;
+    
+    if(ns < LATENCY_HISTOGRAM_SUB_BUCKETS){
+        return (uint32_t)ns;
+    }
+    topBit = 63-__builtin_clzll(ns);
+    
+    return (uint32_t)((topBit-LATENCY_HISTOGRAM_SUB_BITS+1) << LATENCY_HISTOGRAM_SUB_BITS)
+           + (uint32_t)((ns >> (topBit-LATENCY_HISTOGRAM_SUB_BITS)) & (LATENCY_HISTOGRAM_SUB_BUCKETS-1));
+}
+
+static uint64_t latencyHistogramBucketLow(uint32_t bucket)
+{
+    uint32_t octave = bucket >> LATENCY_HISTOGRAM_SUB_BITS;
+    
+    if(octave == 0){
+        return bucket;
+    }
+    return (uint64_t)(LATENCY_HISTOGRAM_SUB_BUCKETS + (bucket & (LATENCY_HISTOGRAM_SUB_BUCKETS-1))) << (octave-1);
+}
+
+void latencyHistogramRecord(LatencyHistogram *histogram, uint64_t ns)
+{
+    histogram->counts[latencyHistogramBucket(ns)]++;
+    histogram->numSamples++;
+    if(ns > histogram->maxNs){
+        histogram->maxNs = ns;
+    }
+}
+
+uint64_t latencyHistogramPercentile(const LatencyHistogram *histogram, double percentile)
+{
+    uint64_t    rank, seen = 0;
+    
+    if(!histogram->numSamples){
+        return 0;
+    }
+    
+    //The rank of the sample we want, counting from 1.
+    rank = (uint64_t)(percentile/100.0*histogram->numSamples + 0.5);
+    if(rank < 1){
+        rank = 1;
+    }
+    if(rank > histogram->numSamples){
+        rank = histogram->numSamples;
+    }
+    
+    for(uint32_t bucket=0; bucket<LATENCY_HISTOGRAM_NUM_BUCKETS; bucket++){
+        seen += histogram->counts[bucket];
+        if(seen >= rank){
+            uint64_t low    = latencyHistogramBucketLow(bucket);
+            uint64_t high   = bucket+1 < LATENCY_HISTOGRAM_NUM_BUCKETS ? latencyHistogramBucketLow(bucket+1) : UINT64_MAX;
+            uint64_t middle = low + (high-low)/2;
+            
+            //Never report more than was actually seen.
+            return middle < histogram->maxNs ? middle : histogram->maxNs;
+        }
+    }
+    return histogram->maxNs;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Probe
+
+void latencyProbeInit(LatencyProbe *probe, LatencyProbeClock clock, void *clockContext)
+{
+    memset(probe, 0, sizeof(LatencyProbe));
+    
+    probe->clock        = clock ? clock : monotonicClockNsWithContext;
+    probe->clockContext = clockContext;
+    probe->state        = LATENCY_PROBE_NO_STATE;
+}
+
+void latencyProbeSetEnabled(LatencyProbe *probe, bool enabled)
+{
+    //Start the time in the current state from now, rather than from when the probe was last enabled.
+    if(enabled && !probe->enabled){
+        probe->stateStartNs     = probe->clock(probe->clockContext);
+        probe->oldestUnshownNs  = 0;
+    }
+    if(!enabled && probe->enabled && probe->state != LATENCY_PROBE_NO_STATE){
+        probe->stateNs[probe->state] += probe->clock(probe->clockContext) - probe->stateStartNs;
+    }
+    probe->enabled = enabled;
+}
+
+void latencyProbeReset(LatencyProbe *probe)
+{
+    memset(probe->stages, 0, sizeof(probe->stages));
+    memset(probe->stateReads, 0, sizeof(probe->stateReads));
+    memset(probe->stateNs, 0, sizeof(probe->stateNs));
+    probe->oldestUnshownNs  = 0;
+    probe->stateStartNs     = probe->clock(probe->clockContext);
+}
+
+void latencyProbeSetState(LatencyProbe *probe, int state)
+{
+    uint64_t now;
+    
+    if(state < 0 || state >= LATENCY_PROBE_MAX_STATES){
+        state = LATENCY_PROBE_NO_STATE;
+    }
+    
+    //The state is tracked even while disabled, so that the counts are right as soon as the probe is enabled.
+    if(probe->enabled){
+        now = probe->clock(probe->clockContext);
+        if(probe->state != LATENCY_PROBE_NO_STATE){
+            probe->stateNs[probe->state] += now - probe->stateStartNs;
+        }
+        probe->stateStartNs = now;
+    }
+    probe->state = state;
+}
+
+void latencyProbeRecordNotify(LatencyProbe *probe, uint64_t notifyNs)
+{
+    probe->notifyNs = notifyNs;
+}
+
+void latencyProbeRecordStage(LatencyProbe *probe, LatencyStage stage)
+{
+    latencyProbeRecordStageAt(probe, stage, probe->clock(probe->clockContext));
+}
+
+void latencyProbeRecordStageAt(LatencyProbe *probe, LatencyStage stage, uint64_t now)
+{
+    //A stage without a notify before it, e.g. a read made up for debugging, isn't counted.
+    if(!probe->notifyNs){
+        return;
+    }
+    latencyHistogramRecord(&probe->stages[stage], now - probe->notifyNs);
+    
+    if(stage == LATENCY_STAGE_SAVED){
+        if(!probe->oldestUnshownNs){
+            probe->oldestUnshownNs = probe->notifyNs;
+        }
+        if(probe->state != LATENCY_PROBE_NO_STATE){
+            probe->stateReads[probe->state]++;
+        }
+    }
+}
+
+uint64_t latencyProbeTakeUnshown(LatencyProbe *probe)
+{
+    uint64_t unshownNs = probe->oldestUnshownNs;
+    
+    probe->oldestUnshownNs = 0;
+    
+    return unshownNs;
+}
+
+void latencyProbeRecordUIRefreshed(LatencyProbe *probe, uint64_t unshownNs, uint64_t refreshedNs)
+{
+    if(unshownNs && refreshedNs > unshownNs){
+        latencyHistogramRecord(&probe->stages[LATENCY_STAGE_UI], refreshedNs - unshownNs);
+    }
+}
+
+double latencyProbeStateReadsPerSecond(LatencyProbe *probe, int state)
+{
+    uint64_t ns;
+    
+    if(state < 0 || state >= LATENCY_PROBE_MAX_STATES){
+        return 0;
+    }
+    
+    ns = probe->stateNs[state];
+    if(probe->enabled && state == probe->state){
+        ns += probe->clock(probe->clockContext) - probe->stateStartNs;
+    }
+    
+    return ns ? probe->stateReads[state]/(ns/1e9) : 0;
+}
+
+size_t latencyProbeFormatReport(LatencyProbe *probe, const int *states, const char *const *stateNames, int numStates,
+                                char *text, size_t size)
+{
+    size_t  length = 0;
+    
+    //Keep going after the text fills up, so that the full length comes back.
+    #define LATENCY_PROBE_APPEND(...)   length += (size_t)snprintf(length < size ? text+length : NULL, length < size ? size-length : 0, __VA_ARGS__)
+    
+    if(size){
+        text[0] = 0;
+    }
+    
+    for(int i=0; i<numStates; i++){
+        int s = states[i];
+        
+        if(s < 0 || s >= LATENCY_PROBE_MAX_STATES){
+            continue;
+        }
+        LATENCY_PROBE_APPEND("%s: %llu reads, %.1f reads/s\n", stateNames[i],
+                             (unsigned long long)probe->stateReads[s], latencyProbeStateReadsPerSecond(probe, s));
+    }
+    
+    for(int stage=0; stage<LATENCY_NUM_STAGES; stage++){
+        const LatencyHistogram *histogram = &probe->stages[stage];
+        
+        LATENCY_PROBE_APPEND("%s: %llu samples, p50 %.3fms, p99 %.3fms, max %.3fms\n", latencyStageNames[stage],
+                             (unsigned long long)histogram->numSamples,
+                             latencyHistogramPercentile(histogram, 50)/1e6, latencyHistogramPercentile(histogram, 99)/1e6,
+                             histogram->maxNs/1e6);
+    }
+    
+    #undef LATENCY_PROBE_APPEND
+    
+    return length;
+}
@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: LatencyProbe.h                                                            //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module times tag reads through the app, from the BTLE notification to the  //
+//  tag list update, with fixed-size histograms so that the cost per read stays     //
+//  constant. It also counts reads per app state for throughput figures.            //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef LatencyProbe_h
+#define LatencyProbe_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "MonotonicClock.h"
+
+//Each power of two is split into 2^LATENCY_HISTOGRAM_SUB_BITS buckets, so a percentile is within 12.5% of the true value.
+#define LATENCY_HISTOGRAM_SUB_BITS      3
+#define LATENCY_HISTOGRAM_NUM_BUCKETS   ((64-LATENCY_HISTOGRAM_SUB_BITS+1) << LATENCY_HISTOGRAM_SUB_BITS)
+#define LATENCY_PROBE_MAX_STATES        16      //App states are counted by their number, which must be below this.
+#define LATENCY_PROBE_NO_STATE          (-1)
+
+//Every latency is measured from when the notification that completed the read was received.
+typedef enum
+{
+    LATENCY_STAGE_DECODED   =   0,  //The packet decoder returned a complete read.
+    LATENCY_STAGE_SAVED     =   1,  //The read was saved into the tag list.
+    LATENCY_STAGE_UI        =   2,  //The view controllers showed the read. One sample per batch, for the oldest read in it.
+    LATENCY_NUM_STAGES      =   3
+} LatencyStage;
+
+typedef MonotonicClockSource LatencyProbeClock;
+
+typedef struct
+{
+    uint64_t    counts[LATENCY_HISTOGRAM_NUM_BUCKETS];
+    uint64_t    numSamples;
+    uint64_t    maxNs;
+} LatencyHistogram;
+
+//Not thread safe. All of the marks for one read have to come from the same thread, or be otherwise serialized.
+typedef struct
+{
+    bool                enabled;
+    LatencyProbeClock   clock;
+    void                *clockContext;
+    uint64_t            notifyNs;           //When the notification that completed the read being handled now was received.
+    uint64_t            oldestUnshownNs;    //Notification time of the oldest saved read not yet shown, 0 if none.
+    LatencyHistogram    stages[LATENCY_NUM_STAGES];
+    int                 state;
+    uint64_t            stateStartNs;
+    uint64_t            stateReads[LATENCY_PROBE_MAX_STATES];
+    uint64_t            stateNs[LATENCY_PROBE_MAX_STATES];
+} LatencyProbe;
+
+void        latencyHistogramRecord(LatencyHistogram *histogram, uint64_t ns);
+//Percentile from 0 to 100. Returns the middle of the bucket it falls in, or 0 if there are no samples.
+uint64_t    latencyHistogramPercentile(const LatencyHistogram *histogram, double percentile);
+
+//Probes start disabled. Passing a NULL clock uses monotonicClockNsWithContext.
+void        latencyProbeInit(LatencyProbe *probe, LatencyProbeClock clock, void *clockContext);
+void        latencyProbeSetEnabled(LatencyProbe *probe, bool enabled);
+//Clears the histograms and counts, but keeps the current state and whether the probe is enabled.
+void        latencyProbeReset(LatencyProbe *probe);
+//Time and reads are counted against the state until the next call. Pass LATENCY_PROBE_NO_STATE to stop counting.
+void        latencyProbeSetState(LatencyProbe *probe, int state);
+
+//The notification time comes from the same clock as the probe's, e.g. the timestamp the packet was queued with.
+void        latencyProbeRecordNotify(LatencyProbe *probe, uint64_t notifyNs);
+void        latencyProbeRecordStage(LatencyProbe *probe, LatencyStage stage);
+//For a stage that was timed elsewhere with latencyProbeNow, e.g. on a thread that may not mark the probe itself.
+void        latencyProbeRecordStageAt(LatencyProbe *probe, LatencyStage stage, uint64_t ns);
+//The UI stage comes in two halves, so that the batch can be shown on another thread. When the batch goes out, take the
+//notification time of the oldest read in it, 0 if none. Once it has been shown, record that with the time it was shown.
+uint64_t    latencyProbeTakeUnshown(LatencyProbe *probe);
+void        latencyProbeRecordUIRefreshed(LatencyProbe *probe, uint64_t unshownNs, uint64_t refreshedNs);
+
+//These are what goes in the hot path. When the probe is disabled they cost one load and branch.
+static inline uint64_t latencyProbeNow(LatencyProbe *probe)                  { return probe->enabled ? probe->clock(probe->clockContext) : 0; }
+static inline void latencyProbeMarkNotify(LatencyProbe *probe, uint64_t ns)  { if(probe->enabled) latencyProbeRecordNotify(probe, ns); }
+static inline void latencyProbeMarkDecoded(LatencyProbe *probe)              { if(probe->enabled) latencyProbeRecordStage(probe, LATENCY_STAGE_DECODED); }
+static inline void latencyProbeMarkDecodedAt(LatencyProbe *probe, uint64_t ns)
+{
+    if(probe->enabled && ns) latencyProbeRecordStageAt(probe, LATENCY_STAGE_DECODED, ns);
+}
+static inline void latencyProbeMarkSaved(LatencyProbe *probe)                { if(probe->enabled) latencyProbeRecordStage(probe, LATENCY_STAGE_SAVED); }
+static inline void latencyProbeMarkUIRefreshed(LatencyProbe *probe, uint64_t unshownNs, uint64_t refreshedNs)
+{
+    if(probe->enabled && unshownNs) latencyProbeRecordUIRefreshed(probe, unshownNs, refreshedNs);
+}
+
+//Reads per second for a state, including time spent in it up to now.
+double      latencyProbeStateReadsPerSecond(LatencyProbe *probe, int state);
+
+//Writes a text report of the states given and every stage into text, truncating if needed.
+//Returns the length the full report would have, like snprintf.
+size_t      latencyProbeFormatReport(LatencyProbe *probe, const int *states, const char *const *stateNames, int numStates,
+                                     char *text, size_t size);
+
+#endif /* LatencyProbe_h */
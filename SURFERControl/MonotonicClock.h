@@ -0,0 +1,46 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: MonotonicClock.h                                                          //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module is the one clock that timestamps are taken on throughout the app.   //
+//  Modules that take an injected clock default to monotonicClockNsWithContext, so  //
+//  tests can replace it with one they step by hand.                                //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef MonotonicClock_h
+#define MonotonicClock_h
+
+#include <stdint.h>
+
+//The signature of an injected clock. The context is whatever was passed in along with it.
+typedef uint64_t (*MonotonicClockSource)(void *context);
+
+//Nanoseconds on CLOCK_MONOTONIC.
+uint64_t    monotonicClockNs(void);
+//The same, as a MonotonicClockSource. The context is ignored.
+uint64_t    monotonicClockNsWithContext(void *context);
+
+#endif /* MonotonicClock_h */
@@ -30,34 +30,49 @@
 
 #import <Foundation/Foundation.h>
 
+#import "TagPacketDecoder.h"
+#import "LatencyProbe.h"
+#import "TagStore.h"
+#import "TagSnapshot.h"
+
+//Changes to the tag list are collected and passed on to the delegates in batches, at most once per notificationInterval.
+//Rows inserted in a batch are not repeated in the updated rows of that batch. The delegates are called on the main
+//thread, once the snapshot has moved on to the one with the batch in it.
 @protocol RFIDTagListDelegateTLVC
-- (void)addNewTagToTable:(NSInteger)row;
-- (void)reloadTableTagData;
+- (void)insertTagRows:(NSIndexSet *)insertedRows reloadTagRows:(NSIndexSet *)updatedRows;
 @end
 
 @protocol RFIDTagListDelegateTIVC
-- (void)displayTagInformation;
+- (void)displayTagInformationForChangedRows:(NSIndexSet *)changedRows;
 @optional
 
 @end
 
-@class RFIDTag;
-
 @interface RFIDTagList : NSObject
 
-@property (nonatomic, readonly, copy) NSArray *allRFIDTags; //Provides a copy of the array of RFID tags, not to be manipulated
+@property (nonatomic, readonly) dispatch_queue_t ingestQueue; //Serial queue on which reads are saved. All changes to the list are made on it.
+@property (nonatomic, readonly) const TagSnapshot *snapshot; //Main thread only. The tags as of the last batch handed to the delegates.
 @property (nonatomic,weak) id<RFIDTagListDelegateTLVC> delegateTLVC;
 @property (nonatomic,weak) id<RFIDTagListDelegateTIVC> delegateTIVC;
+@property (nonatomic) NSTimeInterval notificationInterval; //Minimum time between change notifications to the delegates. Defaults to one display frame.
+@property (nonatomic, readonly) LatencyProbe *latencyProbe; //Times reads from notification to display. Disabled unless turned on.
+@property (nonatomic, readonly) TagStore *tagStore; //What each reader has seen of each tag. Reader sessions merge into it.
+@property (nonatomic) BOOL tracking; //Set on the ingest queue. While set, the range and RSSI shown are those of each tag's tracking filter.
 
 + (instancetype)theOnlyRFIDTagListWithDelegateTLVC:(id<RFIDTagListDelegateTLVC>) delegateTLVC; //A class method for either creating or returning the RFID Tag List singleton object
 + (instancetype)theOnlyRFIDTagListWithDelegateTIVC:(id<RFIDTagListDelegateTIVC>) delegateTIVC; //A class method for either creating or returning the RFID Tag List singleton object
 + (instancetype)theOnlyRFIDTagList;
-- (RFIDTag *)createFakeDebugTag; //For debugging, we'll want to generate fake tags at random intervals.
-- (void)clearRFIDTagList;
-- (void)saveTagWithEPC: (NSString *)epc withFreqSlot: (uint8_t)freqSlot //When we get a tag read, we'll want to dump the data
-        withHopNotSkip: (BOOL)hopNotSkip withHopSkipNonce: (uint8_t)hopSkipNonce //This class will take the data and store it in the list of tags.
-           withAntMagI: (int32_t)antMagI withAntMagQ: (int32_t)antMagQ//If the tag is already present, this method will update the
-           withCalMagI: (int32_t)calMagI withCalMagQ: (int32_t)calMagQ;//tag information.
+- (BOOL)createFakeDebugTag; //For debugging, we'll want to generate fake tags at random intervals. Call on the ingest queue.
+//Call on the main thread. The prefix is the first bits bits of the bytes given, as for a variable-length target EPC.
+//Counts the tags in the snapshot, without waiting for reads still being saved.
+- (NSUInteger)countTagsMatchingPrefix:(const uint8_t *)prefix bits:(NSUInteger)bits;
+- (void)clearRFIDTagList; //Call on the main thread. The snapshot is empty when it returns.
+- (void)openReadHistoryInDirectory:(NSString *)directory; //Keeps every read saved from now on in a ReadHistory there. Not cleared with the list.
+- (void)saveTagRead: (const TagRead *)read observation: (const TagStoreObservation *)observation;
+//When we get a tag read, we'll want to dump the data. This class will take the data and store it in the list of tags.
+//If the tag is already present, this method will update the tag information. The observation is the read as already
+//merged into the tag store by the reader session, and the range shown is that of the reader with the best one.
+//Has to be called on the ingest queue.
 
 @end
 
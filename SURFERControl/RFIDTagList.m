@@ -30,12 +30,33 @@
 //////////////////////////////////////////////////////////////////////////////////////
 
 #import "RFIDTagList.h"
-#import "RFIDTag.h"
+#import "EPCIndex.h"
+#import "TagChangeSet.h"
+#import "TagMetrics.h"
+#import "TagRecordArena.h"
+#import "EPCPrefixIndex.h"
+#import "TagTrackFilter.h"
+#import "ReadHistory.h"
+#import "MonotonicClock.h"
 #import <math.h>
 
 @interface RFIDTagList ()
+{
+    TagRecordArena  _tagArena; //The tags themselves, numbered by their row in _tagStore. Only touched on the ingest queue.
+    TagTrackFilterParams    _trackFilterParams;
+    int64_t         _wallClockOffsetNs; //From the clock the packets are stamped with to time since 1970.
+    TagChangeSet    _changeSet; //Rows inserted or updated since the delegates were last notified.
+    BOOL            _changeNotificationScheduled;
+    LatencyProbe    _latencyProbe; //The packet handlers mark the earlier stages, the tag list marks saved and UI refreshed.
+    TagStore        _tagStore;
+    TagSnapshotPublisher    _snapshotPublisher; //Written on the ingest queue along with _tagArena.
+    TagSnapshot             *_snapshot; //The one the main thread is showing. Only touched on the main thread.
+    EPCPrefixIndex          _prefixIndex; //The EPCs of its rows, for finding the tags in a group. Main thread only too.
+    uint32_t                _numRowsIndexed; //Rows of it already in _prefixIndex.
+    ReadHistory             _readHistory; //Only open if asked for. Lives on the ingest queue.
+}
 
-@property (nonatomic) NSMutableArray *privateRFIDTags;
+- (void)deliverInsertedRows:(NSIndexSet *)inserted updatedRows:(NSIndexSet *)updated;
 
 @end
 
@@ -105,26 +126,116 @@ static RFIDTagList *theOnlyRFIDTagList; //Only want one of these so keep it out
     self = [super init];
     
     if(self) {
-        _privateRFIDTags = [[NSMutableArray alloc] init];
+        tagChangeSetInit(&_changeSet, TAG_CHANGE_SET_DEFAULT_INTERVAL_NS, NULL, NULL);
+        _changeNotificationScheduled = NO;
+        latencyProbeInit(&_latencyProbe, NULL, NULL);
+        tagTrackFilterDefaultParams(&_trackFilterParams);
+        if(!tagStoreInit(&_tagStore) || !tagSnapshotPublisherInit(&_snapshotPublisher) || !tagRecordArenaInit(&_tagArena)
+           || !epcPrefixIndexInit(&_prefixIndex)){
+            return nil;
+        }
+        _wallClockOffsetNs = (int64_t)([[NSDate date] timeIntervalSince1970]*1e9) - (int64_t)monotonicClockNs();
+        _snapshot = tagSnapshotAcquire(&_snapshotPublisher);
+        _ingestQueue = dispatch_queue_create("SURFERControl.ingest", DISPATCH_QUEUE_SERIAL);
     }
     
     return self;
 }
 
+- (void)dealloc
+{
+    tagChangeSetFree(&_changeSet);
+    tagStoreFree(&_tagStore);
+    tagRecordArenaFree(&_tagArena);
+    epcPrefixIndexFree(&_prefixIndex);
+    readHistoryClose(&_readHistory);
+    tagSnapshotRelease(_snapshot);
+    tagSnapshotPublisherFree(&_snapshotPublisher);
+}
+
+- (NSTimeInterval)notificationInterval
+{
+    return _changeSet.intervalNs/1e9;
+}
+
+- (void)setNotificationInterval:(NSTimeInterval)notificationInterval
+{
+    _changeSet.intervalNs = (uint64_t)(MAX(notificationInterval,0)*1e9);
+}
+
+- (LatencyProbe *)latencyProbe
+{
+    return &_latencyProbe;
+}
+
+- (TagStore *)tagStore
+{
+    return &_tagStore;
+}
+
+- (const TagSnapshot *)snapshot
+{
+    return _snapshot;
+}
+
 //Here is the function to clear the list of RFID tags
+//We wait for the ingest queue so that the table can be emptied straight away. A batch of changes that was already on
+//its way to the main thread is dropped when it gets there, since its snapshot is older than the empty one.
 
 -(void)clearRFIDTagList
 {
-    if(self) {
-        _privateRFIDTags = [[NSMutableArray alloc] init];
-    }
+    __block TagSnapshot *snapshot;
+    
+    dispatch_sync(_ingestQueue, ^{
+        tagRecordArenaClear(&self->_tagArena);
+        tagChangeSetReset(&self->_changeSet);
+        tagStoreClear(&self->_tagStore);
+        tagSnapshotPublisherClear(&self->_snapshotPublisher);
+        tagSnapshotPublish(&self->_snapshotPublisher);
+        snapshot = tagSnapshotAcquire(&self->_snapshotPublisher);
+    });
+    epcPrefixIndexClear(&_prefixIndex);
+    _numRowsIndexed = 0;
+    [self showSnapshot:snapshot];
+}
+
+//The history is opened on the ingest queue, so that it only sees reads in the order they were saved.
+
+- (void)openReadHistoryInDirectory:(NSString *)directory
+{
+    dispatch_async(_ingestQueue, ^{
+        const char *path = [directory fileSystemRepresentation];
+        
+        if(readHistoryIsOpen(&self->_readHistory)){
+            return;
+        }
+        if(!readHistoryOpen(&self->_readHistory, path, READ_HISTORY_DEFAULT_SEGMENT_RECORDS, READ_HISTORY_DEFAULT_MAX_SEGMENTS, false)){
+            NSLog(@"Could not open the read history in %s", path);
+        }
+    });
 }
 
-//Here is the function to return a copy of the array of tags
+//Main thread only. Takes over the reference to the snapshot. Returns NO, and lets it go, if it is older than the one
+//already showing, which happens to batches that were on their way when the list was cleared.
+//Rows are only ever added to the snapshot, and their EPCs don't change, so only the new ones go in the prefix index. If
+//the index can't grow, the rest go in with a later snapshot.
 
--(NSArray *)allRFIDTags
+- (BOOL)showSnapshot:(TagSnapshot *)snapshot
 {
-    return [self.privateRFIDTags copy];
+    if(snapshot->version < _snapshot->version){
+        tagSnapshotRelease(snapshot);
+        return NO;
+    }
+    tagSnapshotRelease(_snapshot);
+    _snapshot = snapshot;
+    
+    for(; _numRowsIndexed < snapshot->numRows; _numRowsIndexed++){
+        if(!epcPrefixIndexInsert(&_prefixIndex, snapshot->rows[_numRowsIndexed].epcBytes, _numRowsIndexed)){
+            break;
+        }
+    }
+    
+    return YES;
 }
 
 //Below is the main function we'll use when taking in a packet from the bluetooth interface and converting it into
@@ -132,256 +243,372 @@ static RFIDTagList *theOnlyRFIDTagList; //Only want one of these so keep it out
 //1. Act differently depending on whether the packet is a hop or skip.
 //2. Translate I and Q magnitude to an RSSI value in dBm.
 //3. Translate I and Q magnitude to a phase between 0 and pi.
-//4. Compute PDOA range if enough information exists to do so.
+//4. Take the PDOA range from the reader with the best one, or compute it from a hop/skip pair if no reader has one.
 //5. Compute operational frequency from slot value.
 
-- (void)saveTagWithEPC: (NSString *)epc withFreqSlot: (uint8_t)freqSlot //When we get a tag read, we'll want to dump the data
-        withHopNotSkip: (BOOL)hopNotSkip withHopSkipNonce: (uint8_t)hopSkipNonce //This class will take the data and store it in the list of tags.
-           withAntMagI: (int32_t)antMagI withAntMagQ: (int32_t)antMagQ//If the tag is already present, this method will update the
-           withCalMagI: (int32_t)calMagI withCalMagQ: (int32_t)calMagQ//tag information.
+- (void)saveTagRead: (const TagRead *)read observation: (const TagStoreObservation *)observation
 {
-    //First, find the tag we are looking for.
-    RFIDTag *tag = [self findOrCreateActualTagWithEPC:epc];
+    //First, find the tag we are looking for. The tag store has already given it a row.
+    int32_t row = observation->row;
+    TagRecord *tag = [self findOrCreateActualTagWithEPC:read->epc atRow:row timestampNs:observation->timestampNs];
+    if(!tag){
+        NSLog(@"Could not grow the tag list to store a new tag");
+        return;
+    }
     //Next, create useable metrics from the raw values return by the reader.
-    float_t antRSSIdBm  = [self computeTagRSSIFromMagI: antMagI andMagQ: antMagQ];
-    float_t calRSSIdBm  = [self computeTagRSSIFromMagI: calMagI andMagQ: calMagQ];
-    float_t antPhaseDeg = [self computeTagPhaseFromMagI: antMagI andMagQ: antMagQ];
-    float_t calPhaseDeg = [self computeTagPhaseFromMagI: calMagI andMagQ: calMagQ];
-    float_t freqInMHz = [self computeFreqMHzFromSlot: freqSlot];
-    
-    //Next, record the time at which the tag was read
-    
-    tag.lastInterrogation = [[NSDate alloc] init];
-    
-    //Next, enter the data into the tag object
-    if(hopNotSkip){
-        tag.freqHopMHz  =   freqInMHz;
-        tag.magAntHop   =   antRSSIdBm; //This is the data from which tag RSSI is reported.
-        tag.magCalHop   =   calRSSIdBm;
-        tag.phaseAntHop =   antPhaseDeg;
-        tag.phaseCalHop =   calPhaseDeg;
-        tag.nonceHop    =   hopSkipNonce;
+    float_t antRSSIdBm  = observation->rssidBm; //The reader session has already worked this one out.
+    float_t calRSSIdBm  = [self computeTagRSSIFromMagI: read->calMagI andMagQ: read->calMagQ];
+    float_t antPhaseDeg = [self computeTagPhaseFromMagI: read->antMagI andMagQ: read->antMagQ];
+    float_t calPhaseDeg = [self computeTagPhaseFromMagI: read->calMagI andMagQ: read->calMagQ];
+    float_t freqInMHz = [self computeFreqMHzFromSlot: read->freqSlot];
+    
+    //Next, record the time at which the tag was read. This is the time the notification came in, on the monotonic clock.
+    
+    tag->lastSeenNs = observation->timestampNs;
+    
+    //Next, enter the data into the tag record
+    TagRecordMeasurement *measurement = read->hopNotSkip ? &tag->hop : &tag->skip;
+    
+    measurement->pdoa.freqMHz   =   freqInMHz;
+    measurement->magAnt         =   antRSSIdBm; //This is the data from which tag RSSI is reported.
+    measurement->pdoa.magCal    =   calRSSIdBm;
+    measurement->pdoa.phaseAnt  =   antPhaseDeg;
+    measurement->pdoa.phaseCal  =   calPhaseDeg;
+    measurement->pdoa.nonce     =   read->hopSkipNonce;
+    if(read->hopNotSkip){
         //Note that since hop must come first, we clear out the skip data from before
         //However, we don't clear out the computed PDOA range from before
-        tag.freqSkipMHz  =   0;
-        tag.magAntSkip   =   0; //This is the data from which tag RSSI is reported.
-        tag.magCalSkip   =   0;
-        tag.phaseAntSkip =   0;
-        tag.phaseCalSkip =   0;
         //Don't do anything with the nonce. Setting it to 0 may cause bugs.
-    } else {
-        tag.freqSkipMHz  =   freqInMHz;
-        tag.magAntSkip   =   antRSSIdBm; //This is the data from which tag RSSI is reported.
-        tag.magCalSkip   =   calRSSIdBm;
-        tag.phaseAntSkip =   antPhaseDeg;
-        tag.phaseCalSkip =   calPhaseDeg;
-        tag.nonceSkip    =   hopSkipNonce;
-        
-        //Now we also compute PDOA range
-        tag.pdoaRangeMeters = [self computeTagPDOARange:tag];
+        tag->skip.pdoa.freqMHz  =   0;
+        tag->skip.magAnt        =   0;
+        tag->skip.pdoa.magCal   =   0;
+        tag->skip.pdoa.phaseAnt =   0;
+        tag->skip.pdoa.phaseCal =   0;
     }
     
-    //If we have view controllers, update the data
+    //Each reader session keeps a multi-frequency range estimate of the tag from every read with calibration data.
+    //Show the one from whichever reader has the most confident range. Until a reader has two neighboring slots to
+    //work with, fall back to the hop/skip PDOA range.
+    
+    TagStoreRecord  record;
+    uint8_t         bestReader  = TAG_STORE_NO_READER;
     
-    if(self.delegateTLVC){
-        [self.delegateTLVC reloadTableTagData];
+    record.readerMask = 0;
+    if(tagStoreCopyRecord(&_tagStore, observation->row, &record)){
+        bestReader      = tagStoreRecordBestReader(&record);
+        tag->numReaders = (uint8_t)tagStoreRecordNumReaders(&record);
     }
     
-    if(self.delegateTIVC){
-        [self.delegateTIVC displayTagInformation];
+    BOOL            newRange    = NO;
+    
+    if(bestReader != TAG_STORE_NO_READER && record.readers[bestReader].rangeMeters != TAG_METRICS_RANGE_INVALID){
+        tag->rangeMeters        = record.readers[bestReader].rangeMeters;
+        tag->rangeConfidence    = record.readers[bestReader].rangeConfidence;
+        tag->rangeReaderId      = bestReader;
+    } else if(!read->hopNotSkip){
+        //Now we also compute PDOA range. A single hop/skip pair gives no measure of how far to trust it.
+        tag->rangeMeters        = [self computeTagPDOARange:tag];
+        tag->rangeConfidence    = 0;
+        tag->rangeReaderId      = TAG_STORE_NO_READER;
+        newRange                = (tag->hop.pdoa.nonce == tag->skip.pdoa.nonce); //Otherwise the range is the one from before.
+    }
+    
+    //The tracking filter takes every read, so that it is already following the tag when a track starts.
+    //The filter keeps out the 99.9 sentinel, outliers and a second range from the same hop/skip pair.
+    //Each reader has its own RSSI for the tag and its own hop/skip nonces, so the filter only follows one reader at a
+    //time. It stays with that reader while the reader keeps seeing the tag, rather than starting over whenever another
+    //reader's range is a little more confident, and moves to the best reader once it stops.
+    
+    uint8_t trackReader = tag->trackReaderId;
+    
+    if(trackReader == TAG_STORE_NO_READER || !(record.readerMask & (1u << trackReader))
+       || record.readers[trackReader].lastSeenNs + _trackFilterParams.maxGapNs < observation->timestampNs){
+        trackReader = tag->rangeReaderId;
+    }
+    if(trackReader != tag->trackReaderId){
+        tagTrackFilterInit(&tag->track);
+        tag->trackReaderId = trackReader;
+    }
+    
+    if(trackReader == TAG_STORE_NO_READER){
+        tagTrackFilterUpdateRSSI(&tag->track, &_trackFilterParams, antRSSIdBm, observation->timestampNs);
+        if(newRange){
+            tagTrackFilterUpdatePairRange(&tag->track, &_trackFilterParams, tag->rangeMeters, read->hopSkipNonce,
+                                          observation->timestampNs);
+        }
+    } else if(observation->readerId == trackReader){
+        tagTrackFilterUpdateRSSI(&tag->track, &_trackFilterParams, antRSSIdBm, observation->timestampNs);
+        if(observation->rangeUpdated && observation->rangeMeters != TAG_METRICS_RANGE_INVALID){
+            tagTrackFilterUpdateRange(&tag->track, &_trackFilterParams, observation->rangeMeters, observation->timestampNs);
+        }
+    }
+    
+    //Keep the read as it came in, along with what was worked out from it, if the history is being recorded.
+    //After a failed write, e.g. a full disk, stop recording rather than failing on every read.
+    
+    if(readHistoryIsOpen(&_readHistory)
+       && !readHistoryAppend(&_readHistory, read, observation->timestampNs + _wallClockOffsetNs,
+                             antRSSIdBm, antPhaseDeg, tag->rangeMeters)){
+        NSLog(@"Could not write to the read history, so it has been closed");
+        readHistoryClose(&_readHistory);
     }
+    
+    //If we have view controllers, update the data.
+    //Rather than reloading for every read, note the row and let the view controllers know about it on the next batch.
+    
+    [self updateSnapshotRow:row fromTag:tag];
+    tagChangeSetMarkUpdated(&_changeSet, (uint32_t)row);
+    latencyProbeMarkSaved(&_latencyProbe);
+    [self scheduleChangeNotification];
 }
 
-//Method to find the tag we are looking for in the RFID tag list. If the tag isn't there, create it.
--(RFIDTag *)findOrCreateActualTagWithEPC: (NSString *)epc
+//This is where a batch of changes is turned into index sets of table rows, on the ingest queue.
+
+static void rfidTagListDeliverChanges(const uint32_t *insertedRows, uint32_t numInsertedRows,
+                                      const uint32_t *updatedRows, uint32_t numUpdatedRows, void *context)
 {
-    for(RFIDTag *tag in self.privateRFIDTags){
-        //If the tag EPC is in the list, return it.
-        if([tag.epc isEqualToString:epc]){
-            return tag;
-        }
+    RFIDTagList         *tagList    =   (__bridge RFIDTagList *)context;
+    NSMutableIndexSet   *inserted   =   [[NSMutableIndexSet alloc] init];
+    NSMutableIndexSet   *updated    =   [[NSMutableIndexSet alloc] init];
+    
+    for(uint32_t i=0; i<numInsertedRows; i++){
+        [inserted addIndex:insertedRows[i]];
     }
-    //If we go through the list and there was no such tag, create the tag
-    RFIDTag *tag=[[RFIDTag alloc] initTagWithEPC:epc];
-    //And add it to the collection of tags
-    [self.privateRFIDTags addObject:tag];
-    //And add a row to the TagListViewController, if it's been instantiated.
-    if(self.delegateTLVC){
-        [self.delegateTLVC addNewTagToTable:[self.privateRFIDTags indexOfObject:tag]];
+    for(uint32_t i=0; i<numUpdatedRows; i++){
+        [updated addIndex:updatedRows[i]];
     }
-    //Then return this
-    return tag;
+    
+    [tagList deliverInsertedRows:inserted updatedRows:updated];
 }
 
-//And when we want to create a random item for testing out the code, we do it here.
+//Only a batch that goes out gets a new snapshot, so the snapshot the main thread shows always has exactly the rows the
+//view controllers have been told about. Cells all read from that one snapshot, so nothing is copied per cell.
 
--(RFIDTag *)createFakeDebugTag
+- (void)deliverInsertedRows:(NSIndexSet *)inserted updatedRows:(NSIndexSet *)updated
 {
-    RFIDTag *tag = [RFIDTag fakeDebugTag];
-    [self.privateRFIDTags addObject:tag];
+    LatencyProbe    *probe      = &_latencyProbe;
+    uint64_t        unshownNs   = latencyProbeTakeUnshown(probe);
     
-    return tag;
+    tagSnapshotPublish(&_snapshotPublisher);
+    TagSnapshot     *snapshot   = tagSnapshotAcquire(&_snapshotPublisher);
+    
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if(![self showSnapshot:snapshot]){
+            return;
+        }
+        
+        if(self.delegateTLVC){
+            [self.delegateTLVC insertTagRows:inserted reloadTagRows:updated];
+        }
+        
+        if(self.delegateTIVC){
+            NSMutableIndexSet *changed = [updated mutableCopy];
+            [changed addIndexes:inserted];
+            [self.delegateTIVC displayTagInformationForChangedRows:changed];
+        }
+        
+        //The probe belongs to the ingest queue, so the time the batch was shown is recorded over there.
+        uint64_t refreshedNs = latencyProbeNow(probe);
+        if(unshownNs){
+            dispatch_async(self.ingestQueue, ^{
+                latencyProbeMarkUIRefreshed(probe, unshownNs, refreshedNs);
+            });
+        }
+    });
 }
 
-//Compute the phase of the I/Q magnitudes. Return a value that's between 0 and pi.
+//A burst of reads only results in one notification to the view controllers per notification interval.
+//If a notification is already on its way, the rows we just marked will go out with it.
 
--(float_t)computeTagRSSIFromMagI: (int32_t) magI andMagQ: (int32_t) magQ
+- (void)scheduleChangeNotification
 {
-    #define PCEPC_ACK_BITS 128.0  //The number of received data bits in the packet to be used for computing RSSI.
-    #define MILLER_M 8.0          //Miller modulation index. Currently we have it set to 8, the maximum.
-    #define DBE_OSR 24.0         //The oversampling ratio of the digital back end (4.5MHz for tag BLE of 187.5kHz)
-    #define RCVR_GAIN_DB 131.5
-    
-    float_t rssiInWatts          = 0;
-    float_t rssiIndBm            = 0;
-    float_t nChipsPerPacket     = PCEPC_ACK_BITS * MILLER_M * DBE_OSR;
-    float_t receiverPowerGain   = 50.0*(64.0/(pow(M_PI,4)))*pow(10,RCVR_GAIN_DB/10);
+    if(_changeNotificationScheduled){
+        return;
+    }
     
-    rssiInWatts = (1/receiverPowerGain)*(pow(magI/nChipsPerPacket,2)+pow(magQ/nChipsPerPacket,2));
+    _changeNotificationScheduled = YES;
     
-    rssiIndBm   =  10*log10f(rssiInWatts)+30;
+    __weak RFIDTagList *weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)tagChangeSetTimeUntilFlush(&_changeSet)), _ingestQueue, ^{
+        [weakSelf flushChangeNotification];
+    });
+}
+
+- (void)flushChangeNotification
+{
+    _changeNotificationScheduled = NO;
     
-    return rssiIndBm;
+    tagChangeSetFlush(&_changeSet, rfidTagListDeliverChanges, (__bridge void *)self);
     
+    //In case the timer came back a little early, try again.
+    if(tagChangeSetHasChanges(&_changeSet)){
+        [self scheduleChangeNotification];
+    }
 }
 
--(float_t)computeTagPhaseFromMagI: (int32_t) magI andMagQ: (int32_t) magQ
+//Method to find the tag we are looking for in the RFID tag list. If the tag isn't there, create it.
+//The row is the one the tag store gave the tag, so we don't have to look the EPC up again here.
+-(TagRecord *)findOrCreateActualTagWithEPC: (const uint8_t *)epc atRow: (int32_t)row timestampNs: (uint64_t)timestampNs
 {
-    //We know that the minus sign is wrong but we realized late in the game that the SX1257
-    //I and Q RX ADC outputs are misnamed (I and Q are switched).
-    //Rather than going through and renaming everything, since the only angle-dependent feature
-    //of the system (as of 110920) is this, we just compensate for this by adding a minus sign
-    //in the angle calculation.
-    return fmod(atan(-(double)magQ/(double)magI)+M_PI,M_PI);
+    if(row == EPC_INDEX_NOT_FOUND){
+        return NULL;
+    }
+    //If the tag EPC is in the list, return it.
+    if((uint32_t)row < tagRecordArenaCount(&_tagArena)){
+        return tagRecordArenaGet(&_tagArena, (uint32_t)row);
+    }
+    //If there was no such tag, create the tag. The store hands out rows in the order tags were first seen and every read
+    //it takes comes here, so a new tag is always the next record, unless the arena couldn't grow for an earlier one.
+    if((uint32_t)row != tagRecordArenaCount(&_tagArena) || !tagRecordArenaReserve(&_tagArena)){
+        return NULL;
+    }
+    TagRecord *tag = tagRecordArenaAdd(&_tagArena, epc, timestampNs);
+    [self addSnapshotRow:row forTag:tag];
+    //And add a row to the TagListViewController on the next batch of changes.
+    tagChangeSetMarkInserted(&_changeSet, (uint32_t)row);
+    //Then return this
+    return tag;
 }
 
-//Compute the range of the tag from the antenna using the PDOA technique.
+//And when we want to create a random item for testing out the code, we do it here.
 
--(float_t)computeTagPDOARange: (RFIDTag *)tag
+-(BOOL)createFakeDebugTag
 {
-    #define SPEED_LIGHT_VAC 299792458
-    #define ER_PCB 4.2 //Will need to change to 4.2 for actual operation
-    #define ER_CAB 2.0 //Need to check if this is PTFE or not. Same for cable and connector. Will need to change for actual operation (2.0).
-    #define ANT_PCB_ROUTE_M 0.0095
-    #define ANT_CAB_ROUTE_M 0.2286
-    #define CAL_PCB_ROUTE_M 0.0095
-    #define CAL_CAB_ROUTE_M 0.254
-    
-    //#define CAL_PCB_ROUTE_M 0.0292
-    //#define CAL_CAB_ROUTE_M 0.0254
-    
-    float_t ant_known_phase_hop = 0.0;
-    float_t ant_known_phase_skip = 0.0;
-    float_t cal_known_phase_hop = 0.0;
-    float_t cal_known_phase_skip = 0.0;
-    float_t corrected_phase_hop = 0.0;
-    float_t corrected_phase_skip = 0.0;
-    
-    //First thing is we need to determine whether or not we can compute the range.
-    //What are the cases in which we should fail (return a dummy value that can be tested for)?
-    //1. Hop/skip nonce don't match
-    //2. No skip data (skip data is nil'd out).
-    //3. Frequency difference between hop and skip is less than 3.1MHz (otherwise it causes aliasing at range with a big patch antenna.
-    
-    if(tag.nonceHop != tag.nonceSkip){
-        return tag.pdoaRangeMeters; //If the nonces don't match, don't update the range.
-        //In rare cases, there may be a bug in which the nonces wrap around but we imagine that will be rare enough to be acceptable.
-    }
+    TagStoreObservation observation = {{0}, TAG_STORE_DEBUG_READER, false, -60, TAG_METRICS_RANGE_INVALID, 0, monotonicClockNs(), 0, 0};
+    int32_t             row;
     
-    if(!tag.phaseAntHop || !tag.phaseAntSkip || !tag.phaseCalHop || !tag.phaseCalSkip
-       || !tag.freqHopMHz || !tag.freqSkipMHz || tag.magCalHop < -70 || tag.magCalSkip < -70){
-        NSLog(@"Attempted to compute PDOA ranging for a tag with incomplete phase data");
-        //Note that if the returned calibration RSSI is too low, phase data is likely also invalid.
-        return 99.9;
-    }
-
-    if(fabsf(tag.freqHopMHz - tag.freqSkipMHz) > 3.1){
-        NSLog(@"Attempted to compute PDOA ranging for a tag with too large of a hop/skip frequency delta");
-        return 99.9;
-    }
+    //The tag goes through the store like a real one, so that it has a row there.
+    arc4random_buf(observation.epc, sizeof(observation.epc));
+    tagStoreMerge(&_tagStore, &observation, 1);
+    row = observation.row;
     
-    if(fabsf(tag.freqHopMHz - tag.freqSkipMHz) < 0.9){
-        NSLog(@"Attempted to compute PDOA ranging for a tag with too small of a hop/skip frequency delta");
-        return 99.9;
+    TagRecord *tag = [self findOrCreateActualTagWithEPC:observation.epc atRow:row timestampNs:observation.timestampNs];
+    if(!tag){
+        return NO;
     }
     
-    //Second thing is we need to compute the phase of the signal on the PCB/cabling that is not part of a shared path.
-    //In other words, we wish to compute the distance of the antenna to the tag, but both the antenna and calibration device
-    //exist at finite and known distances from the RF receiver.
-    
-    //For the moment, we're going to try a calibration device being a tag that sits right outside of the antenna.
-    //We'll leave the distance between the antenna and the tag as an error for the moment.
-    
-    //4 Pi is actually 2*2pi, the 2 coming from out and back phase changes.
-    
-    ant_known_phase_hop =
-    fmod(4.0*M_PI*tag.freqHopMHz*(1e6)*(ANT_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+ANT_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB))),M_PI);
-    ant_known_phase_skip=
-    fmod(4.0*M_PI*tag.freqSkipMHz*(1e6)*(ANT_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+ANT_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB))),M_PI);
-    cal_known_phase_hop =
-    fmod(4.0*M_PI*tag.freqHopMHz*(1e6)*(ANT_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+ANT_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB))),M_PI);
-    //fmod(4.0*M_PI*tag.freqHopMHz*(1e6)*(CAL_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+CAL_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB))),M_PI);
-    
-    cal_known_phase_skip =
-    fmod(4.0*M_PI*tag.freqSkipMHz*(1e6)*(ANT_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+ANT_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB))),M_PI);
-    //fmod(4.0*M_PI*tag.freqSkipMHz*(1e6)*(CAL_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+CAL_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB))),M_PI);
-    
-    //Third thing is that we need to compute the corrected hop frequency phase and the corrected skip frequency phase.
-    //Because TX and RX phase in the receiver varies randomly with respect to each other, and because the SAW filter
-    //phase varies all over the place, the calibration phase must be removed from the antenna phase
-    
-    corrected_phase_hop     =   fmod((tag.phaseAntHop - tag.phaseCalHop) - (ant_known_phase_hop - cal_known_phase_hop)+2*M_PI,M_PI);
-    corrected_phase_skip    =   fmod((tag.phaseAntSkip - tag.phaseCalSkip) - (ant_known_phase_skip - cal_known_phase_skip)+2*M_PI,M_PI);
+    tag->hop.pdoa.freqMHz       = 902.5+(arc4random() % 24);
+    tag->hop.magAnt             = -30-(50*(double)arc4random()/UINT32_MAX);
+    tag->hop.pdoa.phaseAnt      = 3.14*(double)arc4random()/UINT32_MAX;
+    tag->hop.pdoa.magCal        = -30-(50*(double)arc4random()/UINT32_MAX);
+    tag->hop.pdoa.phaseCal      = 3.14*(double)arc4random()/UINT32_MAX;
+    tag->hop.pdoa.nonce         = 0; //This nonce is to help the pdoa calculation determine how close the hop and skip are in time.
+    tag->skip.pdoa.freqMHz      = tag->hop.pdoa.freqMHz+1;
+    tag->skip.magAnt            = -30-(50*(double)arc4random()/UINT32_MAX);
+    tag->skip.pdoa.phaseAnt     = 3.14*(double)arc4random()/UINT32_MAX;
+    tag->skip.pdoa.magCal       = -30-(50*(double)arc4random()/UINT32_MAX);
+    tag->skip.pdoa.phaseCal     = 3.14*(double)arc4random()/UINT32_MAX;
+    tag->skip.pdoa.nonce        = 0;
+    tag->rangeMeters            = 10*(double)arc4random()/UINT32_MAX;
+    tag->rangeConfidence        = (double)arc4random()/UINT32_MAX;
+    tag->lastSeenNs             = tag->firstSeenNs;
+    [self updateSnapshotRow:row fromTag:tag];
+    
+    return YES;
+}
+
+//Tag groups are looked up in the prefix index, so this doesn't walk the whole list, and the main thread never waits on
+//the ingest queue for it.
+
+- (NSUInteger)countTagsMatchingPrefix:(const uint8_t *)prefix bits:(NSUInteger)bits
+{
+    return epcPrefixIndexCount(&_prefixIndex, prefix, (uint32_t)MIN(bits, (NSUInteger)EPC_PREFIX_INDEX_MAX_BITS));
+}
+
+//The snapshot rows are what the view controllers show, so they are kept up to date along with the tag records.
+//The EPC and first time seen don't change, so they only go in when the tag is added.
+
+-(void)addSnapshotRow: (int32_t)row forTag: (const TagRecord *)tag
+{
+    TagSnapshotRow *snapshotRow = tagSnapshotPublisherEditRow(&_snapshotPublisher, (uint32_t)row);
     
-    //Fourth thing is to finally subtract the hop and skip phases from one another
-    //Div by 4 is for out and back phase change, otherwise it would just be 2*pi.
+    if(!snapshotRow){
+        NSLog(@"Could not grow the tag list snapshot");
+        return;
+    }
+    tagReadFormatEPC(tag->epc, snapshotRow->epc);
+    memcpy(snapshotRow->epcBytes, tag->epc, TAG_EPC_NUM_BYTES);
+    snapshotRow->firstSeen = [self secondsSince1970FromMonotonicNs:tag->firstSeenNs];
+    [self updateSnapshotRow:row fromTag:tag];
+}
+
+-(void)updateSnapshotRow: (int32_t)row fromTag: (const TagRecord *)tag
+{
+    TagSnapshotRow *snapshotRow = tagSnapshotPublisherEditRow(&_snapshotPublisher, (uint32_t)row);
     
-    if(tag.freqHopMHz > tag.freqSkipMHz){
-        return SPEED_LIGHT_VAC/4/M_PI/((tag.freqHopMHz - tag.freqSkipMHz)*(1e6))*fmod(corrected_phase_hop-corrected_phase_skip+2*M_PI,M_PI);
-    } else {
-        return SPEED_LIGHT_VAC/4/M_PI/((tag.freqSkipMHz - tag.freqHopMHz)*(1e6))*fmod(corrected_phase_skip-corrected_phase_hop+2*M_PI,M_PI);
+    if(!snapshotRow){
+        return;
     }
+    snapshotRow->rssidBm            = tag->hop.magAnt;
+    snapshotRow->rangeMeters        = tag->rangeMeters;
+    snapshotRow->rangeConfidence    = tag->rangeConfidence;
+    snapshotRow->rangeRateMetersPerSecond = 0;
+    //While tracking, show the smoothed values instead, once the filter has them.
+    if(_tracking && tag->track.rssi.numUpdates){
+        snapshotRow->rssidBm        = tag->track.rssi.value;
+    }
+    snapshotRow->rangeReaderId      = tag->rangeReaderId;
+    if(_tracking && tag->track.range.numUpdates){
+        snapshotRow->rangeMeters    = tag->track.range.value;
+        snapshotRow->rangeRateMetersPerSecond = tag->track.range.rate;
+        snapshotRow->rangeReaderId  = tag->trackReaderId;
+    }
+    snapshotRow->numReaders         = tag->numReaders;
+    snapshotRow->lastSeen           = tag->lastSeenNs ? [self secondsSince1970FromMonotonicNs:tag->lastSeenNs] : 0;
 }
 
-//Compute the frequency of the tag read from the frequency slot
+-(double)secondsSince1970FromMonotonicNs: (uint64_t)timestampNs
+{
+    return ((int64_t)timestampNs + _wallClockOffsetNs)/1e9;
+}
 
--(float_t)computeFreqMHzFromSlot: (uint8_t)slot
+//The formulas for RSSI, phase and PDOA range live in TagMetrics, where the constant parts are only worked out once.
+
+-(float_t)computeTagRSSIFromMagI: (int32_t) magI andMagQ: (int32_t) magQ
 {
-    float_t freqMHz = 0.0;
-    
-    switch (slot){
-        case 0:     freqMHz = 903.0; break;
-        case 1:     freqMHz = 904.0; break;
-        case 2:     freqMHz = 905.0; break;
-        case 3:     freqMHz = 906.0; break;
-        case 4:     freqMHz = 907.0; break;
-        case 5:     freqMHz = 908.0; break;
-        case 6:     freqMHz = 909.0; break;
-        case 7:     freqMHz = 910.0; break;
-        case 8:     freqMHz = 911.0; break;
-        case 9:     freqMHz = 912.0; break;
-        case 10:    freqMHz = 913.0; break;
-        case 11:    freqMHz = 914.0; break;
-        case 12:    freqMHz = 915.0; break;
-        case 13:    freqMHz = 916.0; break;
-        case 14:    freqMHz = 917.0; break;
-        case 15:    freqMHz = 918.0; break;
-        case 16:    freqMHz = 919.0; break;
-        case 17:    freqMHz = 920.0; break;
-        case 18:    freqMHz = 921.0; break;
-        case 19:    freqMHz = 922.0; break;
-        case 20:    freqMHz = 923.0; break;
-        case 21:    freqMHz = 924.0; break;
-        case 22:    freqMHz = 925.0; break;
-        case 23:    freqMHz = 926.0; break;
-        case 24:    freqMHz = 927.0; break;
-        default:    freqMHz = 915.0; break;
-    }
+    return tagMetricsRSSIdBm(magI, magQ);
+}
+
+//Compute the phase of the I/Q magnitudes. Return a value that's between 0 and pi.
+
+-(float_t)computeTagPhaseFromMagI: (int32_t) magI andMagQ: (int32_t) magQ
+{
+    return tagMetricsPhase(magI, magQ);
+}
 
-    return freqMHz;
+//Compute the range of the tag from the antenna using the PDOA technique.
+
+-(float_t)computeTagPDOARange: (const TagRecord *)tag
+{
+    float               range   = tag->rangeMeters;
+    
+    switch(tagMetricsPDOARange(&tag->hop.pdoa, &tag->skip.pdoa, &range)){
+        case TAG_PDOA_NONCE_MISMATCH:
+            //If the nonces don't match, don't update the range.
+            //In rare cases, there may be a bug in which the nonces wrap around but we imagine that will be rare enough to be acceptable.
+            break;
+        case TAG_PDOA_INCOMPLETE_DATA:
+            NSLog(@"Attempted to compute PDOA ranging for a tag with incomplete phase data");
+            //Note that if the returned calibration RSSI is too low, phase data is likely also invalid.
+            break;
+        case TAG_PDOA_DELTA_TOO_LARGE:
+            NSLog(@"Attempted to compute PDOA ranging for a tag with too large of a hop/skip frequency delta");
+            break;
+        case TAG_PDOA_DELTA_TOO_SMALL:
+            NSLog(@"Attempted to compute PDOA ranging for a tag with too small of a hop/skip frequency delta");
+            break;
+        default:
+            break;
+    }
     
+    return range;
 }
 
+//Compute the frequency of the tag read from the frequency slot
 
+-(float_t)computeFreqMHzFromSlot: (uint8_t)slot
+{
+    return tagMetricsFreqMHzFromSlot(slot);
+}
 
 @end
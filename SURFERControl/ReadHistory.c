@@ -0,0 +1,750 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: ReadHistory.c                                                             //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module keeps a history of every decoded tag read on disk, for offline      //
+//  analysis. Reads go into fixed-size segment files of fixed-width columns, which  //
+//  are memory mapped and only ever appended to. The oldest segments are deleted    //
+//  past a retention limit. An index in memory lists the reads of each tag in time  //
+//  order, so the reads of one tag in a time window are found without a full scan.  //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ReadHistory.h"
+
+#define READ_HISTORY_INITIAL_TAG_CAPACITY   256
+#define READ_HISTORY_INITIAL_TAG_READS      16
+
+static void readHistorySegmentPath(const ReadHistory *history, uint64_t sequence, char *path)
+{
+    snprintf(path, READ_HISTORY_PATH_BYTES, "%s/history-%010llu.srfh", history->directory, (unsigned long long)sequence);
+}
+
+static size_t readHistorySegmentBytes(uint32_t segmentRecords)
+{
+    return READ_HISTORY_HEADER_BYTES + (size_t)segmentRecords*READ_HISTORY_RECORD_BYTES;
+}
+
+static ReadHistorySegment *readHistorySegmentSlot(ReadHistory *history, uint64_t sequence)
+{
+    return &history->segments[sequence % history->maxSegments];
+}
+
+static void readHistoryWriteHeader(uint8_t *bytes, const char *magic, uint16_t headerBytes)
+{
+    uint16_t    version = READ_HISTORY_VERSION;
+    uint32_t    mark    = READ_HISTORY_BYTE_ORDER_MARK;
+    
+    memcpy(bytes, magic, 8);
+    memcpy(bytes+8, &version, 2);
+    memcpy(bytes+10, &headerBytes, 2);
+    memcpy(bytes+12, &mark, 4);
+}
+
+static bool readHistoryCheckHeader(const uint8_t *bytes, const char *magic, uint16_t headerBytes)
+{
+    uint8_t expected[16];
+    
+    readHistoryWriteHeader(expected, magic, headerBytes);
+    
+    return memcmp(bytes, expected, sizeof(expected)) == 0;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Tags
+
+//Makes room for one more tag ID in the arrays kept for each tag.
+static bool readHistoryReserveTag(ReadHistory *history)
+{
+    uint32_t            capacity;
+    uint8_t             *epcs;
+    ReadHistoryTagReads *tagReads;
+    
+    if(history->numTags < history->tagCapacity){
+        return true;
+    }
+    capacity = history->tagCapacity ? 2*history->tagCapacity : READ_HISTORY_INITIAL_TAG_CAPACITY;
+    
+    epcs = realloc(history->epcs, (size_t)capacity*TAG_EPC_NUM_BYTES);
+    if(!epcs){
+        return false;
+    }
+    history->epcs = epcs;
+    
+    tagReads = realloc(history->tagReads, (size_t)capacity*sizeof(ReadHistoryTagReads));
+    if(!tagReads){
+        return false;
+    }
+    memset(tagReads+history->tagCapacity, 0, (size_t)(capacity-history->tagCapacity)*sizeof(ReadHistoryTagReads));
+    history->tagReads       = tagReads;
+    history->tagCapacity    = capacity;
+    
+    return true;
+}
+
+//Gives the EPC the next tag ID, in memory only.
+static uint32_t readHistoryAddTag(ReadHistory *history, const uint8_t *epc)
+{
+    bool        inserted;
+    int32_t     row;
+    
+    if(!readHistoryReserveTag(history)){
+        return READ_HISTORY_NO_TAG;
+    }
+    row = epcIndexFindOrInsert(&history->epcIndex, epc, &inserted);
+    if(row == EPC_INDEX_NOT_FOUND){
+        return READ_HISTORY_NO_TAG;
+    }
+    if(inserted){
+        memcpy(history->epcs + (size_t)row*TAG_EPC_NUM_BYTES, epc, TAG_EPC_NUM_BYTES);
+        history->numTags++;
+    }
+    
+    return (uint32_t)row;
+}
+
+static bool readHistoryAddPosition(ReadHistoryTagReads *tagReads, uint64_t position)
+{
+    if(tagReads->count == tagReads->capacity){
+        uint32_t    capacity    = tagReads->capacity ? 2*tagReads->capacity : READ_HISTORY_INITIAL_TAG_READS;
+        uint64_t    *positions  = realloc(tagReads->positions, (size_t)capacity*sizeof(uint64_t));
+        
+        if(!positions){
+            return false;
+        }
+        tagReads->positions = positions;
+        tagReads->capacity  = capacity;
+    }
+    tagReads->positions[tagReads->count++] = position;
+    
+    return true;
+}
+
+//Loads the EPC of every tag ID. A tag written only in part, if the app was killed in the middle of it, is dropped.
+static bool readHistoryLoadEPCs(ReadHistory *history)
+{
+    char        path[READ_HISTORY_PATH_BYTES];
+    uint8_t     header[READ_HISTORY_EPC_HEADER_BYTES];
+    uint8_t     epc[TAG_EPC_NUM_BYTES];
+    struct stat st;
+    
+    snprintf(path, sizeof(path), "%s/epcs.srfh", history->directory);
+    history->epcFile = open(path, history->readOnly ? O_RDONLY : O_RDWR|O_CREAT, 0644);
+    if(history->epcFile < 0 || fstat(history->epcFile, &st) != 0){
+        return false;
+    }
+    
+    if(st.st_size == 0 && !history->readOnly){
+        readHistoryWriteHeader(header, READ_HISTORY_EPC_MAGIC, READ_HISTORY_EPC_HEADER_BYTES);
+        return pwrite(history->epcFile, header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    }
+    if(pread(history->epcFile, header, sizeof(header), 0) != (ssize_t)sizeof(header)
+       || !readHistoryCheckHeader(header, READ_HISTORY_EPC_MAGIC, READ_HISTORY_EPC_HEADER_BYTES)){
+        return false;
+    }
+    
+    for(off_t offset = READ_HISTORY_EPC_HEADER_BYTES; offset+TAG_EPC_NUM_BYTES <= st.st_size; offset += TAG_EPC_NUM_BYTES){
+        if(pread(history->epcFile, epc, TAG_EPC_NUM_BYTES, offset) != TAG_EPC_NUM_BYTES
+           || readHistoryAddTag(history, epc) == READ_HISTORY_NO_TAG){
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Segments
+
+static void readHistoryMapColumns(ReadHistorySegment *segment, uint32_t n)
+{
+    uint8_t *column = segment->base + READ_HISTORY_HEADER_BYTES;
+    
+    segment->numRecords     = (uint32_t *)(segment->base+20);
+    segment->timestampNs    = (uint64_t *)column;   column += 8*(size_t)n;
+    segment->tagId          = (uint32_t *)column;   column += 4*(size_t)n;
+    segment->antMagI        = (int32_t *)column;    column += 4*(size_t)n;
+    segment->antMagQ        = (int32_t *)column;    column += 4*(size_t)n;
+    segment->calMagI        = (int32_t *)column;    column += 4*(size_t)n;
+    segment->calMagQ        = (int32_t *)column;    column += 4*(size_t)n;
+    segment->rssidBm        = (float *)column;      column += 4*(size_t)n;
+    segment->phaseRad       = (float *)column;      column += 4*(size_t)n;
+    segment->rangeMeters    = (float *)column;      column += 4*(size_t)n;
+    segment->freqSlot       = column;               column += n;
+    segment->flags          = column;               column += n;
+    segment->hopSkipNonce   = column;
+}
+
+static void readHistoryUnmapSegment(ReadHistorySegment *segment)
+{
+    if(segment->base){
+        munmap(segment->base, segment->size);
+    }
+    memset(segment, 0, sizeof(ReadHistorySegment));
+}
+
+//Maps an existing segment. Fails if it isn't one, or was written with a different number of records per segment.
+static bool readHistoryMapSegment(ReadHistory *history, uint64_t sequence, ReadHistorySegment *segment)
+{
+    char        path[READ_HISTORY_PATH_BYTES];
+    struct stat st;
+    uint32_t    segmentRecords;
+    uint64_t    headerSequence;
+    int         file;
+    void        *base;
+    
+    readHistorySegmentPath(history, sequence, path);
+    file = open(path, history->readOnly ? O_RDONLY : O_RDWR);
+    if(file < 0){
+        return false;
+    }
+    if(fstat(file, &st) != 0 || st.st_size < READ_HISTORY_HEADER_BYTES){
+        close(file);
+        return false;
+    }
+    
+    //A mapping stays valid after its file is closed.
+    base = mmap(NULL, (size_t)st.st_size, history->readOnly ? PROT_READ : PROT_READ|PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if(base == MAP_FAILED){
+        return false;
+    }
+    
+    memcpy(&segmentRecords, (uint8_t *)base+16, 4);
+    memcpy(&headerSequence, (uint8_t *)base+24, 8);
+    if(!readHistoryCheckHeader(base, READ_HISTORY_MAGIC, READ_HISTORY_HEADER_BYTES) || segmentRecords != history->segmentRecords
+       || headerSequence != sequence || (size_t)st.st_size != readHistorySegmentBytes(segmentRecords)){
+        munmap(base, (size_t)st.st_size);
+        return false;
+    }
+    
+    segment->sequence   = sequence;
+    segment->base       = base;
+    segment->size       = (size_t)st.st_size;
+    readHistoryMapColumns(segment, segmentRecords);
+    if(*segment->numRecords > segmentRecords){
+        readHistoryUnmapSegment(segment);
+        return false;
+    }
+    
+    return true;
+}
+
+static bool readHistoryCreateSegment(ReadHistory *history, uint64_t sequence, ReadHistorySegment *segment)
+{
+    char        path[READ_HISTORY_PATH_BYTES];
+    size_t      size = readHistorySegmentBytes(history->segmentRecords);
+    int         file;
+    void        *base;
+    
+    readHistorySegmentPath(history, sequence, path);
+    file = open(path, O_RDWR|O_CREAT|O_TRUNC, 0644);
+    if(file < 0){
+        return false;
+    }
+    if(ftruncate(file, (off_t)size) != 0){
+        close(file);
+        unlink(path);
+        return false;
+    }
+    base = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if(base == MAP_FAILED){
+        unlink(path);
+        return false;
+    }
+    
+    //The file starts out as zeros, so the record count is already 0.
+    readHistoryWriteHeader(base, READ_HISTORY_MAGIC, READ_HISTORY_HEADER_BYTES);
+    memcpy((uint8_t *)base+16, &history->segmentRecords, 4);
+    memcpy((uint8_t *)base+24, &sequence, 8);
+    
+    segment->sequence   = sequence;
+    segment->base       = base;
+    segment->size       = size;
+    readHistoryMapColumns(segment, history->segmentRecords);
+    
+    return true;
+}
+
+//Indexes the reads in a segment that was already on disk.
+static bool readHistoryIndexSegment(ReadHistory *history, const ReadHistorySegment *segment)
+{
+    uint64_t    position = segment->sequence*history->segmentRecords;
+    
+    for(uint32_t record=0; record<*segment->numRecords; record++){
+        uint32_t tagId = segment->tagId[record];
+        
+        if(tagId < history->numTags && !readHistoryAddPosition(&history->tagReads[tagId], position+record)){
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+//Deletes the oldest segment. Each tag's positions from it are skipped over, and only moved down once they make up half
+//of the array, so that retention doesn't cost a pass over every read.
+static void readHistoryDeleteOldestSegment(ReadHistory *history)
+{
+    char        path[READ_HISTORY_PATH_BYTES];
+    uint64_t    keptPosition;
+    
+    readHistoryUnmapSegment(readHistorySegmentSlot(history, history->firstSequence));
+    readHistorySegmentPath(history, history->firstSequence, path);
+    unlink(path);
+    history->firstSequence++;
+    
+    keptPosition = history->firstSequence*history->segmentRecords;
+    for(uint32_t tagId=0; tagId<history->numTags; tagId++){
+        ReadHistoryTagReads *tagReads   = &history->tagReads[tagId];
+        uint32_t            low         = tagReads->first;
+        uint32_t            high        = tagReads->count;
+        
+        while(low < high){
+            uint32_t middle = low + (high-low)/2;
+            
+            if(tagReads->positions[middle] < keptPosition){
+                low = middle+1;
+            } else {
+                high = middle;
+            }
+        }
+        tagReads->first = low;
+        
+        if(tagReads->first > tagReads->count/2){
+            memmove(tagReads->positions, tagReads->positions+tagReads->first, (size_t)(tagReads->count-tagReads->first)*sizeof(uint64_t));
+            tagReads->count -= tagReads->first;
+            tagReads->first = 0;
+        }
+    }
+}
+
+static int readHistoryCompareSequences(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    
+    return x < y ? -1 : x > y;
+}
+
+//Lists the sequence numbers of the segments in the directory, oldest first.
+static uint64_t *readHistoryListSegments(ReadHistory *history, uint32_t *numSegments)
+{
+    DIR             *directory  = opendir(history->directory);
+    struct dirent   *entry;
+    uint64_t        *sequences  = NULL;
+    uint32_t        capacity    = 0;
+    
+    *numSegments = 0;
+    if(!directory){
+        return NULL;
+    }
+    while((entry = readdir(directory))){
+        unsigned long long  sequence;
+        int                 length = 0;
+        
+        if(sscanf(entry->d_name, "history-%llu.srfh%n", &sequence, &length) != 1 || length == 0 || entry->d_name[length]){
+            continue;
+        }
+        if(*numSegments == capacity){
+            uint64_t *grown = realloc(sequences, (capacity ? 2*capacity : 64)*sizeof(uint64_t));
+            
+            if(!grown){
+                break;
+            }
+            sequences   = grown;
+            capacity    = capacity ? 2*capacity : 64;
+        }
+        sequences[(*numSegments)++] = sequence;
+    }
+    closedir(directory);
+    
+    if(sequences){
+        qsort(sequences, *numSegments, sizeof(uint64_t), readHistoryCompareSequences);
+    }
+    
+    return sequences;
+}
+
+//The records per segment of an existing history come from its newest segment.
+static uint32_t readHistoryExistingSegmentRecords(ReadHistory *history, uint64_t sequence)
+{
+    char        path[READ_HISTORY_PATH_BYTES];
+    uint8_t     header[READ_HISTORY_HEADER_BYTES];
+    uint32_t    segmentRecords = 0;
+    int         file;
+    
+    readHistorySegmentPath(history, sequence, path);
+    file = open(path, O_RDONLY);
+    if(file < 0){
+        return 0;
+    }
+    if(pread(file, header, sizeof(header), 0) == (ssize_t)sizeof(header)
+       && readHistoryCheckHeader(header, READ_HISTORY_MAGIC, READ_HISTORY_HEADER_BYTES)){
+        memcpy(&segmentRecords, header+16, 4);
+    }
+    close(file);
+    
+    return segmentRecords;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Opening and closing
+
+bool readHistoryOpen(ReadHistory *history, const char *directory, uint32_t segmentRecords, uint32_t maxSegments,
+                     bool readOnly)
+{
+    uint64_t    *sequences;
+    uint32_t    numSegments, firstKept;
+    
+    memset(history, 0, sizeof(ReadHistory));
+    history->epcFile = -1;
+    
+    if(strlen(directory) >= sizeof(history->directory) || !segmentRecords || !maxSegments){
+        return false;
+    }
+    strcpy(history->directory, directory);
+    history->readOnly       = readOnly;
+    history->segmentRecords = (segmentRecords+63) & ~63U;   //Keeps every column 8-byte aligned.
+    history->maxSegments    = maxSegments;
+    
+    if(!readOnly && mkdir(directory, 0755) != 0 && errno != EEXIST){
+        return false;
+    }
+    if(!epcIndexInit(&history->epcIndex)){
+        return false;
+    }
+    if(!readHistoryLoadEPCs(history)){
+        readHistoryClose(history);
+        return false;
+    }
+    
+    sequences = readHistoryListSegments(history, &numSegments);
+    if(numSegments){
+        uint32_t existing = readHistoryExistingSegmentRecords(history, sequences[numSegments-1]);
+        
+        if(existing){
+            history->segmentRecords = existing;
+        }
+        if(readOnly && numSegments > maxSegments){
+            history->maxSegments = numSegments;
+        }
+    }
+    
+    history->segments = calloc(history->maxSegments, sizeof(ReadHistorySegment));
+    if(!history->segments){
+        free(sequences);
+        readHistoryClose(history);
+        return false;
+    }
+    
+    //Only the newest maxSegments sequence numbers are kept. Anything older goes, as it would have on rotation.
+    firstKept = 0;
+    if(numSegments){
+        uint64_t newest = sequences[numSegments-1];
+        
+        while(firstKept < numSegments && newest - sequences[firstKept] >= history->maxSegments){
+            if(!readOnly){
+                char path[READ_HISTORY_PATH_BYTES];
+                
+                readHistorySegmentPath(history, sequences[firstKept], path);
+                unlink(path);
+            }
+            firstKept++;
+        }
+        history->firstSequence  = sequences[firstKept];
+        history->nextSequence   = newest+1;
+    }
+    
+    //A segment that can't be mapped is left as a hole, rather than losing the ones around it.
+    for(uint32_t i=firstKept; i<numSegments; i++){
+        ReadHistorySegment *segment = readHistorySegmentSlot(history, sequences[i]);
+        
+        if(readHistoryMapSegment(history, sequences[i], segment) && !readHistoryIndexSegment(history, segment)){
+            free(sequences);
+            readHistoryClose(history);
+            return false;
+        }
+    }
+    free(sequences);
+    
+    return true;
+}
+
+void readHistoryClose(ReadHistory *history)
+{
+    //The EPC index is the first thing set up, so without it there is nothing to close.
+    if(!history->epcIndex.slots){
+        return;
+    }
+    if(history->segments){
+        readHistorySync(history);
+        for(uint32_t i=0; i<history->maxSegments; i++){
+            readHistoryUnmapSegment(&history->segments[i]);
+        }
+    }
+    for(uint32_t tagId=0; tagId<history->numTags; tagId++){
+        free(history->tagReads[tagId].positions);
+    }
+    if(history->epcFile >= 0){
+        close(history->epcFile);
+    }
+    epcIndexFree(&history->epcIndex);
+    free(history->tagReads);
+    free(history->epcs);
+    free(history->segments);
+    memset(history, 0, sizeof(ReadHistory));
+    history->epcFile = -1;
+}
+
+bool readHistoryIsOpen(const ReadHistory *history)
+{
+    return history->segments != NULL;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Appending
+
+//The segment to write the next read into, starting a new one if the newest is full. The oldest is deleted to make room.
+static ReadHistorySegment *readHistoryWritableSegment(ReadHistory *history)
+{
+    ReadHistorySegment *segment;
+    
+    if(history->nextSequence > history->firstSequence){
+        segment = readHistorySegmentSlot(history, history->nextSequence-1);
+        if(segment->base && *segment->numRecords < history->segmentRecords){
+            return segment;
+        }
+    }
+    
+    if(history->nextSequence - history->firstSequence == history->maxSegments){
+        readHistoryDeleteOldestSegment(history);
+    }
+    if(history->nextSequence == history->firstSequence && history->nextSequence == 0){
+        history->firstSequence = history->nextSequence = 1;
+    }
+    
+    segment = readHistorySegmentSlot(history, history->nextSequence);
+    if(!readHistoryCreateSegment(history, history->nextSequence, segment)){
+        return NULL;
+    }
+    history->nextSequence++;
+    
+    return segment;
+}
+
+bool readHistoryAppend(ReadHistory *history, const TagRead *read, uint64_t timestampNs,
+                       float rssidBm, float phaseRad, float rangeMeters)
+{
+    ReadHistorySegment  *segment;
+    uint32_t            tagId, record;
+    
+    if(history->readOnly || !history->segments){
+        return false;
+    }
+    
+    //A new tag goes into the EPC file before anything refers to it.
+    tagId = readHistoryFindTag(history, read->epc);
+    if(tagId == READ_HISTORY_NO_TAG){
+        off_t offset = READ_HISTORY_EPC_HEADER_BYTES + (off_t)history->numTags*TAG_EPC_NUM_BYTES;
+        
+        if(!readHistoryReserveTag(history)
+           || pwrite(history->epcFile, read->epc, TAG_EPC_NUM_BYTES, offset) != TAG_EPC_NUM_BYTES){
+            return false;
+        }
+        tagId = readHistoryAddTag(history, read->epc);
+        if(tagId == READ_HISTORY_NO_TAG){
+            return false;
+        }
+    }
+    
+    segment = readHistoryWritableSegment(history);
+    if(!segment || !readHistoryAddPosition(&history->tagReads[tagId], segment->sequence*history->segmentRecords + *segment->numRecords)){
+        return false;
+    }
+    
+    record = *segment->numRecords;
+    segment->timestampNs[record]    = timestampNs;
+    segment->tagId[record]          = tagId;
+    segment->antMagI[record]        = read->antMagI;
+    segment->antMagQ[record]        = read->antMagQ;
+    segment->calMagI[record]        = read->calMagI;
+    segment->calMagQ[record]        = read->calMagQ;
+    segment->rssidBm[record]        = rssidBm;
+    segment->phaseRad[record]       = phaseRad;
+    segment->rangeMeters[record]    = rangeMeters;
+    segment->freqSlot[record]       = read->freqSlot;
+    segment->flags[record]          = read->hopNotSkip ? READ_HISTORY_FLAG_HOP : 0;
+    segment->hopSkipNonce[record]   = read->hopSkipNonce;
+    
+    //The count goes last, so a reader of the file never sees a record that is only partly written.
+    __atomic_store_n(segment->numRecords, record+1, __ATOMIC_RELEASE);
+    history->numAppended++;
+    
+    return true;
+}
+
+void readHistorySync(ReadHistory *history)
+{
+    ReadHistorySegment *segment;
+    
+    if(history->readOnly || !history->segments || history->nextSequence == history->firstSequence){
+        return;
+    }
+    segment = readHistorySegmentSlot(history, history->nextSequence-1);
+    if(segment->base){
+        msync(segment->base, segment->size, MS_ASYNC);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Queries
+
+//Returns NULL if the position's segment has been deleted or couldn't be mapped.
+static const ReadHistorySegment *readHistoryPositionSegment(ReadHistory *history, uint64_t position, uint32_t *record)
+{
+    uint64_t            sequence = position / history->segmentRecords;
+    ReadHistorySegment  *segment;
+    
+    if(sequence < history->firstSequence || sequence >= history->nextSequence){
+        return NULL;
+    }
+    segment = readHistorySegmentSlot(history, sequence);
+    if(!segment->base || segment->sequence != sequence){
+        return NULL;
+    }
+    *record = (uint32_t)(position % history->segmentRecords);
+    
+    return segment;
+}
+
+static uint64_t readHistoryPositionTimestamp(ReadHistory *history, uint64_t position)
+{
+    uint32_t                    record;
+    const ReadHistorySegment    *segment = readHistoryPositionSegment(history, position, &record);
+    
+    return segment ? segment->timestampNs[record] : 0;
+}
+
+//The first of the tag's reads, from index low up to high, with a timestamp of at least timestampNs.
+static uint32_t readHistoryLowerBound(ReadHistory *history, const ReadHistoryTagReads *tagReads, uint32_t low, uint32_t high,
+                                      uint64_t timestampNs)
+{
+    while(low < high){
+        uint32_t middle = low + (high-low)/2;
+        
+        if(readHistoryPositionTimestamp(history, tagReads->positions[middle]) < timestampNs){
+            low = middle+1;
+        } else {
+            high = middle;
+        }
+    }
+    
+    return low;
+}
+
+uint32_t readHistoryQueryTag(ReadHistory *history, uint32_t tagId, uint64_t fromNs, uint64_t toNs,
+                             ReadHistoryRecord *records, uint32_t maxRecords)
+{
+    const ReadHistoryTagReads   *tagReads;
+    uint32_t                    first, last, numCopied = 0;
+    
+    if(tagId >= history->numTags || fromNs > toNs){
+        return 0;
+    }
+    tagReads = &history->tagReads[tagId];
+    
+    first   = readHistoryLowerBound(history, tagReads, tagReads->first, tagReads->count, fromNs);
+    last    = toNs == UINT64_MAX ? tagReads->count : readHistoryLowerBound(history, tagReads, first, tagReads->count, toNs+1);
+    
+    for(uint32_t i=first; i<last && numCopied<maxRecords; i++){
+        uint32_t                    record;
+        const ReadHistorySegment    *segment = readHistoryPositionSegment(history, tagReads->positions[i], &record);
+        ReadHistoryRecord           *out     = &records[numCopied];
+        
+        if(!segment){
+            continue;
+        }
+        out->timestampNs    = segment->timestampNs[record];
+        out->tagId          = segment->tagId[record];
+        out->freqSlot       = segment->freqSlot[record];
+        out->flags          = segment->flags[record];
+        out->hopSkipNonce   = segment->hopSkipNonce[record];
+        out->antMagI        = segment->antMagI[record];
+        out->antMagQ        = segment->antMagQ[record];
+        out->calMagI        = segment->calMagI[record];
+        out->calMagQ        = segment->calMagQ[record];
+        out->rssidBm        = segment->rssidBm[record];
+        out->phaseRad       = segment->phaseRad[record];
+        out->rangeMeters    = segment->rangeMeters[record];
+        numCopied++;
+    }
+    
+    return last-first;
+}
+
+uint32_t readHistoryQuery(ReadHistory *history, const uint8_t *epc, uint64_t fromNs, uint64_t toNs,
+                          ReadHistoryRecord *records, uint32_t maxRecords)
+{
+    return readHistoryQueryTag(history, readHistoryFindTag(history, epc), fromNs, toNs, records, maxRecords);
+}
+
+uint32_t readHistoryFindTag(ReadHistory *history, const uint8_t *epc)
+{
+    int32_t row = epcIndexFind(&history->epcIndex, epc);
+    
+    return row == EPC_INDEX_NOT_FOUND ? READ_HISTORY_NO_TAG : (uint32_t)row;
+}
+
+const uint8_t *readHistoryTagEPC(const ReadHistory *history, uint32_t tagId)
+{
+    return tagId < history->numTags ? history->epcs + (size_t)tagId*TAG_EPC_NUM_BYTES : NULL;
+}
+
+uint64_t readHistoryNumRecords(const ReadHistory *history)
+{
+    uint64_t numRecords = 0;
+    
+    for(uint64_t sequence=history->firstSequence; sequence<history->nextSequence; sequence++){
+        const ReadHistorySegment *segment = &history->segments[sequence % history->maxSegments];
+        
+        if(segment->base){
+            numRecords += *segment->numRecords;
+        }
+    }
+    
+    return numRecords;
+}
@@ -0,0 +1,190 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: ReadHistory.h                                                             //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module keeps a history of every decoded tag read on disk, for offline      //
+//  analysis. Reads go into fixed-size segment files of fixed-width columns, which  //
+//  are memory mapped and only ever appended to. The oldest segments are deleted    //
+//  past a retention limit. An index in memory lists the reads of each tag in time  //
+//  order, so the reads of one tag in a time window are found without a full scan.  //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#ifndef ReadHistory_h
+#define ReadHistory_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "TagPacketDecoder.h"
+#include "EPCIndex.h"
+
+//A history is a directory holding epcs.srfh and the segments, history-<sequence>.srfh. Values are stored in host byte
+//order, which is little-endian on every platform the app and the tools run on. The byte order mark catches any other.
+//
+//epcs.srfh, the EPC of each tag ID, in the order the tags were first read:
+//
+//  Offset  Size    Field
+//  0       8       Magic, "SURFEPCS"
+//  8       2       Format version, READ_HISTORY_VERSION
+//  10      2       Header size in bytes
+//  12      4       Byte order mark, READ_HISTORY_BYTE_ORDER_MARK
+//  16      12*T    The EPC of tag ID 0, 1, ...
+//
+//history-<sequence>.srfh, for N records per segment. Each column is N values long, whether or not they are all used:
+//
+//  Offset  Size    Field
+//  0       8       Magic, "SURFHIST"
+//  8       2       Format version, READ_HISTORY_VERSION
+//  10      2       Header size in bytes
+//  12      4       Byte order mark, READ_HISTORY_BYTE_ORDER_MARK
+//  16      4       Records per segment, N
+//  20      4       Number of records written. Only updated once the record's columns are all written.
+//  24      8       Segment sequence number
+//  32      32      Reserved
+//  64      8N      Timestamp, nanoseconds since 1/1/1970 UTC
+//          4N      Tag ID, the EPC's index in epcs.srfh
+//          4N      Antenna I magnitude
+//          4N      Antenna Q magnitude
+//          4N      Calibration I magnitude
+//          4N      Calibration Q magnitude
+//          4N      RSSI in dBm, float
+//          4N      Antenna phase in radians, from 0 to pi, float
+//          4N      PDOA range in meters as shown at the time of the read, float
+//          N       Frequency slot
+//          N       Flags, READ_HISTORY_FLAG_*
+//          N       Hop/skip nonce
+
+#define READ_HISTORY_MAGIC                      "SURFHIST"
+#define READ_HISTORY_EPC_MAGIC                  "SURFEPCS"
+#define READ_HISTORY_VERSION                    1
+#define READ_HISTORY_HEADER_BYTES               64
+#define READ_HISTORY_EPC_HEADER_BYTES           16
+#define READ_HISTORY_BYTE_ORDER_MARK            0x01020304
+#define READ_HISTORY_RECORD_BYTES               43
+#define READ_HISTORY_DEFAULT_SEGMENT_RECORDS    65536   //About 2.8MB per segment.
+#define READ_HISTORY_DEFAULT_MAX_SEGMENTS       32
+#define READ_HISTORY_PATH_BYTES                 1024    //Longest path to a file in the history, including the NUL.
+#define READ_HISTORY_NO_TAG                     UINT32_MAX
+
+#define READ_HISTORY_FLAG_HOP                   (1 << 0)    //Clear for a skip read.
+
+//One read, as stored.
+typedef struct
+{
+    uint64_t    timestampNs;
+    uint32_t    tagId;
+    uint8_t     freqSlot;
+    uint8_t     flags;
+    uint8_t     hopSkipNonce;
+    int32_t     antMagI;
+    int32_t     antMagQ;
+    int32_t     calMagI;
+    int32_t     calMagQ;
+    float       rssidBm;
+    float       phaseRad;
+    float       rangeMeters;
+} ReadHistoryRecord;
+
+//A mapped segment file. The column pointers point into the mapping.
+typedef struct
+{
+    uint64_t    sequence;
+    uint8_t     *base;          //NULL if this slot has no segment.
+    size_t      size;
+    uint32_t    *numRecords;
+    uint64_t    *timestampNs;
+    uint32_t    *tagId;
+    int32_t     *antMagI;
+    int32_t     *antMagQ;
+    int32_t     *calMagI;
+    int32_t     *calMagQ;
+    float       *rssidBm;
+    float       *phaseRad;
+    float       *rangeMeters;
+    uint8_t     *freqSlot;
+    uint8_t     *flags;
+    uint8_t     *hopSkipNonce;
+} ReadHistorySegment;
+
+//The reads of one tag, as positions across all of the segments: sequence*segmentRecords + record.
+typedef struct
+{
+    uint64_t    *positions;
+    uint32_t    first;          //Positions before this one were in segments that have since been deleted.
+    uint32_t    count;
+    uint32_t    capacity;
+} ReadHistoryTagReads;
+
+//Not thread safe. The tag list only uses it from its ingest queue.
+typedef struct
+{
+    char                directory[READ_HISTORY_PATH_BYTES-64];
+    bool                readOnly;
+    int                 epcFile;
+    EPCIndex            epcIndex;           //EPC to tag ID.
+    uint8_t             *epcs;              //TAG_EPC_NUM_BYTES for each tag ID.
+    ReadHistoryTagReads *tagReads;
+    uint32_t            numTags;
+    uint32_t            tagCapacity;
+    ReadHistorySegment  *segments;          //A ring, indexed by sequence % maxSegments.
+    uint32_t            segmentRecords;
+    uint32_t            maxSegments;
+    uint64_t            firstSequence;      //The oldest segment kept.
+    uint64_t            nextSequence;       //One past the newest segment. Equal to firstSequence when there are none.
+    uint64_t            numAppended;        //Since the history was opened.
+} ReadHistory;
+
+//Opens the history in the directory, creating it if need be, and indexes the segments already there. The segment size
+//of an existing history wins over segmentRecords, which is rounded up to a multiple of 64. Segments past maxSegments
+//are deleted, unless readOnly, in which case they are all kept and appends fail. Returns false on error.
+bool        readHistoryOpen(ReadHistory *history, const char *directory, uint32_t segmentRecords, uint32_t maxSegments,
+                            bool readOnly);
+//Safe to call on a history that isn't open, including one that is all zeros.
+void        readHistoryClose(ReadHistory *history);
+bool        readHistoryIsOpen(const ReadHistory *history);
+
+//Reads are expected in time order. A read older than the ones before it is still stored, but a time window query may
+//not find it. The timestamp is in nanoseconds since 1/1/1970 UTC. Returns false if the read could not be stored.
+bool        readHistoryAppend(ReadHistory *history, const TagRead *read, uint64_t timestampNs,
+                              float rssidBm, float phaseRad, float rangeMeters);
+//Asks for the newest segment to be written out. The history doesn't need this to survive the app being killed.
+void        readHistorySync(ReadHistory *history);
+
+//The reads of one tag from fromNs to toNs inclusive, oldest first. Returns how many there are, but only copies up to
+//maxRecords of them, so passing 0 just counts them.
+uint32_t    readHistoryQuery(ReadHistory *history, const uint8_t *epc, uint64_t fromNs, uint64_t toNs,
+                             ReadHistoryRecord *records, uint32_t maxRecords);
+uint32_t    readHistoryQueryTag(ReadHistory *history, uint32_t tagId, uint64_t fromNs, uint64_t toNs,
+                                ReadHistoryRecord *records, uint32_t maxRecords);
+
+//READ_HISTORY_NO_TAG if the tag has never been read.
+uint32_t    readHistoryFindTag(ReadHistory *history, const uint8_t *epc);
+const uint8_t *readHistoryTagEPC(const ReadHistory *history, uint32_t tagId);
+uint64_t    readHistoryNumRecords(const ReadHistory *history);
+
+#endif /* ReadHistory_h */
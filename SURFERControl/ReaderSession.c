@@ -0,0 +1,242 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: ReaderSession.c                                                           //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module holds everything that is per reader on the ingest path: the packet  //
+//  decoder, a queue of the tag notifications not yet decoded, and the range state  //
+//  of each tag as seen from this reader. Decoded reads are merged into the shared  //
+//  tag store. It is plain C so that several readers can be simulated off device.   //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ReaderSession.h"
+#include "TagMetrics.h"
+
+#define READER_SESSION_INITIAL_TAGS     256
+
+bool readerSessionInit(ReaderSession *session, uint8_t readerId, uint32_t queueCapacity)
+{
+    uint32_t capacity = 1;
+    
+    memset(session, 0, sizeof(ReaderSession));
+    
+    while(capacity < queueCapacity && capacity < (1u << 31)){
+        capacity <<= 1;
+    }
+    
+    session->readerId           = readerId;
+    session->queue              = malloc(capacity*sizeof(ReaderPacket));
+    session->queueMask          = capacity-1;
+    session->estimators         = malloc(READER_SESSION_INITIAL_TAGS*sizeof(TagRangeEstimator));
+    session->estimatorCapacity  = READER_SESSION_INITIAL_TAGS;
+    if(!session->queue || !session->estimators || !epcIndexInit(&session->tagIndex)){
+        free(session->queue);
+        free(session->estimators);
+        session->queue      = NULL;
+        session->estimators = NULL;
+        return false;
+    }
+    tagPacketDecoderInit(&session->decoder);
+    
+    return true;
+}
+
+void readerSessionFree(ReaderSession *session)
+{
+    if(!session->queue){
+        return;
+    }
+    epcIndexFree(&session->tagIndex);
+    free(session->queue);
+    free(session->estimators);
+    session->queue      = NULL;
+    session->estimators = NULL;
+}
+
+void readerSessionReset(ReaderSession *session)
+{
+    tagPacketDecoderInit(&session->decoder);
+    session->queueHead = session->queueTail;
+}
+
+void readerSessionClearTags(ReaderSession *session)
+{
+    epcIndexClear(&session->tagIndex);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Queue
+
+//The tail is published with a release store after the packet is written, and the head after the packet is read,
+//so each side sees the other's work on the slot before it sees the slot move.
+bool readerSessionPush(ReaderSession *session, ReaderPacketKind kind, const uint8_t *bytes, size_t length,
+                       uint64_t timestampNs)
+{
+    uint32_t        tail    = session->queueTail;
+    uint32_t        head    = __atomic_load_n(&session->queueHead, __ATOMIC_ACQUIRE);
+    ReaderPacket    *packet;
+    
+    if(tail-head > session->queueMask){
+        session->numDropped++;
+        return false;
+    }
+    
+    packet              = &session->queue[tail & session->queueMask];
+    packet->timestampNs = timestampNs;
+    packet->kind        = (uint8_t)kind;
+    //A notification too long for the slot is queued as empty, which the decoder rejects as the wrong length.
+    packet->length      = length <= sizeof(packet->bytes) ? (uint8_t)length : 0;
+    memcpy(packet->bytes, bytes, packet->length);
+    
+    __atomic_store_n(&session->queueTail, tail+1, __ATOMIC_RELEASE);
+    session->numPushed++;
+    
+    return true;
+}
+
+uint32_t readerSessionNumQueued(ReaderSession *session)
+{
+    return __atomic_load_n(&session->queueTail, __ATOMIC_ACQUIRE) - __atomic_load_n(&session->queueHead, __ATOMIC_ACQUIRE);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Draining
+
+//Range state is per reader, since each reader's antenna sees its own phase for the tag.
+static TagRangeEstimator *readerSessionEstimator(ReaderSession *session, const uint8_t *epc)
+{
+    bool    inserted;
+    int32_t row = epcIndexFindOrInsert(&session->tagIndex, epc, &inserted);
+    
+    if(row == EPC_INDEX_NOT_FOUND){
+        return NULL;
+    }
+    if((uint32_t)row >= session->estimatorCapacity){
+        uint32_t            newCapacity = 2*session->estimatorCapacity;
+        TagRangeEstimator   *estimators = realloc(session->estimators, newCapacity*sizeof(TagRangeEstimator));
+        
+        if(!estimators){
+            return NULL;
+        }
+        session->estimators         = estimators;
+        session->estimatorCapacity  = newCapacity;
+    }
+    if(inserted){
+        tagRangeEstimatorInit(&session->estimators[row]);
+    }
+    return &session->estimators[row];
+}
+
+static void readerSessionObserve(ReaderSession *session, const TagRead *read, uint64_t timestampNs,
+                                 TagStoreObservation *observation)
+{
+    TagRangeEstimator   *estimator  = readerSessionEstimator(session, read->epc);
+    TagRangeEstimate    estimate    = {TAG_METRICS_RANGE_INVALID, 0, 0};
+    
+    memcpy(observation->epc, read->epc, TAG_EPC_NUM_BYTES);
+    observation->readerId       = session->readerId;
+    observation->rangeUpdated   = false;
+    observation->rssidBm        = tagMetricsRSSIdBm(read->antMagI, read->antMagQ);
+    observation->timestampNs    = timestampNs;
+    
+    if(estimator){
+        observation->rangeUpdated = tagRangeEstimatorUpdate(estimator, read->freqSlot, tagMetricsPhase(read->antMagI, read->antMagQ),
+                                                            tagMetricsPhase(read->calMagI, read->calMagQ),
+                                                            tagMetricsRSSIdBm(read->calMagI, read->calMagQ));
+        tagRangeEstimatorGetEstimate(estimator, &estimate);
+    }
+    observation->rangeMeters        = estimate.rangeMeters;
+    observation->rangeConfidence    = estimate.confidence;
+}
+
+static void readerSessionFlush(ReaderSession *session, TagStore *store, uint32_t numReads,
+                               ReaderSessionHandler handler, void *context)
+{
+    if(!numReads){
+        return;
+    }
+    tagStoreMerge(store, session->observations, numReads);
+    session->numReads += numReads;
+    
+    if(handler){
+        for(uint32_t i=0; i<numReads; i++){
+            handler(context, session, TAG_DECODE_READ_READY, &session->reads[i], &session->observations[i]);
+        }
+    }
+}
+
+uint32_t readerSessionDrain(ReaderSession *session, TagStore *store, uint32_t maxPackets,
+                            ReaderSessionHandler handler, void *context)
+{
+    uint32_t    head        = session->queueHead;
+    uint32_t    tail        = __atomic_load_n(&session->queueTail, __ATOMIC_ACQUIRE);
+    uint32_t    numDrained  = 0;
+    uint32_t    numReads    = 0;
+    uint32_t    generation  = tagStoreGeneration(store);
+    
+    //Every session drains into the store, so this is where they all find out that the tag list was cleared.
+    if(generation != session->storeGeneration){
+        readerSessionClearTags(session);
+        session->storeGeneration = generation;
+    }
+    
+    while(head != tail && numDrained < maxPackets){
+        const ReaderPacket  *packet = &session->queue[head & session->queueMask];
+        TagRead             *read   = &session->reads[numReads];
+        uint32_t            flags;
+        
+        if(packet->kind == READER_PACKET_PKT1){
+            flags = tagPacketDecoderPushPkt1(&session->decoder, packet->bytes, packet->length, read);
+        } else {
+            flags = tagPacketDecoderPushPkt2(&session->decoder, packet->bytes, packet->length, read);
+        }
+        if(flags & TAG_DECODE_READ_READY){
+            //Timed here rather than by the handler, which only sees the read once its batch has been merged.
+            readerSessionObserve(session, read, packet->timestampNs, &session->observations[numReads]);
+            session->observations[numReads].decodedNs = session->latencyProbe ? latencyProbeNow(session->latencyProbe) : 0;
+            numReads++;
+        }
+        
+        __atomic_store_n(&session->queueHead, ++head, __ATOMIC_RELEASE);
+        numDrained++;
+        
+        if(handler && (flags & ~(uint32_t)TAG_DECODE_READ_READY)){
+            handler(context, session, flags & ~(uint32_t)TAG_DECODE_READ_READY, NULL, NULL);
+        }
+        if(numReads == READER_SESSION_MERGE_BATCH){
+            readerSessionFlush(session, store, numReads, handler, context);
+            numReads = 0;
+        }
+        if(head == tail){
+            tail = __atomic_load_n(&session->queueTail, __ATOMIC_ACQUIRE);
+        }
+    }
+    readerSessionFlush(session, store, numReads, handler, context);
+    
+    return numDrained;
+}
@@ -0,0 +1,116 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: ReaderSession.h                                                           //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module holds everything that is per reader on the ingest path: the packet  //
+//  decoder, a queue of the tag notifications not yet decoded, and the range state  //
+//  of each tag as seen from this reader. Decoded reads are merged into the shared  //
+//  tag store. It is plain C so that several readers can be simulated off device.   //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef ReaderSession_h
+#define ReaderSession_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "TagPacketDecoder.h"
+#include "TagRangeEstimator.h"
+#include "TagStore.h"
+#include "EPCIndex.h"
+#include "LatencyProbe.h"
+
+#define READER_SESSION_DEFAULT_QUEUE_CAPACITY   1024    //Must be a power of 2.
+#define READER_SESSION_MERGE_BATCH              64      //Reads merged into the tag store per lock.
+
+typedef enum
+{
+    READER_PACKET_PKT1  =   0,
+    READER_PACKET_PKT2  =   1
+} ReaderPacketKind;
+
+//One tag data notification as it came off the air.
+typedef struct
+{
+    uint64_t    timestampNs;
+    uint8_t     kind;
+    uint8_t     length;
+    uint8_t     bytes[TAG_PKT1_NUM_BYTES];
+} ReaderPacket;
+
+typedef struct ReaderSession ReaderSession;
+
+//Called from readerSessionDrain. For a packet that only raised warnings, read and observation are NULL and flags
+//doesn't have TAG_DECODE_READ_READY. For a read, flags is TAG_DECODE_READ_READY and observation->row is the row in the
+//tag store. Reads are handed over after their batch is merged, so a warning may come before reads decoded ahead of it.
+typedef void (*ReaderSessionHandler)(void *context, ReaderSession *session, uint32_t flags,
+                                     const TagRead *read, const TagStoreObservation *observation);
+
+//The queue is single producer, single consumer: one thread pushes the notifications, one thread drains them.
+//Those may be the same thread.
+struct ReaderSession
+{
+    uint8_t             readerId;
+    TagPacketDecoder    decoder;
+    ReaderPacket        *queue;
+    uint32_t            queueMask;
+    uint32_t            queueHead;          //Only written by the draining thread.
+    uint32_t            queueTail;          //Only written by the pushing thread.
+    uint64_t            numPushed;
+    uint64_t            numDropped;         //Notifications lost because the queue was full.
+    uint64_t            numReads;
+    uint32_t            storeGeneration;    //Of the tag store when the tags were last cleared.
+    EPCIndex            tagIndex;           //This reader's own rows, for the range estimators.
+    TagRangeEstimator   *estimators;
+    uint32_t            estimatorCapacity;
+    LatencyProbe        *latencyProbe;      //If set, each read is timed on its clock as the decoder returns it.
+    TagRead             reads[READER_SESSION_MERGE_BATCH];
+    TagStoreObservation observations[READER_SESSION_MERGE_BATCH];
+};
+
+//Returns false if the storage could not be allocated. queueCapacity is rounded up to a power of 2.
+bool        readerSessionInit(ReaderSession *session, uint8_t readerId, uint32_t queueCapacity);
+void        readerSessionFree(ReaderSession *session);
+//Starts the decoder over and empties the queue, e.g. on reconnect. Neither side of the queue may be in use.
+void        readerSessionReset(ReaderSession *session);
+//Forgets the range state of every tag, e.g. when the tag list is cleared.
+void        readerSessionClearTags(ReaderSession *session);
+
+//Producer side. Returns false, and counts the notification as dropped, if the queue is full.
+//A notification of the wrong size is still queued, so that the decoder reports it with TAG_DECODE_BAD_LENGTH.
+bool        readerSessionPush(ReaderSession *session, ReaderPacketKind kind, const uint8_t *bytes, size_t length,
+                              uint64_t timestampNs);
+uint32_t    readerSessionNumQueued(ReaderSession *session);
+
+//Consumer side. Decodes up to maxPackets queued notifications, works out RSSI and range for each read, merges the reads
+//into the store in batches and hands them to the handler, which may be NULL. Returns the number of packets drained.
+//If the store has been cleared since the last drain, the session's tags are cleared first. The drain only reads the latency
+//probe's clock and leaves the marks to the handler, so sessions that share a probe may drain on different threads.
+uint32_t    readerSessionDrain(ReaderSession *session, TagStore *store, uint32_t maxPackets,
+                               ReaderSessionHandler handler, void *context);
+
+#endif /* ReaderSession_h */
@@ -44,12 +44,19 @@
 @import CoreBluetooth;
 #import <Foundation/Foundation.h>
 
+#import "BTLETrace.h"
+#import "TxScheduler.h"
+#import "ReaderSession.h"
+
+@class SURFERPeripheral;
+
 @protocol SURFERPeripheralDelegate
 - (void) didReceiveTargetEPCData:(NSData *) data;
 - (void) didReceiveNewEPCData:(NSData *) data;
 - (void) didReceiveReadStateData:(NSData *) data;
-- (void) didReceivePacketData1Data:(NSData *) data;
-- (void) didReceivePacketData2Data:(NSData *) data;
+//Tag data notifications go into the reader's session queue rather than straight to the delegate.
+//The delegate is told after each one, and drains the session when it suits it.
+- (void) surferPeripheralDidQueueTagPackets:(SURFERPeripheral *) surferPeripheral;
 - (void) didReceiveWaveformDataData:(NSData *) data;
 - (void) didReceiveLogMessageData:(NSData *) data;
 @optional
@@ -60,12 +67,25 @@
 @interface SURFERPeripheral : NSObject <CBPeripheralDelegate>
 @property CBPeripheral *peripheral;
 @property id<SURFERPeripheralDelegate> delegate;
+//Everything written to the reader goes through this queue. It is exposed for its statistics.
+@property (nonatomic, readonly) TxScheduler *txScheduler;
+//The decode state and ingest queue for this reader's tag data, and its ID in the merged tag store.
+//The notifications are pushed on the main thread. Whoever drains the session also has to reset it on reconnect.
+@property (nonatomic, readonly) ReaderSession *readerSession;
+//Serial queue on which the session is drained and reset, so that each reader decodes and merges on its own.
+@property (nonatomic, readonly) dispatch_queue_t drainQueue;
+@property (nonatomic, readonly) uint8_t readerId;
+//With several readers connected, one of them is primary and the app follows its state. The state, EPC, waveform and
+//log notifications of the other readers are not passed to the delegate. Readers are primary unless told otherwise.
+@property (nonatomic) BOOL isPrimary;
 
 + (CBUUID *) surferServiceUUID;
 
-- (SURFERPeripheral *) initWithPeripheral:(CBPeripheral*)peripheral delegate:(id<SURFERPeripheralDelegate>) delegate;
+- (SURFERPeripheral *) initWithPeripheral:(CBPeripheral*)peripheral readerId:(uint8_t) readerId delegate:(id<SURFERPeripheralDelegate>) delegate;
 
+//Writes are queued and sent as the connection interval allows, so they may go out a little later.
 - (void) writeStateData:(NSData *) data;
+- (void) writeStateData:(NSData *) data priority:(TxPriority) priority;
 - (void) writeTargetEPCData:(NSData *) data;
 - (void) writeNewEPCData:(NSData *) data;
 - (void) readTargetEPCData;
@@ -74,4 +94,9 @@
 
 - (void) didConnect;
 - (void) didDisconnect;
+
+//While a trace is running, every notification from the reader is recorded to the file before it is handed to the delegate.
+//The trace is stopped on disconnect.
+- (BOOL) startTraceToFile:(NSString *) path;
+- (void) stopTrace;
 @end
@@ -44,6 +44,7 @@
 //////////////////////////////////////////////////////////////////////////////////////
 
 #import "SURFERPeripheral.h"
+#import "MonotonicClock.h"
 
 //------------------------------------------------------------------------------------------------------------------
 //Declarations
@@ -59,9 +60,17 @@
 @property CBCharacteristic *waveformDataCharacteristic;
 @property CBCharacteristic *logMessageCharacteristic;
 
+- (BOOL) transmitOnChannel:(TxChannel) channel data:(NSData *) data;
+
 @end
 
 @implementation SURFERPeripheral
+{
+    BTLETraceWriter _traceWriter;
+    TxScheduler     _txScheduler;
+    BOOL            _txServiceScheduled;
+    ReaderSession   _readerSession;
+}
 @synthesize peripheral = _peripheral;
 @synthesize delegate = _delegate;
 
@@ -138,17 +147,56 @@
 //---------------------------------------------------------------------------------------------------------------
 //Various fundamental functions regarding management of the reader abstraction in iOS software.
 
-- (SURFERPeripheral *) initWithPeripheral:(CBPeripheral*)peripheral delegate:(id<SURFERPeripheralDelegate>) delegate
+//This connects the TX scheduler to CoreBluetooth. The scheduler lives inside the peripheral object, so it never outlives it.
+//The link's flow control credit depends on the kind of write, so it is checked in transmitOnChannel rather than with canWrite.
+static bool surferPeripheralTxWrite(void *context, TxChannel channel, const uint8_t *bytes, size_t length)
+{
+    SURFERPeripheral *surferPeripheral = (__bridge SURFERPeripheral *)context;
+    
+    return [surferPeripheral transmitOnChannel:channel data:[NSData dataWithBytes:bytes length:length]];
+}
+
+- (SURFERPeripheral *) initWithPeripheral:(CBPeripheral*)peripheral readerId:(uint8_t) readerId delegate:(id<SURFERPeripheralDelegate>) delegate
 {
     if (self = [super init])
     {
         _peripheral = peripheral;
         _peripheral.delegate = self;
         _delegate = delegate;
+        _isPrimary = YES;
+        
+        TxTransport transport = {(__bridge void *)self, NULL, surferPeripheralTxWrite};
+        txSchedulerInit(&_txScheduler, transport, NULL, NULL);
+        
+        if (!readerSessionInit(&_readerSession, readerId, READER_SESSION_DEFAULT_QUEUE_CAPACITY))
+        {
+            return nil;
+        }
+        _drainQueue = dispatch_queue_create("SURFERControl.drain", DISPATCH_QUEUE_SERIAL);
     }
     return self;
 }
 
+- (void) dealloc
+{
+    readerSessionFree(&_readerSession);
+}
+
+- (TxScheduler *) txScheduler
+{
+    return &_txScheduler;
+}
+
+- (ReaderSession *) readerSession
+{
+    return &_readerSession;
+}
+
+- (uint8_t) readerId
+{
+    return _readerSession.readerId;
+}
+
 - (void) didConnect
 {
     [_peripheral discoverServices:@[self.class.surferServiceUUID, self.class.deviceInformationServiceUUID]];
@@ -157,7 +205,51 @@
 
 - (void) didDisconnect
 {
+    [self stopTrace];
+    txSchedulerClear(&_txScheduler);
+}
+
+//----------------------------------------------------------------------------------------------------------------
+//
+//These are functions used to record the data sent by the reader, so that it can be replayed later.
+
+- (BOOL) startTraceToFile:(NSString *) path
+{
+    [self stopTrace];
     
+    if(!btleTraceWriterOpen(&_traceWriter, [path fileSystemRepresentation])){
+        [self stopTrace];
+        return NO;
+    }
+    NSLog(@"Started recording a BTLE trace to %@", path);
+    return YES;
+}
+
+- (void) stopTrace
+{
+    if(btleTraceWriterIsOpen(&_traceWriter)){
+        NSLog(@"Stopped recording a BTLE trace after %llu notifications", _traceWriter.numRecords);
+        if(!btleTraceWriterClose(&_traceWriter)){
+            NSLog(@"BTLE trace file may be incomplete");
+        }
+    }
+}
+
+- (void) traceCharacteristic:(CBCharacteristic *) characteristic
+{
+    BTLETraceChannel channel;
+    
+    if (characteristic == self.writeTargetEPCCharacteristic)        channel = BTLE_TRACE_TARGET_EPC;
+    else if (characteristic == self.writeNewEPCCharacteristic)      channel = BTLE_TRACE_NEW_EPC;
+    else if (characteristic == self.readStateCharacteristic)        channel = BTLE_TRACE_READ_STATE;
+    else if (characteristic == self.packetData1Characteristic)      channel = BTLE_TRACE_PKT1;
+    else if (characteristic == self.packetData2Characteristic)      channel = BTLE_TRACE_PKT2;
+    else if (characteristic == self.waveformDataCharacteristic)     channel = BTLE_TRACE_WAVEFORM;
+    else if (characteristic == self.logMessageCharacteristic)       channel = BTLE_TRACE_LOG_MESSAGE;
+    else if ([characteristic.UUID isEqual:self.class.hardwareRevisionStringUUID]) channel = BTLE_TRACE_HW_REVISION;
+    else return;
+    
+    btleTraceWriterAppend(&_traceWriter, channel, characteristic.value.bytes, characteristic.value.length);
 }
 
 //----------------------------------------------------------------------------------------------------------------
@@ -166,56 +258,108 @@
 
 - (void) writeStateData:(NSData *) data
 {
-    if ((self.writeStateCharacteristic.properties & CBCharacteristicPropertyWriteWithoutResponse) != 0)
-    {
-        [self.peripheral writeValue:data forCharacteristic:self.writeStateCharacteristic type:CBCharacteristicWriteWithoutResponse];
-        //NSLog(@"Wrote %d chars",[data length]);
-        
-    }
-    else if ((self.writeStateCharacteristic.properties & CBCharacteristicPropertyWrite) != 0)
+    [self writeStateData:data priority:TX_PRIORITY_NORMAL];
+}
+
+- (void) writeStateData:(NSData *) data priority:(TxPriority) priority
+{
+    [self enqueueOnChannel:TX_CHANNEL_STATE priority:priority data:data];
+}
+
+- (void) writeTargetEPCData:(NSData *) data
+{
+    [self enqueueOnChannel:TX_CHANNEL_TARGET_EPC priority:TX_PRIORITY_NORMAL data:data];
+}
+
+- (void) writeNewEPCData:(NSData *) data
+{
+    [self enqueueOnChannel:TX_CHANNEL_NEW_EPC priority:TX_PRIORITY_NORMAL data:data];
+}
+
+- (void) enqueueOnChannel:(TxChannel) channel priority:(TxPriority) priority data:(NSData *) data
+{
+    TxEnqueueResult result = txSchedulerEnqueue(&_txScheduler, channel, priority, data.bytes, data.length);
+    
+    if (result == TX_ENQUEUE_QUEUE_FULL)
     {
-        [self.peripheral writeValue:data forCharacteristic:self.writeStateCharacteristic type:CBCharacteristicWriteWithResponse];
+        NSLog(@"TX queue is full, dropped a write of %lu bytes.", (unsigned long)data.length);
     }
-    else
+    else if (result == TX_ENQUEUE_TOO_LONG)
     {
-        NSLog(@"No write property on Write State characteristic, %lu.", (unsigned long)self.writeStateCharacteristic.properties);
+        NSLog(@"Can't send a write of %lu bytes.", (unsigned long)data.length);
     }
+    [self serviceTxQueue];
 }
 
-- (void) writeTargetEPCData:(NSData *) data
+//Sends what the scheduler allows now. If it's waiting on the interval budget, we come back when the oldest packet in
+//the window has aged out of it.
+//If it's waiting on the link, peripheralIsReadyToSendWriteWithoutResponse brings us back, but we also retry after one
+//interval in case a write with response was what held it up.
+- (void) serviceTxQueue
 {
-    if ((self.writeTargetEPCCharacteristic.properties & CBCharacteristicPropertyWriteWithoutResponse) != 0)
-    {
-        [self.peripheral writeValue:data forCharacteristic:self.writeTargetEPCCharacteristic type:CBCharacteristicWriteWithoutResponse];
-        //NSLog(@"Wrote %d chars",[data length]);
-        
-    }
-    else if ((self.writeTargetEPCCharacteristic.properties & CBCharacteristicPropertyWrite) != 0)
+    uint64_t delayNs;
+    
+    txSchedulerService(&_txScheduler);
+    
+    delayNs = txSchedulerServiceDelayNs(&_txScheduler);
+    if (delayNs == TX_SCHEDULER_NO_SERVICE || _txServiceScheduled)
     {
-        [self.peripheral writeValue:data forCharacteristic:self.writeTargetEPCCharacteristic type:CBCharacteristicWriteWithResponse];
+        return;
     }
-    else
+    if (delayNs == 0)
     {
-        NSLog(@"No write property on Write Target EPC characteristic, %lu.", (unsigned long)self.writeTargetEPCCharacteristic.properties);
+        delayNs = _txScheduler.intervalNs;
     }
+    
+    _txServiceScheduled = YES;
+    __weak SURFERPeripheral *weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)delayNs), dispatch_get_main_queue(), ^{
+        SURFERPeripheral *strongSelf = weakSelf;
+        if (strongSelf)
+        {
+            strongSelf->_txServiceScheduled = NO;
+            [strongSelf serviceTxQueue];
+        }
+    });
 }
 
-- (void) writeNewEPCData:(NSData *) data
+- (void) peripheralIsReadyToSendWriteWithoutResponse:(CBPeripheral *)peripheral
+{
+    [self serviceTxQueue];
+}
+
+//Returns NO only if the link can't take the write right now. A write to a characteristic that can't be written is
+//logged and dropped, since retrying won't help.
+- (BOOL) transmitOnChannel:(TxChannel) channel data:(NSData *) data
 {
-    if ((self.writeNewEPCCharacteristic.properties & CBCharacteristicPropertyWriteWithoutResponse) != 0)
+    CBCharacteristic *characteristic;
+    
+    switch (channel)
     {
-        [self.peripheral writeValue:data forCharacteristic:self.writeNewEPCCharacteristic type:CBCharacteristicWriteWithoutResponse];
+        case TX_CHANNEL_STATE:          characteristic = self.writeStateCharacteristic;     break;
+        case TX_CHANNEL_TARGET_EPC:     characteristic = self.writeTargetEPCCharacteristic; break;
+        case TX_CHANNEL_NEW_EPC:        characteristic = self.writeNewEPCCharacteristic;    break;
+        default:                        return YES;
+    }
+    
+    if ((characteristic.properties & CBCharacteristicPropertyWriteWithoutResponse) != 0)
+    {
+        if (!self.peripheral.canSendWriteWithoutResponse)
+        {
+            return NO;
+        }
+        [self.peripheral writeValue:data forCharacteristic:characteristic type:CBCharacteristicWriteWithoutResponse];
         //NSLog(@"Wrote %d chars",[data length]);
-        
     }
-    else if ((self.writeNewEPCCharacteristic.properties & CBCharacteristicPropertyWrite) != 0)
+    else if ((characteristic.properties & CBCharacteristicPropertyWrite) != 0)
     {
-        [self.peripheral writeValue:data forCharacteristic:self.writeNewEPCCharacteristic type:CBCharacteristicWriteWithResponse];
+        [self.peripheral writeValue:data forCharacteristic:characteristic type:CBCharacteristicWriteWithResponse];
     }
     else
     {
-        NSLog(@"No write property on Write New EPC characteristic, %lu.", (unsigned long)self.writeStateCharacteristic.properties);
+        NSLog(@"No write property on characteristic %@, %lu.", characteristic.UUID, (unsigned long)characteristic.properties);
     }
+    return YES;
 }
 
 - (void) readTargetEPCData
@@ -371,7 +515,24 @@
     
     //NSLog(@"Received data on a characteristic.");
     
-    if (characteristic == self.writeTargetEPCCharacteristic)
+    if (btleTraceWriterIsOpen(&_traceWriter))
+    {
+        [self traceCharacteristic:characteristic];
+    }
+    
+    //Tag data from every reader goes into its session. Everything else only matters from the primary reader.
+    if (characteristic == self.packetData1Characteristic || characteristic == self.packetData2Characteristic)
+    {
+        NSData *data = [characteristic value];
+        readerSessionPush(&_readerSession, characteristic == self.packetData1Characteristic ? READER_PACKET_PKT1 : READER_PACKET_PKT2,
+                          data.bytes, data.length, monotonicClockNs());
+        [self.delegate surferPeripheralDidQueueTagPackets:self];
+    }
+    else if (!self.isPrimary)
+    {
+        return;
+    }
+    else if (characteristic == self.writeTargetEPCCharacteristic)
     {
         NSData *data = [characteristic value];
         [self.delegate didReceiveTargetEPCData:data];
@@ -390,18 +551,6 @@
         //NSString *string = [NSString stringWithUTF8String:[[characteristic value] bytes]];
         //NSLog(@"Received %s",[[characteristic value] bytes]);
     }
-    else if (characteristic == self.packetData1Characteristic)
-    {
-    
-        NSData *data = [characteristic value];
-        [self.delegate didReceivePacketData1Data:data];
-    }
-    else if (characteristic == self.packetData2Characteristic)
-    {
-        
-        NSData *data = [characteristic value];
-        [self.delegate didReceivePacketData2Data:data];
-    }
     else if (characteristic == self.waveformDataCharacteristic)
     {
         
@@ -48,13 +48,14 @@
 #import "SURFERPeripheral.h"
 #import "TagListViewController.h"
 
-#define WAVEFORM_FIFO_SIZE      65536
 #define LOG_MESSAGE_FIFO_SIZE   256
+#define CONSOLE_VISIBLE_LINES   200     //The console only ever shows this many of the most recent lines.
 #define MAX_NUM_BYTES_IN_EPC    12
 #define NUM_PCKT1_DATA_BYTES    20
 #define NUM_PCKT2_DATA_BYTES    16
 #define MAX_WAVEFORM_DATA_BYTES 20
 #define MAX_LOG_MESSAGE_BYTES   20
+#define READER_SCAN_WINDOW_SECONDS  5   //After the first reader is found, keep scanning this long for more of them.
 
 @interface TableViewController : UITableViewController <UITextFieldDelegate, CBCentralManagerDelegate, SURFERPeripheralDelegate, NSStreamDelegate,UIImagePickerControllerDelegate,UINavigationControllerDelegate,
     TagListViewControllerDelegate>
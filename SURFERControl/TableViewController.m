@@ -41,12 +41,16 @@
 //                                                                                  //
 //////////////////////////////////////////////////////////////////////////////////////
 
-#include <mach/mach.h>
-#include <mach/mach_time.h>
 
 #import "TagListViewController.h"
 #import "TableViewController.h"
 #import "RFIDTagList.h"
+#import "TagPacketDecoder.h"
+#import "WaveformCapture.h"
+#import "WaveformAnalysis.h"
+#import "ConsoleLog.h"
+#import "MonotonicClock.h"
+#import <QuartzCore/QuartzCore.h>
 #import <math.h>
 
 #pragma mark - Typedef enums of states
@@ -95,13 +99,6 @@ typedef enum
     LAST_INV            =   1
 } OperationState;
 
-//This state reflects the tag data coming in. We need to know if we got supplementary data while we were waiting for it.
-typedef enum
-{
-    WAIT_PKT1           =   0,
-    WAIT_PKT2           =   1
-} TagDataState;
-
 #pragma mark - Properties and Interfaces
 
 @interface TableViewController ()
@@ -109,11 +106,15 @@ typedef enum
 @property ConnectionState c_state;
 @property AppState a_state;
 @property OperationState o_state;
-@property TagDataState t_state;
-@property SURFERPeripheral *currentPeripheral;
-@property NSTimer *txTimer;
+@property SURFERPeripheral *currentPeripheral; //The primary reader. The app's state follows this one.
+@property NSMutableArray *readers; //Every reader connected or being connected to, including the primary one.
 @property NSTimer *debugTimer; //This timer is used to create fake BTLE tag sends for debugging the app in simulation
 @property NSString *rxFilename;
+@property NSString *hardwareRevision; //Saved into the header of waveform captures.
+@property CADisplayLink *consoleDisplayLink; //Redraws the console from the console log at most once per frame.
+@property NSDateFormatter *consoleTimeFormatter;
+
+- (void) handleTagReadFromReader:(uint8_t)readerId read:(const TagRead *)read observation:(const TagStoreObservation *)observation;
 
 @end
 
@@ -122,6 +123,7 @@ typedef enum
 
 //The current peripheral refers to the BLTE connection to the MCU firmware.
 @synthesize cm = _cm;
+@synthesize a_state = _a_state;
 @synthesize currentPeripheral = _currentPeripheral;
 
 #pragma mark - Static Variable Declarations
@@ -137,10 +139,18 @@ static uint8_t m_targetEPC_length                   =    MAX_NUM_BYTES_IN_EPC;
 //The only length of this will be MAX_NUM_BYTES_IN_EPC since we don't want to program an incomplete EPC into a tag.
 static uint8_t m_thenewEPC[MAX_NUM_BYTES_IN_EPC]     =   {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x89, 0xAB, 0xCD, 0xEF};
 
-//This is a FIFO for recovering the waveform data from the reader.
-static uint8_t m_WaveformDataFifo[3*WAVEFORM_FIFO_SIZE]   =   {0};
-//This is the write pointer for the FIFO
-static int  m_waveformFifoWP                            =   0;
+//This is the file that waveform data from the reader is streamed into, a chunk at a time.
+static WaveformCapture m_waveformCapture;
+//The same data is analyzed as it comes in, so that the results are ready when the capture ends.
+static WaveformAnalysis m_waveformAnalysis;
+
+//This is the store behind the console. Lines are added here and the console view is redrawn from it once per frame.
+static ConsoleLog m_consoleLog;
+//The lines copied out of the log for drawing, and how many lines had been added when the console was last drawn.
+static ConsoleLogRecord m_consoleTail[CONSOLE_VISIBLE_LINES];
+static uint64_t m_consoleNumDrawn                       =   0;
+//Added to a log timestamp to get seconds since 1970, for showing wall clock times.
+static double m_consoleWallClockOffset                  =   0;
 
 //This is a FIFO for recovering log messages from the reader.
 static uint8_t m_logMessageFifo[LOG_MESSAGE_FIFO_SIZE]  =   {0};
@@ -148,25 +158,25 @@ static uint8_t m_logMessageFifo[LOG_MESSAGE_FIFO_SIZE]  =   {0};
 static int m_logMessageFifoWP                           =   0;
 
 //During the invertory state, we keep track of the number of inventoried tags.
-//This number should get reset in between inventory operations.
+//This number should get reset in between inventory operations. It is counted up on the ingest queue.
 static uint32_t m_numTagsInventoried                    =   0;
 
-//It looks like we keep track of transmitted packets per connection interval.
-//If we recall correctly, each connection interval is on the order of 30ms.
-//If we recall correctly, this counter is needed because we can only send 6 packets per connection interval.
-static uint8_t m_txPktsPerCnxnIntvl                     =   0;
-
 //We time the inventory for benchmarking purposes.
 //Ultimately this time is dictated by the BTLE packet interval rate allowed by Apple.
 static uint64_t m_startInventoryTime                    =   0;
 
-//These are state variables for holding tag data in between a 2-packet data push
-static NSString *m_currentEpc                           =   @"ABCDEF012345ABCDEF678901";
-static uint8_t m_frequencySlot                          =   0;
-static int32_t m_antMagI                                =   0;
-static int32_t m_antMagQ                                =   0;
-static uint8_t m_dataIdOld                              =   0;
-static uint8_t m_dataIdNew                              =   0;
+//The tag data from each reader is decoded by that reader's session. This one is only for the fake packets made up by
+//the debug timer, so that they go down the same path as real ones, and it has a drain queue of its own like theirs.
+static ReaderSession m_debugReaderSession;
+static dispatch_queue_t m_debugDrainQueue;
+
+//The tag list's latency probe, kept here so that the packet handlers don't have to look it up for every packet.
+//Like the rest of the tag list, it belongs to the ingest queue.
+static LatencyProbe *m_latencyProbe                     =   NULL;
+
+//Reads are saved on the tag list's ingest queue, which keeps its own copy of the app state to decide what to do
+//with each read. It is brought up to date on that queue with every state change, so it is in order with the reads.
+static AppState m_ingestAppState                        =   UNKNOWN;
 
 #pragma mark - Init, View Loads and Segues
 
@@ -181,15 +191,33 @@ static uint8_t m_dataIdNew                              =   0;
 
     self.a_state            =   UNKNOWN;
     self.o_state            =   APP_SPECD;
-    self.t_state            =   WAIT_PKT1;
     self.rxFilename         =   nil;
-    m_numTagsInventoried    =   0;
-    m_currentEpc            =   @"ABCDEF012345ABCDEF678901";
-    m_frequencySlot         =   0;
-    m_antMagI               =   0;
-    m_antMagQ               =   0;
-    m_dataIdOld             =   255; //Start at 255 so that the first packet is 0
-    m_dataIdNew             =   255; //start at 255 so that the first packet is 0
+    __atomic_store_n(&m_numTagsInventoried, 0, __ATOMIC_RELAXED);
+    self.readers            =   [[NSMutableArray alloc] init];
+    
+    //Latency probes are turned on with the SURFERLatencyProbes user default, e.g. "-SURFERLatencyProbes YES" as a launch argument.
+    m_latencyProbe          =   [RFIDTagList theOnlyRFIDTagList].latencyProbe;
+    BOOL enableProbes       =   [[NSUserDefaults standardUserDefaults] boolForKey:@"SURFERLatencyProbes"];
+    dispatch_async([RFIDTagList theOnlyRFIDTagList].ingestQueue, ^{
+        latencyProbeSetEnabled(m_latencyProbe, enableProbes);
+    });
+    
+    //The read history is turned on the same way, with the SURFERReadHistory user default. It goes in Documents/ReadHistory.
+    if([[NSUserDefaults standardUserDefaults] boolForKey:@"SURFERReadHistory"]){
+        NSString *documents = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+        [[RFIDTagList theOnlyRFIDTagList] openReadHistoryInDirectory:[documents stringByAppendingPathComponent:@"ReadHistory"]];
+    }
+    
+    //The console log has to exist before anything is printed to the console.
+    if(!m_consoleLog.records){
+        consoleLogInit(&m_consoleLog, CONSOLE_LOG_DEFAULT_CAPACITY);
+        m_consoleWallClockOffset    =   [[NSDate date] timeIntervalSince1970] - monotonicClockNs()/1e9;
+    }
+    self.consoleTimeFormatter = [[NSDateFormatter alloc] init];
+    [self.consoleTimeFormatter setDateFormat:@"HH:mm:ss.SSS"];
+    [self.consoleDisplayLink invalidate];
+    self.consoleDisplayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(consoleDisplayLinkFired:)];
+    [self.consoleDisplayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
     
     //Load dummy values into EPC state variables in case syncing with the reader doesn't work.
     
@@ -213,10 +241,6 @@ static uint8_t m_dataIdNew                              =   0;
     [_currentPeripheral readTargetEPCData];
     [_currentPeripheral readNewEPCData];
     
-    //This is setting the BTLE packet timer. Experimentation showed us that 30ms is about the correct setting here.
-    [self.txTimer invalidate];
-    self.txTimer=[NSTimer scheduledTimerWithTimeInterval:0.03 target:self selector:@selector(txTimerFireMethod:) userInfo:nil repeats:YES];
-    
     //This is setting the debug timer. We want to send packets about 30s after starting the app
     //FOr now we do not have it repeat.
     [self.debugTimer invalidate];
@@ -254,7 +278,7 @@ static uint8_t m_dataIdNew                              =   0;
     
     self.a_state            =   UNKNOWN;
     self.rxFilename         =   nil;
-    m_numTagsInventoried    =   0;
+    __atomic_store_n(&m_numTagsInventoried, 0, __ATOMIC_RELAXED);
     
     //Above code added 083017
     
@@ -309,18 +333,7 @@ static uint8_t m_dataIdNew                              =   0;
 //This appears to be a function which returns the time in milliseconds.
 uint64_t getTickCount(void)
 {
-    static mach_timebase_info_data_t sTimebaseInfo;
-    uint64_t machTime = mach_absolute_time();
-    
-    // Convert to nanoseconds - if this is the first time we've run, get the timebase.
-    if (sTimebaseInfo.denom == 0 )
-    {
-        (void) mach_timebase_info(&sTimebaseInfo);
-    }
-    
-    // Convert the mach time to milliseconds
-    uint64_t millis = ((machTime / 1000000) * sTimebaseInfo.numer) / sTimebaseInfo.denom;
-    return millis;
+    return monotonicClockNs()/1000000;
 }
 
 #pragma mark - Button Enable/Disable
@@ -614,6 +627,13 @@ uint64_t getTickCount(void)
         //If a zero-length EPC is entered, that's OK. This means that no masking operations will be performed
         //during search, inventory, etc.
         
+        //Otherwise, say how many of the tags seen so far are in the group it selects. The reader masks whole bytes.
+        if(m_targetEPC_length > 0){
+            NSUInteger numMatching = [[RFIDTagList theOnlyRFIDTagList] countTagsMatchingPrefix:m_targetEPC bits:8*m_targetEPC_length];
+            
+            [self addTextToConsole:[NSString stringWithFormat:@"Target EPC matches %lu of the tags seen so far",(unsigned long)numMatching]];
+        }
+        
     } else {
         for (int loop_tfsee=0; loop_tfsee < MAX_NUM_BYTES_IN_EPC; loop_tfsee++){
             [hex appendFormat:@"%02X" , (*(m_thenewEPC+loop_tfsee) & 0x00FF)];
@@ -662,16 +682,30 @@ uint64_t getTickCount(void)
             break;
             
         case CONNECTED:
+            //Disconnecting the primary reader disconnects the rest of them too.
             NSLog(@"Disconnect peripheral %@", self.currentPeripheral.peripheral.name);
+            [self.cm stopScan];
             [self.cm cancelPeripheralConnection:self.currentPeripheral.peripheral];
             break;
     }
 }
 
+//Commands that start or stop reading tags go to every reader, so that they all cover the floor together.
+//Commands that act on one tag, such as programming or killing it, only go to the primary reader.
+- (void)writeStateToAllReaders:(uint8_t)state priority:(TxPriority)priority
+{
+    for(SURFERPeripheral *reader in self.readers){
+        [reader writeStateData:[[NSData alloc] initWithBytes:&state length:1] priority:priority];
+    }
+}
+
 - (IBAction)targetEPCButtonTouched:(id)sender {
     if(self.a_state==IDLE_CONFIGURED){
      
-        [_currentPeripheral writeTargetEPCData: [[NSData alloc] initWithBytes:&m_targetEPC length:m_targetEPC_length]];
+        //Every reader searches and tracks the same target.
+        for(SURFERPeripheral *reader in self.readers){
+            [reader writeTargetEPCData: [[NSData alloc] initWithBytes:&m_targetEPC length:m_targetEPC_length]];
+        }
         NSLog(@"Yes you actually sent a target epc");
         //[_currentPeripheral readTargetEPCData];
     }
@@ -691,9 +725,7 @@ uint64_t getTickCount(void)
     NSLog(@"Yes you pressed the initialize button");
     
     if(self.a_state==IDLE_UNCONFIGURED || self.a_state==UNKNOWN){
-        uint8_t byteToSend  =   (uint8_t)INITIALIZING_A;
-        
-        [_currentPeripheral writeStateData: [[NSData alloc] initWithBytes:&byteToSend length:1]];
+        [self writeStateToAllReaders:(uint8_t)INITIALIZING_A priority:TX_PRIORITY_NORMAL];
         NSLog(@"Yes you actually sent an initalize");
     }
     
@@ -702,13 +734,9 @@ uint64_t getTickCount(void)
 - (IBAction)searchButtonPressed:(id)sender {
 
     if(self.a_state==IDLE_CONFIGURED && self.o_state==APP_SPECD){
-        uint8_t byteToSend  =   (uint8_t)SEARCHING_APP_SPECD;
-        
-        [_currentPeripheral writeStateData: [[NSData alloc] initWithBytes:&byteToSend length:1]];
+        [self writeStateToAllReaders:(uint8_t)SEARCHING_APP_SPECD priority:TX_PRIORITY_NORMAL];
     } else if(self.a_state==IDLE_CONFIGURED && self.o_state==LAST_INV){
-        uint8_t byteToSend  =   (uint8_t)SEARCHING_LAST_INV;
-        
-        [_currentPeripheral writeStateData: [[NSData alloc] initWithBytes:&byteToSend length:1]];
+        [self writeStateToAllReaders:(uint8_t)SEARCHING_LAST_INV priority:TX_PRIORITY_NORMAL];
     }
     
 }
@@ -716,9 +744,7 @@ uint64_t getTickCount(void)
 - (IBAction)inventoryButtonPressed:(id)sender{
     
     if(self.a_state==IDLE_CONFIGURED){
-        uint8_t byteToSend  =   (uint8_t)INVENTORYING;
-        
-        [_currentPeripheral writeStateData: [[NSData alloc] initWithBytes:&byteToSend length:1]];
+        [self writeStateToAllReaders:(uint8_t)INVENTORYING priority:TX_PRIORITY_NORMAL];
     }
     
 }
@@ -760,13 +786,9 @@ uint64_t getTickCount(void)
 - (IBAction)trackButtonPressed:(id)sender{
     
     if((self.a_state==IDLE_CONFIGURED && self.o_state==APP_SPECD) || self.a_state==TRACK_APP_SPECD){
-        uint8_t byteToSend  =   (uint8_t)TRACK_APP_SPECD;
-        
-        [_currentPeripheral writeStateData: [[NSData alloc] initWithBytes:&byteToSend length:1]];
+        [self writeStateToAllReaders:(uint8_t)TRACK_APP_SPECD priority:TX_PRIORITY_NORMAL];
     } else if((self.a_state==IDLE_CONFIGURED && self.o_state==LAST_INV) || self.a_state==TRACK_LAST_INV){
-        uint8_t byteToSend  =   (uint8_t)TRACK_LAST_INV;
-        
-        [_currentPeripheral writeStateData: [[NSData alloc] initWithBytes:&byteToSend length:1]];
+        [self writeStateToAllReaders:(uint8_t)TRACK_LAST_INV priority:TX_PRIORITY_NORMAL];
     }
     
 }
@@ -805,9 +827,8 @@ uint64_t getTickCount(void)
 - (IBAction)resetASICsButtonPressed:(id)sender {
     if(self.a_state == IDLE_CONFIGURED || self.a_state == IDLE_UNCONFIGURED ||
        self.a_state == TESTING_DTC || self.a_state == TRACK_APP_SPECD || self.a_state == TRACK_LAST_INV){
-        uint8_t byteToSend  =   (uint8_t)RESET_ASICS;
-        
-        [_currentPeripheral writeStateData: [[NSData alloc] initWithBytes:&byteToSend length:1]];
+        //The reset goes ahead of anything still waiting to be sent.
+        [self writeStateToAllReaders:(uint8_t)RESET_ASICS priority:TX_PRIORITY_URGENT];
         NSLog(@"Yes you actually sent a reset");
     }
 }
@@ -891,13 +912,6 @@ uint64_t getTickCount(void)
 {
     int dataLength = (int)[data length];
     uint64_t        elapsedInventoryTime =  0;
-    NSData          *waveformDataAsObject;
-    NSDateFormatter *formatter;
-    NSString        *dateString;
-    NSArray         *paths;
-    NSString        *documentsDirectory;
-    NSString        *fileName;
-    NSString        *FilePath;
     uint8_t         *peripheral_state;
     
     if(dataLength != 1){
@@ -958,6 +972,7 @@ uint64_t getTickCount(void)
                     self.a_state=PROG_LAST_INV;
                     break;
                 case(RECOV_WVFM_MEM):
+                    [self startWaveformCapture];
                     self.a_state=RECOV_WVFM_MEM;
                     break;
                 case(RESET_ASICS):
@@ -1011,9 +1026,15 @@ uint64_t getTickCount(void)
             switch(*peripheral_state){
                 case(IDLE_CONFIGURED):
                     elapsedInventoryTime = (getTickCount()-m_startInventoryTime)/1000;
-                    [self addTextToConsole:[NSString stringWithFormat:@"Inventory over: counted %d tags in %llu seconds",m_numTagsInventoried,elapsedInventoryTime]];
-                    m_numTagsInventoried=0;
                     self.a_state=IDLE_CONFIGURED;
+                    //Let the ingest queue get through the reads that came in before the state change, so that they are counted.
+                    dispatch_async([RFIDTagList theOnlyRFIDTagList].ingestQueue, ^{
+                        uint32_t numTagsInventoried = __atomic_exchange_n(&m_numTagsInventoried, 0, __ATOMIC_RELAXED);
+                        dispatch_async(dispatch_get_main_queue(), ^{
+                            [self addTextToConsole:[NSString stringWithFormat:@"Inventory over: counted %d tags in %llu seconds",numTagsInventoried,elapsedInventoryTime]];
+                        });
+                    });
+                    [self reportLatencyProbe];
                     break;
                 default:
                     [self addTextToConsole:[NSString stringWithFormat:@"Error: illegal state transition from INVENTORYING detected"]];
@@ -1053,24 +1074,12 @@ uint64_t getTickCount(void)
         case(RECOV_WVFM_MEM):
             switch(*peripheral_state){
                 case(IDLE_CONFIGURED):
-                    //Dump fifo to file and reset the fifo pointer
-                    waveformDataAsObject    = [NSData dataWithBytes:m_WaveformDataFifo length:3*m_waveformFifoWP];
-                    // and then you can…
-                    formatter               = [[NSDateFormatter alloc] init];
-                    [formatter setDateFormat:@"MM-dd-yyyy-HH-mm"];
-                    dateString              = [formatter stringFromDate:[NSDate date]];
-                    
-                    paths                   = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES);
-                    documentsDirectory      = [paths objectAtIndex:0];
-                    fileName                = [NSString stringWithFormat:@"waveform%@.txt",dateString];
-                    FilePath                = [documentsDirectory stringByAppendingPathComponent:fileName];
-                    
-                    [waveformDataAsObject writeToFile:FilePath atomically:YES];
-                    
-                    m_waveformFifoWP    =   0;
+                    //The data has been going to the file all along, so all that's left is to finish it off.
+                    [self finishWaveformCapture];
                     self.a_state=IDLE_CONFIGURED;
                     break;
                 default:
+                    [self finishWaveformCapture];
                     [self addTextToConsole:[NSString stringWithFormat:@"Error: illegal state transition from RECOV_WVFM_MEM detected"]];
                     self.a_state=*peripheral_state; //Go there anyway so we don't lock up our app.
                     break;
@@ -1113,6 +1122,7 @@ uint64_t getTickCount(void)
             switch(*peripheral_state){
                 case(IDLE_CONFIGURED):
                     self.a_state=IDLE_CONFIGURED;
+                    [self reportLatencyProbe];
                     break;
                 case(TRACK_APP_SPECD):
                     self.a_state=TRACK_APP_SPECD;
@@ -1130,6 +1140,7 @@ uint64_t getTickCount(void)
             switch(*peripheral_state){
                 case(IDLE_CONFIGURED):
                     self.a_state=IDLE_CONFIGURED;
+                    [self reportLatencyProbe];
                     break;
                 case(TRACK_LAST_INV):
                     self.a_state=TRACK_LAST_INV;
@@ -1177,166 +1188,120 @@ uint64_t getTickCount(void)
 
 #pragma mark - BTLE Tag Data Handlers
 
-//When we read a tag either in search or inventory, the reader pushes data back over a BTLE indication.
-//The first data back is the EPC, the exit code, and the RFID operation number.
-- (void) didReceivePacketData1Data:(NSData *)data
+//When we read a tag either in search or inventory, the reader pushes data back over two BTLE indications.
+//The first data back is the EPC, the exit code, and the RFID operation number. The second is the I and Q magnitude data.
+//Note that this data is sent as the "main" and "alt" data, which correpond to I and Q respectively only when the MCU formware sets
+//the "use_i" flag.
+//In the future, we will need to sync up the use_i flag in iOS software so that we can accurately
+//report I and Q data to higher-level software.
+//Each reader queues these in its own session, which decodes them with TagPacketDecoder and merges the reads into the
+//tag store. That happens on the reader's own drain queue, so that the main thread only has to queue the notifications
+//and readers don't wait on each other. Only saving the reads into the tag list goes through its ingest queue.
+//Here we just report what happened and pass on complete reads.
+- (void) surferPeripheralDidQueueTagPackets:(SURFERPeripheral *)surferPeripheral
 {
-    int dataLength = (int)[data length]; //assume length < buffer size for the time being
+    //The block holds on to the reader, so that its session outlives the drain even if the reader disconnects.
+    dispatch_async(surferPeripheral.drainQueue, ^{
+        [self drainReaderSession:surferPeripheral.readerSession];
+    });
+}
+
+//A read on its way from a drain queue to the ingest queue.
+typedef struct
+{
+    TagRead             read;
+    TagStoreObservation observation;
+} TableViewControllerPendingRead;
+
+static void tableViewControllerLogDecodeWarnings(uint8_t readerId, uint32_t flags)
+{
+    if(flags & TAG_DECODE_BAD_LENGTH){
+        consoleLogAppendf(&m_consoleLog, CONSOLE_LOG_ERROR, CONSOLE_LOG_SOURCE_DECODER, "Reader %d: Received tag data but wrong # bytes", readerId);
+    }
     
-    if(dataLength != NUM_PCKT1_DATA_BYTES) {
-        [self addTextToConsole:[NSString stringWithFormat:@"Received Data 1 but wrong # bytes"]];
-        return;
+    if(flags & TAG_DECODE_SEQUENCE_GAP){
+        consoleLogAppendf(&m_consoleLog, CONSOLE_LOG_WARNING, CONSOLE_LOG_SOURCE_DECODER, "Reader %d: Got data packets out of order. May be due to reader reset.", readerId);
     }
-    else {
-            
-        if(self.a_state==INVENTORYING){
-            m_numTagsInventoried++; //If we are doing an inventory, let's count up the number of tags we are inventorying.
-        }
-        
-        uint8_t *dataBuf=malloc(dataLength * sizeof(uint8_t));
-        [data getBytes:dataBuf length:dataLength];
-        
-        //Unpack the data from the packet
-        
-        m_currentEpc = [NSString stringWithFormat:@"%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x",
-        dataBuf[0], dataBuf[1], dataBuf[2], dataBuf[3], dataBuf[4], dataBuf[5],
-        dataBuf[6], dataBuf[7], dataBuf[8], dataBuf[9], dataBuf[10], dataBuf[11]];
-        
-        BOOL expectingSupplementData = (dataBuf[12] & 128) != 0; //Supplement data indicator is contained in the msb of this byte
-        m_frequencySlot = dataBuf[12] & 31; //Mask off the lower 5 bits - frequencySlot can only go up to 31.
-        m_antMagI = (int32_t)(((uint32_t)dataBuf[13] << 24)+((uint32_t)dataBuf[14] << 16)+((uint32_t)dataBuf[15] << 8));
-        m_antMagQ = (int32_t)(((uint32_t)dataBuf[16] << 24)+((uint32_t)dataBuf[17] << 16)+((uint32_t)dataBuf[18] << 8));
-        m_dataIdOld=m_dataIdNew;
-        m_dataIdNew=dataBuf[19]; //A nonce that we can use if we get packets out of order
-        
-        if(m_dataIdNew != ((m_dataIdOld+1) % 256)){
-            [self addTextToConsole:[NSString stringWithFormat:@"Got data packets out of order. May be due to reader reset."]];
-        }
-        
-        switch(self.t_state){
-            case WAIT_PKT2:
-                //Uh-oh, we were waiting for PKT2 but got a packet 1? Disregard the previous packet 1 and proceed as normal.
-                //Do make a note of the incident in the console, however.
-                [self addTextToConsole:[NSString stringWithFormat:@"Got PKT1 while expecting PKT2."]];
-              
-            case WAIT_PKT1:
-                
-                if(!expectingSupplementData){
-                    
-                    //If we're not expecting supplemental data, write the tag data to the tag list now
-                    //If we're not doing supplemental tag data, we're only doing hops (no PDOA)
-                    //If we're not doing supplemental data, we don't have cal data.
-                    
-                    //BELOW IS A METHOD - MUST SEND TO THE RIGHT OBJECT
-                    [[RFIDTagList theOnlyRFIDTagList] saveTagWithEPC: m_currentEpc
-                                                        withFreqSlot: m_frequencySlot
-                                                      withHopNotSkip: TRUE
-                                                    withHopSkipNonce: 128
-                                                    //We put a dummy value in here that is unlikely to result in an unflagged scenario in which
-                                                    //a non-supplement hop read is combined with a supplement skip read to result in
-                                                    //a valid-seeming ranging measurement. (Recall hop and skip nonce must be same to
-                                                    //produce a valid range measurement).
-                                                    //Also with CalMag=0, attempting to make any ranging measurement with this
-                                                    //information should result in an error (99.9m being displayed).
-                                                         withAntMagI: m_antMagI
-                                                         withAntMagQ: m_antMagQ
-                                                         withCalMagI: 0
-                                                         withCalMagQ: 0];
-                    self.t_state=WAIT_PKT1;
-                } else {
-                    //If we are expecting supplemental data, then wait until the next packet to send it to the iDevice.
-                    self.t_state=WAIT_PKT2;
-                }
-                
-                break;
-                
-            default:
-                [self addTextToConsole:[NSString stringWithFormat:@"Got unknown packet state"]];
-                break;
-                
-        }
+    
+    if(flags & TAG_DECODE_PKT1_IN_WAIT_PKT2){
+        //Uh-oh, we were waiting for PKT2 but got a packet 1? The decoder disregards the previous packet 1.
+        //Do make a note of the incident in the console, however.
+        consoleLogAppendf(&m_consoleLog, CONSOLE_LOG_WARNING, CONSOLE_LOG_SOURCE_DECODER, "Reader %d: Got PKT1 while expecting PKT2.", readerId);
+    }
+    
+    if(flags & TAG_DECODE_PKT2_IN_WAIT_PKT1){
+        //Uh-oh, we were waiting for PKT1 but got a packet 2?
+        //The decoder disregards this packet 2 and retains state as waiting for packet 1.
+        consoleLogAppendf(&m_consoleLog, CONSOLE_LOG_WARNING, CONSOLE_LOG_SOURCE_DECODER, "Reader %d: Got PKT2 while expecting PKT1", readerId);
+    }
+}
+
+//Warnings go straight to the console log, which any thread may append to. Reads are collected for the ingest queue.
+static void tableViewControllerHandleTagData(void *context, ReaderSession *session, uint32_t flags,
+                                             const TagRead *read, const TagStoreObservation *observation)
+{
+    NSMutableData *pendingReads = (__bridge NSMutableData *)context;
+    
+    if(flags & TAG_DECODE_READ_READY){
+        TableViewControllerPendingRead pending = {*read, *observation};
         
+        [pendingReads appendBytes:&pending length:sizeof(pending)];
+    }
+    else{
+        tableViewControllerLogDecodeWarnings(session->readerId, flags);
     }
 }
 
-//When we read a tag either in search or inventory, the reader pushes data back over a BTLE indication.
-//The second data back is the I and Q magnitude data.
-//Note that this data is sent as the "main" and "alt" data, which correpond to I and Q respectively only when the MCU formware sets
-//the "use_i" flag.
-//In the future, we will need to sync up the use_i flag in iOS software so that we can accurately
-//report I and Q data to higher-level software.
+//Runs on the drain queue of the session's reader. The reads of one drain are handed to the ingest queue together.
+- (void) drainReaderSession:(ReaderSession *)session
+{
+    RFIDTagList     *tagList        = [RFIDTagList theOnlyRFIDTagList];
+    NSMutableData   *pendingReads   = [NSMutableData data];
+    uint8_t         readerId        = session->readerId;
+    
+    session->latencyProbe = m_latencyProbe;
+    readerSessionDrain(session, tagList.tagStore, UINT32_MAX, tableViewControllerHandleTagData, (__bridge void *)pendingReads);
+    
+    if(pendingReads.length){
+        dispatch_async(tagList.ingestQueue, ^{
+            const TableViewControllerPendingRead    *pending    = pendingReads.bytes;
+            NSUInteger                              numPending  = pendingReads.length/sizeof(TableViewControllerPendingRead);
+            
+            for(NSUInteger i=0; i<numPending; i++){
+                [self handleTagReadFromReader:readerId read:&pending[i].read observation:&pending[i].observation];
+            }
+        });
+    }
+}
 
-- (void) didReceivePacketData2Data:(NSData *)data
+//Neither side of the session may be in use while it is reset. Nothing is pushed while the main thread waits here, and
+//the drains already queued for the reader run first.
+- (void) resetReaderSession:(SURFERPeripheral *)reader
 {
-    int dataLength = (int)[data length]; //assume length < buffer size for the time being
+    dispatch_sync(reader.drainQueue, ^{
+        readerSessionReset(reader.readerSession);
+    });
+}
+
+//Runs on the tag list's ingest queue, which is where the latency probe and m_ingestAppState belong.
+- (void) handleTagReadFromReader:(uint8_t)readerId read:(const TagRead *)read observation:(const TagStoreObservation *)observation
+{
+    //The session timed this read when it came out of the decoder, before its batch was merged.
+    latencyProbeMarkNotify(m_latencyProbe, observation->timestampNs);
+    latencyProbeMarkDecodedAt(m_latencyProbe, observation->decodedNs);
     
-    if(dataLength != NUM_PCKT2_DATA_BYTES) {
-        [self addTextToConsole:[NSString stringWithFormat:@"Received Data 2 but wrong # bytes"]];
-        return;
-    } else {
-        uint8_t *dataBuf=malloc(dataLength * sizeof(uint8_t));
-        [data getBytes:dataBuf length:dataLength];
-        
-        //Unpack the data from the packet.
-        //Bytes 1 and 2 are acutally the LSB of the antenna magI and magQ
-        
-        //Don't add LSB for now. Actually this turned out not to really matter so try to add in when possible.
-        m_antMagI += (uint32_t)dataBuf[1];
-        m_antMagQ += (uint32_t)dataBuf[2];
-        //Next, get the calibration magI and magQ
-        int32_t calMagI = (int32_t)(((uint32_t)dataBuf[4] << 24)+((uint32_t)dataBuf[5] << 16)+((uint32_t)dataBuf[6] << 8)+((uint32_t)dataBuf[7] << 0));
-        int32_t calMagQ = (int32_t)(((uint32_t)dataBuf[8] << 24)+((uint32_t)dataBuf[9] << 16)+((uint32_t)dataBuf[10] << 8)+((uint32_t)dataBuf[11] << 0));
-        BOOL hopNotSkip = (dataBuf[12] == 255);
-        m_dataIdOld=m_dataIdNew;
-        uint8_t hopSkipNonce=dataBuf[14];
-        m_dataIdNew=dataBuf[15]; //A nonce that we can use if we get packets out of order
-        
-        //For debug. DOn't do this in tracking mode though or it will slow down the app a lot.
-        if(self.a_state != TRACK_APP_SPECD && self.a_state != TRACK_LAST_INV){
-            [self addTextToConsole:[NSString stringWithFormat:@"freqSlot: %d",m_frequencySlot]];
-            [self addTextToConsole:[NSString stringWithFormat:@"antMagI: %d",m_antMagI]];
-            [self addTextToConsole:[NSString stringWithFormat:@"antMagQ: %d",m_antMagQ]];
-            [self addTextToConsole:[NSString stringWithFormat:@"calMagI: %d",calMagI]];
-            [self addTextToConsole:[NSString stringWithFormat:@"calMagQ: %d",calMagQ]];
-        }
-        
-        if(m_dataIdNew != (m_dataIdOld+1) % 256){
-            [self addTextToConsole:[NSString stringWithFormat:@"Got data packets out of order. May be due to reader reset."]];
-        }
-        
-        switch(self.t_state){
-            case WAIT_PKT1:
-                //Uh-oh, we were waiting for PKT1 but got a packet 2?
-                //Disregard this packet 2 and exit this function.
-                //We retain state as waiting for packaet 1.
-                [self addTextToConsole:[NSString stringWithFormat:@"Got PKT2 while expecting PKT1"]];
-                break;
-                
-            case WAIT_PKT2:
-                           
-                //If we're not expecting supplemental data, write the tag data to the tag list now
-                //If we're not doing supplemental tag data, we're only doing hops (no PDOA)
-                //If we're not doing supplemental data, we don't have cal data.
-                           
-                //BELOW IS A METHOD - MUST SEND TO THE RIGHT OBJECT
-                [[RFIDTagList theOnlyRFIDTagList] saveTagWithEPC: m_currentEpc
-                                                        withFreqSlot: m_frequencySlot
-                                                        withHopNotSkip: hopNotSkip
-                                                        withHopSkipNonce: hopSkipNonce
-                                                        withAntMagI: m_antMagI
-                                                        withAntMagQ: m_antMagQ
-                                                        withCalMagI: calMagI
-                                                        withCalMagQ: calMagQ];
-                //OK, everything worked out. Now we wait for packet 1 again.
-                self.t_state=WAIT_PKT1;
-                break;
-                       
-            default:
-                [self addTextToConsole:[NSString stringWithFormat:@"Got unknown packet state"]];
-                break;
-                       
-               }
+    if(m_ingestAppState==INVENTORYING){
+        __atomic_add_fetch(&m_numTagsInventoried, 1, __ATOMIC_RELAXED); //If we are doing an inventory, let's count up the number of tags we are inventorying.
     }
+    
+    //For debug. DOn't do this in tracking mode though or it will slow down the app a lot.
+    //It goes straight into the console log, one line per read, so that no string is made for it until it is drawn.
+    if(m_ingestAppState != TRACK_APP_SPECD && m_ingestAppState != TRACK_LAST_INV){
+        consoleLogAppendf(&m_consoleLog, CONSOLE_LOG_INFO, CONSOLE_LOG_SOURCE_DECODER, "Reader %d: slot %d ant %d/%d cal %d/%d",
+                          readerId, read->freqSlot, read->antMagI, read->antMagQ, read->calMagI, read->calMagQ);
+    }
+    
+    [[RFIDTagList theOnlyRFIDTagList] saveTagRead:read observation:observation];
 }
 
 #pragma mark - BTLE Waveform Data Handler
@@ -1346,40 +1311,102 @@ uint64_t getTickCount(void)
 //containing the sequential bytes that were in the waveform RAM.
 - (void) didReceiveWaveformDataData:(NSData *)data
 {
-    //Fill up waveform buffer. When we transition back to idle, we dump the buffer to a file
+    //Append the packed bytes to the capture file. The bits are kept as the reader sent them, earliest bit in the LSB.
+    //They only get expanded to one ASCII bit per line by the wvfm2txt tool, if the text format is wanted.
     //Check that we are in the waveform receive state
     if(self.a_state==RECOV_WVFM_MEM){
-        int dataLength = (int)[data length]; //assume length < buffer size for the time being
-        uint8_t *dataBuf=malloc(dataLength * sizeof(uint8_t));
-        [data getBytes:dataBuf length:dataLength];
-        
-        for(int i=0; i<dataLength; i++){
-            for(int j=0; j<8; j++){
-                if(m_waveformFifoWP < WAVEFORM_FIFO_SIZE){
-                    //For each bit, sub in the appropriate ASCII 0 or 1
-                    //In other words, we get a binary 0 or 1 in, and we need to turn that into an ASCII 0 or 1
-                    m_WaveformDataFifo[(3*m_waveformFifoWP)+0]=0x30+((dataBuf[i] >> j) & 1);
-                    //After each ASCII 0 or 1, we "hit return" so that the bits are all in a vertical column in the text file.
-                    m_WaveformDataFifo[(3*m_waveformFifoWP)+1]=0x0D;    //Carriage return
-                    m_WaveformDataFifo[(3*m_waveformFifoWP)+2]=0x0A;    //line feed
-                    m_waveformFifoWP++;
-                    //Indeed, the earliest bits in time are the LSBs
-                }
-                //Don't have the buffer overflow else check here otherwise we will have a million of them maybe.
-            }
+        //Only report the first failure, otherwise we would get one for every notification.
+        if(waveformCaptureIsOpen(&m_waveformCapture) && !m_waveformCapture.failed
+           && !waveformCaptureAppend(&m_waveformCapture, [data bytes], [data length])){
+            [self addTextToConsole:[NSString stringWithFormat:@"Error: could not write waveform data to the capture file"]];
         }
-        
-        //Have buffer overflow check here so that we only get one of them.
-        if(m_waveformFifoWP > WAVEFORM_FIFO_SIZE){
-            [self addTextToConsole:[NSString stringWithFormat:@"Program attempted a waveform data buffer overflow"]];
+        //The analysis goes on whether or not the file could be written. If it runs out of memory, what it has so far
+        //would be misleading, so it is dropped and not reported.
+        if(m_waveformAnalysis.words && !waveformAnalysisAppend(&m_waveformAnalysis, [data bytes], [data length])){
+            waveformAnalysisFree(&m_waveformAnalysis);
+            [self addTextToConsole:[NSString stringWithFormat:@"Error: not enough memory to analyze the waveform"]];
         }
-        
     }
     else{
         [self addTextToConsole:[NSString stringWithFormat:@"Error: Got waveform data while outside of the waveform data state"]];
     }
 }
 
+//Captures go in the documents directory, named by the time they were started.
+
+- (void)startWaveformCapture
+{
+    NSDateFormatter *formatter  = [[NSDateFormatter alloc] init];
+    NSDate          *now        = [NSDate date];
+    NSArray         *paths      = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES);
+    NSString        *fileName;
+    NSString        *filePath;
+    
+    //Don't leave a capture open from before, e.g. if the reader went away partway through.
+    waveformCaptureClose(&m_waveformCapture);
+    
+    [formatter setDateFormat:@"MM-dd-yyyy-HH-mm"];
+    fileName    = [NSString stringWithFormat:@"waveform%@.wvfm",[formatter stringFromDate:now]];
+    filePath    = [[paths objectAtIndex:0] stringByAppendingPathComponent:fileName];
+    
+    if(!waveformCaptureOpen(&m_waveformCapture, [filePath fileSystemRepresentation], [self.hardwareRevision UTF8String],
+                            (uint64_t)([now timeIntervalSince1970]*1e6))){
+        [self addTextToConsole:[NSString stringWithFormat:@"Error: could not create waveform capture file %@",fileName]];
+        waveformCaptureClose(&m_waveformCapture);
+    }
+    
+    if(m_waveformAnalysis.words){
+        waveformAnalysisReset(&m_waveformAnalysis);
+    } else {
+        WaveformAnalysisParams params;
+        
+        waveformAnalysisDefaultParams(&params);
+        if(!waveformAnalysisInit(&m_waveformAnalysis, &params)){
+            [self addTextToConsole:[NSString stringWithFormat:@"Error: could not set up waveform analysis"]];
+        }
+    }
+}
+
+- (void)finishWaveformCapture
+{
+    if(waveformCaptureIsOpen(&m_waveformCapture)){
+        uint64_t numBits = 8*m_waveformCapture.numBytes;
+        
+        if(waveformCaptureClose(&m_waveformCapture)){
+            [self addTextToConsole:[NSString stringWithFormat:@"Saved waveform capture of %llu bits",numBits]];
+        } else {
+            [self addTextToConsole:[NSString stringWithFormat:@"Error: waveform capture file may be incomplete"]];
+        }
+    }
+    
+    [self reportWaveformAnalysis];
+}
+
+//Only the tail of the capture is left to analyze by now, so this doesn't hold up the UI. An analysis that is already
+//finished was reported at the end of an earlier capture.
+
+- (void)reportWaveformAnalysis
+{
+    if(!m_waveformAnalysis.words || m_waveformAnalysis.finished){
+        return;
+    }
+    waveformAnalysisFinish(&m_waveformAnalysis);
+    
+    [self addTextToConsole:[NSString stringWithFormat:@"Waveform: duty cycle %2.1f%%, %llu edges, most common runs %u zeros and %u ones, longest %llu and %llu",
+                            100*waveformAnalysisDutyCycle(&m_waveformAnalysis),m_waveformAnalysis.numEdges,
+                            waveformAnalysisMostCommonRun(&m_waveformAnalysis, 0),waveformAnalysisMostCommonRun(&m_waveformAnalysis, 1),
+                            m_waveformAnalysis.longestRun[0],m_waveformAnalysis.longestRun[1]]];
+    [self addTextToConsole:[NSString stringWithFormat:@"Waveform: found %u Miller-%u replies",m_waveformAnalysis.numPackets,
+                            m_waveformAnalysis.params.millerM]];
+    //A long capture can have hundreds of them. Tools/wvfmstat lists them all from the capture file.
+    for(uint32_t i=0; i<m_waveformAnalysis.numPackets && i<8; i++){
+        const WaveformPacket *packet = &m_waveformAnalysis.packets[i];
+        
+        [self addTextToConsole:[NSString stringWithFormat:@"Reply at bit %llu: preamble %1.2f, %u symbols, weakest %1.2f",
+                                packet->bitOffset,packet->preambleScore,packet->numSymbols,packet->minSymbolScore]];
+    }
+}
+
 //This code allows setting the name of the file which will contain data from the waveform capture.
 
 void setRxFilename(char* file_name, void *uData){
@@ -1402,7 +1429,6 @@ void setRxFilename(char* file_name, void *uData){
     //When we see a null character, dump the data to the console and reset the fifo pointer
     //The other thing we need to do is to ensure that data beyond the fifo pointer is not printed
     
-        NSString        *logMessage;
         int dataLength = (int)[data length]; //assume length < buffer size for the time being
         uint8_t *dataBuf=malloc(dataLength * sizeof(uint8_t));
         [data getBytes:dataBuf length:dataLength];
@@ -1416,18 +1442,16 @@ void setRxFilename(char* file_name, void *uData){
             if(dataBuf[i]==0){
                 //uint8_t *cleanLogMessageBuf=malloc(m_logMessageFifoWP * sizeof(uint8_t));
                 //memcpy(cleanLogMessageBuf,m_logMessageFifo,m_logMessageFifoWP);
-                logMessage = [NSString stringWithUTF8String:(char *)m_logMessageFifo];
-                [self addTextToConsole:[NSString stringWithFormat:@"SURFER: %@",logMessage]];
+                consoleLogAppend(&m_consoleLog, CONSOLE_LOG_INFO, CONSOLE_LOG_SOURCE_FIRMWARE, (char *)m_logMessageFifo);
                 m_logMessageFifoWP  =   0;
             }
         }
     
         if(m_logMessageFifoWP >= LOG_MESSAGE_FIFO_SIZE){
-            [self addTextToConsole:[NSString stringWithFormat:@"Program attempted a log message data buffer overflow"]];
+            consoleLogAppend(&m_consoleLog, CONSOLE_LOG_ERROR, CONSOLE_LOG_SOURCE_APP, "Program attempted a log message data buffer overflow");
             //Ensure the final character is a null data character, dump the data and reset the fifo pointer.
             m_logMessageFifo[LOG_MESSAGE_FIFO_SIZE-1]=0;
-            logMessage = [NSString stringWithUTF8String:(char *)m_logMessageFifo];
-            [self addTextToConsole:[NSString stringWithFormat:@"SURFER: %@",logMessage]];
+            consoleLogAppend(&m_consoleLog, CONSOLE_LOG_INFO, CONSOLE_LOG_SOURCE_FIRMWARE, (char *)m_logMessageFifo);
             m_logMessageFifoWP  =   0;
         }
     
@@ -1436,28 +1460,69 @@ void setRxFilename(char* file_name, void *uData){
 }
 
 //The function below came from Nordic Semiconductor's ViewController.m file.
-//In this case, we merely print text while prepending a timestamp.
+//The text now goes into the console log, with the timestamp prepended when it's drawn. Errors are picked out by their prefix.
 
 - (void) addTextToConsole:(NSString *) string
 {
+    [self addTextToConsole:string fromSource:CONSOLE_LOG_SOURCE_APP
+              withSeverity:[string hasPrefix:@"Error"] ? CONSOLE_LOG_ERROR : CONSOLE_LOG_INFO];
+}
 
-    NSDateFormatter *formatter;
-    formatter = [[NSDateFormatter alloc] init];
-    [formatter setDateFormat:@"HH:mm:ss.SSS"];
+- (void) addTextToConsole:(NSString *)string fromSource:(ConsoleLogSource)source withSeverity:(ConsoleLogSeverity)severity
+{
+    const char *text = [string UTF8String];
+    
+    consoleLogAppend(&m_consoleLog, severity, source, text ? text : "");
+}
+
+//Once per frame, redraw the console with the most recent lines if any have been added since last time.
+//The cost of this depends only on CONSOLE_VISIBLE_LINES, not on how long the app has been running.
+
+- (void)consoleDisplayLinkFired:(CADisplayLink *)displayLink
+{
+    uint64_t        numAppended = consoleLogNumAppended(&m_consoleLog);
+    uint32_t        numLines;
+    NSMutableString *text;
+    
+    if(numAppended == m_consoleNumDrawn){
+        return;
+    }
+    m_consoleNumDrawn   = numAppended;
+    
+    numLines    = consoleLogCopyTail(&m_consoleLog, m_consoleTail, CONSOLE_VISIBLE_LINES);
+    text        = [[NSMutableString alloc] initWithCapacity:numLines*48];
+    
+    for(uint32_t i=0; i<numLines; i++){
+        ConsoleLogRecord    *record = &m_consoleTail[i];
+        NSDate              *date   = [NSDate dateWithTimeIntervalSince1970:m_consoleWallClockOffset + record->timestampNs/1e9];
+        NSString            *piece  = [[NSString alloc] initWithBytes:record->text length:record->length encoding:NSUTF8StringEncoding];
+        
+        //Firmware messages aren't checked for being UTF-8, so show their bytes one per character rather than nothing.
+        if(!piece){
+            piece = [[NSString alloc] initWithBytes:record->text length:record->length encoding:NSISOLatin1StringEncoding];
+        }
+        //The rest of a long line goes back on the end of the line it came from.
+        if(record->continued && text.length){
+            [text deleteCharactersInRange:NSMakeRange(text.length-1, 1)];
+            [text appendFormat:@"%@\n", piece];
+            continue;
+        }
+        [text appendFormat:@"[%@]: %@%@\n",[self.consoleTimeFormatter stringFromDate:date],
+         record->source == CONSOLE_LOG_SOURCE_FIRMWARE ? @"SURFER: " : @"", piece];
+    }
     
-    self.consoleTextView.text = [self.consoleTextView.text stringByAppendingFormat:@"[%@]: %@\n",[formatter stringFromDate:[NSDate date]], string];
+    self.consoleTextView.text = text;
     
+    [self.consoleTextView setScrollEnabled:NO];
+    [self.consoleTextView scrollRangeToVisible:NSMakeRange(text.length, 0)];
+    [self.consoleTextView setScrollEnabled:YES];
 }
 
 //This button clears the log screen. It fills up pretty fast.
 - (IBAction)clearButtonPressed:(id)sender {
  // Clear the console
-    self.consoleTextView.text = [NSString stringWithFormat:@"Cleared\n"];
-    
-    [self.consoleTextView setScrollEnabled:NO];
-    NSRange bottom = NSMakeRange(self.consoleTextView.text.length-1, self.consoleTextView.text.length);
-    [self.consoleTextView scrollRangeToVisible:bottom];
-    [self.consoleTextView setScrollEnabled:YES];
+    consoleLogClear(&m_consoleLog);
+    [self addTextToConsole:@"Cleared"];
 }
 
 #pragma mark - Bluetooth Connection
@@ -1482,16 +1547,65 @@ void setRxFilename(char* file_name, void *uData){
 //The function below came from Nordic Semiconductor's ViewController.m file.
 - (void) centralManager:(CBCentralManager *)central didDiscoverPeripheral:(CBPeripheral *)peripheral advertisementData:(NSDictionary *)advertisementData RSSI:(NSNumber *)RSSI
 {
+    SURFERPeripheral    *reader;
+    uint32_t            usedReaderIds = 0;
+    uint8_t             readerId;
+    
+    for(SURFERPeripheral *existing in self.readers){
+        if([existing.peripheral isEqual:peripheral]){
+            return;
+        }
+        usedReaderIds |= 1u << existing.readerId;
+    }
+    
     NSLog(@"Did discover peripheral %@ with RSSI: %@", peripheral.name, RSSI);
     [self addTextToConsole:[NSString stringWithFormat:@"Did discover peripheral %@ with RSSI: %@", peripheral.name, RSSI]];
     
-    [self.cm stopScan];
+    //The last reader ID is kept for the debug timer's made-up reads.
+    for(readerId=0; readerId<TAG_STORE_DEBUG_READER && (usedReaderIds & (1u << readerId)); readerId++){
+    }
+    if(readerId == TAG_STORE_DEBUG_READER){
+        [self.cm stopScan];
+        return;
+    }
     
-    self.currentPeripheral = [[SURFERPeripheral alloc] initWithPeripheral:peripheral delegate:self];
+    reader = [[SURFERPeripheral alloc] initWithPeripheral:peripheral readerId:readerId delegate:self];
+    if(!reader){
+        return;
+    }
+    
+    //The ID may have belonged to a reader that has since gone away. What that reader saw isn't this one's. Its own
+    //drains were finished when it went, and this one's are queued after this.
+    dispatch_async(reader.drainQueue, ^{
+        tagStoreForgetReader([RFIDTagList theOnlyRFIDTagList].tagStore, readerId);
+    });
+    
+    //The first reader found is the primary one. We keep scanning for a little while longer so that the other readers
+    //covering the floor can join in.
+    if(!self.currentPeripheral){
+        self.currentPeripheral = reader;
+        __weak TableViewController *weakSelf = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(READER_SCAN_WINDOW_SECONDS*NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+            [weakSelf.cm stopScan];
+        });
+    } else {
+        reader.isPrimary = NO;
+    }
+    [self.readers addObject:reader];
     
     [self.cm connectPeripheral:peripheral options:@{CBConnectPeripheralOptionNotifyOnDisconnectionKey: [NSNumber numberWithBool:YES]}];
 }
 
+- (SURFERPeripheral *) readerForPeripheral:(CBPeripheral *)peripheral
+{
+    for(SURFERPeripheral *reader in self.readers){
+        if([reader.peripheral isEqual:peripheral]){
+            return reader;
+        }
+    }
+    return nil;
+}
+
 //Usually, this function will be seen to execute right after didDiscoverPeripheral
 //This is also a reset function.
 //No state-syncing is performed yet (the iOS state is the UNKNOWN state at the moment) because
@@ -1502,15 +1616,25 @@ void setRxFilename(char* file_name, void *uData){
 //The basic portions of the function below came from Nordic Semiconductor's ViewController.m file.
 - (void) centralManager:(CBCentralManager *)central didConnectPeripheral:(CBPeripheral *)peripheral
 {
+    SURFERPeripheral *reader = [self readerForPeripheral:peripheral];
+    
     NSLog(@"Did connect peripheral %@", peripheral.name);
     
+    //Additional readers just need to be set up. The app state only follows the primary reader.
+    if(reader && !reader.isPrimary){
+        [self addTextToConsole:[NSString stringWithFormat:@"Did connect to %@ as reader %d", peripheral.name, reader.readerId]];
+        [self resetReaderSession:reader];
+        [reader didConnect];
+        return;
+    }
+    
     [self addTextToConsole:[NSString stringWithFormat:@"Did connect to %@", peripheral.name]];
     
     self.c_state = CONNECTED;
     
     
     self.a_state            =   UNKNOWN;
-    m_numTagsInventoried    =   0;
+    __atomic_store_n(&m_numTagsInventoried, 0, __ATOMIC_RELAXED);
     
     //Following code added 083017
     self.rxFilename         =   nil;
@@ -1538,7 +1662,33 @@ void setRxFilename(char* file_name, void *uData){
     
     if ([self.currentPeripheral.peripheral isEqual:peripheral])
     {
+        [self resetReaderSession:self.currentPeripheral];
         [self.currentPeripheral didConnect];
+        [self startTraceIfEnabled];
+    }
+}
+
+//Recording a trace of everything the reader sends is turned on with the SURFERRecordBTLETrace user default,
+//e.g. by passing "-SURFERRecordBTLETrace YES" as a launch argument. Traces can be replayed with Tools/tracereplay.c.
+- (void) startTraceIfEnabled
+{
+    NSDateFormatter *formatter;
+    NSArray         *paths;
+    NSString        *fileName;
+    
+    if(![[NSUserDefaults standardUserDefaults] boolForKey:@"SURFERRecordBTLETrace"]){
+        return;
+    }
+    
+    formatter   = [[NSDateFormatter alloc] init];
+    [formatter setDateFormat:@"MM-dd-yyyy-HH-mm-ss"];
+    paths       = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES);
+    fileName    = [NSString stringWithFormat:@"trace%@.surftrace",[formatter stringFromDate:[NSDate date]]];
+    
+    if([self.currentPeripheral startTraceToFile:[[paths objectAtIndex:0] stringByAppendingPathComponent:fileName]]){
+        [self addTextToConsole:[NSString stringWithFormat:@"Recording BTLE trace to %@",fileName]];
+    } else {
+        [self addTextToConsole:[NSString stringWithFormat:@"Error: could not create BTLE trace file %@",fileName]];
     }
 }
 
@@ -1548,32 +1698,113 @@ void setRxFilename(char* file_name, void *uData){
 //The function below came from Nordic Semiconductor's ViewController.m file.
 - (void) centralManager:(CBCentralManager *)central didDisconnectPeripheral:(CBPeripheral *)peripheral error:(NSError *)error
 {
+    SURFERPeripheral    *reader = [self readerForPeripheral:peripheral];
+    char                txReport[256];
+    
     NSLog(@"Did disconnect peripheral %@", peripheral.name);
     
     [self addTextToConsole:[NSString stringWithFormat:@"Did disconnect from %@, error code %ld", peripheral.name, (long)error.code]];
     
+    if(reader){
+        [reader didDisconnect];
+        txSchedulerFormatReport(reader.txScheduler, txReport, sizeof(txReport));
+        [self addTextToConsole:[NSString stringWithFormat:@"Reader %d %s", reader.readerId, txReport]];
+        //Its ID can go to the next reader found, so what it has queued has to be merged under this one first.
+        dispatch_sync(reader.drainQueue, ^{});
+        [self.readers removeObject:reader];
+    }
+    
+    //Losing one of the additional readers doesn't change the app state.
+    if(reader && !reader.isPrimary){
+        return;
+    }
+    
     self.c_state            =   IDLE;
     self.a_state            =   UNKNOWN;
     
-    m_numTagsInventoried    =   0;
+    __atomic_store_n(&m_numTagsInventoried, 0, __ATOMIC_RELAXED);
     
-    if ([self.currentPeripheral.peripheral isEqual:peripheral])
-    {
-        [self.currentPeripheral didDisconnect];
+    //The other readers only follow the primary one, so they are disconnected along with it.
+    if(reader == self.currentPeripheral){
+        for(SURFERPeripheral *other in self.readers){
+            [self.cm cancelPeripheralConnection:other.peripheral];
+        }
+        self.currentPeripheral = nil;
+    }
+}
+
+#pragma mark - Latency Probe
+
+//Every state change also goes to the ingest queue, for the latency probe to count reads per state and for the tag
+//handlers to act on. The tag list shows smoothed values in the tracking states.
+- (AppState)a_state
+{
+    return _a_state;
+}
+
+- (void)setA_state:(AppState)a_state
+{
+    RFIDTagList *tagList = [RFIDTagList theOnlyRFIDTagList];
+    
+    _a_state = a_state;
+    dispatch_async(tagList.ingestQueue, ^{
+        m_ingestAppState = a_state;
+        latencyProbeSetState(tagList.latencyProbe, a_state);
+        tagList.tracking = (a_state == TRACK_APP_SPECD || a_state == TRACK_LAST_INV);
+    });
+}
+
+//At the end of an inventory or a track, print the throughput and latencies to the console and add them to latency.txt
+//in the documents directory. Then start counting again for the next one.
+- (void)reportLatencyProbe
+{
+    static const int    states[]        = {INVENTORYING, TRACK_APP_SPECD, TRACK_LAST_INV};
+    static const char   *stateNames[]   = {"INVENTORYING", "TRACK_APP_SPECD", "TRACK_LAST_INV"};
+    
+    if(!m_latencyProbe->enabled){
+        return;
     }
+    
+    //The probe is only read on the ingest queue. Going through it also means the reads queued before now are counted.
+    dispatch_async([RFIDTagList theOnlyRFIDTagList].ingestQueue, ^{
+        NSMutableData *report = [NSMutableData dataWithLength:latencyProbeFormatReport(m_latencyProbe, states, stateNames, 3, NULL, 0)+1];
+        latencyProbeFormatReport(m_latencyProbe, states, stateNames, 3, [report mutableBytes], [report length]);
+        [report setLength:[report length]-1];
+        latencyProbeReset(m_latencyProbe);
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self writeLatencyReport:report];
+        });
+    });
 }
 
-//This resets the BTLE packet counter for a given connection interval.
-- (void)txTimerFireMethod:(NSTimer *)timer{
-    if (timer==self.txTimer){
-        m_txPktsPerCnxnIntvl=0;
+- (void)writeLatencyReport:(NSData *)report
+{
+    NSArray             *paths          = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES);
+    NSString            *filePath       = [[paths objectAtIndex:0] stringByAppendingPathComponent:@"latency.txt"];
+    NSFileHandle        *file;
+    
+    for(NSString *line in [[[NSString alloc] initWithData:report encoding:NSUTF8StringEncoding] componentsSeparatedByString:@"\n"]){
+        if([line length]){
+            [self addTextToConsole:line];
+        }
+    }
+    
+    if(![[NSFileManager defaultManager] fileExistsAtPath:filePath]){
+        [[NSFileManager defaultManager] createFileAtPath:filePath contents:nil attributes:nil];
     }
+    file = [NSFileHandle fileHandleForWritingAtPath:filePath];
+    [file seekToEndOfFile];
+    [file writeData:[[NSString stringWithFormat:@"%@\n",[NSDate date]] dataUsingEncoding:NSUTF8StringEncoding]];
+    [file writeData:report];
+    [file closeFile];
 }
 
 #pragma mark - Miscellaneous
 
 - (void) didReadHardwareRevisionString:(NSString *)string
 {
+    self.hardwareRevision = string;
     [self addTextToConsole:[NSString stringWithFormat:@"Hardware revision: %@", string]];
 }
 
@@ -1771,16 +2002,22 @@ void setRxFilename(char* file_name, void *uData){
         NSData *tag2Packet2Data1 = [[NSData alloc] initWithBytes:dataBuft2p2d1 length:NUM_PCKT1_DATA_BYTES];
         NSData *tag2Packet2Data2 = [[NSData alloc] initWithBytes:dataBuft2p2d2 length:NUM_PCKT2_DATA_BYTES];
         
-        //Call the methods - we're mocking BTLE data transfers here
-        [self didReceivePacketData1Data:tag1Packet1Data1];
-        [self didReceivePacketData2Data:tag1Packet1Data2];
-        [self didReceivePacketData1Data:tag1Packet2Data1];
-        [self didReceivePacketData2Data:tag1Packet2Data2];
-        
-        [self didReceivePacketData1Data:tag2Packet1Data1];
-        [self didReceivePacketData2Data:tag2Packet1Data2];
-        [self didReceivePacketData1Data:tag2Packet2Data1];
-        [self didReceivePacketData2Data:tag2Packet2Data2];
+        //Queue the packets - we're mocking BTLE data transfers here
+        //The fake reader has a reader ID of its own, which no real reader is given.
+        if(!m_debugReaderSession.queue){
+            if(!readerSessionInit(&m_debugReaderSession, TAG_STORE_DEBUG_READER, READER_SESSION_DEFAULT_QUEUE_CAPACITY)){
+                return;
+            }
+            m_debugDrainQueue = dispatch_queue_create("SURFERControl.drain.debug", DISPATCH_QUEUE_SERIAL);
+        }
+        for(NSData *data in @[tag1Packet1Data1, tag1Packet1Data2, tag1Packet2Data1, tag1Packet2Data2,
+                              tag2Packet1Data1, tag2Packet1Data2, tag2Packet2Data1, tag2Packet2Data2]){
+            readerSessionPush(&m_debugReaderSession, [data length] == NUM_PCKT1_DATA_BYTES ? READER_PACKET_PKT1 : READER_PACKET_PKT2,
+                              [data bytes], [data length], monotonicClockNs());
+        }
+        dispatch_async(m_debugDrainQueue, ^{
+            [self drainReaderSession:&m_debugReaderSession];
+        });
     }
 }
 
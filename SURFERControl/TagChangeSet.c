@@ -0,0 +1,171 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagChangeSet.c                                                            //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module collects the rows of the RFID tag list that were inserted or        //
+//  updated since the views were last told about them, so that many tag reads       //
+//  can be reported to the views in one batch.                                      //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "TagChangeSet.h"
+
+#define TAG_CHANGE_INSERTED     1
+#define TAG_CHANGE_UPDATED      2
+
+//Make sure that there is room to mark the given row.
+static bool tagChangeSetReserve(TagChangeSet *changeSet, uint32_t row)
+{
+    uint32_t    newCapacity =   changeSet->rowCapacity ? changeSet->rowCapacity : 256;
+    uint32_t    *inserted;
+    uint32_t    *updated;
+    uint8_t     *marks;
+    
+    if(row < changeSet->rowCapacity){
+        return true;
+    }
+    
+    while(newCapacity <= row){
+        newCapacity *= 2;
+    }
+    
+    inserted    =   realloc(changeSet->insertedRows, newCapacity*sizeof(uint32_t));
+    if(!inserted){
+        return false;
+    }
+    changeSet->insertedRows = inserted;
+    
+    updated     =   realloc(changeSet->updatedRows, newCapacity*sizeof(uint32_t));
+    if(!updated){
+        return false;
+    }
+    changeSet->updatedRows = updated;
+    
+    marks       =   realloc(changeSet->rowMarks, newCapacity);
+    if(!marks){
+        return false;
+    }
+    memset(marks+changeSet->rowCapacity, 0, newCapacity-changeSet->rowCapacity);
+    changeSet->rowMarks     =   marks;
+    changeSet->rowCapacity  =   newCapacity;
+    
+    return true;
+}
+
+void tagChangeSetInit(TagChangeSet *changeSet, uint64_t intervalNs, TagChangeSetClock clock, void *clockContext)
+{
+    memset(changeSet, 0, sizeof(*changeSet));
+    
+    changeSet->intervalNs   =   intervalNs;
+    changeSet->clock        =   clock ? clock : monotonicClockNsWithContext;
+    changeSet->clockContext =   clockContext;
+}
+
+void tagChangeSetFree(TagChangeSet *changeSet)
+{
+    tagChangeSetReset(changeSet);
+    
+    free(changeSet->insertedRows);
+    free(changeSet->updatedRows);
+    free(changeSet->rowMarks);
+    
+    changeSet->insertedRows =   NULL;
+    changeSet->updatedRows  =   NULL;
+    changeSet->rowMarks     =   NULL;
+    changeSet->rowCapacity  =   0;
+}
+
+void tagChangeSetReset(TagChangeSet *changeSet)
+{
+    //Only the marked rows need their flags cleared.
+    for(uint32_t i=0; i<changeSet->numInsertedRows; i++){
+        changeSet->rowMarks[changeSet->insertedRows[i]] = 0;
+    }
+    for(uint32_t i=0; i<changeSet->numUpdatedRows; i++){
+        changeSet->rowMarks[changeSet->updatedRows[i]] = 0;
+    }
+    
+    changeSet->numInsertedRows  =   0;
+    changeSet->numUpdatedRows   =   0;
+}
+
+bool tagChangeSetMarkInserted(TagChangeSet *changeSet, uint32_t row)
+{
+    if(!tagChangeSetReserve(changeSet, row)){
+        return false;
+    }
+    
+    if(!(changeSet->rowMarks[row] & TAG_CHANGE_INSERTED)){
+        changeSet->rowMarks[row] |= TAG_CHANGE_INSERTED;
+        changeSet->insertedRows[changeSet->numInsertedRows++] = row;
+    }
+    
+    return true;
+}
+
+bool tagChangeSetMarkUpdated(TagChangeSet *changeSet, uint32_t row)
+{
+    if(!tagChangeSetReserve(changeSet, row)){
+        return false;
+    }
+    
+    //A row inserted in this batch will be drawn fresh anyway, so it doesn't need an update as well.
+    if(!changeSet->rowMarks[row]){
+        changeSet->rowMarks[row] |= TAG_CHANGE_UPDATED;
+        changeSet->updatedRows[changeSet->numUpdatedRows++] = row;
+    }
+    
+    return true;
+}
+
+bool tagChangeSetHasChanges(const TagChangeSet *changeSet)
+{
+    return changeSet->numInsertedRows != 0 || changeSet->numUpdatedRows != 0;
+}
+
+uint64_t tagChangeSetTimeUntilFlush(const TagChangeSet *changeSet)
+{
+    uint64_t elapsedNs = changeSet->clock(changeSet->clockContext) - changeSet->lastFlushNs;
+    
+    return elapsedNs >= changeSet->intervalNs ? 0 : changeSet->intervalNs - elapsedNs;
+}
+
+bool tagChangeSetFlush(TagChangeSet *changeSet, TagChangeSetHandler handler, void *context)
+{
+    if(!tagChangeSetHasChanges(changeSet) || tagChangeSetTimeUntilFlush(changeSet) != 0){
+        return false;
+    }
+    
+    changeSet->lastFlushNs = changeSet->clock(changeSet->clockContext);
+    changeSet->numFlushes++;
+    
+    handler(changeSet->insertedRows, changeSet->numInsertedRows, changeSet->updatedRows, changeSet->numUpdatedRows, context);
+    
+    tagChangeSetReset(changeSet);
+    
+    return true;
+}
@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagChangeSet.h                                                            //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module collects the rows of the RFID tag list that were inserted or        //
+//  updated since the views were last told about them, so that many tag reads       //
+//  can be reported to the views in one batch.                                      //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TagChangeSet_h
+#define TagChangeSet_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "MonotonicClock.h"
+
+#define TAG_CHANGE_SET_DEFAULT_INTERVAL_NS  (1000000000ULL/60) //About one display frame.
+
+//The clock is injectable so that the coalescing can be driven by a fake clock outside of the app.
+typedef MonotonicClockSource TagChangeSetClock;
+
+typedef struct
+{
+    uint32_t            *insertedRows;
+    uint32_t            numInsertedRows;
+    uint32_t            *updatedRows;
+    uint32_t            numUpdatedRows;
+    uint32_t            rowCapacity;    //Capacity of each of the arrays above and of rowMarks.
+    uint8_t             *rowMarks;      //Per-row flags so that each row is listed at most once per batch.
+    uint64_t            intervalNs;
+    uint64_t            lastFlushNs;
+    uint32_t            numFlushes;
+    TagChangeSetClock   clock;
+    void                *clockContext;
+} TagChangeSet;
+
+//Called with one batch of changes. Rows inserted in this batch are not repeated in the updated rows.
+typedef void (*TagChangeSetHandler)(const uint32_t *insertedRows, uint32_t numInsertedRows,
+                                    const uint32_t *updatedRows, uint32_t numUpdatedRows, void *context);
+
+//If clock is NULL, monotonicClockNsWithContext is used.
+void        tagChangeSetInit(TagChangeSet *changeSet, uint64_t intervalNs, TagChangeSetClock clock, void *clockContext);
+void        tagChangeSetFree(TagChangeSet *changeSet);
+//Forget all pending changes, for example when the tag list is cleared.
+void        tagChangeSetReset(TagChangeSet *changeSet);
+
+//These return false only if the row storage could not grow.
+bool        tagChangeSetMarkInserted(TagChangeSet *changeSet, uint32_t row);
+bool        tagChangeSetMarkUpdated(TagChangeSet *changeSet, uint32_t row);
+
+bool        tagChangeSetHasChanges(const TagChangeSet *changeSet);
+//Nanoseconds until a flush is allowed, 0 if one is allowed now.
+uint64_t    tagChangeSetTimeUntilFlush(const TagChangeSet *changeSet);
+//If there are changes and the interval has elapsed, pass them to the handler and empty the set.
+//Returns true if the handler was called.
+bool        tagChangeSetFlush(TagChangeSet *changeSet, TagChangeSetHandler handler, void *context);
+
+#endif /* TagChangeSet_h */
@@ -29,7 +29,6 @@
 
 #import "TagInfoViewController.h"
 #import "RFIDTagList.h"
-#import "RFIDTag.h"
 
 @interface TagInfoViewController ()
 
@@ -44,18 +43,32 @@
     [self displayTagInformation];
 }
 
+//Only redraw if the tag we are showing was among those that changed.
+- (void)displayTagInformationForChangedRows:(NSIndexSet *)changedRows
+{
+    if([changedRows containsIndex:self.row]){
+        [self displayTagInformation];
+    }
+}
+
 - (void)displayTagInformation
 {
     //Pull out the tag corresponding to the row in question.
     
-    NSArray *tags   = [[RFIDTagList theOnlyRFIDTagListWithDelegateTIVC:self] allRFIDTags]; //May want to point theOnlyRFIDTagList to null in between radio operations.
-    RFIDTag *tag    = tags[self.row];
+    const TagSnapshot *snapshot = [RFIDTagList theOnlyRFIDTagListWithDelegateTIVC:self].snapshot;
     
-    self.epcTextView.text       = tag.epc;
-    self.firstTextView.text     = [NSDateFormatter localizedStringFromDate:tag.firstInterrogation
+    //The list may have been cleared since the row was picked.
+    if(self.row < 0 || self.row >= (NSInteger)snapshot->numRows){
+        return;
+    }
+    
+    const TagSnapshotRow *tag   = &snapshot->rows[self.row];
+    
+    self.epcTextView.text       = [[NSString alloc] initWithUTF8String:tag->epc];
+    self.firstTextView.text     = [NSDateFormatter localizedStringFromDate:[NSDate dateWithTimeIntervalSince1970:tag->firstSeen]
                                                                  dateStyle:NSDateFormatterShortStyle
                                                                  timeStyle:NSDateFormatterFullStyle];
-    self.lastTextView.text      = [NSDateFormatter localizedStringFromDate:tag.lastInterrogation
+    self.lastTextView.text      = [NSDateFormatter localizedStringFromDate:[NSDate dateWithTimeIntervalSince1970:tag->lastSeen]
                                                                  dateStyle:NSDateFormatterShortStyle
                                                                  timeStyle:NSDateFormatterFullStyle];
     NSString *rssiString;
@@ -63,22 +76,31 @@
     NSString *messageString;
     BOOL isError = FALSE;
     
-    if(tag.magAntHop < 0){
+    if(tag->rssidBm < 0){
         //We have a valid RSSI value in the tag.
-        rssiString  = [[NSString alloc] initWithFormat:@"RSSI: %2.1fdBm ",tag.magAntHop];
+        rssiString  = [[NSString alloc] initWithFormat:@"RSSI: %2.1fdBm ",tag->rssidBm];
     } else {
         rssiString  = [[NSString alloc] initWithFormat:@"RSSI: Invalid "];
         isError = TRUE;
     }
     
-    if(tag.pdoaRangeMeters > 0){
+    if(tag->rangeMeters > 0 && tag->rangeReaderId != TAG_STORE_NO_READER){
+        //We have a valid pdoaRange for the tag from one of the readers.
+        rangeString  = [[NSString alloc] initWithFormat:@"Range: %2.1fm from reader %d (confidence %1.2f), seen by %u readers",
+                        tag->rangeMeters,tag->rangeReaderId,tag->rangeConfidence,tag->numReaders];
+    } else if(tag->rangeMeters > 0){
         //We have a valid pdoaRange for the tag.
-        rangeString  = [[NSString alloc] initWithFormat:@"Range: %2.1fm ",tag.pdoaRangeMeters];
+        rangeString  = [[NSString alloc] initWithFormat:@"Range: %2.1fm (confidence %1.2f)",tag->rangeMeters,tag->rangeConfidence];
     } else {
         rangeString  = [[NSString alloc] initWithFormat:@"Range: Invalid"];
         isError = TRUE;
     }
     
+    if(tag->rangeRateMetersPerSecond != 0){
+        //While tracking, the range is smoothed and we also know how fast the tag is moving.
+        rangeString  = [rangeString stringByAppendingFormat:@", moving %+1.2fm/s",tag->rangeRateMetersPerSecond];
+    }
+    
     if(isError){
         messageString  = [[NSString alloc] initWithFormat:@"There is an error."];
     } else {
@@ -33,7 +33,6 @@
 #import "TagListViewController.h"
 #import "TagInfoViewController.h"
 #import "RFIDTagList.h"
-#import "RFIDTag.h"
 
 @interface TagListViewController ()
 
@@ -64,56 +63,61 @@
 
 - (IBAction)clearRFIDTagList
 {
+    RFIDTagList *tagList    = [RFIDTagList theOnlyRFIDTagListWithDelegateTLVC:self];
+    NSInteger   numRows     = [self.tableView numberOfRowsInSection:0];
+    
+    //Delete the data store. The snapshot is empty once this returns.
+    [tagList clearRFIDTagList];
+    
+    //If the snapshot could not be emptied, just show what is there.
+    if(tagList.snapshot->numRows){
+        [self.tableView reloadData];
+        return;
+    }
+    
     //Begin operations
     [self.tableView beginUpdates];
     
     //Delete the rows
-    //First we have to look at our array of tags and work back to find their rows then indexPaths
-    NSArray *tags   = [[RFIDTagList theOnlyRFIDTagListWithDelegateTLVC:self] allRFIDTags];
-    //Loop through all of the tags
-    for (RFIDTag *tag in tags) {
-        NSInteger row=[tags indexOfObject:tag];
+    for (NSInteger row = 0; row < numRows; row++) {
         NSIndexPath *indexPath = [NSIndexPath indexPathForRow:row inSection:0];
         [self.tableView deleteRowsAtIndexPaths:@[indexPath] withRowAnimation:UITableViewRowAnimationFade];
     }
     
-    //Delete the data store
-    [[RFIDTagList theOnlyRFIDTagListWithDelegateTLVC:self] clearRFIDTagList];
-    
     //Check that everything is n'sync.
     [self.tableView endUpdates];
 }
 
 #pragma mark - Table view data source
 
-- (NSString *)createTableRowDetailString:(RFIDTag *)tag
+- (NSString *)createTableRowDetailString:(const TagSnapshotRow *)tag
 {
     NSString *rssiString;
     NSString *rangeString;
     
-    if(tag.magAntHop < 0){
+    if(tag->rssidBm < 0){
         //We have a valid RSSI value in the tag.
-        rssiString  = [[NSString alloc] initWithFormat:@"RSSI: %2.1fdBm ",tag.magAntHop];
+        rssiString  = [[NSString alloc] initWithFormat:@"RSSI: %2.1fdBm ",tag->rssidBm];
     } else {
         rssiString  = [[NSString alloc] initWithFormat:@"RSSI: Invalid "];
     }
     
-    if(tag.pdoaRangeMeters > 0){
+    if(tag->rangeMeters > 0){
         //We have a valid pdoaRange for the tag.
-        rangeString  = [[NSString alloc] initWithFormat:@"Range: %2.1fm ",tag.pdoaRangeMeters];
+        rangeString  = [[NSString alloc] initWithFormat:@"Range: %2.1fm ",tag->rangeMeters];
     } else {
         rangeString  = [[NSString alloc] initWithFormat:@"Range: Invalid"];
     }
     
     return [[NSString alloc] initWithFormat:@"%@ %@  Last Time: %@",rssiString,rangeString,
-            [NSDateFormatter localizedStringFromDate:tag.lastInterrogation
+            [NSDateFormatter localizedStringFromDate:[NSDate dateWithTimeIntervalSince1970:tag->lastSeen]
                                            dateStyle:NSDateFormatterShortStyle
                                            timeStyle:NSDateFormatterMediumStyle]];
 }
 
 - (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section
 {
-    return [[[RFIDTagList theOnlyRFIDTagListWithDelegateTLVC:self] allRFIDTags] count];
+    return [RFIDTagList theOnlyRFIDTagListWithDelegateTLVC:self].snapshot->numRows;
 }
 
 - (UITableViewCell *)tableView:(UITableView *)tableView cellForRowAtIndexPath:(NSIndexPath *)indexPath
@@ -129,11 +133,11 @@
     }
     
     //Pull out the tag corresponding to the row in question.
+    //Every cell in a pass reads from the same snapshot, which only changes when a batch of changes comes in.
     
-    NSArray *tags   = [[RFIDTagList theOnlyRFIDTagListWithDelegateTLVC:self] allRFIDTags]; //May want to point theOnlyRFIDTagList to null in between radio operations.
-    RFIDTag *tag    = tags[indexPath.row];
+    const TagSnapshotRow *tag   = &[RFIDTagList theOnlyRFIDTagListWithDelegateTLVC:self].snapshot->rows[indexPath.row];
     
-    cell.textLabel.text         = [[NSString alloc] initWithFormat:@"Tag %ld: %@",indexPath.row,tag.epc];
+    cell.textLabel.text         = [[NSString alloc] initWithFormat:@"Tag %ld: %s",indexPath.row,tag->epc];
     cell.detailTextLabel.text   = [self createTableRowDetailString:tag];
     
     return cell;
@@ -148,24 +152,36 @@
     [self.navigationController pushViewController:tivc animated:YES];
 }
 
-//If we get a new EPC value, add a new row to the table
-- (void)addNewTagToTable:(NSInteger)row
+//The tag list sends us the rows that were added or changed since the last batch.
+//New tags are always appended, so the updated rows keep their index across the inserts.
+- (void)insertTagRows:(NSIndexSet *)insertedRows reloadTagRows:(NSIndexSet *)updatedRows
 {
-    NSIndexPath *indexPath = [NSIndexPath indexPathForRow:row inSection:0];
-    //Insert the new row into the table.
+    NSMutableArray *insertedIndexPaths  = [[NSMutableArray alloc] initWithCapacity:[insertedRows count]];
+    NSMutableArray *updatedIndexPaths   = [[NSMutableArray alloc] initWithCapacity:[updatedRows count]];
+    NSInteger numTags                   = [RFIDTagList theOnlyRFIDTagListWithDelegateTLVC:self].snapshot->numRows;
+    
+    //If the table picked up some of the new tags on its own (e.g. it was loaded in between the read and this batch),
+    //inserting them again would put it out of sync, so just reload everything.
+    if([self.tableView numberOfRowsInSection:0] + (NSInteger)[insertedRows count] != numTags){
+        [self.tableView reloadData];
+        return;
+    }
+    
+    [insertedRows enumerateIndexesUsingBlock:^(NSUInteger row, BOOL *stop) {
+        [insertedIndexPaths addObject:[NSIndexPath indexPathForRow:row inSection:0]];
+    }];
+    [updatedRows enumerateIndexesUsingBlock:^(NSUInteger row, BOOL *stop) {
+        [updatedIndexPaths addObject:[NSIndexPath indexPathForRow:row inSection:0]];
+    }];
     
     [self.tableView beginUpdates];
     
-    [self.tableView insertRowsAtIndexPaths:@[indexPath] withRowAnimation:UITableViewRowAnimationTop];
+    [self.tableView insertRowsAtIndexPaths:insertedIndexPaths withRowAnimation:UITableViewRowAnimationTop];
+    [self.tableView reloadRowsAtIndexPaths:updatedIndexPaths withRowAnimation:UITableViewRowAnimationNone];
     
     [self.tableView endUpdates];
 }
 
-- (void)reloadTableTagData
-{
-    [self.tableView reloadData];
-}
-
 /*
 // Override to support conditional editing of the table view.
 - (BOOL)tableView:(UITableView *)tableView canEditRowAtIndexPath:(NSIndexPath *)indexPath {
@@ -0,0 +1,456 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagMetrics.c                                                              //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module turns the raw I/Q magnitudes reported by the reader into RSSI,      //
+//  phase and PDOA range. It has a scalar path for single reads and a batch path    //
+//  that works on arrays of reads with SSE2 or NEON where available.                //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <pthread.h>
+
+#include "TagMetrics.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TAG_METRICS_USE_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TAG_METRICS_USE_NEON
+#endif
+
+//Constants for computing RSSI.
+#define PCEPC_ACK_BITS 128.0  //The number of received data bits in the packet to be used for computing RSSI.
+#define MILLER_M 8.0          //Miller modulation index. Currently we have it set to 8, the maximum.
+#define DBE_OSR 24.0         //The oversampling ratio of the digital back end (4.5MHz for tag BLE of 187.5kHz)
+#define RCVR_GAIN_DB 131.5
+
+//Constants for computing PDOA range.
+#define SPEED_LIGHT_VAC 299792458
+#define ER_PCB 4.2 //Will need to change to 4.2 for actual operation
+#define ER_CAB 2.0 //Need to check if this is PTFE or not. Same for cable and connector. Will need to change for actual operation (2.0).
+#define ANT_PCB_ROUTE_M 0.0095
+#define ANT_CAB_ROUTE_M 0.2286
+#define CAL_PCB_ROUTE_M 0.0095
+#define CAL_CAB_ROUTE_M 0.254
+
+//#define CAL_PCB_ROUTE_M 0.0292
+//#define CAL_CAB_ROUTE_M 0.0254
+
+#define PDOA_MAX_FREQ_DELTA_MHZ 3.1f
+#define PDOA_MIN_FREQ_DELTA_MHZ 0.9f
+
+//These are the parts of the formulas that never change, worked out once.
+static struct
+{
+    double  rssiOffsetdB;           //10*log10(1/(receiverPowerGain*nChipsPerPacket^2))+30
+    double  antKnownDelayS;         //Round trip delay of the PCB/cable route to the antenna that is not part of the shared path.
+    double  calKnownDelayS;         //Same for the calibration path.
+    float   freqMHz[TAG_METRICS_NUM_SLOTS];
+    float   antKnownPhase[TAG_METRICS_NUM_SLOTS];
+    float   calKnownPhase[TAG_METRICS_NUM_SLOTS];
+} m_tagMetricsConstants;
+
+static pthread_once_t m_tagMetricsConstantsOnce = PTHREAD_ONCE_INIT;
+
+static void tagMetricsComputeConstants(void)
+{
+    double nChipsPerPacket      = PCEPC_ACK_BITS * MILLER_M * DBE_OSR;
+    double receiverPowerGain    = 50.0*(64.0/(pow(M_PI,4)))*pow(10,RCVR_GAIN_DB/10);
+    
+    m_tagMetricsConstants.rssiOffsetdB      = 30.0-10.0*log10(receiverPowerGain)-20.0*log10(nChipsPerPacket);
+    m_tagMetricsConstants.antKnownDelayS    = ANT_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+ANT_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB));
+    //The calibration path is currently taken to be the same as the antenna path (see the commented-out CAL_* routes).
+    m_tagMetricsConstants.calKnownDelayS    = ANT_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+ANT_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB));
+    
+    for(int slot=0; slot<TAG_METRICS_NUM_SLOTS; slot++){
+        double freqMHz = 903.0+slot;
+        
+        m_tagMetricsConstants.freqMHz[slot]         = (float)freqMHz;
+        m_tagMetricsConstants.antKnownPhase[slot]   = (float)fmod(4.0*M_PI*freqMHz*(1e6)*m_tagMetricsConstants.antKnownDelayS,M_PI);
+        m_tagMetricsConstants.calKnownPhase[slot]   = (float)fmod(4.0*M_PI*freqMHz*(1e6)*m_tagMetricsConstants.calKnownDelayS,M_PI);
+    }
+}
+
+static inline void tagMetricsInitConstants(void)
+{
+    pthread_once(&m_tagMetricsConstantsOnce, tagMetricsComputeConstants);
+}
+
+float tagMetricsFreqMHzFromSlot(uint8_t slot)
+{
+    return slot < TAG_METRICS_NUM_SLOTS ? 903.0f+slot : TAG_METRICS_DEFAULT_FREQ_MHZ;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Scalar path
+
+float tagMetricsRSSIdBm(int32_t magI, int32_t magQ)
+{
+    tagMetricsInitConstants();
+    
+    double power = (double)magI*magI + (double)magQ*magQ;
+    
+    return (float)(10.0*log10(power)+m_tagMetricsConstants.rssiOffsetdB);
+}
+
+//See tagMetricsPhaseReference for why the minus sign is there.
+//Adding pi and then subtracting it again if we went past pi is exactly what fmod(x+pi,pi) does for x in [-pi/2,pi/2].
+float tagMetricsPhase(int32_t magI, int32_t magQ)
+{
+    double phase = atan(-(double)magQ/(double)magI)+M_PI;
+    
+    return (float)(phase >= M_PI ? phase-M_PI : phase);
+}
+
+//Checks common to the scalar and the reference path. The order matters since it decides which status gets reported.
+static TagPDOAStatus tagMetricsPDOACheck(const TagPDOAMeasurement *hop, const TagPDOAMeasurement *skip)
+{
+    if(hop->nonce != skip->nonce){
+        return TAG_PDOA_NONCE_MISMATCH;
+    }
+    
+    if(!hop->phaseAnt || !skip->phaseAnt || !hop->phaseCal || !skip->phaseCal
+       || !hop->freqMHz || !skip->freqMHz || hop->magCal < TAG_METRICS_MIN_CAL_RSSI_DBM || skip->magCal < TAG_METRICS_MIN_CAL_RSSI_DBM){
+        return TAG_PDOA_INCOMPLETE_DATA;
+    }
+    
+    if(fabsf(hop->freqMHz - skip->freqMHz) > PDOA_MAX_FREQ_DELTA_MHZ){
+        return TAG_PDOA_DELTA_TOO_LARGE;
+    }
+    
+    if(fabsf(hop->freqMHz - skip->freqMHz) < PDOA_MIN_FREQ_DELTA_MHZ){
+        return TAG_PDOA_DELTA_TOO_SMALL;
+    }
+    
+    return TAG_PDOA_OK;
+}
+
+//Known phases come from the slot table when the frequency is one of the slots, which it always is for reader data.
+static void tagMetricsKnownPhases(float freqMHz, double *antKnownPhase, double *calKnownPhase)
+{
+    int slot = (int)freqMHz-903;
+    
+    if(slot >= 0 && slot < TAG_METRICS_NUM_SLOTS && m_tagMetricsConstants.freqMHz[slot] == freqMHz){
+        *antKnownPhase  = m_tagMetricsConstants.antKnownPhase[slot];
+        *calKnownPhase  = m_tagMetricsConstants.calKnownPhase[slot];
+    } else {
+        *antKnownPhase  = fmod(4.0*M_PI*freqMHz*(1e6)*m_tagMetricsConstants.antKnownDelayS,M_PI);
+        *calKnownPhase  = fmod(4.0*M_PI*freqMHz*(1e6)*m_tagMetricsConstants.calKnownDelayS,M_PI);
+    }
+}
+
+float tagMetricsCorrectedPhase(uint8_t slot, float phaseAnt, float phaseCal)
+{
+    double antKnownPhase, calKnownPhase;
+    
+    tagMetricsInitConstants();
+    tagMetricsKnownPhases(tagMetricsFreqMHzFromSlot(slot), &antKnownPhase, &calKnownPhase);
+    
+    return (float)fmod((phaseAnt - phaseCal) - (antKnownPhase - calKnownPhase)+2*M_PI,M_PI);
+}
+
+TagPDOAStatus tagMetricsPDOARange(const TagPDOAMeasurement *hop, const TagPDOAMeasurement *skip, float *rangeMeters)
+{
+    TagPDOAStatus   status = tagMetricsPDOACheck(hop, skip);
+    double          antKnownPhaseHop, calKnownPhaseHop, antKnownPhaseSkip, calKnownPhaseSkip;
+    double          correctedPhaseHop, correctedPhaseSkip;
+    
+    if(status == TAG_PDOA_NONCE_MISMATCH){
+        return status;
+    }
+    if(status != TAG_PDOA_OK){
+        *rangeMeters = TAG_METRICS_RANGE_INVALID;
+        return status;
+    }
+    
+    tagMetricsInitConstants();
+    tagMetricsKnownPhases(hop->freqMHz, &antKnownPhaseHop, &calKnownPhaseHop);
+    tagMetricsKnownPhases(skip->freqMHz, &antKnownPhaseSkip, &calKnownPhaseSkip);
+    
+    correctedPhaseHop   = fmod((hop->phaseAnt - hop->phaseCal) - (antKnownPhaseHop - calKnownPhaseHop)+2*M_PI,M_PI);
+    correctedPhaseSkip  = fmod((skip->phaseAnt - skip->phaseCal) - (antKnownPhaseSkip - calKnownPhaseSkip)+2*M_PI,M_PI);
+    
+    if(hop->freqMHz > skip->freqMHz){
+        *rangeMeters = SPEED_LIGHT_VAC/4/M_PI/((hop->freqMHz - skip->freqMHz)*(1e6))*fmod(correctedPhaseHop-correctedPhaseSkip+2*M_PI,M_PI);
+    } else {
+        *rangeMeters = SPEED_LIGHT_VAC/4/M_PI/((skip->freqMHz - hop->freqMHz)*(1e6))*fmod(correctedPhaseSkip-correctedPhaseHop+2*M_PI,M_PI);
+    }
+    
+    return TAG_PDOA_OK;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Batch path
+
+#if defined(TAG_METRICS_USE_SSE2) || defined(TAG_METRICS_USE_NEON)
+
+//A thin layer over the two instruction sets so that the math below is only written once.
+#if defined(TAG_METRICS_USE_SSE2)
+typedef __m128  TagVec;
+typedef __m128  TagVecMask;
+static inline TagVec        tagVecSet(float a)                              { return _mm_set1_ps(a); }
+static inline TagVec        tagVecLoadI32(const int32_t *p)                 { return _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)p)); }
+static inline void          tagVecStore(float *p, TagVec a)                 { _mm_storeu_ps(p, a); }
+static inline TagVec        tagVecAdd(TagVec a, TagVec b)                   { return _mm_add_ps(a, b); }
+static inline TagVec        tagVecSub(TagVec a, TagVec b)                   { return _mm_sub_ps(a, b); }
+static inline TagVec        tagVecMul(TagVec a, TagVec b)                   { return _mm_mul_ps(a, b); }
+static inline TagVec        tagVecDiv(TagVec a, TagVec b)                   { return _mm_div_ps(a, b); }
+static inline TagVecMask    tagVecGt(TagVec a, TagVec b)                    { return _mm_cmpgt_ps(a, b); }
+static inline TagVecMask    tagVecGe(TagVec a, TagVec b)                    { return _mm_cmpge_ps(a, b); }
+static inline TagVecMask    tagVecEq(TagVec a, TagVec b)                    { return _mm_cmpeq_ps(a, b); }
+static inline TagVec        tagVecSelect(TagVecMask m, TagVec a, TagVec b)  { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+static inline TagVec        tagVecSignBit(TagVec a)                         { return _mm_and_ps(a, _mm_set1_ps(-0.0f)); }
+static inline TagVec        tagVecAbs(TagVec a)                             { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline TagVec        tagVecXor(TagVec a, TagVec b)                   { return _mm_xor_ps(a, b); }
+
+//Split x into exponent and a mantissa in [1,2).
+static inline void tagVecFrexp(TagVec x, TagVec *exponent, TagVec *mantissa)
+{
+    __m128i bits    = _mm_castps_si128(x);
+    
+    *exponent       = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    *mantissa       = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+}
+#else
+typedef float32x4_t TagVec;
+typedef uint32x4_t  TagVecMask;
+static inline TagVec        tagVecSet(float a)                              { return vdupq_n_f32(a); }
+static inline TagVec        tagVecLoadI32(const int32_t *p)                 { return vcvtq_f32_s32(vld1q_s32(p)); }
+static inline void          tagVecStore(float *p, TagVec a)                 { vst1q_f32(p, a); }
+static inline TagVec        tagVecAdd(TagVec a, TagVec b)                   { return vaddq_f32(a, b); }
+static inline TagVec        tagVecSub(TagVec a, TagVec b)                   { return vsubq_f32(a, b); }
+static inline TagVec        tagVecMul(TagVec a, TagVec b)                   { return vmulq_f32(a, b); }
+#if defined(__aarch64__)
+static inline TagVec        tagVecDiv(TagVec a, TagVec b)                   { return vdivq_f32(a, b); }
+#else
+//32-bit ARM has no vector divide, so refine the reciprocal estimate twice.
+static inline TagVec tagVecDiv(TagVec a, TagVec b)
+{
+    TagVec r = vrecpeq_f32(b);
+    
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    
+    return vmulq_f32(a, r);
+}
+#endif
+static inline TagVecMask    tagVecGt(TagVec a, TagVec b)                    { return vcgtq_f32(a, b); }
+static inline TagVecMask    tagVecGe(TagVec a, TagVec b)                    { return vcgeq_f32(a, b); }
+static inline TagVecMask    tagVecEq(TagVec a, TagVec b)                    { return vceqq_f32(a, b); }
+static inline TagVec        tagVecSelect(TagVecMask m, TagVec a, TagVec b)  { return vbslq_f32(m, a, b); }
+static inline TagVec        tagVecSignBit(TagVec a)                         { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vdupq_n_u32(0x80000000))); }
+static inline TagVec        tagVecAbs(TagVec a)                             { return vabsq_f32(a); }
+static inline TagVec        tagVecXor(TagVec a, TagVec b)                   { return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+
+static inline void tagVecFrexp(TagVec x, TagVec *exponent, TagVec *mantissa)
+{
+    uint32x4_t bits = vreinterpretq_u32_f32(x);
+    
+    *exponent       = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+    *mantissa       = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007FFFFF)), vdupq_n_u32(0x3F800000)));
+}
+#endif
+
+//Natural log for positive, finite, normal x.
+//The mantissa is brought into [sqrt(1/2),sqrt(2)) so that the atanh series below converges quickly.
+static inline TagVec tagVecLn(TagVec x)
+{
+    TagVec      exponent, mantissa, t, t2, series;
+    TagVecMask  high;
+    
+    tagVecFrexp(x, &exponent, &mantissa);
+    high        = tagVecGt(mantissa, tagVecSet((float)M_SQRT2));
+    mantissa    = tagVecSelect(high, tagVecMul(mantissa, tagVecSet(0.5f)), mantissa);
+    exponent    = tagVecSelect(high, tagVecAdd(exponent, tagVecSet(1.0f)), exponent);
+    
+    //ln(m) = 2*atanh(t) with t = (m-1)/(m+1), |t| < 0.172
+    t           = tagVecDiv(tagVecSub(mantissa, tagVecSet(1.0f)), tagVecAdd(mantissa, tagVecSet(1.0f)));
+    t2          = tagVecMul(t, t);
+    series      = tagVecAdd(tagVecSet(2.0f/7.0f), tagVecMul(t2, tagVecSet(2.0f/9.0f)));
+    series      = tagVecAdd(tagVecSet(2.0f/5.0f), tagVecMul(t2, series));
+    series      = tagVecAdd(tagVecSet(2.0f/3.0f), tagVecMul(t2, series));
+    series      = tagVecAdd(tagVecSet(2.0f), tagVecMul(t2, series));
+    
+    return tagVecAdd(tagVecMul(exponent, tagVecSet((float)M_LN2)), tagVecMul(t, series));
+}
+
+//Arctangent with the usual reduction to |x| <= tan(pi/8) followed by a short polynomial.
+static inline TagVec tagVecAtan(TagVec x)
+{
+    TagVec      sign    = tagVecSignBit(x);
+    TagVec      ax      = tagVecAbs(x);
+    TagVecMask  big     = tagVecGt(ax, tagVecSet(2.414213562373095f));
+    TagVecMask  mid     = tagVecGt(ax, tagVecSet(0.4142135623730950f));
+    TagVec      offset, xr, z, poly;
+    
+    offset  = tagVecSelect(big, tagVecSet((float)M_PI_2), tagVecSelect(mid, tagVecSet((float)M_PI_4), tagVecSet(0.0f)));
+    xr      = tagVecSelect(big, tagVecDiv(tagVecSet(-1.0f), ax),
+                           tagVecSelect(mid, tagVecDiv(tagVecSub(ax, tagVecSet(1.0f)), tagVecAdd(ax, tagVecSet(1.0f))), ax));
+    z       = tagVecMul(xr, xr);
+    poly    = tagVecSub(tagVecMul(tagVecSet(8.05374449538e-2f), z), tagVecSet(1.38776856032e-1f));
+    poly    = tagVecAdd(tagVecMul(poly, z), tagVecSet(1.99777106478e-1f));
+    poly    = tagVecSub(tagVecMul(poly, z), tagVecSet(3.33329491539e-1f));
+    poly    = tagVecAdd(tagVecMul(tagVecMul(poly, z), xr), xr);
+    
+    return tagVecXor(tagVecAdd(offset, poly), sign);
+}
+
+static void tagMetricsRSSIPhase4(const int32_t *magI, const int32_t *magQ, float *rssidBm, float *phase)
+{
+    TagVec      i       = tagVecLoadI32(magI);
+    TagVec      q       = tagVecLoadI32(magQ);
+    TagVec      power   = tagVecAdd(tagVecMul(i, i), tagVecMul(q, q));
+    TagVec      rssi, angle;
+    
+    //10*log10(power) plus the fixed receiver gain terms. Zero power gives -infinity, as log10 would.
+    rssi    = tagVecAdd(tagVecMul(tagVecLn(power), tagVecSet((float)(10.0/M_LN10))), tagVecSet((float)m_tagMetricsConstants.rssiOffsetdB));
+    rssi    = tagVecSelect(tagVecEq(power, tagVecSet(0.0f)), tagVecSet(-INFINITY), rssi);
+    tagVecStore(rssidBm, rssi);
+    
+    //fmod(atan(-Q/I)+pi,pi), as in tagMetricsPhase.
+    angle   = tagVecAdd(tagVecAtan(tagVecDiv(tagVecSub(tagVecSet(0.0f), q), i)), tagVecSet((float)M_PI));
+    angle   = tagVecSelect(tagVecGe(angle, tagVecSet((float)M_PI)), tagVecSub(angle, tagVecSet((float)M_PI)), angle);
+    tagVecStore(phase, angle);
+}
+
+#endif
+
+void tagMetricsRSSIPhaseBatch(const int32_t *magI, const int32_t *magQ, size_t count, float *rssidBm, float *phase)
+{
+    size_t n = 0;
+    
+    tagMetricsInitConstants();
+    
+#if defined(TAG_METRICS_USE_SSE2) || defined(TAG_METRICS_USE_NEON)
+    for(; n+4 <= count; n += 4){
+        tagMetricsRSSIPhase4(&magI[n], &magQ[n], &rssidBm[n], &phase[n]);
+    }
+#endif
+    
+    for(; n < count; n++){
+        rssidBm[n]  = tagMetricsRSSIdBm(magI[n], magQ[n]);
+        phase[n]    = tagMetricsPhase(magI[n], magQ[n]);
+    }
+}
+
+//Wrap a non-negative angle into [0,pi). Unlike fmod this is a multiply and a floor, which the compiler can vectorize.
+static inline float tagMetricsWrapPi(float x)
+{
+    return x - floorf(x*(float)M_1_PI)*(float)M_PI;
+}
+
+//The loop below is written without early exits so that it can be vectorized by the compiler.
+void tagMetricsPDOARangeBatch(const TagPDOABatch *batch, size_t count, float *rangeMeters)
+{
+    const float rangeScale = (float)(SPEED_LIGHT_VAC/4/M_PI/(1e6));
+    
+    tagMetricsInitConstants();
+    
+    for(size_t n=0; n<count; n++){
+        uint8_t slotHop     = batch->slotHop[n] < TAG_METRICS_NUM_SLOTS ? batch->slotHop[n] : 12;   //Slot 12 is 915MHz, the default.
+        uint8_t slotSkip    = batch->slotSkip[n] < TAG_METRICS_NUM_SLOTS ? batch->slotSkip[n] : 12;
+        float   freqHop     = m_tagMetricsConstants.freqMHz[slotHop];
+        float   freqSkip    = m_tagMetricsConstants.freqMHz[slotSkip];
+        float   delta       = fabsf(freqHop-freqSkip);
+        float   corrHop     = tagMetricsWrapPi((batch->phaseAntHop[n]-batch->phaseCalHop[n])
+                                               -(m_tagMetricsConstants.antKnownPhase[slotHop]-m_tagMetricsConstants.calKnownPhase[slotHop])+2*(float)M_PI);
+        float   corrSkip    = tagMetricsWrapPi((batch->phaseAntSkip[n]-batch->phaseCalSkip[n])
+                                               -(m_tagMetricsConstants.antKnownPhase[slotSkip]-m_tagMetricsConstants.calKnownPhase[slotSkip])+2*(float)M_PI);
+        float   diff        = freqHop > freqSkip ? corrHop-corrSkip : corrSkip-corrHop;
+        float   range       = rangeScale/delta*tagMetricsWrapPi(diff+2*(float)M_PI);
+        int     invalid     = (batch->phaseAntHop[n] == 0) | (batch->phaseAntSkip[n] == 0)
+                            | (batch->phaseCalHop[n] == 0) | (batch->phaseCalSkip[n] == 0)
+                            | (batch->magCalHop[n] < TAG_METRICS_MIN_CAL_RSSI_DBM) | (batch->magCalSkip[n] < TAG_METRICS_MIN_CAL_RSSI_DBM)
+                            | (delta > PDOA_MAX_FREQ_DELTA_MHZ) | (delta < PDOA_MIN_FREQ_DELTA_MHZ);
+        
+        range           = invalid ? TAG_METRICS_RANGE_INVALID : range;
+        rangeMeters[n]  = batch->nonceHop[n] != batch->nonceSkip[n] ? batch->previousRangeMeters[n] : range;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Reference formulas
+
+float tagMetricsRSSIdBmReference(int32_t magI, int32_t magQ)
+{
+    float_t rssiInWatts          = 0;
+    float_t rssiIndBm            = 0;
+    float_t nChipsPerPacket     = PCEPC_ACK_BITS * MILLER_M * DBE_OSR;
+    float_t receiverPowerGain   = 50.0*(64.0/(pow(M_PI,4)))*pow(10,RCVR_GAIN_DB/10);
+    
+    rssiInWatts = (1/receiverPowerGain)*(pow(magI/nChipsPerPacket,2)+pow(magQ/nChipsPerPacket,2));
+    
+    rssiIndBm   =  10*log10f(rssiInWatts)+30;
+    
+    return rssiIndBm;
+}
+
+float tagMetricsPhaseReference(int32_t magI, int32_t magQ)
+{
+    //We know that the minus sign is wrong but we realized late in the game that the SX1257
+    //I and Q RX ADC outputs are misnamed (I and Q are switched).
+    //Rather than going through and renaming everything, since the only angle-dependent feature
+    //of the system (as of 110920) is this, we just compensate for this by adding a minus sign
+    //in the angle calculation.
+    return fmod(atan(-(double)magQ/(double)magI)+M_PI,M_PI);
+}
+
+float tagMetricsPDOARangeReference(const TagPDOAMeasurement *hop, const TagPDOAMeasurement *skip, float previousRangeMeters)
+{
+    float_t ant_known_phase_hop = 0.0;
+    float_t ant_known_phase_skip = 0.0;
+    float_t cal_known_phase_hop = 0.0;
+    float_t cal_known_phase_skip = 0.0;
+    float_t corrected_phase_hop = 0.0;
+    float_t corrected_phase_skip = 0.0;
+    
+    switch(tagMetricsPDOACheck(hop, skip)){
+        case TAG_PDOA_OK:               break;
+        case TAG_PDOA_NONCE_MISMATCH:   return previousRangeMeters;
+        default:                        return TAG_METRICS_RANGE_INVALID;
+    }
+    
+    //4 Pi is actually 2*2pi, the 2 coming from out and back phase changes.
+    
+    ant_known_phase_hop =
+    fmod(4.0*M_PI*hop->freqMHz*(1e6)*(ANT_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+ANT_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB))),M_PI);
+    ant_known_phase_skip=
+    fmod(4.0*M_PI*skip->freqMHz*(1e6)*(ANT_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+ANT_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB))),M_PI);
+    cal_known_phase_hop =
+    fmod(4.0*M_PI*hop->freqMHz*(1e6)*(ANT_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+ANT_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB))),M_PI);
+    cal_known_phase_skip =
+    fmod(4.0*M_PI*skip->freqMHz*(1e6)*(ANT_PCB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_PCB))+ANT_CAB_ROUTE_M/(SPEED_LIGHT_VAC/sqrt(ER_CAB))),M_PI);
+    
+    corrected_phase_hop     =   fmod((hop->phaseAnt - hop->phaseCal) - (ant_known_phase_hop - cal_known_phase_hop)+2*M_PI,M_PI);
+    corrected_phase_skip    =   fmod((skip->phaseAnt - skip->phaseCal) - (ant_known_phase_skip - cal_known_phase_skip)+2*M_PI,M_PI);
+    
+    if(hop->freqMHz > skip->freqMHz){
+        return SPEED_LIGHT_VAC/4/M_PI/((hop->freqMHz - skip->freqMHz)*(1e6))*fmod(corrected_phase_hop-corrected_phase_skip+2*M_PI,M_PI);
+    } else {
+        return SPEED_LIGHT_VAC/4/M_PI/((skip->freqMHz - hop->freqMHz)*(1e6))*fmod(corrected_phase_skip-corrected_phase_hop+2*M_PI,M_PI);
+    }
+}
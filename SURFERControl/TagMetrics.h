@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagMetrics.h                                                              //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module turns the raw I/Q magnitudes reported by the reader into RSSI,      //
+//  phase and PDOA range. It has a scalar path for single reads and a batch path    //
+//  that works on arrays of reads with SSE2 or NEON where available.                //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TagMetrics_h
+#define TagMetrics_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TAG_METRICS_NUM_SLOTS           25      //Frequency slots 0 to 24 map to 903MHz to 927MHz.
+#define TAG_METRICS_DEFAULT_FREQ_MHZ    915.0f  //Used for any slot outside of the range above.
+#define TAG_METRICS_RANGE_INVALID       99.9f   //Returned as the range when it can't be computed.
+#define TAG_METRICS_MIN_CAL_RSSI_DBM    -70.0f  //Below this the calibration phase is too noisy to use for range.
+
+//Why a PDOA range could or could not be computed.
+typedef enum
+{
+    TAG_PDOA_OK                 =   0,
+    TAG_PDOA_NONCE_MISMATCH     =   1,  //The hop and skip are from different interrogations. Keep the previous range.
+    TAG_PDOA_INCOMPLETE_DATA    =   2,  //Phase or frequency data missing, or calibration RSSI too low.
+    TAG_PDOA_DELTA_TOO_LARGE    =   3,  //Hop/skip frequency delta over 3.1MHz, which aliases at range.
+    TAG_PDOA_DELTA_TOO_SMALL    =   4   //Hop/skip frequency delta under 0.9MHz.
+} TagPDOAStatus;
+
+//One hop or skip measurement as held by a tag.
+typedef struct
+{
+    float       freqMHz;
+    float       phaseAnt;
+    float       phaseCal;
+    float       magCal;
+    uint8_t     nonce;
+} TagPDOAMeasurement;
+
+//A batch of hop/skip pairs, laid out as one array per field. Frequencies are given as slots.
+typedef struct
+{
+    const uint8_t   *slotHop;
+    const float     *phaseAntHop;
+    const float     *phaseCalHop;
+    const float     *magCalHop;
+    const uint8_t   *nonceHop;
+    const uint8_t   *slotSkip;
+    const float     *phaseAntSkip;
+    const float     *phaseCalSkip;
+    const float     *magCalSkip;
+    const uint8_t   *nonceSkip;
+    const float     *previousRangeMeters;   //Passed through when the nonces don't match.
+} TagPDOABatch;
+
+float           tagMetricsFreqMHzFromSlot(uint8_t slot);
+
+//Scalar path, for one read at a time. RSSI is in dBm, phase is in radians between 0 and pi.
+float           tagMetricsRSSIdBm(int32_t magI, int32_t magQ);
+float           tagMetricsPhase(int32_t magI, int32_t magQ);
+//The tag phase at a slot with the calibration phase and the known PCB/cable phase removed, between 0 and pi.
+float           tagMetricsCorrectedPhase(uint8_t slot, float phaseAnt, float phaseCal);
+//On TAG_PDOA_OK, *rangeMeters is written. On TAG_PDOA_NONCE_MISMATCH it is left alone, otherwise it is set to TAG_METRICS_RANGE_INVALID.
+TagPDOAStatus   tagMetricsPDOARange(const TagPDOAMeasurement *hop, const TagPDOAMeasurement *skip, float *rangeMeters);
+
+//Batch path. The outputs must hold count values.
+void            tagMetricsRSSIPhaseBatch(const int32_t *magI, const int32_t *magQ, size_t count, float *rssidBm, float *phase);
+void            tagMetricsPDOARangeBatch(const TagPDOABatch *batch, size_t count, float *rangeMeters);
+
+//The formulas as they were originally written, in double precision with nothing precomputed.
+//These are kept as the reference that the paths above are checked against.
+float           tagMetricsRSSIdBmReference(int32_t magI, int32_t magQ);
+float           tagMetricsPhaseReference(int32_t magI, int32_t magQ);
+float           tagMetricsPDOARangeReference(const TagPDOAMeasurement *hop, const TagPDOAMeasurement *skip, float previousRangeMeters);
+
+#endif /* TagMetrics_h */
@@ -0,0 +1,183 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagPacketDecoder.c                                                        //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module decodes the PKT1/PKT2 tag data notifications sent by the reader     //
+//  into complete tag reads. It is plain C so that it can be built and exercised    //
+//  outside of the iOS application.                                                 //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#include "TagPacketDecoder.h"
+
+//The data ID is a nonce that the reader increments with every packet so that we can detect packets out of order.
+static uint32_t tagPacketDecoderTrackDataId(TagPacketDecoder *decoder, uint8_t dataId)
+{
+    decoder->dataIdOld  =   decoder->dataIdNew;
+    decoder->dataIdNew  =   dataId;
+    
+    if(decoder->dataIdNew != (uint8_t)(decoder->dataIdOld+1)){
+        decoder->numSequenceGaps++;
+        return TAG_DECODE_SEQUENCE_GAP;
+    }
+    
+    return 0;
+}
+
+//Magnitudes are sent big-endian.
+static int32_t tagPacketDecoderUnpackBE32(const uint8_t *bytes)
+{
+    return (int32_t)(((uint32_t)bytes[0] << 24)+((uint32_t)bytes[1] << 16)+((uint32_t)bytes[2] << 8)+((uint32_t)bytes[3] << 0));
+}
+
+void tagPacketDecoderInit(TagPacketDecoder *decoder)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    
+    decoder->state      =   WAIT_PKT1;
+    decoder->dataIdOld  =   255; //Start at 255 so that the first packet is 0
+    decoder->dataIdNew  =   255; //Start at 255 so that the first packet is 0
+}
+
+//The first data back is the EPC, the frequency slot, the upper 24 bits of the antenna I/Q magnitudes and the data ID.
+uint32_t tagPacketDecoderPushPkt1(TagPacketDecoder *decoder, const uint8_t *bytes, size_t length, TagRead *read)
+{
+    uint32_t    flags   =   0;
+    TagRead     *pending=   &decoder->pending;
+    bool        expectingSupplementData;
+    
+    if(length != TAG_PKT1_NUM_BYTES){
+        decoder->numDiscardedPkts++;
+        return TAG_DECODE_BAD_LENGTH;
+    }
+    
+    memcpy(pending->epc, bytes, TAG_EPC_NUM_BYTES);
+    
+    expectingSupplementData =   (bytes[12] & 128) != 0; //Supplement data indicator is contained in the msb of this byte
+    pending->freqSlot       =   bytes[12] & 31; //Mask off the lower 5 bits - frequencySlot can only go up to 31.
+    //The LSBs of the antenna magnitudes arrive in PKT2.
+    pending->antMagI        =   (int32_t)(((uint32_t)bytes[13] << 24)+((uint32_t)bytes[14] << 16)+((uint32_t)bytes[15] << 8));
+    pending->antMagQ        =   (int32_t)(((uint32_t)bytes[16] << 24)+((uint32_t)bytes[17] << 16)+((uint32_t)bytes[18] << 8));
+    
+    flags |= tagPacketDecoderTrackDataId(decoder, bytes[19]);
+    
+    if(decoder->state == WAIT_PKT2){
+        //We were waiting for PKT2 but got a packet 1. Disregard the previous packet 1 and proceed as normal.
+        decoder->numDiscardedPkts++;
+        flags |= TAG_DECODE_PKT1_IN_WAIT_PKT2;
+    }
+    
+    if(!expectingSupplementData){
+        //If we're not doing supplemental tag data, we're only doing hops (no PDOA) and we don't have cal data.
+        //With CalMag=0, attempting to make any ranging measurement with this information should result in an error.
+        pending->hopNotSkip     =   true;
+        pending->hopSkipNonce   =   TAG_NO_SUPPLEMENT_NONCE;
+        pending->calMagI        =   0;
+        pending->calMagQ        =   0;
+        
+        *read                   =   *pending;
+        decoder->numReads++;
+        decoder->state          =   WAIT_PKT1;
+        flags |= TAG_DECODE_READ_READY;
+    } else {
+        //If we are expecting supplemental data, then wait until the next packet.
+        decoder->state          =   WAIT_PKT2;
+    }
+    
+    return flags;
+}
+
+//The second data back is the LSBs of the antenna I/Q magnitudes, the calibration I/Q magnitudes,
+//the hop/skip flag, the hop/skip nonce and the data ID.
+uint32_t tagPacketDecoderPushPkt2(TagPacketDecoder *decoder, const uint8_t *bytes, size_t length, TagRead *read)
+{
+    uint32_t    flags   =   0;
+    TagRead     *pending=   &decoder->pending;
+    
+    if(length != TAG_PKT2_NUM_BYTES){
+        decoder->numDiscardedPkts++;
+        return TAG_DECODE_BAD_LENGTH;
+    }
+    
+    flags |= tagPacketDecoderTrackDataId(decoder, bytes[15]);
+    
+    if(decoder->state != WAIT_PKT2){
+        //We were waiting for PKT1 but got a packet 2. Disregard this packet 2 and retain state as waiting for packet 1.
+        decoder->numDiscardedPkts++;
+        return flags | TAG_DECODE_PKT2_IN_WAIT_PKT1;
+    }
+    
+    pending->antMagI        =   (int32_t)((uint32_t)pending->antMagI + (uint32_t)bytes[1]);
+    pending->antMagQ        =   (int32_t)((uint32_t)pending->antMagQ + (uint32_t)bytes[2]);
+    pending->calMagI        =   tagPacketDecoderUnpackBE32(&bytes[4]);
+    pending->calMagQ        =   tagPacketDecoderUnpackBE32(&bytes[8]);
+    pending->hopNotSkip     =   (bytes[12] == 255);
+    pending->hopSkipNonce   =   bytes[14];
+    
+    *read                   =   *pending;
+    decoder->numReads++;
+    decoder->state          =   WAIT_PKT1;
+    
+    return flags | TAG_DECODE_READ_READY;
+}
+
+void tagReadFormatEPC(const uint8_t *epc, char *hex)
+{
+    static const char hexDigits[16] = {'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f'};
+    
+    for(int i=0; i<TAG_EPC_NUM_BYTES; i++){
+        hex[2*i+0]  =   hexDigits[epc[i] >> 4];
+        hex[2*i+1]  =   hexDigits[epc[i] & 15];
+    }
+    hex[TAG_EPC_HEX_STRING_LENGTH] = '\0';
+}
+
+static int tagReadHexDigitValue(char c)
+{
+    if(c >= '0' && c <= '9') return c-'0';
+    if(c >= 'a' && c <= 'f') return c-'a'+10;
+    if(c >= 'A' && c <= 'F') return c-'A'+10;
+    return -1;
+}
+
+bool tagReadParseEPC(const char *hex, size_t length, uint8_t *epc)
+{
+    if(length != TAG_EPC_HEX_STRING_LENGTH){
+        return false;
+    }
+    
+    for(int i=0; i<TAG_EPC_NUM_BYTES; i++){
+        int upper   =   tagReadHexDigitValue(hex[2*i+0]);
+        int lower   =   tagReadHexDigitValue(hex[2*i+1]);
+        
+        if(upper < 0 || lower < 0){
+            return false;
+        }
+        epc[i]  =   (uint8_t)((upper << 4) | lower);
+    }
+    
+    return true;
+}
@@ -0,0 +1,107 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagPacketDecoder.h                                                        //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module decodes the PKT1/PKT2 tag data notifications sent by the reader     //
+//  into complete tag reads. It is plain C so that it can be built and exercised    //
+//  outside of the iOS application.                                                 //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TagPacketDecoder_h
+#define TagPacketDecoder_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define TAG_EPC_NUM_BYTES           12
+#define TAG_PKT1_NUM_BYTES          20
+#define TAG_PKT2_NUM_BYTES          16
+#define TAG_EPC_HEX_STRING_LENGTH   (2*TAG_EPC_NUM_BYTES)
+
+//When the reader sends a read without supplemental data, there is no hop/skip nonce.
+//We put a dummy value in here that is unlikely to result in an unflagged scenario in which
+//a non-supplement hop read is combined with a supplement skip read to result in
+//a valid-seeming ranging measurement. (Recall hop and skip nonce must be same to
+//produce a valid range measurement).
+#define TAG_NO_SUPPLEMENT_NONCE     128
+
+//This state reflects the tag data coming in. We need to know if we got supplementary data while we were waiting for it.
+typedef enum
+{
+    WAIT_PKT1           =   0,
+    WAIT_PKT2           =   1
+} TagDataState;
+
+//These flags are returned by the push functions so that the caller can report what happened to the console.
+//More than one flag may be set at once.
+typedef enum
+{
+    TAG_DECODE_READ_READY       =   1 << 0, //A complete tag read was written to the caller's storage.
+    TAG_DECODE_SEQUENCE_GAP     =   1 << 1, //The packet data ID was not one more than the previous one.
+    TAG_DECODE_PKT1_IN_WAIT_PKT2=   1 << 2, //Got PKT1 while expecting PKT2. The previous PKT1 was discarded.
+    TAG_DECODE_PKT2_IN_WAIT_PKT1=   1 << 3, //Got PKT2 while expecting PKT1. This PKT2 was discarded.
+    TAG_DECODE_BAD_LENGTH       =   1 << 4  //The packet had the wrong number of bytes and was discarded.
+} TagDecodeFlags;
+
+//A single, fully assembled tag read.
+typedef struct
+{
+    uint8_t     epc[TAG_EPC_NUM_BYTES];
+    uint8_t     freqSlot;
+    bool        hopNotSkip;
+    uint8_t     hopSkipNonce;
+    int32_t     antMagI;
+    int32_t     antMagQ;
+    int32_t     calMagI;
+    int32_t     calMagQ;
+} TagRead;
+
+//The reassembly state held in between a 2-packet data push, plus some counters for diagnostics.
+typedef struct
+{
+    TagDataState    state;
+    TagRead         pending;
+    uint8_t         dataIdOld;
+    uint8_t         dataIdNew;
+    uint32_t        numReads;
+    uint32_t        numSequenceGaps;
+    uint32_t        numDiscardedPkts;
+} TagPacketDecoder;
+
+void        tagPacketDecoderInit(TagPacketDecoder *decoder);
+
+//Each push function takes the raw bytes of one BTLE notification.
+//If a complete read results, it is copied to *read and TAG_DECODE_READ_READY is set in the return value.
+uint32_t    tagPacketDecoderPushPkt1(TagPacketDecoder *decoder, const uint8_t *bytes, size_t length, TagRead *read);
+uint32_t    tagPacketDecoderPushPkt2(TagPacketDecoder *decoder, const uint8_t *bytes, size_t length, TagRead *read);
+
+//Writes the EPC as lowercase hex into hex, which must hold TAG_EPC_HEX_STRING_LENGTH+1 characters.
+void        tagReadFormatEPC(const uint8_t *epc, char *hex);
+//Reads a hex EPC string of exactly TAG_EPC_HEX_STRING_LENGTH characters (either case) back into binary.
+//Returns false if the string is the wrong length or contains a non-hex character.
+bool        tagReadParseEPC(const char *hex, size_t length, uint8_t *epc);
+
+#endif /* TagPacketDecoder_h */
@@ -0,0 +1,192 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagRangeEstimator.c                                                       //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module estimates the range of a tag from the phases seen at every          //
+//  frequency slot, rather than from a single hop/skip pair. Each read is           //
+//  folded into a small fixed-size state in constant time.                          //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <math.h>
+#include <string.h>
+
+#include "TagRangeEstimator.h"
+
+#define SPEED_LIGHT_VAC                 299792458.0
+//The range at which the phasor of a 1MHz step has turned once, about 75m. A step of k slots turns k times as fast.
+#define TAG_RANGE_ALIAS_M               ((float)(SPEED_LIGHT_VAC/4/(1e6)))
+//A range spread across pairs of this many meters drops the confidence to about a third.
+#define TAG_RANGE_CONFIDENCE_SPREAD_M   1.0f
+//Candidate ranges whose fit is within this fraction of the pair weight are a tie, and the shorter one wins.
+#define TAG_RANGE_TIE_FRACTION          1e-3f
+
+void tagRangeEstimatorInit(TagRangeEstimator *estimator)
+{
+    memset(estimator, 0, sizeof(TagRangeEstimator));
+}
+
+bool tagRangeEstimatorUpdate(TagRangeEstimator *estimator, uint8_t slot, float phaseAnt, float phaseCal, float magCal)
+{
+    float   phase, cos2Phase, sin2Phase;
+    int     other, delta;
+    
+    if(slot >= TAG_METRICS_NUM_SLOTS || !phaseAnt || !phaseCal || magCal < TAG_METRICS_MIN_CAL_RSSI_DBM){
+        return false;
+    }
+    
+    phase       = tagMetricsCorrectedPhase(slot, phaseAnt, phaseCal);
+    cos2Phase   = cosf(2*phase);
+    sin2Phase   = sinf(2*phase);
+    estimator->numReads++;
+    
+    for(delta = 0; delta < TAG_RANGE_MAX_SLOT_DELTA; delta++){
+        estimator->weight[delta] *= TAG_RANGE_FORGET_FACTOR;
+        estimator->sumCos[delta] *= TAG_RANGE_FORGET_FACTOR;
+        estimator->sumSin[delta] *= TAG_RANGE_FORGET_FACTOR;
+    }
+    
+    //Pair the new phase with every recent neighbor. At most 2*TAG_RANGE_MAX_SLOT_DELTA pairs, so constant time.
+    //The phases only run from 0 to pi, so twice the step from the lower slot to the higher is the phasor angle,
+    //which turns 2*pi per alias.
+    for(other = (int)slot-TAG_RANGE_MAX_SLOT_DELTA; other <= (int)slot+TAG_RANGE_MAX_SLOT_DELTA; other++){
+        float   sign;
+        
+        if(other < 0 || other >= TAG_METRICS_NUM_SLOTS || other == slot || !(estimator->slotMask & (1u << other))){
+            continue;
+        }
+        if(estimator->numReads - estimator->readNumber[other] > TAG_RANGE_MAX_PAIR_AGE){
+            continue;
+        }
+        
+        delta   = (other > slot ? other-slot : slot-other) - 1;
+        sign    = other > slot ? 1.0f : -1.0f;
+        
+        estimator->weight[delta] += 1;
+        estimator->sumCos[delta] += estimator->cos2Phase[other]*cos2Phase + estimator->sin2Phase[other]*sin2Phase;
+        estimator->sumSin[delta] += sign*(estimator->sin2Phase[other]*cos2Phase - estimator->cos2Phase[other]*sin2Phase);
+    }
+    
+    estimator->cos2Phase[slot]  = cos2Phase;
+    estimator->sin2Phase[slot]  = sin2Phase;
+    estimator->readNumber[slot] = estimator->numReads;
+    estimator->slotMask        |= 1u << slot;
+    
+    return true;
+}
+
+//How well a range lines up with the pair phasors of every slot step. The phasor of step k turns at k times the rate
+//of that of a 1MHz step, so its cos and sin come from the 1MHz ones by the angle addition formulas.
+static float tagRangeEstimatorFit(const TagRangeEstimator *estimator, float range)
+{
+    float   angle   = (float)(2*M_PI)*range/TAG_RANGE_ALIAS_M;
+    float   cos1    = cosf(angle);
+    float   sin1    = sinf(angle);
+    float   cosK    = cos1;
+    float   sinK    = sin1;
+    float   fit     = 0;
+    int     delta;
+    
+    for(delta = 0; delta < TAG_RANGE_MAX_SLOT_DELTA; delta++){
+        float   nextCos = cosK*cos1 - sinK*sin1;
+        
+        fit    += estimator->sumCos[delta]*cosK + estimator->sumSin[delta]*sinK;
+        sinK    = sinK*cos1 + cosK*sin1;
+        cosK    = nextCos;
+    }
+    return fit;
+}
+
+void tagRangeEstimatorGetEstimate(const TagRangeEstimator *estimator, TagRangeEstimate *estimate)
+{
+    float   base[TAG_RANGE_MAX_SLOT_DELTA], resultant[TAG_RANGE_MAX_SLOT_DELTA];
+    float   totalWeight = 0, bestFit = 0, bestRange = 0, bestUnfolded = 0;
+    float   sumRange = 0, sumRangeWeight = 0, sumSpread = 0;
+    bool    haveBest = false;
+    int     delta, alias;
+    
+    estimate->numSlots = (uint8_t)__builtin_popcount(estimator->slotMask);
+    
+    for(delta = 0; delta < TAG_RANGE_MAX_SLOT_DELTA; delta++){
+        totalWeight        += estimator->weight[delta];
+        resultant[delta]    = sqrtf(estimator->sumCos[delta]*estimator->sumCos[delta] + estimator->sumSin[delta]*estimator->sumSin[delta]);
+        base[delta]         = atan2f(estimator->sumSin[delta], estimator->sumCos[delta])/(float)(2*M_PI)*TAG_RANGE_ALIAS_M/(delta+1);
+    }
+    if(totalWeight <= 0){
+        estimate->rangeMeters   = TAG_METRICS_RANGE_INVALID;
+        estimate->confidence    = 0;
+        return;
+    }
+    
+    //Each step's mean phasor gives the range modulo its alias period. Try every alias of the widest step seen within
+    //one 1MHz period and keep the one that fits all the steps best. This is the same as unwrapping the phase across
+    //frequency, but works whichever steps have been seen, so missing slots only cost precision. A tie, as when only
+    //one step has been seen, goes to the shorter range before folding near-zero ranges back below 0m.
+    delta = TAG_RANGE_MAX_SLOT_DELTA-1;
+    while(delta >= 0 && resultant[delta] <= 0){
+        delta--;
+    }
+    for(alias = 0; delta >= 0 && alias <= delta; alias++){
+        float   range   = base[delta] + alias*TAG_RANGE_ALIAS_M/(delta+1);
+        float   unfolded, fit;
+        
+        unfolded    = range < 0 ? range+TAG_RANGE_ALIAS_M : range;
+        range       = unfolded > TAG_RANGE_ALIAS_M-TAG_RANGE_NEAR_ZERO_M ? unfolded-TAG_RANGE_ALIAS_M : unfolded;
+        fit         = tagRangeEstimatorFit(estimator, range);
+        if(!haveBest || fit > bestFit + TAG_RANGE_TIE_FRACTION*totalWeight ||
+           (fit > bestFit - TAG_RANGE_TIE_FRACTION*totalWeight && unfolded < bestUnfolded)){
+            bestFit         = fit;
+            bestRange       = range;
+            bestUnfolded    = unfolded;
+            haveBest        = true;
+        }
+    }
+    if(!haveBest){
+        estimate->rangeMeters   = TAG_METRICS_RANGE_INVALID;
+        estimate->confidence    = 0;
+        return;
+    }
+    
+    //Then average the steps at their aliases nearest the best fit. A step of k slots has k times the range resolution,
+    //so it gets k^2 times the weight, as well as the weight of how well its pairs agree.
+    for(delta = 0; delta < TAG_RANGE_MAX_SLOT_DELTA; delta++){
+        float   period  = TAG_RANGE_ALIAS_M/(delta+1);
+        float   meanLength, spread;
+        
+        if(resultant[delta] <= 0){
+            continue;
+        }
+        sumRange       += (base[delta] + period*roundf((bestRange-base[delta])/period))*resultant[delta]*(delta+1)*(delta+1);
+        sumRangeWeight += resultant[delta]*(delta+1)*(delta+1);
+        
+        //Circular standard deviation of the pairs, in meters.
+        meanLength      = fminf(resultant[delta]/estimator->weight[delta], 1);
+        spread          = sqrtf(-2*logf(fmaxf(meanLength, 1e-6f)))*period/(float)(2*M_PI);
+        sumSpread      += estimator->weight[delta]*spread*spread;
+    }
+    
+    estimate->rangeMeters   = fmaxf(sumRange/sumRangeWeight, 0);
+    estimate->confidence    = totalWeight/(totalWeight+1)*expf(-sqrtf(sumSpread/totalWeight)/TAG_RANGE_CONFIDENCE_SPREAD_M);
+}
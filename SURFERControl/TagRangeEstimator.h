@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagRangeEstimator.h                                                       //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module estimates the range of a tag from the phases seen at every          //
+//  frequency slot, rather than from a single hop/skip pair. Each read is           //
+//  folded into a small fixed-size state in constant time.                          //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TagRangeEstimator_h
+#define TagRangeEstimator_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "TagMetrics.h"
+
+//Every read is paired with the latest phase stored at each slot up to this many slots away.
+//A 3MHz step is the largest that doesn't alias within the read range, the same as PDOA_MAX_FREQ_DELTA_MHZ.
+#define TAG_RANGE_MAX_SLOT_DELTA        3
+//A stored phase older than this many reads of the tag is not paired, since the tag may have moved.
+#define TAG_RANGE_MAX_PAIR_AGE          64
+//Each read scales the weight of the pairs before it by this much, so old pairs fade out.
+#define TAG_RANGE_FORGET_FACTOR         0.9f
+//A 1MHz step only gives the range modulo about 75m. Ranges this close below that are taken as just short of 0m.
+#define TAG_RANGE_NEAR_ZERO_M           5.0f
+
+//One tag's worth of state. The size is fixed no matter how many reads the tag sees.
+//The range of a pair is only known modulo c/(4*deltaF), so pairs are not averaged as ranges but as the unit phasor
+//exp(j*2*deltaPhase), which turns once per alias. Each slot step has its own sum, since each aliases at its own range.
+typedef struct
+{
+    float       cos2Phase[TAG_METRICS_NUM_SLOTS];   //Phasor of twice the latest corrected phase at each slot,
+    float       sin2Phase[TAG_METRICS_NUM_SLOTS];   //so that the phasor of a pair is a product, not a cos and sin.
+    uint32_t    readNumber[TAG_METRICS_NUM_SLOTS];  //Read count at which each phase was stored, 0 if never.
+    uint32_t    numReads;
+    uint32_t    slotMask;                           //Bit n is set once slot n has a phase.
+    float       weight[TAG_RANGE_MAX_SLOT_DELTA];   //Weighted pair count for slot steps of 1, 2 and 3.
+    float       sumCos[TAG_RANGE_MAX_SLOT_DELTA];   //Weighted sums of the phasor of those pairs.
+    float       sumSin[TAG_RANGE_MAX_SLOT_DELTA];
+} TagRangeEstimator;
+
+typedef struct
+{
+    float       rangeMeters;    //TAG_METRICS_RANGE_INVALID until at least one pair of slots has been seen.
+    float       confidence;     //0 to 1. Rises with the number of pairs and falls with their circular spread.
+    uint8_t     numSlots;       //How many slots have contributed a phase.
+} TagRangeEstimate;
+
+void    tagRangeEstimatorInit(TagRangeEstimator *estimator);
+//Adds one read. Reads without usable calibration data are ignored and false is returned.
+bool    tagRangeEstimatorUpdate(TagRangeEstimator *estimator, uint8_t slot, float phaseAnt, float phaseCal, float magCal);
+void    tagRangeEstimatorGetEstimate(const TagRangeEstimator *estimator, TagRangeEstimate *estimate);
+
+#endif /* TagRangeEstimator_h */
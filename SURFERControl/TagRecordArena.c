@@ -0,0 +1,119 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagRecordArena.c                                                          //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module keeps the tag list's tags as fixed-layout records in a chunked      //
+//  arena. See TagRecordArena.h.                                                    //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "TagRecordArena.h"
+#include "TagStore.h"
+
+#define TAG_RECORD_ARENA_INITIAL_CHUNKS 16
+
+bool tagRecordArenaInit(TagRecordArena *arena)
+{
+    memset(arena, 0, sizeof(TagRecordArena));
+    
+    arena->chunks = malloc(TAG_RECORD_ARENA_INITIAL_CHUNKS*sizeof(TagRecord *));
+    if(!arena->chunks){
+        return false;
+    }
+    arena->chunkCapacity = TAG_RECORD_ARENA_INITIAL_CHUNKS;
+    
+    return true;
+}
+
+void tagRecordArenaFree(TagRecordArena *arena)
+{
+    if(!arena->chunks){
+        return;
+    }
+    for(uint32_t i=0; i<arena->numChunks; i++){
+        free(arena->chunks[i]);
+    }
+    free(arena->chunks);
+    memset(arena, 0, sizeof(TagRecordArena));
+}
+
+void tagRecordArenaClear(TagRecordArena *arena)
+{
+    arena->numRecords = 0;
+}
+
+//Only the chunk pointer array is ever reallocated, never the chunks.
+bool tagRecordArenaReserve(TagRecordArena *arena)
+{
+    uint32_t    chunk   =   arena->numRecords >> TAG_RECORD_ARENA_CHUNK_SHIFT;
+    TagRecord   **chunks;
+    
+    if(chunk < arena->numChunks){
+        return true;
+    }
+    if(arena->numChunks == arena->chunkCapacity){
+        chunks = realloc(arena->chunks, 2*arena->chunkCapacity*sizeof(TagRecord *));
+        if(!chunks){
+            return false;
+        }
+        arena->chunks           = chunks;
+        arena->chunkCapacity    = 2*arena->chunkCapacity;
+    }
+    arena->chunks[arena->numChunks] = malloc(TAG_RECORD_ARENA_CHUNK_RECORDS*sizeof(TagRecord));
+    if(!arena->chunks[arena->numChunks]){
+        return false;
+    }
+    arena->numChunks++;
+    
+    return true;
+}
+
+TagRecord *tagRecordArenaAdd(TagRecordArena *arena, const uint8_t *epc, uint64_t firstSeenNs)
+{
+    TagRecord *record;
+    
+    if(!tagRecordArenaReserve(arena)){
+        return NULL;
+    }
+    record = tagRecordArenaGet(arena, arena->numRecords++);
+    
+    memset(record, 0, sizeof(TagRecord));
+    memcpy(record->epc, epc, TAG_EPC_NUM_BYTES);
+    record->rangeReaderId   = TAG_STORE_NO_READER;
+    record->trackReaderId   = TAG_STORE_NO_READER;
+    record->firstSeenNs     = firstSeenNs;
+    tagTrackFilterInit(&record->track);
+    
+    return record;
+}
+
+size_t tagRecordArenaBytes(const TagRecordArena *arena)
+{
+    return arena->chunkCapacity*sizeof(TagRecord *) + (size_t)arena->numChunks*TAG_RECORD_ARENA_CHUNK_RECORDS*sizeof(TagRecord);
+}
@@ -0,0 +1,109 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagRecordArena.h                                                          //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module keeps the tag list's tags as fixed-layout records in a chunked      //
+//  arena. A record holds the binary EPC, monotonic timestamps and the hop and skip //
+//  measurements side by side, so saving a read allocates nothing. Chunks are never //
+//  moved, so a record stays where it is until the arena is cleared.                //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+
+#ifndef TagRecordArena_h
+#define TagRecordArena_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "TagPacketDecoder.h"
+#include "TagMetrics.h"
+#include "TagTrackFilter.h"
+
+#define TAG_RECORD_ARENA_CHUNK_SHIFT    10      //1024 records, 144kB, per chunk.
+#define TAG_RECORD_ARENA_CHUNK_RECORDS  (1u << TAG_RECORD_ARENA_CHUNK_SHIFT)
+
+//The last hop or skip read of a tag. The PDOA part goes straight to tagMetricsPDOARange.
+typedef struct
+{
+    TagPDOAMeasurement  pdoa;
+    float               magAnt;         //Received tag magnitude in dBm.
+} TagRecordMeasurement;
+
+//Everything the tag list keeps about a tag. 144 bytes.
+typedef struct
+{
+    uint8_t                 epc[TAG_EPC_NUM_BYTES];
+    uint8_t                 rangeReaderId;      //TAG_STORE_NO_READER if the range came from the hop/skip pair.
+    uint8_t                 numReaders;
+    uint8_t                 trackReaderId;      //The reader the tracking filter follows. TAG_STORE_NO_READER for the hop/skip pair.
+    uint8_t                 reserved;
+    uint64_t                firstSeenNs;        //On the clock the packets are stamped with, monotonicClockNs.
+    uint64_t                lastSeenNs;         //0 until a read has been saved.
+    TagRecordMeasurement    hop;
+    TagRecordMeasurement    skip;
+    float                   rangeMeters;        //The PDOA range in meters, 0 until there is one.
+    float                   rangeConfidence;    //From 0 to 1. 0 if only a hop/skip pair was used.
+    TagTrackFilter          track;              //The smoothed range and RSSI, shown while tracking.
+} TagRecord;
+
+//Records are numbered in the order they were added, which is the order of the rows the EPC index hands out.
+typedef struct
+{
+    TagRecord   **chunks;
+    uint32_t    numChunks;          //Allocated. Kept when the arena is cleared, to be filled again.
+    uint32_t    chunkCapacity;      //Of the chunk pointer array.
+    uint32_t    numRecords;
+} TagRecordArena;
+
+//Returns false if the storage could not be allocated.
+bool        tagRecordArenaInit(TagRecordArena *arena);
+void        tagRecordArenaFree(TagRecordArena *arena);
+//Forgets all of the records, but keeps the memory.
+void        tagRecordArenaClear(TagRecordArena *arena);
+
+//Makes room for one more record, so that the next add can't fail. Returns false if the arena could not grow.
+bool        tagRecordArenaReserve(TagRecordArena *arena);
+//Adds a record for the EPC, first seen at firstSeenNs and with nothing else known yet. Its number is the arena's
+//count before the call. Returns NULL if the arena could not grow.
+TagRecord   *tagRecordArenaAdd(TagRecordArena *arena, const uint8_t *epc, uint64_t firstSeenNs);
+
+//Bytes allocated, including chunks kept after a clear.
+size_t      tagRecordArenaBytes(const TagRecordArena *arena);
+
+static inline uint32_t tagRecordArenaCount(const TagRecordArena *arena)
+{
+    return arena->numRecords;
+}
+
+//The record has to exist.
+static inline TagRecord *tagRecordArenaGet(const TagRecordArena *arena, uint32_t number)
+{
+    return &arena->chunks[number >> TAG_RECORD_ARENA_CHUNK_SHIFT][number & (TAG_RECORD_ARENA_CHUNK_RECORDS-1)];
+}
+
+#endif /* TagRecordArena_h */
@@ -0,0 +1,250 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagSnapshot.c                                                             //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module publishes the tag list to the UI as versioned, immutable snapshots. //
+//  One thread, the tag list's ingest queue, edits a working copy of the rows and   //
+//  publishes it when something has changed. Any thread can take a reference to the //
+//  current snapshot and read it without locks for as long as it holds it.          //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "TagSnapshot.h"
+
+#define TAG_SNAPSHOT_INITIAL_CAPACITY   256
+
+static TagSnapshot *tagSnapshotAllocate(uint32_t capacity)
+{
+    TagSnapshot *snapshot = malloc(sizeof(TagSnapshot) + (size_t)capacity*sizeof(TagSnapshotRow));
+    
+    if(snapshot){
+        snapshot->capacity = capacity;
+    }
+    return snapshot;
+}
+
+bool tagSnapshotPublisherInit(TagSnapshotPublisher *publisher)
+{
+    memset(publisher, 0, sizeof(TagSnapshotPublisher));
+    
+    publisher->rows             = malloc(TAG_SNAPSHOT_INITIAL_CAPACITY*sizeof(TagSnapshotRow));
+    publisher->editedRows       = malloc(TAG_SNAPSHOT_INITIAL_CAPACITY*sizeof(uint32_t));
+    publisher->lastEditedRows   = malloc(TAG_SNAPSHOT_INITIAL_CAPACITY*sizeof(uint32_t));
+    publisher->edited           = calloc(TAG_SNAPSHOT_INITIAL_CAPACITY, 1);
+    publisher->current          = tagSnapshotAllocate(0);
+    if(!publisher->rows || !publisher->editedRows || !publisher->lastEditedRows || !publisher->edited || !publisher->current){
+        free(publisher->rows);
+        free(publisher->editedRows);
+        free(publisher->lastEditedRows);
+        free(publisher->edited);
+        free(publisher->current);
+        publisher->rows = NULL;
+        return false;
+    }
+    publisher->capacity             = TAG_SNAPSHOT_INITIAL_CAPACITY;
+    publisher->current->version     = 0;
+    publisher->current->numRows     = 0;
+    publisher->current->refCount    = 1;    //The publisher's own reference.
+    pthread_mutex_init(&publisher->mutex, NULL);
+    
+    return true;
+}
+
+void tagSnapshotPublisherFree(TagSnapshotPublisher *publisher)
+{
+    if(!publisher->rows){
+        return;
+    }
+    pthread_mutex_destroy(&publisher->mutex);
+    tagSnapshotRelease(publisher->current);
+    free(publisher->spare);
+    free(publisher->rows);
+    free(publisher->editedRows);
+    free(publisher->lastEditedRows);
+    free(publisher->edited);
+    publisher->rows = NULL;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Writer
+
+//The edit lists can hold every row, so they never fill up.
+static bool tagSnapshotPublisherGrow(TagSnapshotPublisher *publisher)
+{
+    size_t          newCapacity = 2*(size_t)publisher->capacity;
+    TagSnapshotRow  *rows;
+    uint32_t        *editedRows, *lastEditedRows;
+    uint8_t         *edited;
+    
+    if(!(rows = realloc(publisher->rows, newCapacity*sizeof(TagSnapshotRow)))){
+        return false;
+    }
+    publisher->rows = rows;
+    if(!(editedRows = realloc(publisher->editedRows, newCapacity*sizeof(uint32_t)))){
+        return false;
+    }
+    publisher->editedRows = editedRows;
+    if(!(lastEditedRows = realloc(publisher->lastEditedRows, newCapacity*sizeof(uint32_t)))){
+        return false;
+    }
+    publisher->lastEditedRows = lastEditedRows;
+    if(!(edited = realloc(publisher->edited, newCapacity))){
+        return false;
+    }
+    memset(&edited[publisher->capacity], 0, newCapacity-publisher->capacity);
+    publisher->edited   = edited;
+    publisher->capacity = (uint32_t)newCapacity;
+    
+    return true;
+}
+
+TagSnapshotRow *tagSnapshotPublisherEditRow(TagSnapshotPublisher *publisher, uint32_t row)
+{
+    if(row > publisher->numRows){
+        return NULL;
+    }
+    if(row == publisher->capacity && !tagSnapshotPublisherGrow(publisher)){
+        return NULL;
+    }
+    if(row == publisher->numRows){
+        memset(&publisher->rows[row], 0, sizeof(TagSnapshotRow));
+        publisher->numRows++;
+    }
+    if(!publisher->edited[row]){
+        publisher->edited[row] = 1;
+        publisher->editedRows[publisher->numEditedRows++] = row;
+    }
+    publisher->changed = true;
+    
+    return &publisher->rows[row];
+}
+
+void tagSnapshotPublisherClear(TagSnapshotPublisher *publisher)
+{
+    publisher->numRows = 0;
+    publisher->changed = true;
+}
+
+//Rows past the end of the list were cleared away, and are left out.
+static void tagSnapshotCopyRows(TagSnapshotPublisher *publisher, TagSnapshot *snapshot, const uint32_t *rows, uint32_t numRows)
+{
+    for(uint32_t i=0; i<numRows; i++){
+        if(rows[i] < publisher->numRows){
+            snapshot->rows[rows[i]] = publisher->rows[rows[i]];
+            publisher->numRowsCopied++;
+        }
+    }
+}
+
+bool tagSnapshotPublish(TagSnapshotPublisher *publisher)
+{
+    TagSnapshot *snapshot, *retired;
+    uint32_t    *lastEditedRows;
+    
+    if(!publisher->changed){
+        return true;
+    }
+    
+    //Write over the spare if it is big enough, bringing it up to date from the version it has. Otherwise make a new one
+    //with room to grow, copy every row into it, and drop the spare. Past half the rows, one memcpy beats going row by row.
+    if(publisher->spare && publisher->spare->capacity >= publisher->numRows
+       && publisher->spare->version+1 == publisher->current->version
+       && publisher->numLastEditedRows+publisher->numEditedRows < publisher->numRows/2){
+        snapshot            = publisher->spare;
+        publisher->spare    = NULL;
+        tagSnapshotCopyRows(publisher, snapshot, publisher->lastEditedRows, publisher->numLastEditedRows);
+        tagSnapshotCopyRows(publisher, snapshot, publisher->editedRows, publisher->numEditedRows);
+    } else {
+        if(publisher->spare && publisher->spare->capacity >= publisher->numRows){
+            snapshot            = publisher->spare;
+            publisher->spare    = NULL;
+        } else {
+            snapshot = tagSnapshotAllocate(publisher->capacity);
+            if(!snapshot){
+                return false;
+            }
+            free(publisher->spare);
+            publisher->spare = NULL;
+        }
+        memcpy(snapshot->rows, publisher->rows, (size_t)publisher->numRows*sizeof(TagSnapshotRow));
+        publisher->numRowsCopied += publisher->numRows;
+    }
+    snapshot->numRows   = publisher->numRows;
+    snapshot->version   = publisher->current->version+1;
+    snapshot->refCount  = 1;
+    
+    //The rows have to be in memory before another thread can get at the snapshot. The mutex sees to that.
+    pthread_mutex_lock(&publisher->mutex);
+    retired             = publisher->current;
+    publisher->current  = snapshot;
+    pthread_mutex_unlock(&publisher->mutex);
+    
+    //If no reader still has the old snapshot, keep it for next time rather than going back to malloc.
+    if(__atomic_sub_fetch(&retired->refCount, 1, __ATOMIC_ACQ_REL) == 0){
+        publisher->spare = retired;
+    }
+    
+    //The rows edited for this snapshot are the ones the spare will be missing next time.
+    for(uint32_t i=0; i<publisher->numEditedRows; i++){
+        publisher->edited[publisher->editedRows[i]] = 0;
+    }
+    lastEditedRows                  = publisher->lastEditedRows;
+    publisher->lastEditedRows       = publisher->editedRows;
+    publisher->numLastEditedRows    = publisher->numEditedRows;
+    publisher->editedRows           = lastEditedRows;
+    publisher->numEditedRows        = 0;
+    publisher->changed              = false;
+    
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Readers
+
+//The reference is taken under the lock, so the publisher can't retire the snapshot in between reading the pointer
+//and counting the reference.
+TagSnapshot *tagSnapshotAcquire(TagSnapshotPublisher *publisher)
+{
+    TagSnapshot *snapshot;
+    
+    pthread_mutex_lock(&publisher->mutex);
+    snapshot = publisher->current;
+    __atomic_add_fetch(&snapshot->refCount, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&publisher->mutex);
+    
+    return snapshot;
+}
+
+//Whoever lets go of the last reference frees the snapshot, unless it is the publisher, which keeps it as the spare.
+void tagSnapshotRelease(TagSnapshot *snapshot)
+{
+    if(snapshot && __atomic_sub_fetch(&snapshot->refCount, 1, __ATOMIC_ACQ_REL) == 0){
+        free(snapshot);
+    }
+}
@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagSnapshot.h                                                             //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module publishes the tag list to the UI as versioned, immutable snapshots. //
+//  One thread, the tag list's ingest queue, edits a working copy of the rows and   //
+//  publishes it when something has changed. Any thread can take a reference to the //
+//  current snapshot and read it without locks for as long as it holds it.          //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#ifndef TagSnapshot_h
+#define TagSnapshot_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "TagPacketDecoder.h"
+
+//One row of the tag list, as the UI shows it.
+typedef struct
+{
+    char        epc[TAG_EPC_HEX_STRING_LENGTH+1];
+    uint8_t     epcBytes[TAG_EPC_NUM_BYTES];    //The same EPC, for the prefix index.
+    uint8_t     rangeReaderId;      //TAG_STORE_NO_READER if the range is from the hop/skip pair.
+    uint8_t     numReaders;
+    float       rssidBm;
+    float       rangeMeters;
+    float       rangeConfidence;
+    float       rangeRateMetersPerSecond;   //Positive going away. Only known while tracking, 0 otherwise.
+    double      firstSeen;          //Seconds since 1970.
+    double      lastSeen;           //Seconds since 1970, or 0 if no read has been saved yet.
+} TagSnapshotRow;
+
+typedef struct
+{
+    uint64_t        version;        //Counts up by one with each snapshot published.
+    uint32_t        numRows;
+    uint32_t        capacity;
+    uint32_t        refCount;
+    TagSnapshotRow  rows[];
+} TagSnapshot;
+
+typedef struct
+{
+    pthread_mutex_t     mutex;      //Only held to swap the current snapshot or to take a reference to it.
+    TagSnapshot         *current;
+    //Everything below belongs to the writer.
+    TagSnapshot         *spare;     //The last snapshot retired with no readers left, kept to be written over.
+    TagSnapshotRow      *rows;
+    uint32_t            numRows;
+    uint32_t            capacity;
+    bool                changed;
+    //The spare is one version behind the current snapshot, so bringing it up to date only takes the rows edited for
+    //the current one and those edited since.
+    uint32_t            *editedRows;        //Since the last publish, each row once.
+    uint32_t            numEditedRows;
+    uint32_t            *lastEditedRows;    //Those that went out with the current snapshot.
+    uint32_t            numLastEditedRows;
+    uint8_t             *edited;            //Per row, set while it is in editedRows.
+    uint64_t            numRowsCopied;      //Into snapshots, over all publishes.
+} TagSnapshotPublisher;
+
+//Publishes an empty snapshot as version 0. Returns false if the storage could not be allocated.
+bool            tagSnapshotPublisherInit(TagSnapshotPublisher *publisher);
+//Snapshots still referenced by readers stay valid until they are released.
+void            tagSnapshotPublisherFree(TagSnapshotPublisher *publisher);
+
+//Writer side. The row has to exist already or be the next one. Returns NULL if the rows could not grow.
+TagSnapshotRow  *tagSnapshotPublisherEditRow(TagSnapshotPublisher *publisher, uint32_t row);
+void            tagSnapshotPublisherClear(TagSnapshotPublisher *publisher);
+//Makes a new snapshot of the working rows, if anything changed since the last one. If the spare can be written over,
+//only the rows edited since it was current are copied. Returns false if the snapshot could not be allocated, in which
+//case the changes go out with the next one.
+bool            tagSnapshotPublish(TagSnapshotPublisher *publisher);
+
+//Reader side, safe to call from any thread. The snapshot must not be written to, and must be released when done.
+TagSnapshot     *tagSnapshotAcquire(TagSnapshotPublisher *publisher);
+void            tagSnapshotRelease(TagSnapshot *snapshot);
+
+#endif /* TagSnapshot_h */
@@ -0,0 +1,265 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagStore.c                                                                //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module is the merged tag store for all of the connected readers. It keeps  //
+//  one record per EPC with which readers have seen the tag and, for each of them,  //
+//  the best RSSI and the latest range. It is plain C and thread safe, so that      //
+//  reader sessions on different threads can merge into it.                         //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "TagStore.h"
+#include "TagMetrics.h"
+
+#define TAG_STORE_INITIAL_CAPACITY  256
+
+bool tagStoreInit(TagStore *store)
+{
+    memset(store, 0, sizeof(TagStore));
+    
+    store->records = malloc(TAG_STORE_INITIAL_CAPACITY*sizeof(TagStoreRecord));
+    if(!store->records || !epcIndexInit(&store->index)){
+        free(store->records);
+        store->records = NULL;
+        return false;
+    }
+    store->capacity = TAG_STORE_INITIAL_CAPACITY;
+    pthread_mutex_init(&store->mutex, NULL);
+    
+    return true;
+}
+
+void tagStoreFree(TagStore *store)
+{
+    if(!store->records){
+        return;
+    }
+    pthread_mutex_destroy(&store->mutex);
+    epcIndexFree(&store->index);
+    free(store->records);
+    store->records = NULL;
+}
+
+void tagStoreClear(TagStore *store)
+{
+    pthread_mutex_lock(&store->mutex);
+    epcIndexClear(&store->index);
+    store->numObservations = 0;
+    store->generation++;
+    pthread_mutex_unlock(&store->mutex);
+}
+
+uint32_t tagStoreGeneration(TagStore *store)
+{
+    uint32_t generation;
+    
+    pthread_mutex_lock(&store->mutex);
+    generation = store->generation;
+    pthread_mutex_unlock(&store->mutex);
+    
+    return generation;
+}
+
+void tagStoreForgetReader(TagStore *store, uint8_t readerId)
+{
+    if(readerId >= TAG_STORE_MAX_READERS){
+        return;
+    }
+    
+    pthread_mutex_lock(&store->mutex);
+    for(uint32_t row=0; row<store->index.count; row++){
+        TagStoreRecord *record = &store->records[row];
+        
+        memset(&record->readers[readerId], 0, sizeof(TagStoreReaderView));
+        record->readers[readerId].rangeMeters = TAG_METRICS_RANGE_INVALID;
+        record->readerMask &= ~(1u << readerId);
+    }
+    pthread_mutex_unlock(&store->mutex);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Merging
+
+//Called with the lock held. Makes room for one more record, so that a row handed out by the index always has one.
+static bool tagStoreReserve(TagStore *store)
+{
+    uint32_t        newCapacity;
+    TagStoreRecord  *records;
+    
+    if(store->index.count < store->capacity){
+        return true;
+    }
+    
+    newCapacity = 2*store->capacity;
+    records     = realloc(store->records, newCapacity*sizeof(TagStoreRecord));
+    if(!records){
+        return false;
+    }
+    store->records  = records;
+    store->capacity = newCapacity;
+    
+    return true;
+}
+
+uint32_t tagStoreMerge(TagStore *store, TagStoreObservation *observations, uint32_t count)
+{
+    uint32_t numNewTags = 0;
+    
+    pthread_mutex_lock(&store->mutex);
+    
+    for(uint32_t i=0; i<count; i++){
+        TagStoreObservation *observation    = &observations[i];
+        TagStoreReaderView  *view;
+        TagStoreRecord      *record;
+        int32_t             row;
+        bool                inserted;
+        
+        observation->row = EPC_INDEX_NOT_FOUND;
+        if(observation->readerId >= TAG_STORE_MAX_READERS){
+            continue;
+        }
+        
+        //If there is no room for another record, the read can still go to a tag we already have.
+        if(tagStoreReserve(store)){
+            row = epcIndexFindOrInsert(&store->index, observation->epc, &inserted);
+        } else {
+            row         = epcIndexFind(&store->index, observation->epc);
+            inserted    = false;
+        }
+        if(row == EPC_INDEX_NOT_FOUND){
+            continue;
+        }
+        
+        record = &store->records[row];
+        if(inserted){
+            memset(record, 0, sizeof(TagStoreRecord));
+            memcpy(record->epc, observation->epc, TAG_EPC_NUM_BYTES);
+            for(int r=0; r<TAG_STORE_MAX_READERS; r++){
+                record->readers[r].rangeMeters = TAG_METRICS_RANGE_INVALID;
+            }
+            record->firstSeenNs = observation->timestampNs;
+            numNewTags++;
+        }
+        
+        view = &record->readers[observation->readerId];
+        if(!view->numReads || observation->rssidBm > view->bestRSSIdBm){
+            view->bestRSSIdBm = observation->rssidBm;
+        }
+        view->lastRSSIdBm   = observation->rssidBm;
+        view->lastSeenNs    = observation->timestampNs;
+        view->numReads++;
+        if(observation->rangeMeters != TAG_METRICS_RANGE_INVALID){
+            view->rangeMeters       = observation->rangeMeters;
+            view->rangeConfidence   = observation->rangeConfidence;
+        }
+        
+        record->readerMask |= 1u << observation->readerId;
+        if(observation->timestampNs > record->lastSeenNs){
+            record->lastSeenNs = observation->timestampNs;
+        }
+        observation->row = row;
+    }
+    store->numObservations += count;
+    
+    pthread_mutex_unlock(&store->mutex);
+    
+    return numNewTags;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Lookup
+
+uint32_t tagStoreNumTags(TagStore *store)
+{
+    uint32_t count;
+    
+    pthread_mutex_lock(&store->mutex);
+    count = store->index.count;
+    pthread_mutex_unlock(&store->mutex);
+    
+    return count;
+}
+
+bool tagStoreCopyRecord(TagStore *store, int32_t row, TagStoreRecord *record)
+{
+    bool found;
+    
+    pthread_mutex_lock(&store->mutex);
+    found = row >= 0 && (uint32_t)row < store->index.count;
+    if(found){
+        *record = store->records[row];
+    }
+    pthread_mutex_unlock(&store->mutex);
+    
+    return found;
+}
+
+int32_t tagStoreFindRecord(TagStore *store, const uint8_t *epc, TagStoreRecord *record)
+{
+    int32_t row;
+    
+    pthread_mutex_lock(&store->mutex);
+    row = epcIndexFind(&store->index, epc);
+    if(row != EPC_INDEX_NOT_FOUND){
+        *record = store->records[row];
+    }
+    pthread_mutex_unlock(&store->mutex);
+    
+    return row;
+}
+
+uint8_t tagStoreRecordBestReader(const TagStoreRecord *record)
+{
+    uint8_t best        = TAG_STORE_NO_READER;
+    bool    bestRanged  = false;
+    
+    for(uint8_t r=0; r<TAG_STORE_MAX_READERS; r++){
+        const TagStoreReaderView *view = &record->readers[r];
+        bool ranged = view->rangeMeters != TAG_METRICS_RANGE_INVALID;
+        
+        if(!(record->readerMask & (1u << r))){
+            continue;
+        }
+        if(best == TAG_STORE_NO_READER || (ranged && !bestRanged)){
+            best        = r;
+            bestRanged  = ranged;
+        } else if(ranged == bestRanged){
+            if(ranged ? view->rangeConfidence > record->readers[best].rangeConfidence
+                      : view->lastRSSIdBm > record->readers[best].lastRSSIdBm){
+                best = r;
+            }
+        }
+    }
+    return best;
+}
+
+uint32_t tagStoreRecordNumReaders(const TagStoreRecord *record)
+{
+    return (uint32_t)__builtin_popcount(record->readerMask);
+}
@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagStore.h                                                                //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module is the merged tag store for all of the connected readers. It keeps  //
+//  one record per EPC with which readers have seen the tag and, for each of them,  //
+//  the best RSSI and the latest range. It is plain C and thread safe, so that      //
+//  reader sessions on different threads can merge into it.                         //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TagStore_h
+#define TagStore_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "TagPacketDecoder.h"
+#include "EPCIndex.h"
+
+#define TAG_STORE_MAX_READERS       8       //Reader IDs go from 0 to TAG_STORE_MAX_READERS-1.
+#define TAG_STORE_DEBUG_READER      (TAG_STORE_MAX_READERS-1)   //Kept for made-up reads. Real readers never get it.
+#define TAG_STORE_NO_READER         0xFF
+
+//What one reader has seen of one tag.
+typedef struct
+{
+    uint32_t    numReads;
+    float       lastRSSIdBm;
+    float       bestRSSIdBm;
+    float       rangeMeters;        //TAG_METRICS_RANGE_INVALID until the reader has a range for the tag.
+    float       rangeConfidence;
+    uint64_t    lastSeenNs;
+} TagStoreReaderView;
+
+typedef struct
+{
+    uint8_t             epc[TAG_EPC_NUM_BYTES];
+    uint32_t            readerMask;     //Bit n is set if reader n has seen the tag.
+    uint64_t            firstSeenNs;
+    uint64_t            lastSeenNs;
+    TagStoreReaderView  readers[TAG_STORE_MAX_READERS];
+} TagStoreRecord;
+
+//One read as worked out by a reader session, ready to be merged.
+typedef struct
+{
+    uint8_t     epc[TAG_EPC_NUM_BYTES];
+    uint8_t     readerId;
+    bool        rangeUpdated;       //Set if this read went into the session's range, so the range is a new measurement.
+    float       rssidBm;
+    float       rangeMeters;        //TAG_METRICS_RANGE_INVALID if the session has no range for the tag yet.
+    float       rangeConfidence;
+    uint64_t    timestampNs;
+    uint64_t    decodedNs;          //When the session's decoder returned the read, from latencyProbeNow. 0 if not timed.
+    int32_t     row;                //Filled in by tagStoreMerge. EPC_INDEX_NOT_FOUND if the store could not grow.
+} TagStoreObservation;
+
+typedef struct
+{
+    pthread_mutex_t     mutex;
+    EPCIndex            index;          //Rows count up in the order tags were first seen, by any reader.
+    TagStoreRecord      *records;
+    uint32_t            capacity;
+    uint64_t            numObservations;
+    uint32_t            generation;     //Counts up on every clear, so that reader sessions know to forget their tags too.
+} TagStore;
+
+//Returns false if the storage could not be allocated.
+bool        tagStoreInit(TagStore *store);
+void        tagStoreFree(TagStore *store);
+void        tagStoreClear(TagStore *store);
+uint32_t    tagStoreGeneration(TagStore *store);
+//Takes what the reader has seen out of every record, for when its ID goes to a different reader.
+void        tagStoreForgetReader(TagStore *store, uint8_t readerId);
+
+//Merges a batch of observations under one lock, so that sessions don't contend on every read.
+//Returns how many of them were for tags the store hadn't seen before.
+uint32_t    tagStoreMerge(TagStore *store, TagStoreObservation *observations, uint32_t count);
+
+uint32_t    tagStoreNumTags(TagStore *store);
+//Records are copied out, since another thread may grow the store at any time.
+bool        tagStoreCopyRecord(TagStore *store, int32_t row, TagStoreRecord *record);
+//Returns the row of the EPC, or EPC_INDEX_NOT_FOUND. The record is only written if found.
+int32_t     tagStoreFindRecord(TagStore *store, const uint8_t *epc, TagStoreRecord *record);
+
+//The reader to take the tag's range from: the one with the most confident range, or if no reader has a range,
+//the one that saw it strongest last. TAG_STORE_NO_READER if no reader has seen the tag.
+uint8_t     tagStoreRecordBestReader(const TagStoreRecord *record);
+uint32_t    tagStoreRecordNumReaders(const TagStoreRecord *record);
+
+#endif /* TagStore_h */
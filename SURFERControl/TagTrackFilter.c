@@ -0,0 +1,163 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagTrackFilter.c                                                          //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module smooths the range and RSSI of a tag while it is being tracked. See  //
+//  TagTrackFilter.h.                                                               //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <math.h>
+#include <string.h>
+
+#include "TagTrackFilter.h"
+#include "TagMetrics.h"
+
+void tagTrackFilterDefaultParams(TagTrackFilterParams *params)
+{
+    //Range reads during a track come in every few tens of ms, with about 0.3m of noise and a tag moving at walking pace.
+    params->range.alpha                 = 0.2f;
+    params->range.beta                  = 0.02f;
+    params->range.gateSigmas            = 3.0f;
+    params->range.minGate               = 0.5f;
+    params->range.initialSigma          = 0.5f;
+    params->range.maxConsecutiveRejects = 4;
+    //RSSI swings a few dB with multipath, so it gets a wider gate and less weight on the rate.
+    params->rssi.alpha                  = 0.2f;
+    params->rssi.beta                   = 0.02f;
+    params->rssi.gateSigmas             = 4.0f;
+    params->rssi.minGate                = 4.0f;
+    params->rssi.initialSigma           = 2.0f;
+    params->rssi.maxConsecutiveRejects  = 4;
+    params->maxNonceAge                 = 32;
+    params->maxGapNs                    = 2000000000ULL;
+}
+
+void tagTrackFilterInit(TagTrackFilter *filter)
+{
+    memset(filter, 0, sizeof(TagTrackFilter));
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Filtering
+
+static TagTrackResult tagTrackChannelStart(TagTrackChannel *channel, const TagTrackChannelParams *params, float measurement,
+                                           uint64_t timestampNs)
+{
+    channel->lastNs             = timestampNs;
+    channel->value              = measurement;
+    channel->rate               = 0;
+    channel->residualVariance   = params->initialSigma*params->initialSigma;
+    channel->numUpdates         = 1;
+    channel->consecutiveRejects = 0;
+    
+    return TAG_TRACK_STARTED;
+}
+
+//Predict to the time of the read, then move the value and the rate toward the read by alpha and beta of the residual.
+//A time going backwards, as from a second reader a little behind the first, restarts the track rather than predicting back.
+static TagTrackResult tagTrackChannelUpdate(TagTrackChannel *channel, const TagTrackChannelParams *params, uint64_t maxGapNs,
+                                            float measurement, uint64_t timestampNs)
+{
+    float   dt, prediction, residual, gate;
+    
+    if(!channel->numUpdates || timestampNs < channel->lastNs || timestampNs-channel->lastNs > maxGapNs){
+        return tagTrackChannelStart(channel, params, measurement, timestampNs);
+    }
+    
+    dt          = fmaxf((float)(timestampNs-channel->lastNs)*1e-9f, TAG_TRACK_MIN_DT_S);
+    prediction  = channel->value + channel->rate*dt;
+    residual    = measurement - prediction;
+    gate        = fmaxf(params->minGate, params->gateSigmas*sqrtf(channel->residualVariance));
+    
+    if(fabsf(residual) > gate){
+        //A run of outliers means the filter has lost the tag rather than the reads being bad.
+        if(++channel->consecutiveRejects > params->maxConsecutiveRejects){
+            return tagTrackChannelStart(channel, params, measurement, timestampNs);
+        }
+        return TAG_TRACK_REJECTED_OUTLIER;
+    }
+    
+    channel->value              = prediction + params->alpha*residual;
+    channel->rate              += params->beta*residual/dt;
+    channel->residualVariance  += TAG_TRACK_VARIANCE_WEIGHT*(residual*residual - channel->residualVariance);
+    channel->lastNs             = timestampNs;
+    channel->consecutiveRejects = 0;
+    if(channel->numUpdates < UINT16_MAX){
+        channel->numUpdates++;
+    }
+    
+    return TAG_TRACK_ACCEPTED;
+}
+
+static bool tagTrackRangeValid(float rangeMeters)
+{
+    return isfinite(rangeMeters) && rangeMeters > 0 && rangeMeters < TAG_METRICS_RANGE_INVALID;
+}
+
+TagTrackResult tagTrackFilterUpdateRange(TagTrackFilter *filter, const TagTrackFilterParams *params, float rangeMeters,
+                                         uint64_t timestampNs)
+{
+    if(!tagTrackRangeValid(rangeMeters)){
+        return TAG_TRACK_REJECTED_INVALID;
+    }
+    
+    filter->rangeFromPair = false;
+    
+    return tagTrackChannelUpdate(&filter->range, &params->range, params->maxGapNs, rangeMeters, timestampNs);
+}
+
+TagTrackResult tagTrackFilterUpdatePairRange(TagTrackFilter *filter, const TagTrackFilterParams *params, float rangeMeters,
+                                             uint8_t nonce, uint64_t timestampNs)
+{
+    uint8_t nonceAge = (uint8_t)(nonce - filter->rangeNonce);
+    
+    if(!tagTrackRangeValid(rangeMeters)){
+        return TAG_TRACK_REJECTED_INVALID;
+    }
+    if(filter->range.numUpdates && filter->rangeFromPair && nonceAge == 0){
+        return TAG_TRACK_REJECTED_STALE;
+    }
+    
+    //Too many interrogations since the last pair, or the nonce has wrapped, so the prediction can't be trusted.
+    if(filter->rangeFromPair && nonceAge > params->maxNonceAge){
+        filter->range.numUpdates = 0;
+    }
+    filter->rangeNonce      = nonce;
+    filter->rangeFromPair   = true;
+    
+    return tagTrackChannelUpdate(&filter->range, &params->range, params->maxGapNs, rangeMeters, timestampNs);
+}
+
+TagTrackResult tagTrackFilterUpdateRSSI(TagTrackFilter *filter, const TagTrackFilterParams *params, float rssidBm,
+                                        uint64_t timestampNs)
+{
+    if(!isfinite(rssidBm) || rssidBm >= 0){
+        return TAG_TRACK_REJECTED_INVALID;
+    }
+    
+    return tagTrackChannelUpdate(&filter->rssi, &params->rssi, params->maxGapNs, rssidBm, timestampNs);
+}
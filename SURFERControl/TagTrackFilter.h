@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TagTrackFilter.h                                                          //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module smooths the range and RSSI of a tag while it is being tracked. Each //
+//  tag gets an alpha-beta filter on each of the two, which takes O(1) time per read//
+//  and a fixed amount of memory. Sentinel ranges, reads far from the prediction    //
+//  and range pairs already seen or too many interrogations old are kept out of it. //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+
+#ifndef TagTrackFilter_h
+#define TagTrackFilter_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TAG_TRACK_MIN_DT_S              0.001f  //Reads closer together than this are taken to be this far apart.
+#define TAG_TRACK_VARIANCE_WEIGHT       0.0625f //Weight of each new residual in the running residual variance.
+
+//How one of the values is filtered.
+typedef struct
+{
+    float       alpha;                  //How much of each residual goes into the value, 0 to 1.
+    float       beta;                   //How much of each residual, over the time since the last read, goes into the rate.
+    float       gateSigmas;             //A read further than this many residual deviations from the prediction is an outlier...
+    float       minGate;                //...unless it is within this much of it.
+    float       initialSigma;           //The residual deviation assumed when a track starts.
+    uint8_t     maxConsecutiveRejects;  //After this many outliers in a row the track restarts from the next one.
+} TagTrackChannelParams;
+
+typedef struct
+{
+    TagTrackChannelParams   range;
+    TagTrackChannelParams   rssi;
+    uint8_t                 maxNonceAge;    //A range pair this many interrogations after the last one restarts the track.
+    uint64_t                maxGapNs;       //As does a read this long after the last one accepted.
+} TagTrackFilterParams;
+
+//One filtered value. Read value and rate once numUpdates is nonzero.
+typedef struct
+{
+    uint64_t    lastNs;                 //Time of the last read accepted.
+    float       value;
+    float       rate;                   //Change in value per second.
+    float       residualVariance;
+    uint16_t    numUpdates;             //Reads accepted since the track started, stopping at UINT16_MAX. 0 if not started.
+    uint8_t     consecutiveRejects;
+} TagTrackChannel;
+
+//One tag's worth of state. 56 bytes.
+typedef struct
+{
+    TagTrackChannel range;              //Meters, and meters per second, positive going away.
+    TagTrackChannel rssi;               //dBm, and dB per second.
+    uint8_t         rangeNonce;         //Of the last range pair taken in.
+    bool            rangeFromPair;      //The last range taken in came from a hop/skip pair, so rangeNonce applies.
+} TagTrackFilter;
+
+typedef enum
+{
+    TAG_TRACK_ACCEPTED          =   0,
+    TAG_TRACK_STARTED           =   1,  //The track (re)started from this read.
+    TAG_TRACK_REJECTED_INVALID  =   2,  //TAG_METRICS_RANGE_INVALID, not a number, or an RSSI that is not negative.
+    TAG_TRACK_REJECTED_STALE    =   3,  //A range from the same hop/skip pair as the last one.
+    TAG_TRACK_REJECTED_OUTLIER  =   4
+} TagTrackResult;
+
+void            tagTrackFilterDefaultParams(TagTrackFilterParams *params);
+void            tagTrackFilterInit(TagTrackFilter *filter);
+
+//Range reads are only passed in when they come from a new measurement. Ranges from a reader's estimator are
+//gated on time alone. Ranges from a single hop/skip pair also carry the pair's nonce, and one from the same pair
+//as the last is not taken in again.
+TagTrackResult  tagTrackFilterUpdateRange(TagTrackFilter *filter, const TagTrackFilterParams *params, float rangeMeters,
+                                          uint64_t timestampNs);
+TagTrackResult  tagTrackFilterUpdatePairRange(TagTrackFilter *filter, const TagTrackFilterParams *params, float rangeMeters,
+                                              uint8_t nonce, uint64_t timestampNs);
+TagTrackResult  tagTrackFilterUpdateRSSI(TagTrackFilter *filter, const TagTrackFilterParams *params, float rssidBm,
+                                         uint64_t timestampNs);
+
+#endif /* TagTrackFilter_h */
@@ -0,0 +1,213 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TxScheduler.c                                                             //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module queues the commands sent from the app to the reader and paces them  //
+//  to fit the BTLE connection interval. The link itself is reached through a       //
+//  transport interface so that the scheduling can be exercised off the device.     //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "TxScheduler.h"
+
+void txSchedulerInit(TxScheduler *scheduler, TxTransport transport, LatencyProbeClock clock, void *clockContext)
+{
+    memset(scheduler, 0, sizeof(TxScheduler));
+    
+    scheduler->transport        = transport;
+    scheduler->clock            = clock ? clock : monotonicClockNsWithContext;
+    scheduler->clockContext     = clockContext;
+    scheduler->intervalNs       = TX_SCHEDULER_DEFAULT_INTERVAL_NS;
+    scheduler->pktsPerInterval  = TX_SCHEDULER_DEFAULT_PKTS_PER_INTERVAL;
+}
+
+void txSchedulerSetBudget(TxScheduler *scheduler, uint64_t intervalNs, uint32_t pktsPerInterval)
+{
+    scheduler->intervalNs       = intervalNs ? intervalNs : 1;
+    scheduler->pktsPerInterval  = pktsPerInterval ? pktsPerInterval : 1;
+    if(scheduler->pktsPerInterval > TX_SCHEDULER_MAX_PKTS_PER_INTERVAL){
+        scheduler->pktsPerInterval = TX_SCHEDULER_MAX_PKTS_PER_INTERVAL;
+    }
+    scheduler->sentNext         = 0;
+    scheduler->numRecentSent    = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Queue
+
+TxEnqueueResult txSchedulerEnqueue(TxScheduler *scheduler, TxChannel channel, TxPriority priority,
+                                   const uint8_t *bytes, size_t length)
+{
+    bool        urgent  = (priority == TX_PRIORITY_URGENT);
+    uint32_t    begin   = urgent ? 0 : scheduler->numUrgent;
+    uint32_t    end     = urgent ? scheduler->numUrgent : scheduler->numQueued;
+    TxCommand   *command;
+    
+    if(length == 0 || length > TX_COMMAND_MAX_BYTES || (unsigned)channel >= TX_NUM_CHANNELS){
+        scheduler->numRejected++;
+        return TX_ENQUEUE_TOO_LONG;
+    }
+    
+    //Only the last command at this priority can be merged into.
+    if(end > begin && scheduler->queue[end-1].channel == channel){
+        command = &scheduler->queue[end-1];
+        
+        if(channel != TX_CHANNEL_STATE){
+            memcpy(command->bytes, bytes, length);
+            command->length = (uint8_t)length;
+            scheduler->numEnqueued++;
+            scheduler->numMerged++;
+            return TX_ENQUEUE_MERGED;
+        }
+        if(command->length == length && !memcmp(command->bytes, bytes, length)){
+            scheduler->numEnqueued++;
+            scheduler->numMerged++;
+            return TX_ENQUEUE_MERGED;
+        }
+    }
+    
+    if(scheduler->numQueued == TX_SCHEDULER_QUEUE_CAPACITY){
+        scheduler->numRejected++;
+        return TX_ENQUEUE_QUEUE_FULL;
+    }
+    
+    memmove(&scheduler->queue[end+1], &scheduler->queue[end], (scheduler->numQueued-end)*sizeof(TxCommand));
+    command             = &scheduler->queue[end];
+    command->channel    = channel;
+    command->priority   = priority;
+    command->length     = (uint8_t)length;
+    command->enqueuedNs = scheduler->clock(scheduler->clockContext);
+    memcpy(command->bytes, bytes, length);
+    
+    scheduler->numQueued++;
+    if(urgent){
+        scheduler->numUrgent++;
+    }
+    if(scheduler->numQueued > scheduler->maxQueued){
+        scheduler->maxQueued = scheduler->numQueued;
+    }
+    scheduler->numEnqueued++;
+    
+    return TX_ENQUEUE_QUEUED;
+}
+
+void txSchedulerClear(TxScheduler *scheduler)
+{
+    scheduler->numDropped   += scheduler->numQueued;
+    scheduler->numQueued    = 0;
+    scheduler->numUrgent    = 0;
+}
+
+void txSchedulerResetStatistics(TxScheduler *scheduler)
+{
+    scheduler->maxQueued    = scheduler->numQueued;
+    scheduler->numEnqueued  = 0;
+    scheduler->numMerged    = 0;
+    scheduler->numRejected  = 0;
+    scheduler->numSent      = 0;
+    scheduler->numDropped   = 0;
+    scheduler->numDeferred  = 0;
+    memset(&scheduler->sendLatency, 0, sizeof(LatencyHistogram));
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Pacing
+
+//The window slides with every packet: one may only go once the packet pktsPerInterval before it went at least
+//intervalNs ago. So we never put more than the budget into any stretch of one interval, whatever the phase of the
+//real connection events.
+static uint64_t txSchedulerBudgetDelayNs(TxScheduler *scheduler, uint64_t now)
+{
+    uint64_t elapsed;
+    
+    if(scheduler->numRecentSent < scheduler->pktsPerInterval){
+        return 0;
+    }
+    elapsed = now - scheduler->sentNs[scheduler->sentNext];
+    return elapsed >= scheduler->intervalNs ? 0 : scheduler->intervalNs - elapsed;
+}
+
+uint32_t txSchedulerService(TxScheduler *scheduler)
+{
+    TxTransport *transport  = &scheduler->transport;
+    uint64_t    now         = scheduler->clock(scheduler->clockContext);
+    uint32_t    numSent     = 0;
+    TxCommand   *command;
+    
+    while(scheduler->numQueued){
+        command = &scheduler->queue[0];
+        
+        if(txSchedulerBudgetDelayNs(scheduler, now) ||
+           (transport->canWrite && !transport->canWrite(transport->context)) ||
+           !transport->write(transport->context, command->channel, command->bytes, command->length)){
+            scheduler->numDeferred++;
+            break;
+        }
+        
+        latencyHistogramRecord(&scheduler->sendLatency, now - command->enqueuedNs);
+        scheduler->sentNs[scheduler->sentNext] = now;
+        scheduler->sentNext = (scheduler->sentNext+1) % scheduler->pktsPerInterval;
+        if(scheduler->numRecentSent < scheduler->pktsPerInterval){
+            scheduler->numRecentSent++;
+        }
+        scheduler->numSent++;
+        numSent++;
+        
+        if(scheduler->numUrgent){
+            scheduler->numUrgent--;
+        }
+        scheduler->numQueued--;
+        memmove(&scheduler->queue[0], &scheduler->queue[1], scheduler->numQueued*sizeof(TxCommand));
+    }
+    
+    return numSent;
+}
+
+uint64_t txSchedulerServiceDelayNs(TxScheduler *scheduler)
+{
+    if(!scheduler->numQueued){
+        return TX_SCHEDULER_NO_SERVICE;
+    }
+    return txSchedulerBudgetDelayNs(scheduler, scheduler->clock(scheduler->clockContext));
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Report
+
+size_t txSchedulerFormatReport(TxScheduler *scheduler, char *text, size_t size)
+{
+    const LatencyHistogram *latency = &scheduler->sendLatency;
+    
+    return (size_t)snprintf(text, size, "TX: %llu sent, %llu merged, %llu rejected, %llu dropped, %llu deferred, "
+                            "max queue %u, latency p50 %.1fms p99 %.1fms max %.1fms",
+                            (unsigned long long)scheduler->numSent, (unsigned long long)scheduler->numMerged,
+                            (unsigned long long)scheduler->numRejected, (unsigned long long)scheduler->numDropped,
+                            (unsigned long long)scheduler->numDeferred, scheduler->maxQueued,
+                            latencyHistogramPercentile(latency, 50)/1e6, latencyHistogramPercentile(latency, 99)/1e6,
+                            latency->maxNs/1e6);
+}
@@ -0,0 +1,143 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: TxScheduler.h                                                             //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module queues the commands sent from the app to the reader and paces them  //
+//  to fit the BTLE connection interval. The link itself is reached through a       //
+//  transport interface so that the scheduling can be exercised off the device.     //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TxScheduler_h
+#define TxScheduler_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "LatencyProbe.h"
+
+#define TX_SCHEDULER_QUEUE_CAPACITY             32
+#define TX_COMMAND_MAX_BYTES                    16      //Enough for the longest EPC the reader takes.
+#define TX_SCHEDULER_NO_SERVICE                 UINT64_MAX
+
+//Experimentation showed that the connection interval is about 30ms and that 6 packets fit in each one.
+#define TX_SCHEDULER_DEFAULT_INTERVAL_NS        30000000ULL
+#define TX_SCHEDULER_DEFAULT_PKTS_PER_INTERVAL  6
+#define TX_SCHEDULER_MAX_PKTS_PER_INTERVAL      32      //Larger budgets are cut down to this.
+
+//One channel per writable characteristic on the reader.
+typedef enum
+{
+    TX_CHANNEL_STATE        =   0,
+    TX_CHANNEL_TARGET_EPC   =   1,
+    TX_CHANNEL_NEW_EPC      =   2,
+    TX_NUM_CHANNELS         =   3
+} TxChannel;
+
+//Urgent commands go ahead of every normal one, e.g. so that a reset isn't stuck behind other commands.
+typedef enum
+{
+    TX_PRIORITY_NORMAL      =   0,
+    TX_PRIORITY_URGENT      =   1
+} TxPriority;
+
+typedef enum
+{
+    TX_ENQUEUE_QUEUED       =   0,
+    TX_ENQUEUE_MERGED       =   1,  //The command was folded into one already waiting to go out.
+    TX_ENQUEUE_QUEUE_FULL   =   2,
+    TX_ENQUEUE_TOO_LONG     =   3
+} TxEnqueueResult;
+
+//canWrite tells whether the link has a credit for another write without response. If it is NULL the
+//scheduler only goes by its own per-interval budget.
+//write returns false if the link couldn't take the packet after all, in which case it stays queued and is retried.
+typedef struct
+{
+    void    *context;
+    bool    (*canWrite)(void *context);
+    bool    (*write)(void *context, TxChannel channel, const uint8_t *bytes, size_t length);
+} TxTransport;
+
+typedef struct
+{
+    TxChannel   channel;
+    TxPriority  priority;
+    uint8_t     length;
+    uint8_t     bytes[TX_COMMAND_MAX_BYTES];
+    uint64_t    enqueuedNs;
+} TxCommand;
+
+//Not thread safe. Everything has to be called from the queue that the BTLE callbacks come in on.
+typedef struct
+{
+    TxTransport         transport;
+    LatencyProbeClock   clock;
+    void                *clockContext;
+    uint64_t            intervalNs;
+    uint32_t            pktsPerInterval;
+    uint64_t            sentNs[TX_SCHEDULER_MAX_PKTS_PER_INTERVAL];    //When the last pktsPerInterval packets went, a ring.
+    uint32_t            sentNext;           //Where the next send time goes. Once the ring is full, the oldest send.
+    uint32_t            numRecentSent;      //Entries of the ring in use, up to pktsPerInterval.
+    TxCommand           queue[TX_SCHEDULER_QUEUE_CAPACITY];     //Urgent commands first, then in the order they came in.
+    uint32_t            numQueued;
+    uint32_t            numUrgent;
+    uint32_t            maxQueued;
+    uint64_t            numEnqueued;
+    uint64_t            numMerged;
+    uint64_t            numRejected;
+    uint64_t            numSent;
+    uint64_t            numDropped;
+    uint64_t            numDeferred;        //Times there was something to send but no credit for it.
+    LatencyHistogram    sendLatency;        //From enqueue to handing the packet to the transport.
+} TxScheduler;
+
+//Passing a NULL clock uses monotonicClockNsWithContext.
+void            txSchedulerInit(TxScheduler *scheduler, TxTransport transport, LatencyProbeClock clock, void *clockContext);
+//No stretch of intervalNs ever has more than pktsPerInterval packets sent in it. The packets already sent are
+//forgotten, so set the budget before sending.
+void            txSchedulerSetBudget(TxScheduler *scheduler, uint64_t intervalNs, uint32_t pktsPerInterval);
+
+//A command is merged when the last one queued at its priority is for the same channel. A state command is merged
+//only if it is the same, since the reader acts on every one. An EPC command replaces the queued value, since only
+//the latest one matters. Commands queued behind another channel are never merged, so the order between channels holds.
+TxEnqueueResult txSchedulerEnqueue(TxScheduler *scheduler, TxChannel channel, TxPriority priority,
+                                   const uint8_t *bytes, size_t length);
+
+//Sends as much as the budget and the link allow. Returns the number of packets sent.
+uint32_t        txSchedulerService(TxScheduler *scheduler);
+//How long until txSchedulerService could send more: 0 if now, TX_SCHEDULER_NO_SERVICE if nothing is queued.
+//This doesn't know about the link's own credits; the transport should call txSchedulerService when those come back.
+uint64_t        txSchedulerServiceDelayNs(TxScheduler *scheduler);
+
+//Drops everything queued, e.g. on disconnect. The statistics are kept.
+void            txSchedulerClear(TxScheduler *scheduler);
+void            txSchedulerResetStatistics(TxScheduler *scheduler);
+
+//Writes one line of statistics into text, truncating if needed. Returns the length it would have, like snprintf.
+size_t          txSchedulerFormatReport(TxScheduler *scheduler, char *text, size_t size);
+
+#endif /* TxScheduler_h */
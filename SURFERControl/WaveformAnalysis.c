@@ -0,0 +1,575 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: WaveformAnalysis.c                                                        //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module analyzes a waveform capture as it streams in from the reader. See   //
+//  WaveformAnalysis.h.                                                             //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "WaveformAnalysis.h"
+
+#define WAVEFORM_ANALYSIS_INITIAL_WORDS     4096    //256kbit, grown by doubling if a reply and the search around it need more.
+#define WAVEFORM_ANALYSIS_INITIAL_EDGES     1024
+#define WAVEFORM_ANALYSIS_INITIAL_PACKETS   16
+
+void waveformAnalysisDefaultParams(WaveformAnalysisParams *params)
+{
+    params->samplesPerHalfCycle = WAVEFORM_ANALYSIS_DEFAULT_HALF_CYCLE;
+    params->millerM             = WAVEFORM_ANALYSIS_DEFAULT_MILLER_M;
+    params->preambleThreshold   = 0.6f;
+    params->symbolThreshold     = 0.5f;
+    params->maxEdges            = WAVEFORM_ANALYSIS_DEFAULT_MAX_EDGES;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Miller encoding
+
+//The baseband level flips in the middle of a 1, and at the boundary between two 0s.
+typedef struct
+{
+    int     level;
+    int     previousBit;
+} WaveformMillerState;
+
+static void waveformAnalysisPutBits(uint64_t *out, uint64_t offset, uint32_t count, bool value)
+{
+    for(uint32_t i=0; i<count; i++, offset++){
+        if(value){
+            out[offset >> 6] |= 1ULL << (offset & 63);
+        } else {
+            out[offset >> 6] &= ~(1ULL << (offset & 63));
+        }
+    }
+}
+
+//One bit period of subcarrier at the level, flipping halfway through if asked. Returns the number of bits written.
+static uint64_t waveformAnalysisPutSymbol(const WaveformAnalysisParams *params, int level, bool flipHalfway,
+                                          uint64_t *out, uint64_t offset)
+{
+    uint64_t start = offset;
+    
+    for(uint32_t cycle=0; cycle<params->millerM; cycle++){
+        if(flipHalfway && cycle == params->millerM/2){
+            level = -level;
+        }
+        if(out){
+            waveformAnalysisPutBits(out, offset, params->samplesPerHalfCycle, level > 0);
+            waveformAnalysisPutBits(out, offset+params->samplesPerHalfCycle, params->samplesPerHalfCycle, level < 0);
+        }
+        offset += 2*params->samplesPerHalfCycle;
+    }
+    return offset-start;
+}
+
+static uint64_t waveformAnalysisPutMillerBit(const WaveformAnalysisParams *params, WaveformMillerState *state, int bit,
+                                             uint64_t *out, uint64_t offset)
+{
+    uint64_t numBits;
+    
+    if(bit){
+        numBits         = waveformAnalysisPutSymbol(params, state->level, true, out, offset);
+        state->level    = -state->level;
+    } else {
+        if(!state->previousBit){
+            state->level = -state->level;
+        }
+        numBits         = waveformAnalysisPutSymbol(params, state->level, false, out, offset);
+    }
+    state->previousBit = bit;
+    
+    return numBits;
+}
+
+//The pilot tone is plain subcarrier, with no change of level.
+static uint64_t waveformAnalysisPutPreamble(const WaveformAnalysisParams *params, WaveformMillerState *state,
+                                            uint64_t *out, uint64_t offset)
+{
+    const char  *preambleBits   = WAVEFORM_ANALYSIS_PREAMBLE_BITS;
+    uint64_t    start           = offset;
+    
+    for(int i=0; i<WAVEFORM_ANALYSIS_PREAMBLE_PILOT_BITS; i++){
+        offset += waveformAnalysisPutSymbol(params, state->level, false, out, offset);
+    }
+    state->previousBit = 1;
+    for(int i=0; preambleBits[i]; i++){
+        offset += waveformAnalysisPutMillerBit(params, state, preambleBits[i]-'0', out, offset);
+    }
+    return offset-start;
+}
+
+uint64_t waveformAnalysisEncodeMiller(const WaveformAnalysisParams *params, const uint8_t *bits, uint32_t numBits,
+                                      bool withPreamble, uint64_t *out, uint64_t outOffset)
+{
+    WaveformMillerState state       =   {1, 1};
+    uint64_t            offset      =   outOffset;
+    
+    if(withPreamble){
+        offset += waveformAnalysisPutPreamble(params, &state, out, offset);
+    }
+    for(uint32_t i=0; i<numBits; i++){
+        int bit = bits ? (bits[i >> 3] >> (7 - (i & 7))) & 1 : 0;
+        
+        offset += waveformAnalysisPutMillerBit(params, &state, bit, out, offset);
+    }
+    return offset-outOffset;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Setup
+
+static bool waveformAnalysisBuildTemplates(WaveformAnalysis *analysis)
+{
+    const WaveformAnalysisParams    *params =   &analysis->params;
+    WaveformMillerState             state   =   {1, 1};
+    
+    analysis->preambleBits  = (uint32_t)waveformAnalysisPutPreamble(params, &state, NULL, 0);
+    analysis->symbolBits    = 2*params->millerM*params->samplesPerHalfCycle;
+    analysis->preamble      = calloc(analysis->preambleBits/64+1, sizeof(uint64_t));
+    analysis->symbols[0]    = calloc(analysis->symbolBits/64+1, sizeof(uint64_t));
+    analysis->symbols[1]    = calloc(analysis->symbolBits/64+1, sizeof(uint64_t));
+    if(!analysis->preamble || !analysis->symbols[0] || !analysis->symbols[1]){
+        return false;
+    }
+    
+    state.level = 1;
+    waveformAnalysisPutPreamble(params, &state, analysis->preamble, 0);
+    analysis->preambleEndLevel = state.level;
+    waveformAnalysisPutSymbol(params, 1, false, analysis->symbols[0], 0);
+    waveformAnalysisPutSymbol(params, 1, true, analysis->symbols[1], 0);
+    
+    //Correlation falls off over a half cycle either side of the peak, so a quarter of one between tries can't miss it.
+    analysis->stride = params->samplesPerHalfCycle/4 ? params->samplesPerHalfCycle/4 : 1;
+    
+    return true;
+}
+
+bool waveformAnalysisInit(WaveformAnalysis *analysis, const WaveformAnalysisParams *params)
+{
+    memset(analysis, 0, sizeof(WaveformAnalysis));
+    
+    if(!params->samplesPerHalfCycle || !params->millerM || params->millerM % 2){
+        return false;
+    }
+    analysis->params        = *params;
+    analysis->words         = calloc(WAVEFORM_ANALYSIS_INITIAL_WORDS, sizeof(uint64_t));
+    analysis->packets       = malloc(WAVEFORM_ANALYSIS_INITIAL_PACKETS*sizeof(WaveformPacket));
+    if(!analysis->words || !analysis->packets || !waveformAnalysisBuildTemplates(analysis)){
+        waveformAnalysisFree(analysis);
+        return false;
+    }
+    analysis->wordCapacity      = WAVEFORM_ANALYSIS_INITIAL_WORDS;
+    analysis->packetCapacity    = WAVEFORM_ANALYSIS_INITIAL_PACKETS;
+    analysis->maxEdgesStored    = params->maxEdges;
+    
+    return true;
+}
+
+void waveformAnalysisFree(WaveformAnalysis *analysis)
+{
+    free(analysis->words);
+    free(analysis->edges);
+    free(analysis->packets);
+    free(analysis->preamble);
+    free(analysis->symbols[0]);
+    free(analysis->symbols[1]);
+    memset(analysis, 0, sizeof(WaveformAnalysis));
+}
+
+void waveformAnalysisReset(WaveformAnalysis *analysis)
+{
+    if(!analysis->words){
+        return;
+    }
+    memset(analysis->words, 0, ((analysis->numBits+63)/64-analysis->wordBase+1)*sizeof(uint64_t));
+    memset(analysis->runHistogram, 0, sizeof(analysis->runHistogram));
+    analysis->wordBase          = 0;
+    analysis->numBits           = 0;
+    analysis->finished          = false;
+    analysis->numOnes           = 0;
+    analysis->numEdges          = 0;
+    analysis->numEdgesStored    = 0;
+    analysis->maxEdgesStored    = analysis->params.maxEdges;
+    analysis->longestRun[0]     = 0;
+    analysis->longestRun[1]     = 0;
+    analysis->statsWords        = 0;
+    analysis->runStart          = 0;
+    analysis->searchOffset      = 0;
+    analysis->numPackets        = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Bit statistics
+
+static void waveformAnalysisEndRun(WaveformAnalysis *analysis, uint64_t end, int value)
+{
+    uint64_t length = end-analysis->runStart;
+    
+    analysis->runHistogram[value][length < WAVEFORM_ANALYSIS_RUN_BINS ? length : WAVEFORM_ANALYSIS_RUN_BINS-1]++;
+    if(length > analysis->longestRun[value]){
+        analysis->longestRun[value] = length;
+    }
+    analysis->runStart = end;
+}
+
+//The edge list starts empty and doubles as edges come in, so a capture with few edges costs little. If it can't grow,
+//it stays as it is and later edges are only counted.
+static bool waveformAnalysisGrowEdges(WaveformAnalysis *analysis)
+{
+    uint32_t    newCapacity;
+    uint32_t    *edges;
+    
+    if(analysis->edgeCapacity >= analysis->maxEdgesStored){
+        return false;
+    }
+    if(!analysis->edgeCapacity){
+        newCapacity = WAVEFORM_ANALYSIS_INITIAL_EDGES;
+    } else {
+        newCapacity = analysis->edgeCapacity > UINT32_MAX/2 ? UINT32_MAX : 2*analysis->edgeCapacity;
+    }
+    if(newCapacity > analysis->maxEdgesStored){
+        newCapacity = analysis->maxEdgesStored;
+    }
+    edges = realloc(analysis->edges, (size_t)newCapacity*sizeof(uint32_t));
+    if(!edges){
+        analysis->maxEdgesStored = analysis->edgeCapacity;
+        return false;
+    }
+    analysis->edges         = edges;
+    analysis->edgeCapacity  = newCapacity;
+    
+    return true;
+}
+
+//Edges in a word are where it differs from itself shifted up by one, with the last bit of the word before shifted in.
+//Only the edges are visited, lowest first, so a word of steady signal costs a popcount and nothing else.
+static void waveformAnalysisCountWord(WaveformAnalysis *analysis, uint64_t index, uint64_t validMask)
+{
+    //The window always starts at or before the word before the one counted.
+    uint64_t    word        =   analysis->words[index-analysis->wordBase] & validMask;
+    uint64_t    carry       =   index ? analysis->words[index-1-analysis->wordBase] >> 63 : word & 1;
+    uint64_t    edges       =   (word ^ ((word << 1) | carry)) & validMask;
+    uint64_t    base        =   index*64;
+    
+    analysis->numOnes   += (uint64_t)__builtin_popcountll(word);
+    analysis->numEdges  += (uint64_t)__builtin_popcountll(edges);
+    
+    while(edges){
+        uint32_t position = (uint32_t)__builtin_ctzll(edges);
+        
+        if(analysis->numEdgesStored < analysis->maxEdgesStored && base+position <= UINT32_MAX
+           && (analysis->numEdgesStored < analysis->edgeCapacity || waveformAnalysisGrowEdges(analysis))){
+            analysis->edges[analysis->numEdgesStored++] = (uint32_t)(base+position);
+        }
+        //The run that ends here is of the value the bit before the edge had.
+        waveformAnalysisEndRun(analysis, base+position, (int)!((word >> position) & 1));
+        edges &= edges-1;
+    }
+}
+
+static void waveformAnalysisCountComplete(WaveformAnalysis *analysis)
+{
+    uint64_t numComplete = analysis->numBits/64;
+    
+    while(analysis->statsWords < numComplete){
+        waveformAnalysisCountWord(analysis, analysis->statsWords++, UINT64_MAX);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Correlation
+
+//The 64 capture bits starting at any bit offset still in the window. The zero word past the end makes this safe right
+//up to the last bit.
+static inline uint64_t waveformAnalysisBitsAt(const WaveformAnalysis *analysis, uint64_t offset)
+{
+    uint64_t    index   =   (offset >> 6) - analysis->wordBase;
+    unsigned    shift   =   (unsigned)(offset & 63);
+    
+    if(!shift){
+        return analysis->words[index];
+    }
+    return (analysis->words[index] >> shift) | (analysis->words[index+1] << (64-shift));
+}
+
+//Matching bits minus mismatching bits, over the length of the template.
+static int32_t waveformAnalysisCorrelate(const WaveformAnalysis *analysis, uint64_t offset, const uint64_t *template,
+                                         uint32_t numBits)
+{
+    uint32_t    numWords    =   numBits/64;
+    uint32_t    mismatches  =   0;
+    uint32_t    i;
+    
+    for(i=0; i<numWords; i++){
+        mismatches += (uint32_t)__builtin_popcountll(waveformAnalysisBitsAt(analysis, offset+64*i) ^ template[i]);
+    }
+    if(numBits % 64){
+        uint64_t mask = (1ULL << (numBits % 64))-1;
+        
+        mismatches += (uint32_t)__builtin_popcountll((waveformAnalysisBitsAt(analysis, offset+64*i) ^ template[i]) & mask);
+    }
+    return (int32_t)numBits - 2*(int32_t)mismatches;
+}
+
+static WaveformPacket *waveformAnalysisNewPacket(WaveformAnalysis *analysis)
+{
+    if(analysis->numPackets == analysis->packetCapacity){
+        WaveformPacket *packets = realloc(analysis->packets, 2*analysis->packetCapacity*sizeof(WaveformPacket));
+        
+        if(!packets){
+            return NULL;
+        }
+        analysis->packets           = packets;
+        analysis->packetCapacity    = 2*analysis->packetCapacity;
+    }
+    return &analysis->packets[analysis->numPackets++];
+}
+
+//Each symbol is either a 0 or a 1, and the Miller state says which level each would start at. The one that correlates
+//better wins, and the reply is over once neither correlates well.
+static void waveformAnalysisDecodeSymbols(WaveformAnalysis *analysis, WaveformPacket *packet, int polarity)
+{
+    WaveformMillerState state   =   {analysis->preambleEndLevel, 1};
+    uint64_t            offset  =   packet->bitOffset + analysis->preambleBits;
+    int32_t             minimum =   (int32_t)(analysis->params.symbolThreshold*analysis->symbolBits);
+    
+    packet->numSymbols      = 0;
+    packet->minSymbolScore  = 1;
+    memset(packet->bits, 0, sizeof(packet->bits));
+    
+    while(packet->numSymbols < WAVEFORM_ANALYSIS_MAX_SYMBOLS && offset+analysis->symbolBits <= analysis->numBits){
+        int     start0  =   state.previousBit ? state.level : -state.level;
+        int     start1  =   state.level;
+        int32_t score0  =   polarity*start0*waveformAnalysisCorrelate(analysis, offset, analysis->symbols[0], analysis->symbolBits);
+        int32_t score1  =   polarity*start1*waveformAnalysisCorrelate(analysis, offset, analysis->symbols[1], analysis->symbolBits);
+        int     bit     =   score1 > score0;
+        int32_t score   =   bit ? score1 : score0;
+        float   normalized;
+        
+        if(score < minimum){
+            break;
+        }
+        normalized = (float)score/analysis->symbolBits;
+        if(normalized < packet->minSymbolScore){
+            packet->minSymbolScore = normalized;
+        }
+        if(bit){
+            packet->bits[packet->numSymbols >> 3] |= (uint8_t)(0x80 >> (packet->numSymbols & 7));
+        }
+        packet->numSymbols++;
+        state.level         = bit ? -start1 : start0;
+        state.previousBit   = bit;
+        offset             += analysis->symbolBits;
+    }
+}
+
+//Tries the preamble a stride apart until one comes close. Being up to half a stride off the peak costs up to
+//stride/samplesPerHalfCycle of correlation, so the bar is lowered by that much to start with, unless every offset is
+//tried anyway. A pilot tone a cycle off also comes close, so the best of the next symbol's worth of offsets is then
+//found, and refined to the bit. Only then does the correlation have to reach the threshold.
+static void waveformAnalysisSearch(WaveformAnalysis *analysis)
+{
+    uint32_t    preambleBits    =   analysis->preambleBits;
+    uint32_t    stride          =   analysis->stride;
+    int32_t     threshold       =   (int32_t)(analysis->params.preambleThreshold*preambleBits);
+    int32_t     nearThreshold   =   stride > 1 ? threshold - (int32_t)((uint64_t)stride*preambleBits/analysis->params.samplesPerHalfCycle)
+                                               : threshold;
+    //Until the capture is finished, only look where the whole search and the longest reply after it are already in.
+    uint64_t    lookahead       =   analysis->finished ? preambleBits
+                                                       : preambleBits + analysis->symbolBits + stride
+                                                         + (uint64_t)WAVEFORM_ANALYSIS_MAX_SYMBOLS*analysis->symbolBits;
+    
+    while(analysis->searchOffset + lookahead <= analysis->numBits){
+        uint64_t        offset      =   analysis->searchOffset;
+        int32_t         score       =   waveformAnalysisCorrelate(analysis, offset, analysis->preamble, preambleBits);
+        uint64_t        best        =   offset;
+        int32_t         bestScore   =   score;
+        uint64_t        end;
+        WaveformPacket  *packet;
+        
+        if(abs(score) < nearThreshold){
+            analysis->searchOffset += stride;
+            continue;
+        }
+        
+        end = offset + analysis->symbolBits + stride;
+        if(end + preambleBits > analysis->numBits){
+            end = analysis->numBits - preambleBits;
+        }
+        for(uint64_t candidate=offset+stride; candidate<=end; candidate+=stride){
+            score = waveformAnalysisCorrelate(analysis, candidate, analysis->preamble, preambleBits);
+            if(abs(score) > abs(bestScore)){
+                best        = candidate;
+                bestScore   = score;
+            }
+        }
+        offset = best;
+        for(uint64_t candidate=(offset > stride ? offset-stride : 0); candidate<=offset+stride; candidate++){
+            if(candidate + preambleBits > analysis->numBits){
+                break;
+            }
+            score = waveformAnalysisCorrelate(analysis, candidate, analysis->preamble, preambleBits);
+            if(abs(score) > abs(bestScore)){
+                best        = candidate;
+                bestScore   = score;
+            }
+        }
+        
+        if(abs(bestScore) < threshold){
+            analysis->searchOffset += stride;
+            continue;
+        }
+        
+        packet = waveformAnalysisNewPacket(analysis);
+        if(!packet){
+            analysis->searchOffset = best + preambleBits;
+            continue;
+        }
+        packet->bitOffset       = best;
+        packet->preambleScore   = (float)bestScore/preambleBits;
+        waveformAnalysisDecodeSymbols(analysis, packet, bestScore < 0 ? -1 : 1);
+        analysis->searchOffset  = best + preambleBits + (uint64_t)packet->numSymbols*analysis->symbolBits;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Streaming
+
+//Words before both the next word to count, less the one whose last bit it carries in, and the next preamble search,
+//less a stride it can refine back by, are done with. They are dropped by moving the rest down to the start.
+static void waveformAnalysisCompact(WaveformAnalysis *analysis)
+{
+    uint64_t    searchWord  =   (analysis->searchOffset > analysis->stride ? analysis->searchOffset-analysis->stride : 0) >> 6;
+    uint64_t    statsWord   =   analysis->statsWords ? analysis->statsWords-1 : 0;
+    uint64_t    keepFrom    =   searchWord < statsWord ? searchWord : statsWord;
+    size_t      numUsed     =   (size_t)((analysis->numBits+63)/64 - analysis->wordBase) + 1;
+    size_t      numDropped;
+    
+    if(keepFrom <= analysis->wordBase){
+        return;
+    }
+    numDropped = (size_t)(keepFrom - analysis->wordBase);
+    memmove(analysis->words, analysis->words+numDropped, (numUsed-numDropped)*sizeof(uint64_t));
+    memset(analysis->words+numUsed-numDropped, 0, numDropped*sizeof(uint64_t));
+    analysis->wordBase = keepFrom;
+}
+
+static bool waveformAnalysisReserve(WaveformAnalysis *analysis, size_t numBytes)
+{
+    //One spare word past the end, which stays zero.
+    size_t      neededWords =   (size_t)((analysis->numBits + 8*(uint64_t)numBytes + 63)/64 - analysis->wordBase) + 1;
+    size_t      newCapacity =   analysis->wordCapacity;
+    uint64_t    *words;
+    
+    if(neededWords <= analysis->wordCapacity){
+        return true;
+    }
+    //Only move the window once it is full, so each word is moved a bounded number of times however small the appends.
+    waveformAnalysisCompact(analysis);
+    neededWords = (size_t)((analysis->numBits + 8*(uint64_t)numBytes + 63)/64 - analysis->wordBase) + 1;
+    if(neededWords <= analysis->wordCapacity){
+        return true;
+    }
+    if(!newCapacity){
+        newCapacity = WAVEFORM_ANALYSIS_INITIAL_WORDS;
+    }
+    while(newCapacity < neededWords){
+        if(newCapacity > SIZE_MAX/2/sizeof(uint64_t)){
+            return false;
+        }
+        newCapacity *= 2;
+    }
+    words = realloc(analysis->words, newCapacity*sizeof(uint64_t));
+    if(!words){
+        return false;
+    }
+    memset(words+analysis->wordCapacity, 0, (newCapacity-analysis->wordCapacity)*sizeof(uint64_t));
+    analysis->words         = words;
+    analysis->wordCapacity  = newCapacity;
+    
+    return true;
+}
+
+bool waveformAnalysisAppend(WaveformAnalysis *analysis, const uint8_t *bytes, size_t length)
+{
+    //An analysis whose setup failed has no templates or window, so it can't take anything.
+    if(!analysis->words || analysis->finished || !waveformAnalysisReserve(analysis, length)){
+        return false;
+    }
+    
+    //Bytes are shifted into place, so this doesn't depend on the byte order of the host.
+    for(size_t i=0; i<length; i++){
+        analysis->words[(analysis->numBits >> 6) - analysis->wordBase] |= (uint64_t)bytes[i] << (analysis->numBits & 63);
+        analysis->numBits += 8;
+    }
+    
+    waveformAnalysisCountComplete(analysis);
+    waveformAnalysisSearch(analysis);
+    
+    return true;
+}
+
+void waveformAnalysisFinish(WaveformAnalysis *analysis)
+{
+    if(!analysis->words || analysis->finished){
+        return;
+    }
+    analysis->finished = true;
+    
+    waveformAnalysisCountComplete(analysis);
+    if(analysis->numBits % 64){
+        waveformAnalysisCountWord(analysis, analysis->statsWords++, (1ULL << (analysis->numBits % 64))-1);
+    }
+    if(analysis->numBits){
+        uint64_t last = analysis->numBits-1;
+        
+        waveformAnalysisEndRun(analysis, analysis->numBits, (int)((analysis->words[(last >> 6) - analysis->wordBase] >> (last & 63)) & 1));
+    }
+    waveformAnalysisSearch(analysis);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Results
+
+double waveformAnalysisDutyCycle(const WaveformAnalysis *analysis)
+{
+    return analysis->numBits ? (double)analysis->numOnes/analysis->numBits : 0;
+}
+
+uint32_t waveformAnalysisMostCommonRun(const WaveformAnalysis *analysis, int value)
+{
+    uint32_t    mostCommon  =   0;
+    
+    for(uint32_t length=1; length<WAVEFORM_ANALYSIS_RUN_BINS; length++){
+        if(analysis->runHistogram[value][length] > analysis->runHistogram[value][mostCommon]){
+            mostCommon = length;
+        }
+    }
+    return mostCommon;
+}
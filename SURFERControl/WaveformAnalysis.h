@@ -0,0 +1,133 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: WaveformAnalysis.h                                                        //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module analyzes a waveform capture as it streams in from the reader, on the//
+//  packed bits themselves, 64 at a time. It counts ones and edges, keeps the edge  //
+//  positions and a histogram of run lengths, and finds Miller-encoded tag replies  //
+//  by correlating against the preamble and then each symbol. Everything but the    //
+//  tail of the capture has been analyzed by the time the last bytes come in. Only  //
+//  the bits not yet analyzed are kept, so memory does not grow with the capture.   //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+
+#ifndef WaveformAnalysis_h
+#define WaveformAnalysis_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define WAVEFORM_ANALYSIS_RUN_BINS              256     //Runs of this many bits or more go in the last bin.
+#define WAVEFORM_ANALYSIS_MAX_SYMBOLS           256     //Most symbols decoded after each preamble.
+#define WAVEFORM_ANALYSIS_DEFAULT_MAX_EDGES     (1u << 20)
+//The capture is the sliced receive signal at the digital back end rate, 24 samples per subcarrier cycle.
+#define WAVEFORM_ANALYSIS_DEFAULT_HALF_CYCLE    12
+#define WAVEFORM_ANALYSIS_DEFAULT_MILLER_M      8
+#define WAVEFORM_ANALYSIS_PREAMBLE_PILOT_BITS   4       //Bit periods of plain subcarrier before the preamble bits, TRext=0.
+#define WAVEFORM_ANALYSIS_PREAMBLE_BITS         "010111"
+
+typedef struct
+{
+    uint32_t    samplesPerHalfCycle;    //Capture bits per half cycle of the subcarrier.
+    uint32_t    millerM;                //Subcarrier cycles per symbol. Must be even.
+    float       preambleThreshold;      //Correlation, from 0 to 1, at which a preamble is taken to be there.
+    float       symbolThreshold;        //Correlation below which a symbol is taken to be past the end of the reply.
+    uint32_t    maxEdges;               //Edge positions kept. Edges past these, or past bit UINT32_MAX, are still counted.
+} WaveformAnalysisParams;
+
+//A tag reply found in the capture.
+typedef struct
+{
+    uint64_t    bitOffset;              //Where the preamble starts.
+    float       preambleScore;          //Correlation with the preamble, from -1 to 1. Negative if the capture is inverted.
+    float       minSymbolScore;         //Of the symbols decoded.
+    uint32_t    numSymbols;
+    uint8_t     bits[WAVEFORM_ANALYSIS_MAX_SYMBOLS/8];  //The decoded bits, first bit in the MSB of bits[0].
+} WaveformPacket;
+
+typedef struct
+{
+    WaveformAnalysisParams  params;
+    //The part of the capture still to be analyzed, from word wordBase of the capture on, earliest bit in the LSB of
+    //words[0]. There is always a zero word past the last bit. Bit offsets everywhere else are from the capture start.
+    uint64_t                *words;
+    size_t                  wordCapacity;
+    uint64_t                wordBase;
+    uint64_t                numBits;            //In the whole capture.
+    bool                    finished;
+    //Bit statistics.
+    uint64_t                numOnes;
+    uint64_t                numEdges;           //Including those past maxEdges.
+    uint32_t                *edges;             //Bit positions at which the value differs from the bit before.
+    uint32_t                numEdgesStored;
+    uint32_t                edgeCapacity;       //Grown as edges come in, up to maxEdges.
+    uint32_t                maxEdgesStored;     //maxEdges, or fewer if the edge list could not grow.
+    uint64_t                runHistogram[2][WAVEFORM_ANALYSIS_RUN_BINS];  //Runs of zeros, then runs of ones, by length.
+    uint64_t                longestRun[2];
+    uint64_t                statsWords;         //Complete words counted so far.
+    uint64_t                runStart;
+    //Correlation. Templates are packed the same way as the capture.
+    uint64_t                *preamble;
+    uint32_t                preambleBits;
+    uint64_t                *symbols[2];        //Data-0 and data-1 starting at the high level.
+    uint32_t                symbolBits;
+    int                     preambleEndLevel;   //Baseband level at the end of the preamble, +1 or -1.
+    uint32_t                stride;             //Offsets between preamble correlations before refining.
+    uint64_t                searchOffset;       //Next offset to try the preamble at.
+    WaveformPacket          *packets;
+    uint32_t                numPackets;
+    uint32_t                packetCapacity;
+} WaveformAnalysis;
+
+void        waveformAnalysisDefaultParams(WaveformAnalysisParams *params);
+//Returns false if the storage could not be allocated or the parameters make no sense.
+bool        waveformAnalysisInit(WaveformAnalysis *analysis, const WaveformAnalysisParams *params);
+//This and the rest are safe to call on an analysis that was never set up, or whose setup failed, as long as it is all
+//zeros. Appending to one fails, and there is nothing to finish.
+void        waveformAnalysisFree(WaveformAnalysis *analysis);
+//Starts again on a new capture with the same parameters, keeping the memory.
+void        waveformAnalysisReset(WaveformAnalysis *analysis);
+
+//Takes bytes as the reader sends them. Analysis keeps up with the data, except for the last preamble and packet's
+//worth of bits, which waits for more. Returns false if the capture could not be stored.
+bool        waveformAnalysisAppend(WaveformAnalysis *analysis, const uint8_t *bytes, size_t length);
+//Analyzes what is left. Nothing more can be appended after this until a reset.
+void        waveformAnalysisFinish(WaveformAnalysis *analysis);
+
+//The fraction of bits that are ones.
+double      waveformAnalysisDutyCycle(const WaveformAnalysis *analysis);
+//The run length with the most runs of the value, 0 if there are none.
+uint32_t    waveformAnalysisMostCommonRun(const WaveformAnalysis *analysis, int value);
+
+//Miller encodes the bits, first bit in the MSB of bits[0], after the preamble if asked for, into the packed capture
+//format at out starting at bit outOffset. The tag's subcarrier starts high. Returns the number of bits written, or if
+//out is NULL, the number that would be, in which case bits may be NULL too.
+uint64_t    waveformAnalysisEncodeMiller(const WaveformAnalysisParams *params, const uint8_t *bits, uint32_t numBits,
+                                         bool withPreamble, uint64_t *out, uint64_t outOffset);
+
+#endif /* WaveformAnalysis_h */
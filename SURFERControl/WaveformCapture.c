@@ -0,0 +1,214 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: WaveformCapture.c                                                         //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module writes waveform captures recovered from the reader to disk in a     //
+//  packed binary format, a chunk at a time while the data streams in, and          //
+//  converts them back to the original one-bit-per-line text format.                //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <string.h>
+
+#include "WaveformCapture.h"
+
+static void waveformCapturePutLE(uint8_t *bytes, uint64_t value, int numBytes)
+{
+    for(int i=0; i<numBytes; i++){
+        bytes[i] = (uint8_t)(value >> (8*i));
+    }
+}
+
+static uint64_t waveformCaptureGetLE(const uint8_t *bytes, int numBytes)
+{
+    uint64_t value = 0;
+    
+    for(int i=0; i<numBytes; i++){
+        value |= (uint64_t)bytes[i] << (8*i);
+    }
+    return value;
+}
+
+static bool waveformCaptureWriteHeader(WaveformCapture *capture)
+{
+    uint8_t bytes[WAVEFORM_CAPTURE_HEADER_BYTES] = {0};
+    
+    memcpy(bytes, WAVEFORM_CAPTURE_MAGIC, 8);
+    waveformCapturePutLE(bytes+8, capture->header.version, 2);
+    waveformCapturePutLE(bytes+10, capture->header.headerBytes, 2);
+    waveformCapturePutLE(bytes+12, capture->header.chunkBytes, 4);
+    waveformCapturePutLE(bytes+16, capture->header.timestampUs, 8);
+    waveformCapturePutLE(bytes+24, capture->header.bitCount, 8);
+    memcpy(bytes+32, capture->header.hardwareRevision, strlen(capture->header.hardwareRevision));
+    
+    return fseek(capture->file, 0, SEEK_SET) == 0 && fwrite(bytes, 1, sizeof(bytes), capture->file) == sizeof(bytes);
+}
+
+//Write out whatever is in the chunk buffer. This is a full chunk except at the end of the capture.
+static bool waveformCaptureFlushChunk(WaveformCapture *capture)
+{
+    if(capture->chunkFill && fwrite(capture->chunk, 1, capture->chunkFill, capture->file) != capture->chunkFill){
+        capture->failed = true;
+    }
+    capture->chunkFill = 0;
+    
+    return !capture->failed;
+}
+
+bool waveformCaptureOpen(WaveformCapture *capture, const char *path, const char *hardwareRevision, uint64_t timestampUs)
+{
+    memset(capture, 0, sizeof(WaveformCapture));
+    
+    capture->file = fopen(path, "wb");
+    if(!capture->file){
+        return false;
+    }
+    //The chunk buffer already batches the writes, so there's no need for stdio to hold a second copy.
+    setvbuf(capture->file, NULL, _IONBF, 0);
+    
+    capture->header.version     = WAVEFORM_CAPTURE_VERSION;
+    capture->header.headerBytes = WAVEFORM_CAPTURE_HEADER_BYTES;
+    capture->header.chunkBytes  = WAVEFORM_CAPTURE_CHUNK_BYTES;
+    capture->header.timestampUs = timestampUs;
+    capture->header.bitCount    = WAVEFORM_CAPTURE_BIT_COUNT_UNKNOWN;
+    if(hardwareRevision){
+        strncpy(capture->header.hardwareRevision, hardwareRevision, WAVEFORM_CAPTURE_HW_REVISION_BYTES);
+    }
+    
+    if(!waveformCaptureWriteHeader(capture)){
+        capture->failed = true;
+    }
+    return !capture->failed;
+}
+
+bool waveformCaptureAppend(WaveformCapture *capture, const uint8_t *bytes, size_t length)
+{
+    if(!capture->file || capture->failed){
+        return false;
+    }
+    
+    while(length){
+        size_t numToCopy = WAVEFORM_CAPTURE_CHUNK_BYTES - capture->chunkFill;
+        
+        if(numToCopy > length){
+            numToCopy = length;
+        }
+        memcpy(capture->chunk+capture->chunkFill, bytes, numToCopy);
+        capture->chunkFill  += numToCopy;
+        capture->numBytes   += numToCopy;
+        bytes               += numToCopy;
+        length              -= numToCopy;
+        
+        if(capture->chunkFill == WAVEFORM_CAPTURE_CHUNK_BYTES && !waveformCaptureFlushChunk(capture)){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool waveformCaptureClose(WaveformCapture *capture)
+{
+    bool succeeded;
+    
+    if(!capture->file){
+        return false;
+    }
+    
+    //The bit count goes in last, so a capture that never got here can still be read up to where it stopped.
+    if(waveformCaptureFlushChunk(capture)){
+        capture->header.bitCount = 8*capture->numBytes;
+        if(!waveformCaptureWriteHeader(capture)){
+            capture->failed = true;
+        }
+    }
+    
+    succeeded       = fclose(capture->file) == 0 && !capture->failed;
+    capture->file   = NULL;
+    
+    return succeeded;
+}
+
+bool waveformCaptureIsOpen(const WaveformCapture *capture)
+{
+    return capture->file != NULL;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Reading
+
+bool waveformCaptureReadHeader(FILE *file, WaveformCaptureHeader *header)
+{
+    uint8_t bytes[WAVEFORM_CAPTURE_HEADER_BYTES];
+    
+    if(fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes) || memcmp(bytes, WAVEFORM_CAPTURE_MAGIC, 8) != 0){
+        return false;
+    }
+    
+    header->version     = (uint16_t)waveformCaptureGetLE(bytes+8, 2);
+    header->headerBytes = (uint16_t)waveformCaptureGetLE(bytes+10, 2);
+    header->chunkBytes  = (uint32_t)waveformCaptureGetLE(bytes+12, 4);
+    header->timestampUs = waveformCaptureGetLE(bytes+16, 8);
+    header->bitCount    = waveformCaptureGetLE(bytes+24, 8);
+    memcpy(header->hardwareRevision, bytes+32, WAVEFORM_CAPTURE_HW_REVISION_BYTES);
+    header->hardwareRevision[WAVEFORM_CAPTURE_HW_REVISION_BYTES] = 0;
+    
+    if(header->version < 1 || header->headerBytes < WAVEFORM_CAPTURE_HEADER_BYTES){
+        return false;
+    }
+    //Skip any header fields added by a later version.
+    return fseek(file, header->headerBytes, SEEK_SET) == 0;
+}
+
+bool waveformCaptureConvertToText(FILE *in, FILE *out)
+{
+    WaveformCaptureHeader   header;
+    uint8_t                 bytes[WAVEFORM_CAPTURE_CHUNK_BYTES];
+    char                    text[3*8*WAVEFORM_CAPTURE_CHUNK_BYTES];
+    uint64_t                bitsLeft;
+    size_t                  numBytes;
+    
+    if(!waveformCaptureReadHeader(in, &header)){
+        return false;
+    }
+    bitsLeft = header.bitCount;
+    
+    while(bitsLeft && (numBytes = fread(bytes, 1, sizeof(bytes), in)) > 0){
+        size_t numChars = 0;
+        
+        for(size_t i=0; i<numBytes && bitsLeft; i++){
+            for(int j=0; j<8 && bitsLeft; j++, bitsLeft--){
+                //Earliest bit in time is the LSB. Each bit goes on its own line so they are all in a column.
+                text[numChars++] = '0'+((bytes[i] >> j) & 1);
+                text[numChars++] = '\r';
+                text[numChars++] = '\n';
+            }
+        }
+        if(fwrite(text, 1, numChars, out) != numChars){
+            return false;
+        }
+    }
+    
+    return !ferror(in);
+}
@@ -0,0 +1,93 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: WaveformCapture.h                                                         //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  This module writes waveform captures recovered from the reader to disk in a     //
+//  packed binary format, a chunk at a time while the data streams in, and          //
+//  converts them back to the original one-bit-per-line text format.                //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef WaveformCapture_h
+#define WaveformCapture_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+//File layout, all integers little-endian:
+//
+//  Offset  Size    Field
+//  0       8       Magic, "SURFWVFM"
+//  8       2       Format version, WAVEFORM_CAPTURE_VERSION
+//  10      2       Header size in bytes, so that later versions can grow the header
+//  12      4       Chunk size in bytes that the payload was written with
+//  16      8       Capture start time, in microseconds since 1/1/1970 UTC
+//  24      8       Number of bits captured, WAVEFORM_CAPTURE_BIT_COUNT_UNKNOWN if the capture was never closed
+//  32      32      Reader hardware revision string, NUL padded
+//  64      ...     Payload. The waveform bytes exactly as the reader sent them, earliest bit in the LSB.
+
+#define WAVEFORM_CAPTURE_MAGIC              "SURFWVFM"
+#define WAVEFORM_CAPTURE_VERSION            1
+#define WAVEFORM_CAPTURE_HEADER_BYTES       64
+#define WAVEFORM_CAPTURE_HW_REVISION_BYTES  32
+#define WAVEFORM_CAPTURE_CHUNK_BYTES        4096
+#define WAVEFORM_CAPTURE_BIT_COUNT_UNKNOWN  UINT64_MAX
+
+typedef struct
+{
+    uint16_t    version;
+    uint16_t    headerBytes;
+    uint32_t    chunkBytes;
+    uint64_t    timestampUs;
+    uint64_t    bitCount;
+    char        hardwareRevision[WAVEFORM_CAPTURE_HW_REVISION_BYTES+1];    //Always NUL terminated.
+} WaveformCaptureHeader;
+
+//A capture in progress. Only one chunk of payload is ever held in memory.
+typedef struct
+{
+    FILE                    *file;
+    WaveformCaptureHeader   header;
+    uint8_t                 chunk[WAVEFORM_CAPTURE_CHUNK_BYTES];
+    size_t                  chunkFill;
+    uint64_t                numBytes;
+    bool                    failed;     //Set on the first write error, after which appends are dropped.
+} WaveformCapture;
+
+//Writing. hardwareRevision may be NULL. All of these return false once a write has failed.
+bool    waveformCaptureOpen(WaveformCapture *capture, const char *path, const char *hardwareRevision, uint64_t timestampUs);
+bool    waveformCaptureAppend(WaveformCapture *capture, const uint8_t *bytes, size_t length);
+//Writes out the last partial chunk and the final bit count. Safe to call on a capture that isn't open.
+bool    waveformCaptureClose(WaveformCapture *capture);
+bool    waveformCaptureIsOpen(const WaveformCapture *capture);
+
+//Reading. Leaves the file positioned at the start of the payload.
+bool    waveformCaptureReadHeader(FILE *file, WaveformCaptureHeader *header);
+//Writes the payload out as ASCII '0'/'1' followed by CR LF for every bit, as the app used to save captures.
+bool    waveformCaptureConvertToText(FILE *in, FILE *out);
+
+#endif /* WaveformCapture_h */
@@ -0,0 +1,278 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: arenatest.c                                                               //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Test and benchmark of TagRecordArena: records keep their EPC and address as the //
+//  arena grows, a clear reuses the memory, and 100k tags take less memory and time //
+//  per read than the one-object-per-tag model the tag list used to have.           //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o arenatest Tools/arenatest.c                           //
+//  SURFERControl/TagRecordArena.c SURFERControl/TagTrackFilter.c                   //
+//  SURFERControl/TagMetrics.c SURFERControl/EPCIndex.c                             //
+//  SURFERControl/TagPacketDecoder.c SURFERControl/MonotonicClock.c -lm             //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "TagRecordArena.h"
+#include "TagStore.h"
+#include "EPCIndex.h"
+#include "MonotonicClock.h"
+#include "testcheck.h"
+
+#define ARENATEST_NUM_TAGS      100000
+#define ARENATEST_NUM_READS     2000000
+#define ARENATEST_MALLOC_HEADER 8       //What a typical malloc keeps in front of each allocation.
+
+static uint32_t arenaTestRandom(uint32_t *state)
+{
+    *state = *state*1664525u + 1013904223u;
+    
+    return *state >> 8;
+}
+
+static void arenaTestEPC(uint32_t tag, uint8_t epc[TAG_EPC_NUM_BYTES])
+{
+    memset(epc, 0xA5, TAG_EPC_NUM_BYTES);
+    memcpy(&epc[TAG_EPC_NUM_BYTES-sizeof(tag)], &tag, sizeof(tag));
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//The object-per-tag model
+
+//What the tag list used to allocate for each tag: an object with the EPC as a string and the first and last time seen
+//as date objects, the last one made anew for every read. The Objective-C runtime's own overhead is left out, so the
+//real objects were bigger than this.
+typedef struct
+{
+    void        *isa;
+    double      timeIntervalSince1970;
+} ArenaTestDate;
+
+typedef struct
+{
+    void            *isa;
+    uint32_t        refCount;
+    char            *epc;
+    ArenaTestDate   *firstInterrogation;
+    ArenaTestDate   *lastInterrogation;
+    float           hop[5];
+    uint8_t         nonceHop;
+    float           skip[5];
+    uint8_t         nonceSkip;
+    float           pdoaRangeMeters;
+} ArenaTestObjectTag;
+
+typedef struct
+{
+    ArenaTestObjectTag  **tags;
+    uint32_t            numTags;
+    uint32_t            capacity;
+    size_t              bytes;      //Allocated, counting each allocation as malloc rounds it.
+} ArenaTestObjectList;
+
+static void *arenaTestAllocate(ArenaTestObjectList *list, size_t size)
+{
+    list->bytes += (size+ARENATEST_MALLOC_HEADER+15) & ~(size_t)15;
+    
+    return malloc(size);
+}
+
+static void arenaTestDeallocate(ArenaTestObjectList *list, void *pointer, size_t size)
+{
+    if(pointer){
+        list->bytes -= (size+ARENATEST_MALLOC_HEADER+15) & ~(size_t)15;
+        free(pointer);
+    }
+}
+
+static ArenaTestDate *arenaTestDate(ArenaTestObjectList *list, double seconds)
+{
+    ArenaTestDate *date = arenaTestAllocate(list, sizeof(ArenaTestDate));
+    
+    date->isa                   = NULL;
+    date->timeIntervalSince1970 = seconds;
+    
+    return date;
+}
+
+static ArenaTestObjectTag *arenaTestObjectAdd(ArenaTestObjectList *list, const uint8_t *epc, double seconds)
+{
+    ArenaTestObjectTag *tag;
+    
+    if(list->numTags == list->capacity){
+        size_t oldBytes = list->capacity*sizeof(ArenaTestObjectTag *);
+        
+        list->capacity  = list->capacity ? 2*list->capacity : 16;
+        list->tags      = realloc(list->tags, list->capacity*sizeof(ArenaTestObjectTag *));
+        list->bytes     += list->capacity*sizeof(ArenaTestObjectTag *) - oldBytes;
+    }
+    tag                     = arenaTestAllocate(list, sizeof(ArenaTestObjectTag));
+    memset(tag, 0, sizeof(ArenaTestObjectTag));
+    tag->epc                = arenaTestAllocate(list, TAG_EPC_HEX_STRING_LENGTH+1);
+    tagReadFormatEPC(epc, tag->epc);
+    tag->firstInterrogation = arenaTestDate(list, seconds);
+    list->tags[list->numTags++] = tag;
+    
+    return tag;
+}
+
+static void arenaTestObjectFree(ArenaTestObjectList *list)
+{
+    for(uint32_t i=0; i<list->numTags; i++){
+        free(list->tags[i]->epc);
+        free(list->tags[i]->firstInterrogation);
+        free(list->tags[i]->lastInterrogation);
+        free(list->tags[i]);
+    }
+    free(list->tags);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Records
+
+static void arenaTestRecords(void)
+{
+    TagRecordArena  arena;
+    uint8_t         epc[TAG_EPC_NUM_BYTES];
+    TagRecord       *first;
+    size_t          bytes;
+    uint32_t        numWrong = 0;
+    
+    TEST_CHECK(tagRecordArenaInit(&arena), "could not set up the arena");
+    
+    for(uint32_t n=0; n<ARENATEST_NUM_TAGS; n++){
+        arenaTestEPC(n, epc);
+        numWrong += tagRecordArenaAdd(&arena, epc, 1000+n) == NULL;
+    }
+    first = tagRecordArenaGet(&arena, 0);
+    for(uint32_t n=0; n<ARENATEST_NUM_TAGS; n++){
+        TagRecord *record = tagRecordArenaGet(&arena, n);
+        
+        arenaTestEPC(n, epc);
+        numWrong += memcmp(record->epc, epc, TAG_EPC_NUM_BYTES) || record->firstSeenNs != 1000+n || record->lastSeenNs
+                    || record->rangeReaderId != TAG_STORE_NO_READER;
+    }
+    TEST_CHECK(tagRecordArenaCount(&arena) == ARENATEST_NUM_TAGS && numWrong == 0, "%u wrong records", numWrong);
+    
+    //A clear keeps the chunks, so the records go back where they were and nothing more is allocated.
+    bytes = tagRecordArenaBytes(&arena);
+    first->lastSeenNs = 5;
+    tagRecordArenaClear(&arena);
+    TEST_CHECK(tagRecordArenaCount(&arena) == 0, "clear left %u records", tagRecordArenaCount(&arena));
+    arenaTestEPC(7, epc);
+    TEST_CHECK(tagRecordArenaAdd(&arena, epc, 1) == first && first->lastSeenNs == 0 && !memcmp(first->epc, epc, TAG_EPC_NUM_BYTES),
+               "record 0 after the clear");
+    for(uint32_t n=1; n<ARENATEST_NUM_TAGS; n++){
+        tagRecordArenaAdd(&arena, epc, 1);
+    }
+    TEST_CHECK(tagRecordArenaBytes(&arena) == bytes && tagRecordArenaGet(&arena, 0) == first, "the arena grew from %zu to %zu bytes",
+               bytes, tagRecordArenaBytes(&arena));
+    
+    tagRecordArenaFree(&arena);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Benchmark
+
+//The same reads, spread at random over the tags, saved both ways. Each finds the tag by EPC with the same index, so
+//only the way the tags are kept differs.
+static void arenaTestBenchmark(void)
+{
+    TagRecordArena      arena;
+    ArenaTestObjectList list;
+    EPCIndex            index;
+    uint8_t             epc[TAG_EPC_NUM_BYTES];
+    uint32_t            random;
+    uint64_t            startNs, arenaNs, objectNs;
+    bool                inserted;
+    
+    memset(&list, 0, sizeof(list));
+    TEST_CHECK(tagRecordArenaInit(&arena) && epcIndexInit(&index), "could not set up the arena");
+    
+    random  = 1;
+    startNs = monotonicClockNs();
+    for(uint32_t i=0; i<ARENATEST_NUM_READS; i++){
+        uint64_t    nowNs = 1000000000ULL + i*1000ULL;
+        int32_t     row;
+        TagRecord   *record;
+        
+        arenaTestEPC(arenaTestRandom(&random) % ARENATEST_NUM_TAGS, epc);
+        tagRecordArenaReserve(&arena);
+        row     = epcIndexFindOrInsert(&index, epc, &inserted);
+        record  = inserted ? tagRecordArenaAdd(&arena, epc, nowNs) : tagRecordArenaGet(&arena, (uint32_t)row);
+        record->lastSeenNs          = nowNs;
+        record->hop.pdoa.freqMHz    = 915.25f;
+        record->hop.magAnt          = -50;
+        record->hop.pdoa.phaseAnt   = 1.5f;
+        record->hop.pdoa.nonce      = (uint8_t)i;
+    }
+    arenaNs = monotonicClockNs()-startNs;
+    epcIndexFree(&index);
+    
+    TEST_CHECK(epcIndexInit(&index), "could not set up the index");
+    random  = 1;
+    startNs = monotonicClockNs();
+    for(uint32_t i=0; i<ARENATEST_NUM_READS; i++){
+        double              seconds = 1.0 + i*1e-6;
+        int32_t             row;
+        ArenaTestObjectTag  *tag;
+        
+        arenaTestEPC(arenaTestRandom(&random) % ARENATEST_NUM_TAGS, epc);
+        row = epcIndexFindOrInsert(&index, epc, &inserted);
+        tag = inserted ? arenaTestObjectAdd(&list, epc, seconds) : list.tags[row];
+        arenaTestDeallocate(&list, tag->lastInterrogation, sizeof(ArenaTestDate));
+        tag->lastInterrogation  = arenaTestDate(&list, seconds);
+        tag->hop[0]             = 915.25f;
+        tag->hop[1]             = -50;
+        tag->hop[2]             = 1.5f;
+        tag->nonceHop           = (uint8_t)i;
+    }
+    objectNs = monotonicClockNs()-startNs;
+    epcIndexFree(&index);
+    
+    printf("%u tags, %u reads: arena %.1f ns/read and %.1f MB, objects %.1f ns/read and %.1f MB\n",
+           tagRecordArenaCount(&arena), ARENATEST_NUM_READS, (double)arenaNs/ARENATEST_NUM_READS, tagRecordArenaBytes(&arena)/1e6,
+           (double)objectNs/ARENATEST_NUM_READS, list.bytes/1e6);
+    TEST_CHECK(tagRecordArenaCount(&arena) == list.numTags, "%u records against %u objects", tagRecordArenaCount(&arena), list.numTags);
+    TEST_CHECK(tagRecordArenaBytes(&arena) < list.bytes, "the arena took %zu bytes against %zu for the objects",
+               tagRecordArenaBytes(&arena), list.bytes);
+    TEST_CHECK(arenaNs < objectNs, "the arena took %.1f ns/read against %.1f for the objects",
+               (double)arenaNs/ARENATEST_NUM_READS, (double)objectNs/ARENATEST_NUM_READS);
+    
+    tagRecordArenaFree(&arena);
+    arenaTestObjectFree(&list);
+}
+
+int main(void)
+{
+    arenaTestRecords();
+    arenaTestBenchmark();
+    
+    return testCheckExit("arenatest");
+}
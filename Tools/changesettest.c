@@ -0,0 +1,240 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: changesettest.c                                                           //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Tests of the change set that batches tag list notifications, driven by an       //
+//  injected clock. 10k reads per second for one second of simulated time, with the //
+//  flush timer the tag list uses, should reach the UI in about 60 batches, each    //
+//  naming every changed row once.                                                  //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o changesettest Tools/changesettest.c                   //
+//  SURFERControl/TagChangeSet.c SURFERControl/MonotonicClock.c                     //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "TagChangeSet.h"
+#include "MonotonicClock.h"
+#include "testcheck.h"
+
+#define CHANGESETTEST_NUM_TAGS          500
+#define CHANGESETTEST_READS_PER_SECOND  10000
+#define CHANGESETTEST_SECONDS           1
+
+typedef struct
+{
+    uint64_t    nowNs;
+} ChangeSetTestClock;
+
+//What the handler saw, to be checked against what was marked.
+typedef struct
+{
+    uint32_t    numBatches;
+    uint32_t    numWrong;
+    uint64_t    lastBatchNs;
+    uint64_t    minGapNs;
+    uint8_t     marked[CHANGESETTEST_NUM_TAGS];     //Since the last batch, as the test marked them.
+    bool        shown[CHANGESETTEST_NUM_TAGS];      //Ever inserted into the UI.
+    ChangeSetTestClock  *clock;
+} ChangeSetTestBatches;
+
+static uint64_t changeSetTestClockNs(void *context)
+{
+    return ((ChangeSetTestClock *)context)->nowNs;
+}
+
+//Every row changed since the last batch has to be in this one, exactly once, and inserted rows not again as updated.
+static void changeSetTestHandler(const uint32_t *insertedRows, uint32_t numInsertedRows,
+                                 const uint32_t *updatedRows, uint32_t numUpdatedRows, void *context)
+{
+    ChangeSetTestBatches    *batches    =   context;
+    uint8_t                 seen[CHANGESETTEST_NUM_TAGS];
+    
+    memset(seen, 0, sizeof(seen));
+    for(uint32_t i=0; i<numInsertedRows; i++){
+        uint32_t row = insertedRows[i];
+        
+        batches->numWrong += row >= CHANGESETTEST_NUM_TAGS || seen[row] || batches->marked[row] != 1 || batches->shown[row];
+        if(row < CHANGESETTEST_NUM_TAGS){
+            seen[row]           =   1;
+            batches->shown[row] =   true;
+        }
+    }
+    for(uint32_t i=0; i<numUpdatedRows; i++){
+        uint32_t row = updatedRows[i];
+        
+        batches->numWrong += row >= CHANGESETTEST_NUM_TAGS || seen[row] || batches->marked[row] != 2 || !batches->shown[row];
+        if(row < CHANGESETTEST_NUM_TAGS){
+            seen[row] = 2;
+        }
+    }
+    for(uint32_t row=0; row<CHANGESETTEST_NUM_TAGS; row++){
+        batches->numWrong += (batches->marked[row] != 0) != (seen[row] != 0);
+    }
+    memset(batches->marked, 0, sizeof(batches->marked));
+    
+    if(batches->numBatches > 0 && batches->clock->nowNs-batches->lastBatchNs < batches->minGapNs){
+        batches->minGapNs = batches->clock->nowNs-batches->lastBatchNs;
+    }
+    batches->lastBatchNs = batches->clock->nowNs;
+    batches->numBatches++;
+}
+
+//Reads at a steady rate with the flush scheduled the way RFIDTagList does: when there are changes and no flush is
+//due yet, one is set for when the interval will be up, and tried again if it comes back with changes left.
+static void changeSetTestSteadyReads(void)
+{
+    ChangeSetTestClock      clock       =   {1000000000ULL};
+    ChangeSetTestBatches    batches;
+    TagChangeSet            changeSet;
+    uint64_t                readGapNs   =   1000000000ULL/CHANGESETTEST_READS_PER_SECOND;
+    uint64_t                flushAtNs   =   0;
+    bool                    scheduled   =   false;
+    bool                    present[CHANGESETTEST_NUM_TAGS];
+    uint32_t                numReads    =   CHANGESETTEST_READS_PER_SECOND*CHANGESETTEST_SECONDS;
+    
+    memset(&batches, 0, sizeof(batches));
+    memset(present, 0, sizeof(present));
+    batches.clock       =   &clock;
+    batches.minGapNs    =   UINT64_MAX;
+    tagChangeSetInit(&changeSet, TAG_CHANGE_SET_DEFAULT_INTERVAL_NS, changeSetTestClockNs, &clock);
+    srand(3);
+    
+    for(uint32_t i=0; i<numReads; i++){
+        uint32_t row = (uint32_t)rand() % CHANGESETTEST_NUM_TAGS;
+        
+        clock.nowNs += readGapNs;
+        if(scheduled && clock.nowNs >= flushAtNs){
+            scheduled = false;
+            tagChangeSetFlush(&changeSet, changeSetTestHandler, &batches);
+        }
+        
+        //Rows are handed out in order, so a new tag takes the next one.
+        if(!present[row]){
+            for(row=0; present[row]; row++){
+            }
+            present[row] = true;
+            tagChangeSetMarkInserted(&changeSet, row);
+            batches.marked[row] = 1;
+        } else {
+            tagChangeSetMarkUpdated(&changeSet, row);
+            if(!batches.marked[row]){
+                batches.marked[row] = 2;
+            }
+        }
+        if(!scheduled){
+            scheduled   =   true;
+            flushAtNs   =   clock.nowNs + tagChangeSetTimeUntilFlush(&changeSet);
+        }
+    }
+    //Let the last batch out.
+    clock.nowNs = flushAtNs;
+    tagChangeSetFlush(&changeSet, changeSetTestHandler, &batches);
+    
+    TEST_CHECK(batches.numBatches >= 58 && batches.numBatches <= 62, "%u batches for %u reads in %ds",
+               batches.numBatches, numReads, CHANGESETTEST_SECONDS);
+    TEST_CHECK(batches.numWrong == 0, "%u rows were missing, repeated or in the wrong list", batches.numWrong);
+    TEST_CHECK(batches.minGapNs >= TAG_CHANGE_SET_DEFAULT_INTERVAL_NS, "batches %llu ns apart",
+               (unsigned long long)batches.minGapNs);
+    TEST_CHECK(!tagChangeSetHasChanges(&changeSet), "changes left over");
+    printf("%u reads in %d s of simulated time reached the UI in %u batches\n", numReads, CHANGESETTEST_SECONDS,
+           batches.numBatches);
+    
+    tagChangeSetFree(&changeSet);
+}
+
+//A flush is held back until the interval is up, and a reset drops the pending rows.
+static void changeSetTestInterval(void)
+{
+    ChangeSetTestClock      clock   =   {5000000000ULL};
+    ChangeSetTestBatches    batches;
+    TagChangeSet            changeSet;
+    
+    memset(&batches, 0, sizeof(batches));
+    batches.clock       =   &clock;
+    batches.minGapNs    =   UINT64_MAX;
+    tagChangeSetInit(&changeSet, 1000000, changeSetTestClockNs, &clock);
+    
+    TEST_CHECK(!tagChangeSetFlush(&changeSet, changeSetTestHandler, &batches), "flush with nothing to flush");
+    tagChangeSetMarkInserted(&changeSet, 7);
+    batches.marked[7] = 1;
+    TEST_CHECK(tagChangeSetFlush(&changeSet, changeSetTestHandler, &batches), "first flush is not held back");
+    
+    clock.nowNs += 400000;
+    tagChangeSetMarkUpdated(&changeSet, 7);
+    batches.marked[7] = 2;
+    TEST_CHECK(tagChangeSetTimeUntilFlush(&changeSet) == 600000, "%llu ns until flush",
+               (unsigned long long)tagChangeSetTimeUntilFlush(&changeSet));
+    TEST_CHECK(!tagChangeSetFlush(&changeSet, changeSetTestHandler, &batches), "flush before the interval is up");
+    clock.nowNs += 600000;
+    TEST_CHECK(tagChangeSetFlush(&changeSet, changeSetTestHandler, &batches), "flush once the interval is up");
+    
+    //Rows marked before a reset are forgotten, and can be marked again afterwards.
+    tagChangeSetMarkInserted(&changeSet, 3);
+    tagChangeSetReset(&changeSet);
+    TEST_CHECK(!tagChangeSetHasChanges(&changeSet), "changes after reset");
+    clock.nowNs += 1000000;
+    tagChangeSetMarkInserted(&changeSet, 3);
+    batches.marked[3] = 1;
+    TEST_CHECK(tagChangeSetFlush(&changeSet, changeSetTestHandler, &batches), "flush after reset");
+    TEST_CHECK(batches.numBatches == 3 && batches.numWrong == 0, "%u batches, %u wrong rows", batches.numBatches,
+               batches.numWrong);
+    
+    tagChangeSetFree(&changeSet);
+}
+
+//The cost of marking a read, which happens on every read on the ingest queue.
+static void changeSetTestBenchmark(void)
+{
+    TagChangeSet    changeSet;
+    uint64_t        startNs;
+    uint64_t        elapsedNs;
+    uint32_t        numMarks    =   10000000;
+    
+    tagChangeSetInit(&changeSet, 0, NULL, NULL);
+    startNs = monotonicClockNs();
+    for(uint32_t i=0; i<numMarks; i++){
+        tagChangeSetMarkUpdated(&changeSet, (i*2654435761u) % 100000);
+        if((i & 0xFFF) == 0xFFF){
+            tagChangeSetReset(&changeSet);
+        }
+    }
+    elapsedNs = monotonicClockNs()-startNs;
+    printf("Marking a read takes %.1f ns with 100k tags\n", (double)elapsedNs/numMarks);
+    
+    tagChangeSetFree(&changeSet);
+}
+
+int main(void)
+{
+    changeSetTestSteadyReads();
+    changeSetTestInterval();
+    changeSetTestBenchmark();
+    
+    return testCheckExit("changesettest");
+}
@@ -0,0 +1,293 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: consolelogtest.c                                                          //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Test of ConsoleLog. Long lines must carry on into the next records, every       //
+//  record must hold whole UTF-8 characters, and with several threads adding        //
+//  lines while another copies out the tail, every tail copied must be in order     //
+//  with the records of each line kept together. The append is also timed.          //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o consolelogtest Tools/consolelogtest.c                 //
+//  SURFERControl/ConsoleLog.c SURFERControl/MonotonicClock.c -lpthread             //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "ConsoleLog.h"
+#include "MonotonicClock.h"
+#include "testcheck.h"
+
+#define CONSOLELOGTEST_NUM_PRODUCERS        8
+#define CONSOLELOGTEST_LINES_PER_PRODUCER   100000
+#define CONSOLELOGTEST_TAIL_RECORDS         200
+//The most records a line can take, since each holds at least CONSOLE_LOG_TEXT_BYTES-4 bytes of it.
+#define CONSOLELOGTEST_MAX_LINE_RECORDS     ((CONSOLE_LOG_MAX_LINE_BYTES+CONSOLE_LOG_TEXT_BYTES-6)/(CONSOLE_LOG_TEXT_BYTES-4))
+
+//True if the bytes are whole, well-formed UTF-8 characters.
+static bool consoleLogTestIsUTF8(const char *text, size_t length)
+{
+    size_t i = 0;
+    
+    while(i < length){
+        uint8_t lead    = (uint8_t)text[i];
+        size_t  needed  = lead < 0x80 ? 1 : (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : (lead & 0xF8) == 0xF0 ? 4 : 0;
+        
+        if(!needed || i+needed > length){
+            return false;
+        }
+        for(size_t j=1; j<needed; j++){
+            if(((uint8_t)text[i+j] & 0xC0) != 0x80){
+                return false;
+            }
+        }
+        i += needed;
+    }
+    return true;
+}
+
+//Puts the last line in the log back together from its records. Returns the number of records it took.
+static uint32_t consoleLogTestLastLine(ConsoleLog *log, char *line, bool *allUTF8)
+{
+    static ConsoleLogRecord records[CONSOLELOGTEST_MAX_LINE_RECORDS+1];
+    uint32_t                numRecords  = consoleLogCopyTail(log, records, CONSOLELOGTEST_MAX_LINE_RECORDS+1);
+    uint32_t                first       = numRecords;
+    size_t                  length      = 0;
+    
+    while(first && records[first-1].continued){
+        first--;
+    }
+    first   = first ? first-1 : 0;
+    *allUTF8 = true;
+    for(uint32_t i=first; i<numRecords; i++){
+        *allUTF8 &= consoleLogTestIsUTF8(records[i].text, records[i].length) && strlen(records[i].text) == records[i].length;
+        memcpy(line+length, records[i].text, records[i].length);
+        length += records[i].length;
+    }
+    line[length] = 0;
+    
+    return numRecords-first;
+}
+
+//Lines of every length around the record size and the line limit, made of characters of 1, 2, 3 and 4 bytes,
+//so that every kind of character lands across every cut.
+static void consoleLogTestLongLines(void)
+{
+    static const char   *characters[]   = {"a", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80"};
+    static char         line[2*CONSOLE_LOG_MAX_LINE_BYTES], back[2*CONSOLE_LOG_MAX_LINE_BYTES];
+    ConsoleLog          log;
+    uint32_t            numWrong = 0, numBadUTF8 = 0;
+    
+    consoleLogInit(&log, 64);
+    for(size_t c=1; c<4; c++){
+        for(size_t length=0; length+4 < sizeof(line); length++){
+            size_t  fill = 0;
+            bool    allUTF8;
+            
+            //Pad with ASCII so the wide character is at every offset.
+            while(fill < length){
+                const char *character = fill % 7 == 6 ? "a" : characters[c];
+                
+                memcpy(line+fill, character, strlen(character));
+                fill += strlen(character);
+            }
+            line[fill] = 0;
+            consoleLogAppend(&log, CONSOLE_LOG_INFO, CONSOLE_LOG_SOURCE_APP, line);
+            consoleLogTestLastLine(&log, back, &allUTF8);
+            
+            numBadUTF8 += !allUTF8;
+            //Lines up to the limit come back whole. Longer ones come back as whole characters from their start.
+            if(fill < CONSOLE_LOG_MAX_LINE_BYTES){
+                numWrong += strcmp(back, line) != 0;
+            } else {
+                numWrong += strncmp(back, line, strlen(back)) != 0 || strlen(back) < CONSOLE_LOG_MAX_LINE_BYTES-1-4;
+            }
+        }
+    }
+    TEST_CHECK(numWrong == 0, "%u lines did not come back as added", numWrong);
+    TEST_CHECK(numBadUTF8 == 0, "%u lines had records that weren't whole UTF-8 characters", numBadUTF8);
+    
+    //A line with a character cut short at its end, as the firmware log FIFO can do when it overflows.
+    bool allUTF8;
+    
+    consoleLogAppend(&log, CONSOLE_LOG_INFO, CONSOLE_LOG_SOURCE_FIRMWARE, "cut \xF0\x9F\x98");
+    consoleLogTestLastLine(&log, back, &allUTF8);
+    TEST_CHECK(strcmp(back, "cut ") == 0 && allUTF8, "cut character was kept: '%s'", back);
+    
+    //Formatted lines longer than one record, which vsnprintf could cut partway through a character.
+    memset(line, 0, sizeof(line));
+    for(size_t i=0; i+3 < CONSOLE_LOG_MAX_LINE_BYTES+100; i+=3){
+        memcpy(line+i, "\xE2\x82\xAC", 3);
+    }
+    consoleLogAppendf(&log, CONSOLE_LOG_WARNING, CONSOLE_LOG_SOURCE_DECODER, "x%s", line);
+    TEST_CHECK(consoleLogTestLastLine(&log, back, &allUTF8) > 1 && allUTF8, "formatted long line was not split into whole characters");
+    TEST_CHECK(strlen(back) > CONSOLE_LOG_MAX_LINE_BYTES-5 && strncmp(back+1, line, strlen(back)-1) == 0,
+               "formatted long line came back as %zu bytes", strlen(back));
+    
+    consoleLogAppendf(&log, CONSOLE_LOG_INFO, CONSOLE_LOG_SOURCE_APP, "Reader %d: %s", 3, "ok");
+    consoleLogTestLastLine(&log, back, &allUTF8);
+    TEST_CHECK(strcmp(back, "Reader 3: ok") == 0, "short formatted line came back as '%s'", back);
+    
+    consoleLogFree(&log);
+}
+
+static void consoleLogTestClearAndWrap(void)
+{
+    ConsoleLog          log;
+    ConsoleLogRecord    records[16];
+    uint32_t            numRecords;
+    
+    consoleLogInit(&log, 8);
+    for(int i=0; i<5; i++){
+        consoleLogAppendf(&log, CONSOLE_LOG_INFO, CONSOLE_LOG_SOURCE_APP, "line %d", i);
+    }
+    numRecords = consoleLogCopyTail(&log, records, 16);
+    TEST_CHECK(numRecords == 5 && strcmp(records[0].text, "line 0") == 0, "%u records, first '%s'", numRecords, records[0].text);
+    numRecords = consoleLogCopyTail(&log, records, 2);
+    TEST_CHECK(numRecords == 2 && strcmp(records[1].text, "line 4") == 0, "tail of 2 gave %u records", numRecords);
+    
+    consoleLogClear(&log);
+    TEST_CHECK(consoleLogCopyTail(&log, records, 16) == 0 && consoleLogNumAppended(&log) == 5, "clear left records");
+    
+    for(int i=5; i<20; i++){
+        consoleLogAppendf(&log, CONSOLE_LOG_INFO, CONSOLE_LOG_SOURCE_APP, "line %d", i);
+    }
+    numRecords = consoleLogCopyTail(&log, records, 16);
+    TEST_CHECK(numRecords == 8 && records[0].sequence == 12 && strcmp(records[7].text, "line 19") == 0,
+               "wrapped ring gave %u records from %llu", numRecords, (unsigned long long)records[0].sequence);
+    consoleLogFree(&log);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    ConsoleLog  *log;
+    int         producer;
+} ConsoleLogTestProducer;
+
+typedef struct
+{
+    ConsoleLog      *log;
+    bool            done;           //Read and written with __atomic builtins.
+    uint64_t        numTails;
+    uint64_t        numBadTails;
+    uint64_t        numBadLines;
+} ConsoleLogTestReader;
+
+//Every tenth line is long enough to take three records.
+static void *consoleLogTestProduce(void *argument)
+{
+    ConsoleLogTestProducer  *producer = argument;
+    
+    for(int n=0; n<CONSOLELOGTEST_LINES_PER_PRODUCER; n++){
+        if(n % 10 == 9){
+            consoleLogAppendf(producer->log, CONSOLE_LOG_INFO, CONSOLE_LOG_SOURCE_APP, "producer %d line %d %0300d", producer->producer, n, n);
+        } else {
+            consoleLogAppendf(producer->log, CONSOLE_LOG_INFO, CONSOLE_LOG_SOURCE_APP, "producer %d line %d", producer->producer, n);
+        }
+    }
+    return NULL;
+}
+
+//Each tail must run in sequence and time order, and a continued record must follow the record before it in its line.
+static void *consoleLogTestRead(void *argument)
+{
+    static ConsoleLogRecord records[CONSOLELOGTEST_TAIL_RECORDS];
+    ConsoleLogTestReader    *reader = argument;
+    
+    while(!__atomic_load_n(&reader->done, __ATOMIC_ACQUIRE)){
+        uint32_t    numRecords  = consoleLogCopyTail(reader->log, records, CONSOLELOGTEST_TAIL_RECORDS);
+        bool        bad         = false;
+        
+        for(uint32_t i=1; i<numRecords; i++){
+            bad |= records[i].sequence != records[i-1].sequence+1 || records[i].timestampNs < records[i-1].timestampNs;
+            bad |= records[i].continued && records[i].timestampNs != records[i-1].timestampNs;
+        }
+        for(uint32_t i=0; i<numRecords; i++){
+            int producer, line;
+            
+            if(!records[i].continued && (sscanf(records[i].text, "producer %d line %d", &producer, &line) != 2 ||
+               producer < 0 || producer >= CONSOLELOGTEST_NUM_PRODUCERS)){
+                reader->numBadLines++;
+            }
+        }
+        reader->numTails++;
+        reader->numBadTails += bad;
+    }
+    return NULL;
+}
+
+static void consoleLogTestProducers(void)
+{
+    ConsoleLog              log;
+    ConsoleLogTestProducer  producers[CONSOLELOGTEST_NUM_PRODUCERS];
+    pthread_t               producerThreads[CONSOLELOGTEST_NUM_PRODUCERS], readerThread;
+    ConsoleLogTestReader    reader;
+    uint64_t                startNs, elapsedNs, numRecords;
+    
+    consoleLogInit(&log, CONSOLE_LOG_DEFAULT_CAPACITY);
+    memset(&reader, 0, sizeof(reader));
+    reader.log = &log;
+    pthread_create(&readerThread, NULL, consoleLogTestRead, &reader);
+    
+    startNs = monotonicClockNs();
+    for(int p=0; p<CONSOLELOGTEST_NUM_PRODUCERS; p++){
+        producers[p].log        = &log;
+        producers[p].producer   = p;
+        pthread_create(&producerThreads[p], NULL, consoleLogTestProduce, &producers[p]);
+    }
+    for(int p=0; p<CONSOLELOGTEST_NUM_PRODUCERS; p++){
+        pthread_join(producerThreads[p], NULL);
+    }
+    elapsedNs   = monotonicClockNs()-startNs;
+    __atomic_store_n(&reader.done, true, __ATOMIC_RELEASE);
+    pthread_join(readerThread, NULL);
+    
+    //Nine lines in ten take one record, and the tenth three.
+    numRecords = consoleLogNumAppended(&log);
+    TEST_CHECK(numRecords == (uint64_t)CONSOLELOGTEST_NUM_PRODUCERS*CONSOLELOGTEST_LINES_PER_PRODUCER/10*12,
+               "%llu records appended", (unsigned long long)numRecords);
+    TEST_CHECK(reader.numTails > 0 && reader.numBadTails == 0, "%llu of %llu tails out of order",
+               (unsigned long long)reader.numBadTails, (unsigned long long)reader.numTails);
+    TEST_CHECK(reader.numBadLines == 0, "%llu lines were garbled", (unsigned long long)reader.numBadLines);
+    printf("%d threads added %d lines in %.1f ms: %.0f ns per line, while %llu tails of %d records were copied\n",
+           CONSOLELOGTEST_NUM_PRODUCERS, CONSOLELOGTEST_NUM_PRODUCERS*CONSOLELOGTEST_LINES_PER_PRODUCER, elapsedNs/1e6,
+           (double)elapsedNs/(CONSOLELOGTEST_NUM_PRODUCERS*CONSOLELOGTEST_LINES_PER_PRODUCER), (unsigned long long)reader.numTails,
+           CONSOLELOGTEST_TAIL_RECORDS);
+    consoleLogFree(&log);
+}
+
+int main(void)
+{
+    consoleLogTestLongLines();
+    consoleLogTestClearAndWrap();
+    consoleLogTestProducers();
+    
+    return testCheckExit("consolelogtest");
+}
@@ -0,0 +1,325 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: decodertest.c                                                             //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Tests of the PKT1/PKT2 tag packet decoder on Linux/macOS, starting with the     //
+//  packets that debugTimerFireMethod: in TableViewController.m fakes, then out of  //
+//  order, missing and malformed packets and EPC hex conversion. It finishes by     //
+//  replaying the debug packets through the decoder to time it.                     //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o decodertest Tools/decodertest.c                       //
+//  SURFERControl/TagPacketDecoder.c                                                //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "TagPacketDecoder.h"
+#include "testcheck.h"
+
+#define DECODERTEST_BENCH_READS     4000000
+
+//One read as the reader sends it. The data IDs are filled in as the packets are sent.
+typedef struct
+{
+    uint8_t     epc[TAG_EPC_NUM_BYTES];
+    uint8_t     freqSlot;
+    bool        supplement;
+    bool        hopNotSkip;
+    uint8_t     nonce;
+    int32_t     antMagI;
+    int32_t     antMagQ;
+    int32_t     calMagI;
+    int32_t     calMagQ;
+} DecoderTestRead;
+
+//The two tags of debugTimerFireMethod:, each read on a hop and a skip.
+static const DecoderTestRead decoderTestDebugReads[4] =
+{
+    {{0xBA,0xDB,0x01,0x54,0x11,0xFE,0xBA,0xDB,0x01,0x54,0x11,0xFE}, 5, true, true, 2,
+        67744408, -153092960, 38753322, -162864788},
+    {{0xBA,0xDB,0x01,0x54,0x11,0xFE,0xBA,0xDB,0x01,0x54,0x11,0xFE}, 6, true, false, 4,
+        135843950, -97842631, 81347083, -146319552},
+    {{0xCA,0x27,0x57,0x01,0x7D,0xA2,0xC1,0x26,0xA1,0x12,0x16,0x87}, 12, true, true, 6,
+        12597378, 11026043, 51882310, 159169674},
+    {{0xCA,0x27,0x57,0x01,0x7D,0xA2,0xC1,0x26,0xA1,0x12,0x16,0x87}, 13, true, false, 8,
+        13209048, -10286679, 135017289, -98980255},
+};
+
+static void decoderTestPutBE32(uint8_t *bytes, int32_t value)
+{
+    bytes[0]    =   (uint8_t)((uint32_t)value >> 24);
+    bytes[1]    =   (uint8_t)((uint32_t)value >> 16);
+    bytes[2]    =   (uint8_t)((uint32_t)value >> 8);
+    bytes[3]    =   (uint8_t)((uint32_t)value >> 0);
+}
+
+//Lays the read out in the two packets the way the reader firmware does.
+static void decoderTestPack(const DecoderTestRead *read, uint8_t dataId1, uint8_t dataId2,
+                            uint8_t pkt1[TAG_PKT1_NUM_BYTES], uint8_t pkt2[TAG_PKT2_NUM_BYTES])
+{
+    uint8_t antI[4], antQ[4];
+    
+    decoderTestPutBE32(antI, read->antMagI);
+    decoderTestPutBE32(antQ, read->antMagQ);
+    
+    memset(pkt1, 0, TAG_PKT1_NUM_BYTES);
+    memcpy(pkt1, read->epc, TAG_EPC_NUM_BYTES);
+    pkt1[12]    =   (uint8_t)((read->supplement ? 128 : 0) + read->freqSlot);
+    memcpy(&pkt1[13], antI, 3);
+    memcpy(&pkt1[16], antQ, 3);
+    pkt1[19]    =   dataId1;
+    
+    memset(pkt2, 0, TAG_PKT2_NUM_BYTES);
+    pkt2[1]     =   antI[3];
+    pkt2[2]     =   antQ[3];
+    decoderTestPutBE32(&pkt2[4], read->calMagI);
+    decoderTestPutBE32(&pkt2[8], read->calMagQ);
+    pkt2[12]    =   read->hopNotSkip ? 255 : 1;
+    pkt2[14]    =   read->nonce;
+    pkt2[15]    =   dataId2;
+}
+
+static void decoderTestCheckRead(const TagRead *got, const DecoderTestRead *sent)
+{
+    TEST_CHECK(memcmp(got->epc, sent->epc, TAG_EPC_NUM_BYTES) == 0, "EPC");
+    TEST_CHECK(got->freqSlot == sent->freqSlot, "slot %u, sent %u", got->freqSlot, sent->freqSlot);
+    TEST_CHECK(got->hopNotSkip == sent->hopNotSkip, "hop/skip");
+    TEST_CHECK(got->hopSkipNonce == sent->nonce, "nonce %u, sent %u", got->hopSkipNonce, sent->nonce);
+    TEST_CHECK(got->antMagI == sent->antMagI && got->antMagQ == sent->antMagQ, "antenna I/Q %d %d, sent %d %d",
+               got->antMagI, got->antMagQ, sent->antMagI, sent->antMagQ);
+    TEST_CHECK(got->calMagI == sent->calMagI && got->calMagQ == sent->calMagQ, "cal I/Q %d %d, sent %d %d",
+               got->calMagI, got->calMagQ, sent->calMagI, sent->calMagQ);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+
+static void decoderTestDebugPackets(void)
+{
+    TagPacketDecoder    decoder;
+    TagRead             read;
+    uint8_t             pkt1[TAG_PKT1_NUM_BYTES], pkt2[TAG_PKT2_NUM_BYTES];
+    uint8_t             dataId = 0;
+    
+    tagPacketDecoderInit(&decoder);
+    for(int i=0; i<4; i++){
+        decoderTestPack(&decoderTestDebugReads[i], dataId, (uint8_t)(dataId+1), pkt1, pkt2);
+        dataId += 2;
+        TEST_CHECK(tagPacketDecoderPushPkt1(&decoder, pkt1, sizeof(pkt1), &read) == 0, "PKT1 of debug read %d", i);
+        TEST_CHECK(tagPacketDecoderPushPkt2(&decoder, pkt2, sizeof(pkt2), &read) == TAG_DECODE_READ_READY,
+                   "PKT2 of debug read %d", i);
+        decoderTestCheckRead(&read, &decoderTestDebugReads[i]);
+    }
+    TEST_CHECK(decoder.numReads == 4 && decoder.numSequenceGaps == 0 && decoder.numDiscardedPkts == 0,
+               "%u reads, %u gaps, %u discarded", decoder.numReads, decoder.numSequenceGaps, decoder.numDiscardedPkts);
+}
+
+//Without supplemental data the read is complete after PKT1, and can't be used for ranging.
+static void decoderTestNoSupplement(void)
+{
+    TagPacketDecoder    decoder;
+    TagRead             read;
+    DecoderTestRead     sent    =   decoderTestDebugReads[0];
+    uint8_t             pkt1[TAG_PKT1_NUM_BYTES], pkt2[TAG_PKT2_NUM_BYTES];
+    
+    sent.supplement = false;
+    sent.antMagI    = 0x12345600;   //Only the upper 24 bits are sent.
+    sent.antMagQ    = -0x12345600;
+    decoderTestPack(&sent, 0, 1, pkt1, pkt2);
+    
+    tagPacketDecoderInit(&decoder);
+    TEST_CHECK(tagPacketDecoderPushPkt1(&decoder, pkt1, sizeof(pkt1), &read) == TAG_DECODE_READ_READY, "PKT1 alone");
+    TEST_CHECK(read.hopNotSkip && read.hopSkipNonce == TAG_NO_SUPPLEMENT_NONCE, "no supplement read is a hop");
+    TEST_CHECK(read.calMagI == 0 && read.calMagQ == 0, "no cal data");
+    TEST_CHECK(read.antMagI == sent.antMagI && read.antMagQ == sent.antMagQ, "antenna I/Q %d %d", read.antMagI, read.antMagQ);
+    TEST_CHECK(decoder.state == WAIT_PKT1, "back to waiting for PKT1");
+}
+
+static void decoderTestOutOfOrder(void)
+{
+    TagPacketDecoder    decoder;
+    TagRead             read;
+    uint8_t             pkt1a[TAG_PKT1_NUM_BYTES], pkt2a[TAG_PKT2_NUM_BYTES];
+    uint8_t             pkt1b[TAG_PKT1_NUM_BYTES], pkt2b[TAG_PKT2_NUM_BYTES];
+    uint32_t            flags;
+    
+    decoderTestPack(&decoderTestDebugReads[0], 0, 1, pkt1a, pkt2a);
+    decoderTestPack(&decoderTestDebugReads[2], 1, 2, pkt1b, pkt2b);
+    tagPacketDecoderInit(&decoder);
+    
+    //A PKT2 with nothing to go with is dropped. Its PKT1 went missing, so there is also a gap in the data IDs.
+    flags = tagPacketDecoderPushPkt2(&decoder, pkt2a, sizeof(pkt2a), &read);
+    TEST_CHECK(flags == (TAG_DECODE_PKT2_IN_WAIT_PKT1 | TAG_DECODE_SEQUENCE_GAP), "stray PKT2 flags %#x", flags);
+    
+    //A PKT1 whose PKT2 never came is dropped when the next PKT1 arrives, and the next read is that of the new one.
+    tagPacketDecoderInit(&decoder);
+    tagPacketDecoderPushPkt1(&decoder, pkt1a, sizeof(pkt1a), &read);
+    flags = tagPacketDecoderPushPkt1(&decoder, pkt1b, sizeof(pkt1b), &read);
+    TEST_CHECK(flags == TAG_DECODE_PKT1_IN_WAIT_PKT2, "PKT1 after PKT1 flags %#x", flags);
+    flags = tagPacketDecoderPushPkt2(&decoder, pkt2b, sizeof(pkt2b), &read);
+    TEST_CHECK(flags == TAG_DECODE_READ_READY, "PKT2 of the second PKT1 flags %#x", flags);
+    decoderTestCheckRead(&read, &decoderTestDebugReads[2]);
+    TEST_CHECK(decoder.numDiscardedPkts == 1, "%u discarded", decoder.numDiscardedPkts);
+}
+
+static void decoderTestSequence(void)
+{
+    TagPacketDecoder    decoder;
+    TagRead             read;
+    uint8_t             pkt1[TAG_PKT1_NUM_BYTES], pkt2[TAG_PKT2_NUM_BYTES];
+    uint32_t            flags;
+    
+    //The data IDs wrap from 255 to 0 without a gap.
+    tagPacketDecoderInit(&decoder);
+    for(int i=0; i<200; i++){
+        decoderTestPack(&decoderTestDebugReads[i & 3], (uint8_t)(2*i), (uint8_t)(2*i+1), pkt1, pkt2);
+        tagPacketDecoderPushPkt1(&decoder, pkt1, sizeof(pkt1), &read);
+        tagPacketDecoderPushPkt2(&decoder, pkt2, sizeof(pkt2), &read);
+    }
+    TEST_CHECK(decoder.numReads == 200 && decoder.numSequenceGaps == 0, "%u reads, %u gaps across the wrap",
+               decoder.numReads, decoder.numSequenceGaps);
+    
+    //A lost notification shows up as a gap, but the read still goes through.
+    decoderTestPack(&decoderTestDebugReads[0], 150, 151, pkt1, pkt2);
+    flags = tagPacketDecoderPushPkt1(&decoder, pkt1, sizeof(pkt1), &read);
+    TEST_CHECK(flags == TAG_DECODE_SEQUENCE_GAP, "gap flags %#x", flags);
+    flags = tagPacketDecoderPushPkt2(&decoder, pkt2, sizeof(pkt2), &read);
+    TEST_CHECK(flags == TAG_DECODE_READ_READY && decoder.numSequenceGaps == 1, "read after gap flags %#x", flags);
+}
+
+static void decoderTestBadLength(void)
+{
+    TagPacketDecoder    decoder;
+    TagRead             read;
+    uint8_t             bytes[TAG_PKT1_NUM_BYTES+1];
+    
+    memset(bytes, 0, sizeof(bytes));
+    tagPacketDecoderInit(&decoder);
+    TEST_CHECK(tagPacketDecoderPushPkt1(&decoder, bytes, TAG_PKT1_NUM_BYTES-1, &read) == TAG_DECODE_BAD_LENGTH, "short PKT1");
+    TEST_CHECK(tagPacketDecoderPushPkt1(&decoder, bytes, TAG_PKT1_NUM_BYTES+1, &read) == TAG_DECODE_BAD_LENGTH, "long PKT1");
+    TEST_CHECK(tagPacketDecoderPushPkt2(&decoder, bytes, TAG_PKT1_NUM_BYTES, &read) == TAG_DECODE_BAD_LENGTH, "long PKT2");
+    TEST_CHECK(decoder.numDiscardedPkts == 3 && decoder.numReads == 0 && decoder.state == WAIT_PKT1, "bad lengths leave no state");
+}
+
+//The magnitudes are split 24/8 bits across the packets, so check that every byte and the sign make it through.
+static void decoderTestMagnitudes(void)
+{
+    static const int32_t    edges[] = {0, 1, -1, 255, 256, -256, 0x7FFFFFFF, (int32_t)0x80000000, 0x00FF00FF, -0x00FF00FF};
+    TagPacketDecoder        decoder;
+    TagRead                 read;
+    DecoderTestRead         sent    =   decoderTestDebugReads[0];
+    uint8_t                 pkt1[TAG_PKT1_NUM_BYTES], pkt2[TAG_PKT2_NUM_BYTES];
+    uint32_t                numWrong=   0;
+    
+    srand(1);
+    tagPacketDecoderInit(&decoder);
+    for(uint32_t i=0; i<100000; i++){
+        size_t numEdges = sizeof(edges)/sizeof(edges[0]);
+        
+        sent.antMagI    =   i < numEdges ? edges[i] : (int32_t)((uint32_t)rand() << 16 ^ (uint32_t)rand());
+        sent.antMagQ    =   i < numEdges ? edges[numEdges-1-i] : (int32_t)((uint32_t)rand() << 16 ^ (uint32_t)rand());
+        sent.calMagI    =   (int32_t)~(uint32_t)sent.antMagQ;
+        sent.calMagQ    =   sent.antMagI;
+        decoderTestPack(&sent, (uint8_t)(2*i), (uint8_t)(2*i+1), pkt1, pkt2);
+        tagPacketDecoderPushPkt1(&decoder, pkt1, sizeof(pkt1), &read);
+        tagPacketDecoderPushPkt2(&decoder, pkt2, sizeof(pkt2), &read);
+        numWrong += read.antMagI != sent.antMagI || read.antMagQ != sent.antMagQ
+                 || read.calMagI != sent.calMagI || read.calMagQ != sent.calMagQ;
+    }
+    TEST_CHECK(numWrong == 0, "%u of 100000 reads had a magnitude changed", numWrong);
+}
+
+static void decoderTestEPCHex(void)
+{
+    uint8_t epc[TAG_EPC_NUM_BYTES];
+    char    hex[TAG_EPC_HEX_STRING_LENGTH+1];
+    
+    tagReadFormatEPC(decoderTestDebugReads[2].epc, hex);
+    TEST_CHECK(strcmp(hex, "ca2757017da2c126a1121687") == 0, "formatted %s", hex);
+    TEST_CHECK(tagReadParseEPC("CA2757017DA2C126A1121687", TAG_EPC_HEX_STRING_LENGTH, epc)
+               && memcmp(epc, decoderTestDebugReads[2].epc, TAG_EPC_NUM_BYTES) == 0, "parse upper case");
+    TEST_CHECK(!tagReadParseEPC("CA2757017DA2C126A112168", TAG_EPC_HEX_STRING_LENGTH-1, epc), "short string");
+    TEST_CHECK(!tagReadParseEPC("CA2757017DA2C126A112168G", TAG_EPC_HEX_STRING_LENGTH, epc), "non-hex character");
+}
+
+//------------------------------------------------------------------------------------------------------------------
+
+//The four debug reads over and over, as a fast inventory would send them. The loop is single-threaded, so the CPU time
+//it takes is as good as the time on the wall.
+static void decoderTestBenchmark(void)
+{
+    uint8_t             (*pkts1)[TAG_PKT1_NUM_BYTES]    =   malloc(256*TAG_PKT1_NUM_BYTES);
+    uint8_t             (*pkts2)[TAG_PKT2_NUM_BYTES]    =   malloc(256*TAG_PKT2_NUM_BYTES);
+    TagPacketDecoder    decoder;
+    TagRead             read;
+    clock_t             start;
+    double              elapsedNs;
+    uint64_t            checksum    =   0;
+    
+    if(!pkts1 || !pkts2){
+        free(pkts1);
+        free(pkts2);
+        return;
+    }
+    //128 reads take the data IDs once round, so the same packets can be sent again and again without a gap.
+    for(int i=0; i<128; i++){
+        decoderTestPack(&decoderTestDebugReads[i & 3], (uint8_t)(2*i), (uint8_t)(2*i+1), pkts1[i], pkts2[i]);
+    }
+    
+    tagPacketDecoderInit(&decoder);
+    start = clock();
+    for(uint32_t i=0; i<DECODERTEST_BENCH_READS; i++){
+        tagPacketDecoderPushPkt1(&decoder, pkts1[i & 127], TAG_PKT1_NUM_BYTES, &read);
+        tagPacketDecoderPushPkt2(&decoder, pkts2[i & 127], TAG_PKT2_NUM_BYTES, &read);
+        checksum += (uint32_t)read.antMagI;
+    }
+    elapsedNs = (double)(clock()-start)*1e9/CLOCKS_PER_SEC;
+    
+    TEST_CHECK(decoder.numReads == DECODERTEST_BENCH_READS && decoder.numSequenceGaps == 0, "benchmark decoded %u reads",
+               decoder.numReads);
+    printf("Decoded %u reads from %u packets in %.1f ms: %.1f ns per packet, %.1f million reads per second (checksum %llx)\n",
+           DECODERTEST_BENCH_READS, 2*DECODERTEST_BENCH_READS, elapsedNs/1e6, elapsedNs/(2.0*DECODERTEST_BENCH_READS),
+           DECODERTEST_BENCH_READS*1e3/elapsedNs, (unsigned long long)checksum);
+    
+    free(pkts1);
+    free(pkts2);
+}
+
+int main(void)
+{
+    decoderTestDebugPackets();
+    decoderTestNoSupplement();
+    decoderTestOutOfOrder();
+    decoderTestSequence();
+    decoderTestBadLength();
+    decoderTestMagnitudes();
+    decoderTestEPCHex();
+    decoderTestBenchmark();
+    
+    return testCheckExit("decodertest");
+}
@@ -0,0 +1,199 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: epcindextest.c                                                            //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Tests of the EPC index, and a benchmark of it against the linear scan of hex    //
+//  EPC strings that RFIDTagList used to do, with 1k, 10k and 100k tags.            //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o epcindextest Tools/epcindextest.c                     //
+//  SURFERControl/EPCIndex.c SURFERControl/TagPacketDecoder.c                       //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "EPCIndex.h"
+#include "TagPacketDecoder.h"
+#include "testcheck.h"
+
+#define EPCINDEXTEST_LOOKUPS    200000      //Per size, for the index.
+#define EPCINDEXTEST_SCAN_WORK  200000000ULL //String compares per size, for the linear scan.
+
+static uint64_t epcIndexTestRandomState = 88172645463325252ULL;
+
+static uint64_t epcIndexTestRandom(void)
+{
+    epcIndexTestRandomState ^= epcIndexTestRandomState << 13;
+    epcIndexTestRandomState ^= epcIndexTestRandomState >> 7;
+    epcIndexTestRandomState ^= epcIndexTestRandomState << 17;
+    
+    return epcIndexTestRandomState;
+}
+
+//Half of the tags are sequential serials under one prefix, as tags from one roll are, and half are random.
+static void epcIndexTestMakeEPC(uint32_t i, uint8_t *epc)
+{
+    if(i & 1){
+        for(int b=0; b<TAG_EPC_NUM_BYTES; b++){
+            epc[b] = (uint8_t)epcIndexTestRandom();
+        }
+    } else {
+        memset(epc, 0, TAG_EPC_NUM_BYTES);
+        epc[0]  =   0x30;
+        epc[1]  =   0x14;
+        epc[8]  =   (uint8_t)(i >> 24);
+        epc[9]  =   (uint8_t)(i >> 16);
+        epc[10] =   (uint8_t)(i >> 8);
+        epc[11] =   (uint8_t)i;
+    }
+}
+
+static void epcIndexTestCorrectness(void)
+{
+    EPCIndex    index;
+    uint8_t     (*epcs)[TAG_EPC_NUM_BYTES]  =   malloc(20000*TAG_EPC_NUM_BYTES);
+    uint8_t     missing[TAG_EPC_NUM_BYTES]  =   {0xFF};
+    bool        inserted;
+    uint32_t    numWrong                    =   0;
+    
+    if(!epcs || !epcIndexInit(&index)){
+        TEST_CHECK(false, "could not allocate");
+        free(epcs);
+        return;
+    }
+    //Rows are handed out in insertion order, and survive the table growing many times.
+    for(uint32_t i=0; i<20000; i++){
+        epcIndexTestMakeEPC(i, epcs[i]);
+        numWrong += epcIndexFindOrInsert(&index, epcs[i], &inserted) != (int32_t)i || !inserted;
+    }
+    TEST_CHECK(numWrong == 0 && index.count == 20000, "%u of 20000 inserts got the wrong row", numWrong);
+    numWrong = 0;
+    for(uint32_t i=0; i<20000; i++){
+        numWrong += epcIndexFind(&index, epcs[i]) != (int32_t)i;
+        numWrong += epcIndexFindOrInsert(&index, epcs[i], &inserted) != (int32_t)i || inserted;
+    }
+    TEST_CHECK(numWrong == 0 && index.count == 20000, "%u lookups of present EPCs went wrong", numWrong);
+    TEST_CHECK(epcIndexFind(&index, missing) == EPC_INDEX_NOT_FOUND, "missing EPC found");
+    
+    epcIndexClear(&index);
+    TEST_CHECK(epcIndexFind(&index, epcs[0]) == EPC_INDEX_NOT_FOUND && index.count == 0, "EPC found after clear");
+    TEST_CHECK(epcIndexFindOrInsert(&index, epcs[5], &inserted) == 0 && inserted, "rows start again at 0 after clear");
+    
+    epcIndexFree(&index);
+    free(epcs);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+
+//What the tag list did before the index: compare the hex EPC of each tag in turn.
+static int32_t epcIndexTestScan(char (*hex)[TAG_EPC_HEX_STRING_LENGTH+1], uint32_t numTags, const char *epcHex)
+{
+    for(uint32_t i=0; i<numTags; i++){
+        if(strcmp(hex[i], epcHex) == 0){
+            return (int32_t)i;
+        }
+    }
+    
+    return EPC_INDEX_NOT_FOUND;
+}
+
+//The benchmark is single-threaded, so the CPU time it takes is as good as the time on the wall.
+static double epcIndexTestNsSince(clock_t start)
+{
+    return (double)(clock()-start)*1e9/CLOCKS_PER_SEC;
+}
+
+static void epcIndexTestBenchmark(uint32_t numTags)
+{
+    EPCIndex    index;
+    uint8_t     (*epcs)[TAG_EPC_NUM_BYTES]          =   malloc((size_t)numTags*TAG_EPC_NUM_BYTES);
+    char        (*hex)[TAG_EPC_HEX_STRING_LENGTH+1] =   malloc((size_t)numTags*(TAG_EPC_HEX_STRING_LENGTH+1));
+    uint32_t    *lookups                            =   malloc(EPCINDEXTEST_LOOKUPS*sizeof(uint32_t));
+    uint32_t    numScans                            =   (uint32_t)(EPCINDEXTEST_SCAN_WORK/numTags);
+    uint32_t    numWrong                            =   0;
+    bool        inserted;
+    clock_t     start;
+    double      insertNs, indexNs, scanNs;
+    
+    if(!epcs || !hex || !lookups || !epcIndexInit(&index)){
+        TEST_CHECK(false, "could not allocate");
+        free(epcs);
+        free(hex);
+        free(lookups);
+        return;
+    }
+    if(numScans > EPCINDEXTEST_LOOKUPS){
+        numScans = EPCINDEXTEST_LOOKUPS;
+    }
+    for(uint32_t i=0; i<numTags; i++){
+        epcIndexTestMakeEPC(i, epcs[i]);
+        tagReadFormatEPC(epcs[i], hex[i]);
+    }
+    for(uint32_t i=0; i<EPCINDEXTEST_LOOKUPS; i++){
+        lookups[i] = (uint32_t)(epcIndexTestRandom() % numTags);
+    }
+    
+    start = clock();
+    for(uint32_t i=0; i<numTags; i++){
+        epcIndexFindOrInsert(&index, epcs[i], &inserted);
+    }
+    insertNs = epcIndexTestNsSince(start);
+    
+    //A read looks its tag up with find-or-insert, so that is what is timed.
+    start = clock();
+    for(uint32_t i=0; i<EPCINDEXTEST_LOOKUPS; i++){
+        numWrong += epcIndexFindOrInsert(&index, epcs[lookups[i]], &inserted) != (int32_t)lookups[i];
+    }
+    indexNs = epcIndexTestNsSince(start);
+    
+    start = clock();
+    for(uint32_t i=0; i<numScans; i++){
+        numWrong += epcIndexTestScan(hex, numTags, hex[lookups[i]]) != (int32_t)lookups[i];
+    }
+    scanNs = epcIndexTestNsSince(start);
+    
+    TEST_CHECK(numWrong == 0, "%u of the timed lookups with %u tags found the wrong row", numWrong, numTags);
+    printf("%6u tags: insert %5.1f ns, index lookup %5.1f ns, linear scan %9.1f ns, %6.0fx faster, table %zu kB\n",
+           numTags, insertNs/numTags, indexNs/EPCINDEXTEST_LOOKUPS, scanNs/numScans,
+           (scanNs/numScans)/(indexNs/EPCINDEXTEST_LOOKUPS), index.capacity*sizeof(EPCIndexSlot)/1024);
+    
+    epcIndexFree(&index);
+    free(epcs);
+    free(hex);
+    free(lookups);
+}
+
+int main(void)
+{
+    epcIndexTestCorrectness();
+    epcIndexTestBenchmark(1000);
+    epcIndexTestBenchmark(10000);
+    epcIndexTestBenchmark(100000);
+    
+    return testCheckExit("epcindextest");
+}
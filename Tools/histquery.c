@@ -0,0 +1,324 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: histquery.c                                                               //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Prints a read history recorded by the app (see ReadHistory.h). With just the    //
+//  directory, each tag is listed with its number of reads and its first and last   //
+//  read. Given an EPC, the reads of that tag are printed as CSV, optionally only   //
+//  those between two times in seconds since 1/1/1970 UTC. With --bench, a history  //
+//  of made-up reads is recorded in an empty directory, and the ingest rate, size   //
+//  on disk per million reads, time to open and query latency are printed.          //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o histquery Tools/histquery.c                           //
+//  SURFERControl/ReadHistory.c SURFERControl/EPCIndex.c                            //
+//  SURFERControl/TagPacketDecoder.c SURFERControl/MonotonicClock.c                 //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "ReadHistory.h"
+#include "TagPacketDecoder.h"
+#include "MonotonicClock.h"
+
+#define HISTQUERY_BENCH_DEFAULT_READS   1000000
+#define HISTQUERY_BENCH_NUM_TAGS        1000
+#define HISTQUERY_BENCH_READ_NS         1000000         //Made-up reads come 1ms apart, about what a busy reader manages.
+#define HISTQUERY_BENCH_WINDOW_NS       10000000000ULL  //Width of the time window queries.
+#define HISTQUERY_BENCH_NUM_QUERIES     1000
+
+static double histquerySeconds(uint64_t timestampNs)
+{
+    return (double)timestampNs*1e-9;
+}
+
+static int histqueryListTags(ReadHistory *history)
+{
+    ReadHistoryRecord   *records    =   NULL;
+    uint32_t            capacity    =   0;
+    char                epcString[TAG_EPC_HEX_STRING_LENGTH+1];
+    
+    printf("epc,reads,first_s,last_s\n");
+    for(uint32_t tagId=0; tagId<history->numTags; tagId++){
+        uint32_t numReads = readHistoryQueryTag(history, tagId, 0, UINT64_MAX, NULL, 0);
+        
+        if(numReads == 0){
+            //All of this tag's reads were in segments that have been deleted.
+            continue;
+        }
+        if(numReads > capacity){
+            free(records);
+            capacity    = numReads;
+            records     = malloc(capacity*sizeof(ReadHistoryRecord));
+            if(!records){
+                fprintf(stderr, "Out of memory\n");
+                return 1;
+            }
+        }
+        readHistoryQueryTag(history, tagId, 0, UINT64_MAX, records, capacity);
+        tagReadFormatEPC(readHistoryTagEPC(history, tagId), epcString);
+        printf("%s,%u,%.6f,%.6f\n", epcString, numReads, histquerySeconds(records[0].timestampNs),
+               histquerySeconds(records[numReads-1].timestampNs));
+    }
+    free(records);
+    return 0;
+}
+
+static int histqueryPrintReads(ReadHistory *history, const uint8_t *epc, uint64_t fromNs, uint64_t toNs)
+{
+    uint32_t            numReads    =   readHistoryQuery(history, epc, fromNs, toNs, NULL, 0);
+    ReadHistoryRecord   *records    =   malloc((numReads ? numReads : 1)*sizeof(ReadHistoryRecord));
+    
+    if(!records){
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    numReads = readHistoryQuery(history, epc, fromNs, toNs, records, numReads);
+    
+    printf("time_s,slot,hop,nonce,ant_i,ant_q,cal_i,cal_q,rssi_dbm,phase_rad,range_m\n");
+    for(uint32_t i=0; i<numReads; i++){
+        const ReadHistoryRecord *record = &records[i];
+        
+        printf("%llu.%09llu,%u,%d,%u,%d,%d,%d,%d,%.2f,%.4f,%.3f\n", (unsigned long long)(record->timestampNs/1000000000ULL),
+               (unsigned long long)(record->timestampNs%1000000000ULL),
+               record->freqSlot, (record->flags & READ_HISTORY_FLAG_HOP) ? 1 : 0, record->hopSkipNonce,
+               record->antMagI, record->antMagQ, record->calMagI, record->calMagQ,
+               record->rssidBm, record->phaseRad, record->rangeMeters);
+    }
+    free(records);
+    return 0;
+}
+
+static bool histqueryParseSeconds(const char *string, uint64_t *timestampNs)
+{
+    char    *end;
+    double  seconds =   strtod(string, &end);
+    
+    if(end == string || *end != '\0' || seconds < 0){
+        return false;
+    }
+    *timestampNs = (uint64_t)(seconds*1e9);
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Benchmark
+
+static int histqueryCompareNs(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    
+    return x < y ? -1 : x > y;
+}
+
+//Adds up the files the history is made of.
+static uint64_t histqueryDirectoryBytes(const char *directory)
+{
+    DIR             *dir    =   opendir(directory);
+    struct dirent   *entry;
+    uint64_t        bytes   =   0;
+    char            path[READ_HISTORY_PATH_BYTES];
+    struct stat     info;
+    
+    if(!dir){
+        return 0;
+    }
+    while((entry = readdir(dir))){
+        if(!strstr(entry->d_name, ".srfh")){
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        if(stat(path, &info) == 0){
+            bytes += (uint64_t)info.st_size;
+        }
+    }
+    closedir(dir);
+    return bytes;
+}
+
+//Runs queries of random tags, each from a random time for windowNs, and prints the median, 99th percentile and slowest.
+static void histqueryBenchQueries(ReadHistory *history, const char *name, uint64_t startNs, uint64_t spanNs, uint64_t windowNs,
+                                  ReadHistoryRecord *records, uint32_t maxRecords)
+{
+    uint64_t    latencyNs[HISTQUERY_BENCH_NUM_QUERIES];
+    uint64_t    numRecords  =   0;
+    uint32_t    random      =   12345;
+    
+    for(uint32_t q=0; q<HISTQUERY_BENCH_NUM_QUERIES; q++){
+        uint32_t    tagId;
+        uint64_t    fromNs  =   startNs, toNs = UINT64_MAX, queryStartNs;
+        
+        random  = random*1664525u + 1013904223u;
+        tagId   = (random >> 8) % history->numTags;
+        if(windowNs < spanNs){
+            random  = random*1664525u + 1013904223u;
+            fromNs  = startNs + (uint64_t)((random >> 8) % (uint32_t)((spanNs-windowNs)/1000000))*1000000;
+            toNs    = fromNs+windowNs;
+        }
+        
+        queryStartNs    = monotonicClockNs();
+        numRecords      += readHistoryQueryTag(history, tagId, fromNs, toNs, records, maxRecords);
+        latencyNs[q]    = monotonicClockNs()-queryStartNs;
+    }
+    qsort(latencyNs, HISTQUERY_BENCH_NUM_QUERIES, sizeof(uint64_t), histqueryCompareNs);
+    printf("%s: %.1f reads each, p50 %.1f us, p99 %.1f us, max %.1f us\n", name, (double)numRecords/HISTQUERY_BENCH_NUM_QUERIES,
+           latencyNs[HISTQUERY_BENCH_NUM_QUERIES/2]/1e3, latencyNs[HISTQUERY_BENCH_NUM_QUERIES*99/100]/1e3,
+           latencyNs[HISTQUERY_BENCH_NUM_QUERIES-1]/1e3);
+}
+
+//Records numReads made-up reads, spread over a fixed set of tags, into a new history in the directory. The history is
+//left there, so it can be looked at with the other modes afterwards.
+static int histqueryBench(const char *directory, uint32_t numReads)
+{
+    ReadHistory         history;
+    TagRead             read;
+    ReadHistoryRecord   *records;
+    uint64_t            startNs     =   1600000000ULL*1000000000ULL;
+    uint64_t            spanNs      =   (uint64_t)numReads*HISTQUERY_BENCH_READ_NS;
+    uint32_t            maxSegments =   numReads/READ_HISTORY_DEFAULT_SEGMENT_RECORDS + 2;
+    uint32_t            maxRecords  =   numReads/HISTQUERY_BENCH_NUM_TAGS + 1;
+    uint64_t            ingestNs, openNs, bytes;
+    
+    //Checked before opening, since opening to record deletes segments past maxSegments.
+    if(histqueryDirectoryBytes(directory)){
+        fprintf(stderr, "%s already has a read history in it. The benchmark needs an empty directory.\n", directory);
+        return 1;
+    }
+    memset(&history, 0, sizeof(history));
+    mkdir(directory, 0755);
+    if(!readHistoryOpen(&history, directory, READ_HISTORY_DEFAULT_SEGMENT_RECORDS, maxSegments, false)){
+        fprintf(stderr, "Could not create a read history in %s\n", directory);
+        return 1;
+    }
+    
+    memset(&read, 0, sizeof(read));
+    ingestNs = monotonicClockNs();
+    for(uint32_t i=0; i<numReads; i++){
+        uint32_t tag = i % HISTQUERY_BENCH_NUM_TAGS;
+        
+        memcpy(read.epc, &tag, sizeof(tag));
+        read.freqSlot       = (uint8_t)(i % 25);
+        read.hopNotSkip     = (i & 1) == 0;
+        read.hopSkipNonce   = (uint8_t)(i >> 1);
+        read.antMagI        = (int32_t)i;
+        read.antMagQ        = -(int32_t)i;
+        read.calMagI        = 3000000;
+        read.calMagQ        = 4000000;
+        if(!readHistoryAppend(&history, &read, startNs + (uint64_t)i*HISTQUERY_BENCH_READ_NS, -50, 1.5f, 3.25f)){
+            fprintf(stderr, "Append %u failed\n", i);
+            readHistoryClose(&history);
+            return 1;
+        }
+    }
+    readHistorySync(&history);
+    ingestNs = monotonicClockNs()-ingestNs;
+    readHistoryClose(&history);
+    
+    bytes = histqueryDirectoryBytes(directory);
+    printf("Ingest: %u reads of %u tags in %.3f s, %.0f reads/s, %.2f us per read\n", numReads, HISTQUERY_BENCH_NUM_TAGS,
+           ingestNs/1e9, numReads/(ingestNs/1e9), ingestNs/1e3/numReads);
+    printf("Size: %.1f MB, %.1f MB per million reads (%d bytes per read, segments of %d reads)\n", bytes/1e6,
+           bytes/1e6/(numReads/1e6), READ_HISTORY_RECORD_BYTES, READ_HISTORY_DEFAULT_SEGMENT_RECORDS);
+    
+    //Opened again read-only, as this tool does, which indexes every segment.
+    openNs = monotonicClockNs();
+    if(!readHistoryOpen(&history, directory, READ_HISTORY_DEFAULT_SEGMENT_RECORDS, maxSegments, true)){
+        fprintf(stderr, "Could not open %s again\n", directory);
+        return 1;
+    }
+    openNs = monotonicClockNs()-openNs;
+    printf("Open: %.1f ms to index %llu reads\n", openNs/1e6, (unsigned long long)readHistoryNumRecords(&history));
+    
+    records = malloc(maxRecords*sizeof(ReadHistoryRecord));
+    if(!records){
+        fprintf(stderr, "Out of memory\n");
+        readHistoryClose(&history);
+        return 1;
+    }
+    histqueryBenchQueries(&history, "Query, one tag, 10 s window", startNs, spanNs, HISTQUERY_BENCH_WINDOW_NS, records, maxRecords);
+    histqueryBenchQueries(&history, "Query, one tag, all reads", startNs, spanNs, UINT64_MAX, records, maxRecords);
+    histqueryBenchQueries(&history, "Count, one tag, all reads", startNs, spanNs, UINT64_MAX, NULL, 0);
+    
+    free(records);
+    readHistoryClose(&history);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    ReadHistory history;
+    uint8_t     epc[TAG_EPC_NUM_BYTES];
+    uint64_t    fromNs  =   0;
+    uint64_t    toNs    =   UINT64_MAX;
+    int         result;
+    
+    if((argc == 3 || argc == 4) && strcmp(argv[1], "--bench") == 0){
+        long numReads = argc == 4 ? strtol(argv[3], NULL, 10) : HISTQUERY_BENCH_DEFAULT_READS;
+        
+        if(numReads < HISTQUERY_BENCH_NUM_TAGS || numReads > INT32_MAX){
+            fprintf(stderr, "The number of reads has to be from %d to %d\n", HISTQUERY_BENCH_NUM_TAGS, INT32_MAX);
+            return 2;
+        }
+        return histqueryBench(argv[2], (uint32_t)numReads);
+    }
+    if(argc != 2 && argc != 3 && argc != 5){
+        fprintf(stderr, "Usage: %s history_directory [epc [from_s to_s]]\n", argv[0]);
+        fprintf(stderr, "       %s --bench empty_directory [num_reads]\n", argv[0]);
+        fprintf(stderr, "Lists the tags in the history, or prints the reads of one tag as CSV.\n");
+        fprintf(stderr, "With --bench, records made-up reads, a million by default, and times recording and queries.\n");
+        return 2;
+    }
+    if(argc >= 3 && !tagReadParseEPC(argv[2], strlen(argv[2]), epc)){
+        fprintf(stderr, "%s is not a %d digit hex EPC\n", argv[2], TAG_EPC_HEX_STRING_LENGTH);
+        return 2;
+    }
+    if(argc == 5 && (!histqueryParseSeconds(argv[3], &fromNs) || !histqueryParseSeconds(argv[4], &toNs))){
+        fprintf(stderr, "Times are in seconds since 1/1/1970 UTC\n");
+        return 2;
+    }
+    
+    //Read only, so that nothing is deleted and the app can keep recording to it.
+    memset(&history, 0, sizeof(history));
+    if(!readHistoryOpen(&history, argv[1], READ_HISTORY_DEFAULT_SEGMENT_RECORDS, READ_HISTORY_DEFAULT_MAX_SEGMENTS, true)){
+        fprintf(stderr, "Could not open %s as a read history\n", argv[1]);
+        return 1;
+    }
+    fprintf(stderr, "%u tags, %llu segments\n", history.numTags,
+            (unsigned long long)(history.nextSequence-history.firstSequence));
+    
+    if(argc == 2){
+        result = histqueryListTags(&history);
+    } else {
+        result = histqueryPrintReads(&history, epc, fromNs, toNs);
+    }
+    
+    readHistoryClose(&history);
+    return result;
+}
@@ -0,0 +1,300 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: latencytest.c                                                             //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Test of LatencyProbe with an injected clock: histogram buckets and percentiles, //
+//  stage and state accounting, the report, and that a reader session times each    //
+//  read as it leaves the decoder, before its batch is merged and handed on,        //
+//  without marking the probe itself.                                               //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o latencytest Tools/latencytest.c                       //
+//  SURFERControl/LatencyProbe.c SURFERControl/MonotonicClock.c                     //
+//  SURFERControl/ReaderSession.c SURFERControl/TagPacketDecoder.c                  //
+//  SURFERControl/TagStore.c SURFERControl/EPCIndex.c SURFERControl/TagMetrics.c    //
+//  SURFERControl/TagRangeEstimator.c -lm -lpthread                                 //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LatencyProbe.h"
+#include "ReaderSession.h"
+#include "testcheck.h"
+
+#define LATENCYTEST_NOTIFY_TO_DRAIN_NS  5000        //How long each packet sat in the queue before the drain.
+#define LATENCYTEST_HANDLER_NS          1000000     //Time each read spends in the handler, as saving and UI work.
+#define LATENCYTEST_NUM_READS           100
+
+typedef struct
+{
+    uint64_t    nowNs;
+    uint64_t    stepNs;     //Added after every read of the clock.
+} LatencyTestClock;
+
+static uint64_t latencyTestClock(void *context)
+{
+    LatencyTestClock    *clock  = context;
+    uint64_t            nowNs   = clock->nowNs;
+    
+    clock->nowNs += clock->stepNs;
+    
+    return nowNs;
+}
+
+//Every value must land in a bucket whose middle is within 12.5% of it, and the buckets must be in order.
+static void latencyTestHistogram(void)
+{
+    LatencyHistogram    histogram;
+    uint32_t            numWrong = 0;
+    
+    for(uint64_t ns=1; ns < (1ULL << 40); ns = ns*9/8+1){
+        memset(&histogram, 0, sizeof(histogram));
+        latencyHistogramRecord(&histogram, ns);
+        latencyHistogramRecord(&histogram, 2*ns+1000);  //Sets the max above, so the bucket middle isn't capped.
+        
+        uint64_t p0 = latencyHistogramPercentile(&histogram, 0);
+        
+        numWrong += (p0 > ns ? p0-ns : ns-p0) > ns/8+1;
+    }
+    TEST_CHECK(numWrong == 0, "%u values were more than 12.5%% from their bucket", numWrong);
+    
+    //1..1000us evenly: the percentiles fall where they should, to within a bucket.
+    memset(&histogram, 0, sizeof(histogram));
+    TEST_CHECK(latencyHistogramPercentile(&histogram, 50) == 0, "empty histogram has a median");
+    for(uint64_t us=1; us<=1000; us++){
+        latencyHistogramRecord(&histogram, us*1000);
+    }
+    TEST_CHECK(histogram.numSamples == 1000 && histogram.maxNs == 1000000, "%llu samples, max %llu",
+               (unsigned long long)histogram.numSamples, (unsigned long long)histogram.maxNs);
+    TEST_CHECK(llabs((long long)latencyHistogramPercentile(&histogram, 50) - 500000) < 500000/8, "p50 %llu",
+               (unsigned long long)latencyHistogramPercentile(&histogram, 50));
+    TEST_CHECK(llabs((long long)latencyHistogramPercentile(&histogram, 99) - 990000) < 990000/8, "p99 %llu",
+               (unsigned long long)latencyHistogramPercentile(&histogram, 99));
+    TEST_CHECK(latencyHistogramPercentile(&histogram, 100) <= 1000000, "p100 above the max");
+    
+    //Zero and the largest value both have a bucket.
+    latencyHistogramRecord(&histogram, 0);
+    latencyHistogramRecord(&histogram, UINT64_MAX);
+    TEST_CHECK(histogram.maxNs == UINT64_MAX && latencyHistogramPercentile(&histogram, 0) == 0, "edge values");
+}
+
+static void latencyTestProbe(void)
+{
+    LatencyTestClock    clock   = {1000000000, 0};
+    LatencyProbe        probe;
+    const int           states[2]       = {3, 5};
+    const char *const   stateNames[2]   = {"inventory", "track"};
+    char                report[512];
+    size_t              length;
+    
+    latencyProbeInit(&probe, latencyTestClock, &clock);
+    
+    //Disabled, the marks do nothing.
+    latencyProbeMarkNotify(&probe, clock.nowNs);
+    latencyProbeMarkDecoded(&probe);
+    TEST_CHECK(probe.stages[LATENCY_STAGE_DECODED].numSamples == 0 && latencyProbeNow(&probe) == 0, "disabled probe recorded");
+    
+    latencyProbeSetState(&probe, 3);
+    latencyProbeSetEnabled(&probe, true);
+    
+    //A read decoded 10us after its notification, saved 30us after, and shown in a batch 1ms after.
+    latencyProbeMarkNotify(&probe, clock.nowNs);
+    clock.nowNs += 10000;
+    latencyProbeMarkDecoded(&probe);
+    clock.nowNs += 20000;
+    latencyProbeMarkSaved(&probe);
+    TEST_CHECK(probe.stages[LATENCY_STAGE_DECODED].maxNs == 10000 && probe.stages[LATENCY_STAGE_SAVED].maxNs == 30000,
+               "decoded %llu, saved %llu", (unsigned long long)probe.stages[LATENCY_STAGE_DECODED].maxNs,
+               (unsigned long long)probe.stages[LATENCY_STAGE_SAVED].maxNs);
+    
+    //A second read saved before the batch goes out. The batch is timed from the oldest read in it.
+    uint64_t firstNotifyNs = clock.nowNs-30000;
+    
+    latencyProbeMarkNotify(&probe, clock.nowNs);
+    latencyProbeMarkSaved(&probe);
+    uint64_t unshownNs = latencyProbeTakeUnshown(&probe);
+    
+    TEST_CHECK(unshownNs == firstNotifyNs && latencyProbeTakeUnshown(&probe) == 0, "unshown %llu", (unsigned long long)unshownNs);
+    latencyProbeMarkUIRefreshed(&probe, unshownNs, firstNotifyNs+1000000);
+    latencyProbeMarkUIRefreshed(&probe, 0, firstNotifyNs+2000000);
+    TEST_CHECK(probe.stages[LATENCY_STAGE_UI].numSamples == 1 && probe.stages[LATENCY_STAGE_UI].maxNs == 1000000, "UI %llu samples",
+               (unsigned long long)probe.stages[LATENCY_STAGE_UI].numSamples);
+    
+    //Two reads saved in half a second of state 3, then state 5.
+    clock.nowNs = probe.stateStartNs + 500000000;
+    TEST_CHECK(latencyProbeStateReadsPerSecond(&probe, 3) > 3.99 && latencyProbeStateReadsPerSecond(&probe, 3) < 4.01, "%g reads/s",
+               latencyProbeStateReadsPerSecond(&probe, 3));
+    latencyProbeSetState(&probe, 5);
+    clock.nowNs += 500000000;
+    TEST_CHECK(latencyProbeStateReadsPerSecond(&probe, 3) > 3.99 && latencyProbeStateReadsPerSecond(&probe, 3) < 4.01 &&
+               latencyProbeStateReadsPerSecond(&probe, 5) == 0, "state 3 kept counting after it was left");
+    
+    //A stage with no notify before it, as for a made-up debug read, isn't counted.
+    probe.notifyNs = 0;
+    latencyProbeMarkDecoded(&probe);
+    TEST_CHECK(probe.stages[LATENCY_STAGE_DECODED].numSamples == 1, "stage without a notify was counted");
+    
+    length = latencyProbeFormatReport(&probe, states, stateNames, 2, report, sizeof(report));
+    TEST_CHECK(length < sizeof(report) && strstr(report, "inventory: 2 reads, 4.0 reads/s") && strstr(report, "notify to UI: 1 samples"),
+               "report was:\n%s", report);
+    TEST_CHECK(latencyProbeFormatReport(&probe, states, stateNames, 2, report, 10) == length && strlen(report) == 9,
+               "truncated report");
+    
+    latencyProbeReset(&probe);
+    TEST_CHECK(probe.stages[LATENCY_STAGE_SAVED].numSamples == 0 && probe.stateReads[3] == 0 && probe.enabled && probe.state == 5,
+               "reset");
+}
+
+//------------------------------------------------------------------------------------------------------------------
+
+static void latencyTestPutBE32(uint8_t *bytes, int32_t value)
+{
+    bytes[0]    =   (uint8_t)((uint32_t)value >> 24);
+    bytes[1]    =   (uint8_t)((uint32_t)value >> 16);
+    bytes[2]    =   (uint8_t)((uint32_t)value >> 8);
+    bytes[3]    =   (uint8_t)((uint32_t)value >> 0);
+}
+
+//One read of tag n as the reader firmware lays it out in its two packets.
+static void latencyTestPack(uint32_t n, uint8_t pkt1[TAG_PKT1_NUM_BYTES], uint8_t pkt2[TAG_PKT2_NUM_BYTES])
+{
+    uint8_t antI[4], antQ[4];
+    
+    latencyTestPutBE32(antI, 1000000+(int32_t)n);
+    latencyTestPutBE32(antQ, -2000000);
+    memset(pkt1, 0, TAG_PKT1_NUM_BYTES);
+    latencyTestPutBE32(pkt1, (int32_t)n);
+    pkt1[12]    =   (uint8_t)(128 + n % 25);
+    memcpy(&pkt1[13], antI, 3);
+    memcpy(&pkt1[16], antQ, 3);
+    pkt1[19]    =   (uint8_t)(2*n);
+    
+    memset(pkt2, 0, TAG_PKT2_NUM_BYTES);
+    pkt2[1]     =   antI[3];
+    pkt2[2]     =   antQ[3];
+    latencyTestPutBE32(&pkt2[4], 3000000);
+    latencyTestPutBE32(&pkt2[8], 4000000);
+    pkt2[12]    =   255;
+    pkt2[14]    =   (uint8_t)n;
+    pkt2[15]    =   (uint8_t)(2*n+1);
+}
+
+typedef struct
+{
+    LatencyProbe        *probe;
+    LatencyTestClock    *clock;
+    uint32_t            numReads;
+} LatencyTestHandler;
+
+//Stands in for the tag list: marks the read's own notify and decode times, spends a while saving it, then marks it saved.
+static void latencyTestHandle(void *context, ReaderSession *session, uint32_t flags, const TagRead *read,
+                              const TagStoreObservation *observation)
+{
+    LatencyTestHandler  *handler = context;
+    
+    (void)session;
+    (void)read;
+    if(flags & TAG_DECODE_READ_READY){
+        latencyProbeMarkNotify(handler->probe, observation->timestampNs);
+        latencyProbeMarkDecodedAt(handler->probe, observation->decodedNs);
+        handler->clock->nowNs += LATENCYTEST_HANDLER_NS;
+        latencyProbeMarkSaved(handler->probe);
+        handler->numReads++;
+    }
+}
+
+//Every read is decoded in the drain before any read of its batch is handed on, so however long the handler takes,
+//the decoded latency is only the time the packet sat in the queue.
+static void latencyTestReaderSession(void)
+{
+    LatencyTestClock    clock   = {1000000000, 0};
+    LatencyProbe        probe;
+    ReaderSession       session;
+    TagStore            store;
+    LatencyTestHandler  handler = {&probe, &clock, 0};
+    uint8_t             pkt1[TAG_PKT1_NUM_BYTES], pkt2[TAG_PKT2_NUM_BYTES];
+    uint64_t            drainNs;
+    
+    latencyProbeInit(&probe, latencyTestClock, &clock);
+    latencyProbeSetEnabled(&probe, true);
+    TEST_CHECK(readerSessionInit(&session, 0, 256) && tagStoreInit(&store), "could not set up the session");
+    session.latencyProbe = &probe;
+    
+    for(uint32_t n=0; n<LATENCYTEST_NUM_READS; n++){
+        latencyTestPack(n, pkt1, pkt2);
+        readerSessionPush(&session, READER_PACKET_PKT1, pkt1, sizeof(pkt1), clock.nowNs);
+        readerSessionPush(&session, READER_PACKET_PKT2, pkt2, sizeof(pkt2), clock.nowNs);
+    }
+    clock.nowNs += LATENCYTEST_NOTIFY_TO_DRAIN_NS;
+    drainNs = clock.nowNs;
+    readerSessionDrain(&session, &store, UINT32_MAX, latencyTestHandle, &handler);
+    
+    const LatencyHistogram  *decoded    = &probe.stages[LATENCY_STAGE_DECODED];
+    const LatencyHistogram  *saved      = &probe.stages[LATENCY_STAGE_SAVED];
+    uint64_t                firstBatch  = READER_SESSION_MERGE_BATCH < LATENCYTEST_NUM_READS ? READER_SESSION_MERGE_BATCH : LATENCYTEST_NUM_READS;
+    
+    TEST_CHECK(handler.numReads == LATENCYTEST_NUM_READS && decoded->numSamples == LATENCYTEST_NUM_READS &&
+               saved->numSamples == LATENCYTEST_NUM_READS, "%u reads, %llu decoded, %llu saved", handler.numReads,
+               (unsigned long long)decoded->numSamples, (unsigned long long)saved->numSamples);
+    //Reads in the first batch are all decoded before the handler runs. Later batches wait for the handler of earlier ones.
+    TEST_CHECK(decoded->counts[0] == 0 && latencyHistogramPercentile(decoded, 100.0*firstBatch/LATENCYTEST_NUM_READS - 0.5) <=
+               LATENCYTEST_NOTIFY_TO_DRAIN_NS, "first batch decoded after %llu ns",
+               (unsigned long long)latencyHistogramPercentile(decoded, 100.0*firstBatch/LATENCYTEST_NUM_READS - 0.5));
+    TEST_CHECK(decoded->maxNs == LATENCYTEST_NOTIFY_TO_DRAIN_NS + firstBatch*LATENCYTEST_HANDLER_NS, "last read decoded after %llu ns",
+               (unsigned long long)decoded->maxNs);
+    TEST_CHECK(saved->maxNs == clock.nowNs - (drainNs-LATENCYTEST_NOTIFY_TO_DRAIN_NS), "last read saved after %llu ns",
+               (unsigned long long)saved->maxNs);
+    
+    //The drain leaves the probe alone, so nothing is marked without a handler to do it.
+    latencyTestPack(LATENCYTEST_NUM_READS, pkt1, pkt2);
+    readerSessionPush(&session, READER_PACKET_PKT1, pkt1, sizeof(pkt1), clock.nowNs);
+    readerSessionPush(&session, READER_PACKET_PKT2, pkt2, sizeof(pkt2), clock.nowNs);
+    readerSessionDrain(&session, &store, UINT32_MAX, NULL, NULL);
+    TEST_CHECK(decoded->numSamples == LATENCYTEST_NUM_READS && saved->numSamples == LATENCYTEST_NUM_READS &&
+               session.observations[0].decodedNs != 0, "drain marked the probe itself");
+    
+    //Without a probe the session still drains, and doesn't time the reads.
+    session.latencyProbe = NULL;
+    latencyTestPack(LATENCYTEST_NUM_READS, pkt1, pkt2);
+    readerSessionPush(&session, READER_PACKET_PKT1, pkt1, sizeof(pkt1), clock.nowNs);
+    readerSessionPush(&session, READER_PACKET_PKT2, pkt2, sizeof(pkt2), clock.nowNs);
+    readerSessionDrain(&session, &store, UINT32_MAX, NULL, NULL);
+    TEST_CHECK(decoded->numSamples == LATENCYTEST_NUM_READS && session.numReads == LATENCYTEST_NUM_READS+2 &&
+               session.observations[0].decodedNs == 0, "drain without a probe");
+    
+    readerSessionFree(&session);
+    tagStoreFree(&store);
+}
+
+int main(void)
+{
+    latencyTestHistogram();
+    latencyTestProbe();
+    latencyTestReaderSession();
+    
+    return testCheckExit("latencytest");
+}
@@ -0,0 +1,323 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: metricstest.c                                                             //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Accuracy test and microbenchmark of TagMetrics. The scalar and the SSE2/NEON    //
+//  batch paths for RSSI, phase and PDOA range are checked against the reference    //
+//  formulas over a million reads, then each path is timed.                         //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o metricstest Tools/metricstest.c                       //
+//  SURFERControl/TagMetrics.c SURFERControl/MonotonicClock.c -lm -lpthread         //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "TagMetrics.h"
+#include "MonotonicClock.h"
+#include "testcheck.h"
+
+#define METRICSTEST_NUM_READS       1000000
+#define METRICSTEST_MAX_RSSI_ERROR  1e-3    //dB
+#define METRICSTEST_MAX_PHASE_ERROR 1e-5    //Radians
+#define METRICSTEST_MAX_RANGE_ERROR 1e-3    //Meters
+
+static uint64_t metricsTestRandomState = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t metricsTestRandom(void)
+{
+    metricsTestRandomState ^= metricsTestRandomState << 13;
+    metricsTestRandomState ^= metricsTestRandomState >> 7;
+    metricsTestRandomState ^= metricsTestRandomState << 17;
+    
+    return metricsTestRandomState;
+}
+
+static double metricsTestUniform(double low, double high)
+{
+    return low + (high-low)*(double)(metricsTestRandom() >> 11)/(double)(1ULL << 53);
+}
+
+//Magnitudes like the reader's, from about -90dBm to -10dBm at any angle, plus the odd zero I or Q.
+static void metricsTestMagnitudes(int32_t *magI, int32_t *magQ, size_t count)
+{
+    for(size_t n=0; n<count; n++){
+        double amplitude    =   pow(10.0, metricsTestUniform(3.0, 9.3));
+        double angle        =   metricsTestUniform(-M_PI, M_PI);
+        
+        magI[n]     =   (int32_t)(amplitude*cos(angle));
+        magQ[n]     =   (int32_t)(amplitude*sin(angle));
+        if(n % 1000 == 1){
+            magQ[n] = 0;
+        } else if(n % 1000 == 2){
+            magI[n] = 0;
+            magQ[n] = magQ[n] ? magQ[n] : 1;
+        }
+    }
+}
+
+//Phases are taken modulo pi, so 0 and just under pi are next to each other.
+static double metricsTestCircularError(double a, double b, double period)
+{
+    double error = fabs(fmod(a-b, period));
+    
+    return error > period/2 ? period-error : error;
+}
+
+static void metricsTestRSSIPhase(int32_t *magI, int32_t *magQ, float *rssi, float *phase)
+{
+    double  maxRSSIError[2]     =   {0, 0};     //Scalar, batch.
+    double  maxPhaseError[2]    =   {0, 0};
+    
+    tagMetricsRSSIPhaseBatch(magI, magQ, METRICSTEST_NUM_READS, rssi, phase);
+    for(size_t n=0; n<METRICSTEST_NUM_READS; n++){
+        double refRSSI  =   tagMetricsRSSIdBmReference(magI[n], magQ[n]);
+        double refPhase =   tagMetricsPhaseReference(magI[n], magQ[n]);
+        double error;
+        
+        error = fabs(tagMetricsRSSIdBm(magI[n], magQ[n]) - refRSSI);
+        maxRSSIError[0] = fmax(maxRSSIError[0], error);
+        error = fabs(rssi[n] - refRSSI);
+        maxRSSIError[1] = fmax(maxRSSIError[1], error);
+        error = metricsTestCircularError(tagMetricsPhase(magI[n], magQ[n]), refPhase, M_PI);
+        maxPhaseError[0] = fmax(maxPhaseError[0], error);
+        error = metricsTestCircularError(phase[n], refPhase, M_PI);
+        maxPhaseError[1] = fmax(maxPhaseError[1], error);
+    }
+    
+    TEST_CHECK(maxRSSIError[0] < METRICSTEST_MAX_RSSI_ERROR, "scalar RSSI off by %g dB", maxRSSIError[0]);
+    TEST_CHECK(maxRSSIError[1] < METRICSTEST_MAX_RSSI_ERROR, "batch RSSI off by %g dB", maxRSSIError[1]);
+    TEST_CHECK(maxPhaseError[0] < METRICSTEST_MAX_PHASE_ERROR, "scalar phase off by %g rad", maxPhaseError[0]);
+    TEST_CHECK(maxPhaseError[1] < METRICSTEST_MAX_PHASE_ERROR, "batch phase off by %g rad", maxPhaseError[1]);
+    printf("Worst error over %d reads: RSSI %.2g dB scalar, %.2g dB batch; phase %.2g rad scalar, %.2g rad batch\n",
+           METRICSTEST_NUM_READS, maxRSSIError[0], maxRSSIError[1], maxPhaseError[0], maxPhaseError[1]);
+    
+    //Nothing received comes out as -infinity, as log10 of zero would.
+    magI[0] = magQ[0] = 0;
+    tagMetricsRSSIPhaseBatch(magI, magQ, 4, rssi, phase);
+    TEST_CHECK(isinf(rssi[0]) && rssi[0] < 0, "zero power gave %g dBm", rssi[0]);
+}
+
+//Hop/skip pairs with slots from 0 to 24, so some are too close or too far apart, and the odd bad nonce or weak cal.
+typedef struct
+{
+    uint8_t     *slotHop, *slotSkip, *nonceHop, *nonceSkip;
+    float       *phaseAntHop, *phaseCalHop, *magCalHop, *phaseAntSkip, *phaseCalSkip, *magCalSkip, *previous, *range;
+} MetricsTestPairs;
+
+static bool metricsTestAllocPairs(MetricsTestPairs *pairs, size_t count)
+{
+    uint8_t **bytes[]   =   {&pairs->slotHop, &pairs->slotSkip, &pairs->nonceHop, &pairs->nonceSkip};
+    float   **floats[]  =   {&pairs->phaseAntHop, &pairs->phaseCalHop, &pairs->magCalHop, &pairs->phaseAntSkip,
+                             &pairs->phaseCalSkip, &pairs->magCalSkip, &pairs->previous, &pairs->range};
+    bool    ok          =   true;
+    
+    for(size_t i=0; i<sizeof(bytes)/sizeof(bytes[0]); i++){
+        ok &= (*bytes[i] = malloc(count)) != NULL;
+    }
+    for(size_t i=0; i<sizeof(floats)/sizeof(floats[0]); i++){
+        ok &= (*floats[i] = malloc(count*sizeof(float))) != NULL;
+    }
+    
+    return ok;
+}
+
+static void metricsTestFreePairs(MetricsTestPairs *pairs)
+{
+    void *all[] = {pairs->slotHop, pairs->slotSkip, pairs->nonceHop, pairs->nonceSkip, pairs->phaseAntHop, pairs->phaseCalHop,
+                   pairs->magCalHop, pairs->phaseAntSkip, pairs->phaseCalSkip, pairs->magCalSkip, pairs->previous, pairs->range};
+    
+    for(size_t i=0; i<sizeof(all)/sizeof(all[0]); i++){
+        free(all[i]);
+    }
+}
+
+static void metricsTestMakePairs(MetricsTestPairs *pairs, size_t count)
+{
+    for(size_t n=0; n<count; n++){
+        pairs->slotHop[n]       =   (uint8_t)(metricsTestRandom() % TAG_METRICS_NUM_SLOTS);
+        pairs->slotSkip[n]      =   (uint8_t)(metricsTestRandom() % TAG_METRICS_NUM_SLOTS);
+        pairs->nonceHop[n]      =   (uint8_t)n;
+        pairs->nonceSkip[n]     =   (uint8_t)(n % 50 == 0 ? n+1 : n);
+        pairs->phaseAntHop[n]   =   (float)metricsTestUniform(0.001, M_PI);
+        pairs->phaseCalHop[n]   =   (float)metricsTestUniform(0.001, M_PI);
+        pairs->magCalHop[n]     =   (float)metricsTestUniform(-75.0, -20.0);
+        pairs->phaseAntSkip[n]  =   (float)metricsTestUniform(0.001, M_PI);
+        pairs->phaseCalSkip[n]  =   (float)metricsTestUniform(0.001, M_PI);
+        pairs->magCalSkip[n]    =   (float)metricsTestUniform(-75.0, -20.0);
+        pairs->previous[n]      =   (float)metricsTestUniform(0.0, 50.0);
+    }
+}
+
+static void metricsTestMeasurement(const MetricsTestPairs *pairs, size_t n, bool hop, TagPDOAMeasurement *measurement)
+{
+    measurement->freqMHz    =   tagMetricsFreqMHzFromSlot(hop ? pairs->slotHop[n] : pairs->slotSkip[n]);
+    measurement->phaseAnt   =   hop ? pairs->phaseAntHop[n] : pairs->phaseAntSkip[n];
+    measurement->phaseCal   =   hop ? pairs->phaseCalHop[n] : pairs->phaseCalSkip[n];
+    measurement->magCal     =   hop ? pairs->magCalHop[n] : pairs->magCalSkip[n];
+    measurement->nonce      =   hop ? pairs->nonceHop[n] : pairs->nonceSkip[n];
+}
+
+static void metricsTestBatchOf(const MetricsTestPairs *pairs, TagPDOABatch *batch)
+{
+    batch->slotHop              =   pairs->slotHop;
+    batch->phaseAntHop          =   pairs->phaseAntHop;
+    batch->phaseCalHop          =   pairs->phaseCalHop;
+    batch->magCalHop            =   pairs->magCalHop;
+    batch->nonceHop             =   pairs->nonceHop;
+    batch->slotSkip             =   pairs->slotSkip;
+    batch->phaseAntSkip         =   pairs->phaseAntSkip;
+    batch->phaseCalSkip         =   pairs->phaseCalSkip;
+    batch->magCalSkip           =   pairs->magCalSkip;
+    batch->nonceSkip            =   pairs->nonceSkip;
+    batch->previousRangeMeters  =   pairs->previous;
+}
+
+//A range is only known modulo c/(4*delta), so one just under that is as good as one just over 0.
+static void metricsTestPDOA(const MetricsTestPairs *pairs)
+{
+    TagPDOABatch    batch;
+    double          maxError[2]     =   {0, 0};
+    uint32_t        numWrongInvalid =   0;
+    uint32_t        numValid        =   0;
+    
+    metricsTestBatchOf(pairs, &batch);
+    tagMetricsPDOARangeBatch(&batch, METRICSTEST_NUM_READS, pairs->range);
+    
+    for(size_t n=0; n<METRICSTEST_NUM_READS; n++){
+        TagPDOAMeasurement  hop, skip;
+        float               scalar      =   pairs->previous[n];
+        double              reference;
+        double              period;
+        
+        metricsTestMeasurement(pairs, n, true, &hop);
+        metricsTestMeasurement(pairs, n, false, &skip);
+        reference   =   tagMetricsPDOARangeReference(&hop, &skip, pairs->previous[n]);
+        tagMetricsPDOARange(&hop, &skip, &scalar);
+        
+        if(reference == TAG_METRICS_RANGE_INVALID || hop.nonce != skip.nonce){
+            numWrongInvalid += scalar != (float)reference || pairs->range[n] != (float)reference;
+            continue;
+        }
+        numValid++;
+        period      =   299792458.0/(4e6*fabs(hop.freqMHz-skip.freqMHz));
+        maxError[0] =   fmax(maxError[0], metricsTestCircularError(scalar, reference, period));
+        maxError[1] =   fmax(maxError[1], metricsTestCircularError(pairs->range[n], reference, period));
+    }
+    
+    TEST_CHECK(numWrongInvalid == 0, "%u pairs disagreed on an invalid or kept range", numWrongInvalid);
+    TEST_CHECK(numValid > METRICSTEST_NUM_READS/10, "only %u valid pairs", numValid);
+    TEST_CHECK(maxError[0] < METRICSTEST_MAX_RANGE_ERROR, "scalar range off by %g m", maxError[0]);
+    TEST_CHECK(maxError[1] < METRICSTEST_MAX_RANGE_ERROR, "batch range off by %g m", maxError[1]);
+    printf("Worst range error over %u valid pairs: %.2g m scalar, %.2g m batch\n", numValid, maxError[0], maxError[1]);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+
+static void metricsTestBenchmark(const int32_t *magI, const int32_t *magQ, float *rssi, float *phase,
+                                 const MetricsTestPairs *pairs)
+{
+    TagPDOABatch    batch;
+    uint64_t        startNs;
+    uint64_t        elapsedNs[5];
+    volatile float  sink            =   0;
+    
+    startNs = monotonicClockNs();
+    for(size_t n=0; n<METRICSTEST_NUM_READS; n++){
+        rssi[n]     =   tagMetricsRSSIdBmReference(magI[n], magQ[n]);
+        phase[n]    =   tagMetricsPhaseReference(magI[n], magQ[n]);
+    }
+    elapsedNs[0] = monotonicClockNs()-startNs;
+    
+    startNs = monotonicClockNs();
+    for(size_t n=0; n<METRICSTEST_NUM_READS; n++){
+        rssi[n]     =   tagMetricsRSSIdBm(magI[n], magQ[n]);
+        phase[n]    =   tagMetricsPhase(magI[n], magQ[n]);
+    }
+    elapsedNs[1] = monotonicClockNs()-startNs;
+    sink += rssi[METRICSTEST_NUM_READS/2];
+    
+    startNs = monotonicClockNs();
+    tagMetricsRSSIPhaseBatch(magI, magQ, METRICSTEST_NUM_READS, rssi, phase);
+    elapsedNs[2] = monotonicClockNs()-startNs;
+    sink += rssi[METRICSTEST_NUM_READS/2];
+    
+    startNs = monotonicClockNs();
+    for(size_t n=0; n<METRICSTEST_NUM_READS; n++){
+        TagPDOAMeasurement  hop, skip;
+        
+        metricsTestMeasurement(pairs, n, true, &hop);
+        metricsTestMeasurement(pairs, n, false, &skip);
+        pairs->range[n] = pairs->previous[n];
+        tagMetricsPDOARange(&hop, &skip, &pairs->range[n]);
+    }
+    elapsedNs[3] = monotonicClockNs()-startNs;
+    sink += pairs->range[METRICSTEST_NUM_READS/2];
+    
+    metricsTestBatchOf(pairs, &batch);
+    startNs = monotonicClockNs();
+    tagMetricsPDOARangeBatch(&batch, METRICSTEST_NUM_READS, pairs->range);
+    elapsedNs[4] = monotonicClockNs()-startNs;
+    sink += pairs->range[METRICSTEST_NUM_READS/2];
+    
+    printf("RSSI and phase per read: reference %.1f ns, scalar %.1f ns, batch %.1f ns\n", (double)elapsedNs[0]/METRICSTEST_NUM_READS,
+           (double)elapsedNs[1]/METRICSTEST_NUM_READS, (double)elapsedNs[2]/METRICSTEST_NUM_READS);
+    printf("PDOA range per pair: scalar %.1f ns, batch %.1f ns\n", (double)elapsedNs[3]/METRICSTEST_NUM_READS,
+           (double)elapsedNs[4]/METRICSTEST_NUM_READS);
+    (void)sink;
+}
+
+int main(void)
+{
+    int32_t             *magI   =   malloc(METRICSTEST_NUM_READS*sizeof(int32_t));
+    int32_t             *magQ   =   malloc(METRICSTEST_NUM_READS*sizeof(int32_t));
+    float               *rssi   =   malloc(METRICSTEST_NUM_READS*sizeof(float));
+    float               *phase  =   malloc(METRICSTEST_NUM_READS*sizeof(float));
+    MetricsTestPairs    pairs;
+    
+    memset(&pairs, 0, sizeof(pairs));
+    if(!magI || !magQ || !rssi || !phase || !metricsTestAllocPairs(&pairs, METRICSTEST_NUM_READS)){
+        fprintf(stderr, "Could not allocate the test data\n");
+        return 1;
+    }
+    
+    metricsTestMagnitudes(magI, magQ, METRICSTEST_NUM_READS);
+    metricsTestMakePairs(&pairs, METRICSTEST_NUM_READS);
+    metricsTestBenchmark(magI, magQ, rssi, phase, &pairs);
+    metricsTestRSSIPhase(magI, magQ, rssi, phase);
+    metricsTestPDOA(&pairs);
+    
+    free(magI);
+    free(magQ);
+    free(rssi);
+    free(phase);
+    metricsTestFreePairs(&pairs);
+    
+    return testCheckExit("metricstest");
+}
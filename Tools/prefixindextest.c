@@ -0,0 +1,285 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: prefixindextest.c                                                         //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Tests of the EPC prefix index against a plain scan of the EPCs, for counting,   //
+//  listing and telling apart the tags that share leading bits, and a benchmark with//
+//  100k EPCs: adding them the way the tag list does from snapshot rows, and asking //
+//  how many match a target EPC, against the scan the index saves.                  //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o prefixindextest Tools/prefixindextest.c               //
+//  SURFERControl/EPCPrefixIndex.c SURFERControl/MonotonicClock.c                   //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "EPCPrefixIndex.h"
+#include "TagPacketDecoder.h"
+#include "MonotonicClock.h"
+#include "testcheck.h"
+
+#define PREFIXINDEXTEST_TAGS            5000        //For checking against the scan.
+#define PREFIXINDEXTEST_QUERIES         2000
+#define PREFIXINDEXTEST_BENCH_TAGS      100000
+#define PREFIXINDEXTEST_BENCH_QUERIES   200000
+#define PREFIXINDEXTEST_BENCH_SCANS     200
+#define PREFIXINDEXTEST_MIN_SPEEDUP     10          //Of a count over the scan, at 100k tags.
+
+static uint64_t prefixIndexTestRandomState = 88172645463325252ULL;
+
+static uint64_t prefixIndexTestRandom(void)
+{
+    prefixIndexTestRandomState ^= prefixIndexTestRandomState << 13;
+    prefixIndexTestRandomState ^= prefixIndexTestRandomState >> 7;
+    prefixIndexTestRandomState ^= prefixIndexTestRandomState << 17;
+    
+    return prefixIndexTestRandomState;
+}
+
+//Half of the tags are sequential serials from one of four rolls, which share all but their last few bits, and half are
+//random.
+static void prefixIndexTestMakeEPC(uint32_t i, uint8_t *epc)
+{
+    if(i & 1){
+        for(int b=0; b<TAG_EPC_NUM_BYTES; b++){
+            epc[b] = (uint8_t)prefixIndexTestRandom();
+        }
+    } else {
+        memset(epc, 0, TAG_EPC_NUM_BYTES);
+        epc[0]  =   0x30;
+        epc[1]  =   0x14;
+        epc[2]  =   (uint8_t)(0x40 | ((i >> 1) & 3));
+        epc[9]  =   (uint8_t)(i >> 19);
+        epc[10] =   (uint8_t)(i >> 11);
+        epc[11] =   (uint8_t)(i >> 3);
+    }
+}
+
+static bool prefixIndexTestHasPrefix(const uint8_t *epc, const uint8_t *prefix, uint32_t prefixBits)
+{
+    for(uint32_t bit=0; bit<prefixBits && bit<EPC_PREFIX_INDEX_MAX_BITS; bit++){
+        if(((epc[bit/8] ^ prefix[bit/8]) >> (7-bit%8)) & 1){
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t prefixIndexTestCommonBits(const uint8_t *a, const uint8_t *b)
+{
+    uint32_t bit = 0;
+    
+    while(bit < EPC_PREFIX_INDEX_MAX_BITS && !(((a[bit/8] ^ b[bit/8]) >> (7-bit%8)) & 1)){
+        bit++;
+    }
+    return bit;
+}
+
+static const uint8_t (*prefixIndexTestSortEPCs)[TAG_EPC_NUM_BYTES];
+
+static int prefixIndexTestCompareRows(const void *a, const void *b)
+{
+    return memcmp(prefixIndexTestSortEPCs[*(const uint32_t *)a], prefixIndexTestSortEPCs[*(const uint32_t *)b], TAG_EPC_NUM_BYTES);
+}
+
+//A prefix taken from one of the tags, or made up, cut to a random number of bits.
+static uint32_t prefixIndexTestMakePrefix(const uint8_t (*epcs)[TAG_EPC_NUM_BYTES], uint32_t numTags, uint8_t *prefix)
+{
+    if(prefixIndexTestRandom() % 4){
+        memcpy(prefix, epcs[prefixIndexTestRandom() % numTags], TAG_EPC_NUM_BYTES);
+    } else {
+        for(int b=0; b<TAG_EPC_NUM_BYTES; b++){
+            prefix[b] = (uint8_t)prefixIndexTestRandom();
+        }
+    }
+    return (uint32_t)(prefixIndexTestRandom() % (EPC_PREFIX_INDEX_MAX_BITS+9));
+}
+
+static void prefixIndexTestCorrectness(void)
+{
+    EPCPrefixIndex  index;
+    uint8_t         (*epcs)[TAG_EPC_NUM_BYTES]  =   malloc(PREFIXINDEXTEST_TAGS*TAG_EPC_NUM_BYTES);
+    uint32_t        *rows                       =   malloc(PREFIXINDEXTEST_TAGS*sizeof(uint32_t));
+    uint32_t        *expected                   =   malloc(PREFIXINDEXTEST_TAGS*sizeof(uint32_t));
+    uint32_t        numWrongCounts              =   0;
+    uint32_t        numWrongMatches             =   0;
+    uint32_t        numWrongUnique              =   0;
+    uint8_t         prefix[TAG_EPC_NUM_BYTES];
+    
+    if(!epcs || !rows || !expected || !epcPrefixIndexInit(&index)){
+        TEST_CHECK(false, "could not allocate");
+        free(epcs);
+        free(rows);
+        free(expected);
+        return;
+    }
+    TEST_CHECK(epcPrefixIndexCount(&index, prefix, 0) == 0 &&
+               epcPrefixIndexShortestUniquePrefix(&index, prefix) == EPC_PREFIX_INDEX_NOT_FOUND, "an empty index had tags");
+    
+    for(uint32_t i=0; i<PREFIXINDEXTEST_TAGS; i++){
+        prefixIndexTestMakeEPC(i, epcs[i]);
+        TEST_CHECK(epcPrefixIndexInsert(&index, epcs[i], i), "insert %u failed", i);
+        if(i == 0){
+            TEST_CHECK(epcPrefixIndexShortestUniquePrefix(&index, epcs[0]) == 0, "a lone tag needed bits to pick it out");
+        }
+    }
+    //An EPC already there keeps its row.
+    TEST_CHECK(epcPrefixIndexInsert(&index, epcs[7], 12345) && epcPrefixIndexNumTags(&index) == PREFIXINDEXTEST_TAGS,
+               "inserting an EPC twice added a tag");
+    TEST_CHECK(epcPrefixIndexCount(&index, prefix, 0) == PREFIXINDEXTEST_TAGS, "an empty prefix didn't match every tag");
+    
+    for(uint32_t q=0; q<PREFIXINDEXTEST_QUERIES; q++){
+        uint32_t    prefixBits  =   prefixIndexTestMakePrefix((const uint8_t (*)[TAG_EPC_NUM_BYTES])epcs, PREFIXINDEXTEST_TAGS, prefix);
+        uint32_t    maxRows     =   (uint32_t)(prefixIndexTestRandom() % 64);
+        uint32_t    numExpected =   0;
+        uint32_t    count;
+        
+        for(uint32_t i=0; i<PREFIXINDEXTEST_TAGS; i++){
+            if(prefixIndexTestHasPrefix(epcs[i], prefix, prefixBits)){
+                expected[numExpected++] = i;
+            }
+        }
+        prefixIndexTestSortEPCs = (const uint8_t (*)[TAG_EPC_NUM_BYTES])epcs;
+        qsort(expected, numExpected, sizeof(uint32_t), prefixIndexTestCompareRows);
+        
+        numWrongCounts += epcPrefixIndexCount(&index, prefix, prefixBits) != numExpected;
+        //All of the rows, then only the first few, which are still the first in EPC order.
+        count = epcPrefixIndexMatch(&index, prefix, prefixBits, rows, PREFIXINDEXTEST_TAGS);
+        numWrongMatches += count != numExpected || memcmp(rows, expected, numExpected*sizeof(uint32_t)) != 0;
+        count = epcPrefixIndexMatch(&index, prefix, prefixBits, rows, maxRows);
+        numWrongMatches += count != numExpected
+                           || memcmp(rows, expected, (numExpected < maxRows ? numExpected : maxRows)*sizeof(uint32_t)) != 0;
+    }
+    TEST_CHECK(numWrongCounts == 0, "%u of %u counts were wrong", numWrongCounts, PREFIXINDEXTEST_QUERIES);
+    TEST_CHECK(numWrongMatches == 0, "%u of %u matches were wrong", numWrongMatches, 2*PREFIXINDEXTEST_QUERIES);
+    
+    //The shortest unique prefix is one bit past the most any other tag shares, and picks out just the one tag.
+    for(uint32_t i=0; i<PREFIXINDEXTEST_TAGS; i+=17){
+        uint32_t    mostShared  =   0;
+        int32_t     uniqueBits  =   epcPrefixIndexShortestUniquePrefix(&index, epcs[i]);
+        
+        for(uint32_t j=0; j<PREFIXINDEXTEST_TAGS; j++){
+            uint32_t shared = j == i ? 0 : prefixIndexTestCommonBits(epcs[i], epcs[j]);
+            
+            mostShared = shared > mostShared ? shared : mostShared;
+        }
+        numWrongUnique += uniqueBits != (int32_t)mostShared+1 || epcPrefixIndexCount(&index, epcs[i], (uint32_t)uniqueBits) != 1
+                          || epcPrefixIndexCount(&index, epcs[i], (uint32_t)uniqueBits-1) < 2;
+    }
+    TEST_CHECK(numWrongUnique == 0, "%u shortest unique prefixes were wrong", numWrongUnique);
+    memset(prefix, 0xA5, sizeof(prefix));
+    TEST_CHECK(epcPrefixIndexShortestUniquePrefix(&index, prefix) == EPC_PREFIX_INDEX_NOT_FOUND,
+               "found a unique prefix for an EPC that isn't there");
+    
+    //Clearing keeps the memory, and the index fills up the same way again.
+    epcPrefixIndexClear(&index);
+    TEST_CHECK(epcPrefixIndexNumTags(&index) == 0 && epcPrefixIndexCount(&index, prefix, 0) == 0, "clear left tags");
+    for(uint32_t i=0; i<PREFIXINDEXTEST_TAGS; i++){
+        epcPrefixIndexInsert(&index, epcs[i], i);
+    }
+    TEST_CHECK(epcPrefixIndexCount(&index, epcs[0], 16) == epcPrefixIndexMatch(&index, epcs[0], 16, NULL, 0) &&
+               epcPrefixIndexCount(&index, epcs[0], 16) >= PREFIXINDEXTEST_TAGS/2, "the index differed after a clear");
+    
+    epcPrefixIndexFree(&index);
+    free(epcs);
+    free(rows);
+    free(expected);
+}
+
+//The tag list adds each new snapshot row on the main thread, from the EPC bytes in it. Target EPCs are whole bytes.
+static void prefixIndexTestBenchmark(void)
+{
+    EPCPrefixIndex  index;
+    uint8_t         (*epcs)[TAG_EPC_NUM_BYTES]  =   malloc(PREFIXINDEXTEST_BENCH_TAGS*TAG_EPC_NUM_BYTES);
+    uint64_t        startNs;
+    double          insertNs, countNs, scanNs, uniqueNs;
+    uint32_t        numRows     =   0;
+    bool            ok          =   true;
+    
+    if(!epcs || !epcPrefixIndexInit(&index)){
+        TEST_CHECK(false, "could not allocate");
+        free(epcs);
+        return;
+    }
+    for(uint32_t i=0; i<PREFIXINDEXTEST_BENCH_TAGS; i++){
+        prefixIndexTestMakeEPC(i, epcs[i]);
+    }
+    
+    startNs = monotonicClockNs();
+    for(; numRows<PREFIXINDEXTEST_BENCH_TAGS; numRows++){
+        if(!epcPrefixIndexInsert(&index, epcs[numRows], numRows)){
+            ok = false;
+            break;
+        }
+    }
+    insertNs = (double)(monotonicClockNs()-startNs)/PREFIXINDEXTEST_BENCH_TAGS;
+    TEST_CHECK(ok && epcPrefixIndexNumTags(&index) == PREFIXINDEXTEST_BENCH_TAGS, "only %u of %u rows went in",
+               epcPrefixIndexNumTags(&index), PREFIXINDEXTEST_BENCH_TAGS);
+    
+    startNs = monotonicClockNs();
+    for(uint32_t q=0; q<PREFIXINDEXTEST_BENCH_QUERIES; q++){
+        epcPrefixIndexCount(&index, epcs[q % PREFIXINDEXTEST_BENCH_TAGS], 8*(1+q % TAG_EPC_NUM_BYTES));
+    }
+    countNs = (double)(monotonicClockNs()-startNs)/PREFIXINDEXTEST_BENCH_QUERIES;
+    
+    //Queries of the same kind answered by the scan, which is slow enough that only a few are needed.
+    startNs = monotonicClockNs();
+    for(uint32_t q=0; q<PREFIXINDEXTEST_BENCH_SCANS; q++){
+        const uint8_t   *target         =   epcs[(q*7919) % PREFIXINDEXTEST_BENCH_TAGS];
+        uint32_t        prefixBytes     =   1+q % TAG_EPC_NUM_BYTES;
+        uint32_t        numMatching     =   0;
+        
+        for(uint32_t i=0; i<PREFIXINDEXTEST_BENCH_TAGS; i++){
+            numMatching += memcmp(epcs[i], target, prefixBytes) == 0;
+        }
+        TEST_CHECK(numMatching == epcPrefixIndexCount(&index, target, 8*prefixBytes),
+                   "the index and the scan disagree on %u bytes of query %u", prefixBytes, q);
+    }
+    scanNs = (double)(monotonicClockNs()-startNs)/PREFIXINDEXTEST_BENCH_SCANS;
+    
+    startNs = monotonicClockNs();
+    for(uint32_t q=0; q<PREFIXINDEXTEST_BENCH_QUERIES; q++){
+        epcPrefixIndexShortestUniquePrefix(&index, epcs[q % PREFIXINDEXTEST_BENCH_TAGS]);
+    }
+    uniqueNs = (double)(monotonicClockNs()-startNs)/PREFIXINDEXTEST_BENCH_QUERIES;
+    
+    TEST_CHECK(scanNs >= PREFIXINDEXTEST_MIN_SPEEDUP*countNs, "a count took %.1f ns against %.1f ns for the scan", countNs, scanNs);
+    printf("%u tags: adding a snapshot row %.1f ns, target EPC count %.1f ns, scan %.1f ns, %.0fx faster,"
+           " shortest unique prefix %.1f ns\n", PREFIXINDEXTEST_BENCH_TAGS, insertNs, countNs, scanNs, scanNs/countNs, uniqueNs);
+    
+    epcPrefixIndexFree(&index);
+    free(epcs);
+}
+
+int main(void)
+{
+    prefixIndexTestCorrectness();
+    prefixIndexTestBenchmark();
+    
+    return testCheckExit("prefixindextest");
+}
@@ -0,0 +1,263 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: rangetest.c                                                               //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Test of the multi-frequency range estimator on synthetic tags. Phases are made  //
+//  for a tag at a known range, with noise, and the estimate is checked near 0m,    //
+//  where the wider slot steps wrap, out to 65m, with slots missing, and as the     //
+//  tag moves. The update and estimate are then timed.                              //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o rangetest Tools/rangetest.c                           //
+//  SURFERControl/TagRangeEstimator.c SURFERControl/TagMetrics.c                    //
+//  SURFERControl/MonotonicClock.c -lm -lpthread                                    //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "TagRangeEstimator.h"
+#include "TagMetrics.h"
+#include "MonotonicClock.h"
+#include "testcheck.h"
+
+#define RANGETEST_SPEED_LIGHT_VAC   299792458.0
+#define RANGETEST_NUM_READS         300         //Reads of each synthetic tag before its estimate is checked.
+#define RANGETEST_PHASE_NOISE       0.05        //Radians, standard deviation.
+#define RANGETEST_MAX_ERROR_M       0.5
+#define RANGETEST_MAX_MEAN_ERROR_M  0.1
+#define RANGETEST_NUM_BENCH_READS   1000000
+
+static uint64_t rangeTestRandomState = 0x2545F4914F6CDD1DULL;
+
+static double rangeTestUniform(void)
+{
+    rangeTestRandomState ^= rangeTestRandomState << 13;
+    rangeTestRandomState ^= rangeTestRandomState >> 7;
+    rangeTestRandomState ^= rangeTestRandomState << 17;
+    
+    return ((double)(rangeTestRandomState >> 11) + 0.5)/(double)(1ULL << 53);
+}
+
+static double rangeTestGaussian(void)
+{
+    return sqrt(-2*log(rangeTestUniform()))*cos(2*M_PI*rangeTestUniform());
+}
+
+//Feeds one read of a tag at rangeMeters on the given slot. The phase offset of the tag itself is the same at every
+//slot, and the phases handed over are the raw antenna and cal phases that give the wanted corrected phase.
+static void rangeTestRead(TagRangeEstimator *estimator, uint8_t slot, double rangeMeters, double noise)
+{
+    double  freqHz      = tagMetricsFreqMHzFromSlot(slot)*1e6;
+    double  wanted      = 4*M_PI*freqHz*rangeMeters/RANGETEST_SPEED_LIGHT_VAC + 1.234 + noise*rangeTestGaussian();
+    double  phaseCal    = 0.5 + 2*rangeTestUniform();
+    double  offset      = tagMetricsCorrectedPhase(slot, (float)phaseCal, (float)phaseCal);
+    double  phaseAnt    = phaseCal + fmod(fmod(wanted - offset, M_PI) + 2*M_PI, M_PI);
+    
+    tagRangeEstimatorUpdate(estimator, slot, (float)phaseAnt, (float)phaseCal, -40.0f);
+}
+
+//Hops at random over the slots whose bit is set in slotMask, as the reader does over the whole band.
+static void rangeTestReads(TagRangeEstimator *estimator, uint32_t slotMask, double rangeMeters, double noise, uint32_t numReads)
+{
+    for(uint32_t n=0; n<numReads; n++){
+        uint8_t slot;
+        
+        do{
+            slot = (uint8_t)(rangeTestUniform()*TAG_METRICS_NUM_SLOTS);
+        } while(!(slotMask & (1u << slot)));
+        rangeTestRead(estimator, slot, rangeMeters, noise);
+    }
+}
+
+static double rangeTestEstimate(uint32_t slotMask, double rangeMeters, double noise, TagRangeEstimate *estimate)
+{
+    TagRangeEstimator   estimator;
+    
+    tagRangeEstimatorInit(&estimator);
+    rangeTestReads(&estimator, slotMask, rangeMeters, noise, RANGETEST_NUM_READS);
+    tagRangeEstimatorGetEstimate(&estimator, estimate);
+    
+    return fabs(estimate->rangeMeters - rangeMeters);
+}
+
+#define RANGETEST_ALL_SLOTS ((1u << TAG_METRICS_NUM_SLOTS) - 1)
+
+static void rangeTestEmpty(void)
+{
+    TagRangeEstimator   estimator;
+    TagRangeEstimate    estimate;
+    
+    tagRangeEstimatorInit(&estimator);
+    tagRangeEstimatorGetEstimate(&estimator, &estimate);
+    TEST_CHECK(estimate.rangeMeters == TAG_METRICS_RANGE_INVALID && estimate.confidence == 0, "empty gave %g m", estimate.rangeMeters);
+    
+    //One slot alone gives no pair, and reads without calibration are dropped.
+    rangeTestReads(&estimator, 1u << 7, 3.0, 0, 10);
+    TEST_CHECK(!tagRangeEstimatorUpdate(&estimator, 8, 1.0f, 1.0f, TAG_METRICS_MIN_CAL_RSSI_DBM-1), "weak cal was used");
+    TEST_CHECK(!tagRangeEstimatorUpdate(&estimator, 8, 0.0f, 1.0f, -40.0f), "zero phase was used");
+    TEST_CHECK(!tagRangeEstimatorUpdate(&estimator, TAG_METRICS_NUM_SLOTS, 1.0f, 1.0f, -40.0f), "bad slot was used");
+    tagRangeEstimatorGetEstimate(&estimator, &estimate);
+    TEST_CHECK(estimate.rangeMeters == TAG_METRICS_RANGE_INVALID && estimate.numSlots == 1, "one slot gave %g m from %u slots",
+               estimate.rangeMeters, estimate.numSlots);
+}
+
+//Pairs at a tag close to the reader straddle 0m and the 75m alias, which must not average to the middle.
+static void rangeTestNearZero(void)
+{
+    const double    ranges[] = {0.0, 0.05, 0.2, 0.5, 1.0};
+    
+    for(size_t i=0; i<sizeof(ranges)/sizeof(ranges[0]); i++){
+        for(int trial=0; trial<20; trial++){
+            TagRangeEstimate    estimate;
+            double              error = rangeTestEstimate(RANGETEST_ALL_SLOTS, ranges[i], 2*RANGETEST_PHASE_NOISE, &estimate);
+            
+            if(error > 2*RANGETEST_MAX_ERROR_M){
+                TEST_CHECK(error <= 2*RANGETEST_MAX_ERROR_M, "tag at %g m estimated at %g m", ranges[i], estimate.rangeMeters);
+                break;
+            }
+        }
+    }
+}
+
+//Sweeps the range past every point where a 1, 2 or 3 slot step wraps, out to the far end of the alias period.
+static void rangeTestSweep(void)
+{
+    double  maxError = 0, sumError = 0, worstRange = 0;
+    int     numRanges = 0;
+    
+    for(double range = 0.1; range < 65.0; range += 0.173, numRanges++){
+        TagRangeEstimate    estimate;
+        double              error = rangeTestEstimate(RANGETEST_ALL_SLOTS, range, RANGETEST_PHASE_NOISE, &estimate);
+        
+        sumError += error;
+        if(error > maxError){
+            maxError    = error;
+            worstRange  = range;
+        }
+    }
+    TEST_CHECK(maxError < RANGETEST_MAX_ERROR_M, "worst error %g m at %g m", maxError, worstRange);
+    TEST_CHECK(sumError/numRanges < RANGETEST_MAX_MEAN_ERROR_M, "mean error %g m", sumError/numRanges);
+    printf("Sweep of %d ranges from 0.1m to 65m at %g rad noise: mean error %.3f m, worst %.3f m at %.1f m\n",
+           numRanges, RANGETEST_PHASE_NOISE, sumError/numRanges, maxError, worstRange);
+    
+    //Exactly on the alias of the wider steps.
+    const double    wraps[] = {24.98, 37.47, 49.97, 12.49, 62.46};
+    
+    for(size_t i=0; i<sizeof(wraps)/sizeof(wraps[0]); i++){
+        TagRangeEstimate    estimate;
+        double              error = rangeTestEstimate(RANGETEST_ALL_SLOTS, wraps[i], RANGETEST_PHASE_NOISE, &estimate);
+        
+        TEST_CHECK(error < RANGETEST_MAX_ERROR_M, "tag at %g m estimated at %g m", wraps[i], estimate.rangeMeters);
+    }
+}
+
+//Only the steps that were seen can be used. Even slots alone only have 2 slot steps, so they alias at 37.5m,
+//and every third slot alone aliases at 25m. Less the near-zero margin, that is as far as those can tell.
+static void rangeTestMissingSlots(void)
+{
+    const struct
+    {
+        uint32_t    slotMask;
+        double      maxRange;
+        double      maxError;
+        const char  *name;
+    } cases[] = {
+        {0x0155555, 35.0,   RANGETEST_MAX_ERROR_M,      "even slots"},
+        {0x16DB6DB, 65.0,   RANGETEST_MAX_ERROR_M,      "every third slot missing"},
+        {0x1249249, 22.0,   RANGETEST_MAX_ERROR_M,      "every third slot"},
+        {0x00001FF, 65.0,   RANGETEST_MAX_ERROR_M,      "lowest 9 slots"},
+        {0x1800003, 65.0,   5*RANGETEST_MAX_ERROR_M,    "two slots at each end"},   //Only 1 slot steps, and few of them.
+    };
+    
+    for(size_t i=0; i<sizeof(cases)/sizeof(cases[0]); i++){
+        double  maxError = 0, worstRange = 0;
+        
+        for(double range = 0.3; range < cases[i].maxRange; range += 1.37){
+            TagRangeEstimate    estimate;
+            double              error = rangeTestEstimate(cases[i].slotMask, range, RANGETEST_PHASE_NOISE, &estimate);
+            
+            if(error > maxError){
+                maxError    = error;
+                worstRange  = range;
+            }
+        }
+        TEST_CHECK(maxError < cases[i].maxError, "%s: worst error %g m at %g m", cases[i].name, maxError, worstRange);
+    }
+}
+
+//The old pairs fade, so the estimate follows a tag that moves, and noisier phases give less confidence.
+static void rangeTestMovingAndConfidence(void)
+{
+    TagRangeEstimator   estimator;
+    TagRangeEstimate    estimate, noisy;
+    
+    tagRangeEstimatorInit(&estimator);
+    rangeTestReads(&estimator, RANGETEST_ALL_SLOTS, 5.0, RANGETEST_PHASE_NOISE, RANGETEST_NUM_READS);
+    rangeTestReads(&estimator, RANGETEST_ALL_SLOTS, 15.0, RANGETEST_PHASE_NOISE, 100);
+    tagRangeEstimatorGetEstimate(&estimator, &estimate);
+    TEST_CHECK(fabs(estimate.rangeMeters - 15.0) < RANGETEST_MAX_ERROR_M, "moved tag estimated at %g m", estimate.rangeMeters);
+    
+    rangeTestEstimate(RANGETEST_ALL_SLOTS, 10.0, RANGETEST_PHASE_NOISE, &estimate);
+    rangeTestEstimate(RANGETEST_ALL_SLOTS, 10.0, 10*RANGETEST_PHASE_NOISE, &noisy);
+    TEST_CHECK(estimate.confidence > 0.2f && noisy.confidence < estimate.confidence/10, "confidence %g clean, %g noisy",
+               estimate.confidence, noisy.confidence);
+    TEST_CHECK(estimate.numSlots == TAG_METRICS_NUM_SLOTS, "%u slots", estimate.numSlots);
+}
+
+static void rangeTestBenchmark(void)
+{
+    TagRangeEstimator   estimator;
+    TagRangeEstimate    estimate;
+    float               phaseAnt[256];
+    uint64_t            startNs;
+    volatile float      sink = 0;
+    
+    for(int n=0; n<256; n++){
+        phaseAnt[n] = (float)(0.1 + 3*rangeTestUniform());
+    }
+    tagRangeEstimatorInit(&estimator);
+    startNs = monotonicClockNs();
+    for(uint32_t n=0; n<RANGETEST_NUM_BENCH_READS; n++){
+        tagRangeEstimatorUpdate(&estimator, (uint8_t)((n*7) % TAG_METRICS_NUM_SLOTS), phaseAnt[n & 255], 1.0f, -40.0f);
+        tagRangeEstimatorGetEstimate(&estimator, &estimate);
+        sink += estimate.rangeMeters;
+    }
+    printf("Update and estimate: %.1f ns per read\n", (double)(monotonicClockNs()-startNs)/RANGETEST_NUM_BENCH_READS);
+    (void)sink;
+}
+
+int main(void)
+{
+    rangeTestEmpty();
+    rangeTestNearZero();
+    rangeTestSweep();
+    rangeTestMissingSlots();
+    rangeTestMovingAndConfidence();
+    rangeTestBenchmark();
+    
+    return testCheckExit("rangetest");
+}
@@ -0,0 +1,379 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: readerstest.c                                                             //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Test of several reader sessions draining into one tag store at once: every read //
+//  is merged to the right row and reader and timed on the shared latency probe's   //
+//  clock without marking it, what one reader sees stays its own, a cleared store   //
+//  clears each session's tags, a reused reader ID starts afresh, and throughput    //
+//  holds up as readers are added.                                                  //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o readerstest Tools/readerstest.c                       //
+//  SURFERControl/ReaderSession.c SURFERControl/TagPacketDecoder.c                  //
+//  SURFERControl/TagStore.c SURFERControl/EPCIndex.c SURFERControl/TagMetrics.c    //
+//  SURFERControl/TagRangeEstimator.c SURFERControl/LatencyProbe.c                  //
+//  SURFERControl/MonotonicClock.c -lm -lpthread                                    //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "ReaderSession.h"
+#include "TagMetrics.h"
+#include "MonotonicClock.h"
+#include "testcheck.h"
+
+#define READERSTEST_NUM_TAGS        1000
+#define READERSTEST_NUM_ROUNDS      40      //Reads of each tag by each reader.
+#define READERSTEST_NUM_SLOTS       25
+#define READERSTEST_MAX_READERS     4
+#define READERSTEST_QUEUE_CAPACITY  256
+
+static void readersTestPutBE32(uint8_t *bytes, int32_t value)
+{
+    bytes[0]    =   (uint8_t)((uint32_t)value >> 24);
+    bytes[1]    =   (uint8_t)((uint32_t)value >> 16);
+    bytes[2]    =   (uint8_t)((uint32_t)value >> 8);
+    bytes[3]    =   (uint8_t)((uint32_t)value >> 0);
+}
+
+//One read of a tag as the reader firmware lays it out in its two packets. The antenna phase turns with the slot, as it
+//would for a tag some way off, so that the session's range estimator has something to work with.
+static void readersTestPack(uint32_t tag, uint8_t slot, uint8_t dataId, uint8_t pkt1[TAG_PKT1_NUM_BYTES],
+                            uint8_t pkt2[TAG_PKT2_NUM_BYTES])
+{
+    uint8_t antI[4], antQ[4];
+    double  phase = 0.4*slot;
+    
+    readersTestPutBE32(antI, (int32_t)(1000000*cos(phase)));
+    readersTestPutBE32(antQ, (int32_t)(1000000*sin(phase)));
+    memset(pkt1, 0, TAG_PKT1_NUM_BYTES);
+    readersTestPutBE32(pkt1, (int32_t)tag);
+    pkt1[12]    =   (uint8_t)(128 + slot);
+    memcpy(&pkt1[13], antI, 3);
+    memcpy(&pkt1[16], antQ, 3);
+    pkt1[19]    =   dataId;
+    
+    memset(pkt2, 0, TAG_PKT2_NUM_BYTES);
+    pkt2[1]     =   antI[3];
+    pkt2[2]     =   antQ[3];
+    readersTestPutBE32(&pkt2[4], 30000000);
+    readersTestPutBE32(&pkt2[8], 40000000);
+    pkt2[12]    =   255;
+    pkt2[14]    =   slot;
+    pkt2[15]    =   (uint8_t)(dataId+1);
+}
+
+static void readersTestPush(ReaderSession *session, uint32_t tag, uint8_t slot)
+{
+    uint8_t pkt1[TAG_PKT1_NUM_BYTES], pkt2[TAG_PKT2_NUM_BYTES];
+    uint8_t dataId = (uint8_t)session->numPushed;   //Two packets per read, so the IDs run on without a gap.
+    
+    readersTestPack(tag, slot, dataId, pkt1, pkt2);
+    readerSessionPush(session, READER_PACKET_PKT1, pkt1, sizeof(pkt1), monotonicClockNs());
+    readerSessionPush(session, READER_PACKET_PKT2, pkt2, sizeof(pkt2), monotonicClockNs());
+}
+
+static void readersTestEPC(uint32_t tag, uint8_t epc[TAG_EPC_NUM_BYTES])
+{
+    memset(epc, 0, TAG_EPC_NUM_BYTES);
+    readersTestPutBE32(epc, (int32_t)tag);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Several readers at once
+
+typedef struct
+{
+    ReaderSession   session;
+    TagStore        *store;
+    uint32_t        numReads;       //Handed to the handler.
+    uint32_t        numWrongReads;  //Handed over with a row holding some other tag, or with the wrong reader.
+    uint32_t        numUntimedReads;
+} ReadersTestReader;
+
+//Every read handed over has to be at the row the store keeps its tag in, under the reader that read it.
+static void readersTestHandle(void *context, ReaderSession *session, uint32_t flags, const TagRead *read,
+                              const TagStoreObservation *observation)
+{
+    ReadersTestReader   *reader = context;
+    TagStoreRecord      record;
+    
+    if(!(flags & TAG_DECODE_READ_READY)){
+        reader->numWrongReads++;
+        return;
+    }
+    reader->numReads++;
+    if(!tagStoreCopyRecord(reader->store, observation->row, &record) || memcmp(record.epc, read->epc, TAG_EPC_NUM_BYTES)
+       || observation->readerId != session->readerId || !(record.readerMask & (1u << session->readerId))){
+        reader->numWrongReads++;
+    }
+    reader->numUntimedReads += observation->decodedNs == 0;
+}
+
+//Each reader goes round the tags in its own order, draining whenever its queue is close to full, as its drain queue
+//would between bursts of notifications.
+static void *readersTestRun(void *argument)
+{
+    ReadersTestReader   *reader = argument;
+    uint32_t            offset  = 97*reader->session.readerId;
+    
+    for(uint32_t round=0; round<READERSTEST_NUM_ROUNDS; round++){
+        for(uint32_t i=0; i<READERSTEST_NUM_TAGS; i++){
+            if(readerSessionNumQueued(&reader->session)+2 > reader->session.queueMask+1){
+                readerSessionDrain(&reader->session, reader->store, UINT32_MAX, readersTestHandle, reader);
+            }
+            readersTestPush(&reader->session, (i+offset) % READERSTEST_NUM_TAGS, (uint8_t)(round % READERSTEST_NUM_SLOTS));
+        }
+    }
+    readerSessionDrain(&reader->session, reader->store, UINT32_MAX, readersTestHandle, reader);
+    
+    return NULL;
+}
+
+//Returns the reads merged per second, over all of the readers.
+static double readersTestMerge(uint32_t numReaders)
+{
+    ReadersTestReader   readers[READERSTEST_MAX_READERS];
+    pthread_t           threads[READERSTEST_MAX_READERS];
+    TagStore            store;
+    LatencyProbe        probe;
+    uint32_t            numReads = 0, numWrongReads = 0, numUntimedReads = 0, numWrongRecords = 0;
+    uint64_t            startNs, elapsedNs;
+    
+    TEST_CHECK(tagStoreInit(&store), "could not set up the store");
+    //As in the app, every session times its reads on the one probe, and leaves marking it to whoever saves the reads.
+    latencyProbeInit(&probe, NULL, NULL);
+    latencyProbeSetEnabled(&probe, true);
+    for(uint32_t r=0; r<numReaders; r++){
+        memset(&readers[r], 0, sizeof(ReadersTestReader));
+        TEST_CHECK(readerSessionInit(&readers[r].session, (uint8_t)r, READERSTEST_QUEUE_CAPACITY), "could not set up reader %u", r);
+        readers[r].store                = &store;
+        readers[r].session.latencyProbe = &probe;
+    }
+    
+    startNs = monotonicClockNs();
+    for(uint32_t r=0; r<numReaders; r++){
+        pthread_create(&threads[r], NULL, readersTestRun, &readers[r]);
+    }
+    for(uint32_t r=0; r<numReaders; r++){
+        pthread_join(threads[r], NULL);
+    }
+    elapsedNs = monotonicClockNs()-startNs;
+    
+    for(uint32_t r=0; r<numReaders; r++){
+        numReads        += readers[r].numReads;
+        numWrongReads   += readers[r].numWrongReads;
+        numUntimedReads += readers[r].numUntimedReads;
+        TEST_CHECK(readers[r].session.numDropped == 0, "reader %u dropped %llu notifications", r,
+                   (unsigned long long)readers[r].session.numDropped);
+    }
+    TEST_CHECK(numReads == numReaders*READERSTEST_NUM_TAGS*READERSTEST_NUM_ROUNDS && numWrongReads == 0,
+               "%u readers: %u reads, %u wrong", numReaders, numReads, numWrongReads);
+    TEST_CHECK(numUntimedReads == 0 && probe.stages[LATENCY_STAGE_DECODED].numSamples == 0 && probe.notifyNs == 0,
+               "%u readers: %u reads not timed, %llu marked on the probe by the drains", numReaders, numUntimedReads,
+               (unsigned long long)probe.stages[LATENCY_STAGE_DECODED].numSamples);
+    TEST_CHECK(tagStoreNumTags(&store) == READERSTEST_NUM_TAGS && store.numObservations == numReads,
+               "%u readers: %u tags, %llu observations", numReaders, tagStoreNumTags(&store),
+               (unsigned long long)store.numObservations);
+    
+    //Every reader saw every tag the same number of times, and has a range for it by now.
+    for(uint32_t row=0; row<READERSTEST_NUM_TAGS; row++){
+        TagStoreRecord  record;
+        bool            right = tagStoreCopyRecord(&store, (int32_t)row, &record) && record.readerMask == (1u << numReaders)-1;
+        
+        for(uint32_t r=0; right && r<numReaders; r++){
+            right = record.readers[r].numReads == READERSTEST_NUM_ROUNDS && record.readers[r].rangeMeters != TAG_METRICS_RANGE_INVALID;
+        }
+        numWrongRecords += !right;
+    }
+    TEST_CHECK(numWrongRecords == 0, "%u readers: %u records with the wrong reads", numReaders, numWrongRecords);
+    
+    for(uint32_t r=0; r<numReaders; r++){
+        readerSessionFree(&readers[r].session);
+    }
+    tagStoreFree(&store);
+    
+    return numReads/(elapsedNs/1e9);
+}
+
+//With more readers than CPUs the readers take turns, so the total can't go up, but it mustn't fall away either, as it
+//would if they spent their time waiting on the store's lock. With a CPU each they should mostly run side by side.
+static void readersTestScaling(void)
+{
+    long    numCPUs         = sysconf(_SC_NPROCESSORS_ONLN);
+    double  oneReaderRate   = readersTestMerge(1);
+    
+    for(uint32_t numReaders=2; numReaders<=READERSTEST_MAX_READERS; numReaders*=2){
+        double  rate        = readersTestMerge(numReaders);
+        double  parallel    = numCPUs < (long)numReaders ? (numCPUs > 1 ? numCPUs : 1) : numReaders;
+        
+        printf("%u readers: %.0f reads/s in total, %.2fx one reader, %ld CPUs online\n", numReaders, rate,
+               rate/oneReaderRate, numCPUs);
+        TEST_CHECK(rate >= 0.5*parallel*oneReaderRate, "%u readers only merged %.0f reads/s against %.0f for one",
+                   numReaders, rate, oneReaderRate);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Clearing and reader IDs
+
+static void readersTestRecord(TagStore *store, uint32_t tag, TagStoreRecord *record)
+{
+    uint8_t epc[TAG_EPC_NUM_BYTES];
+    
+    readersTestEPC(tag, epc);
+    if(tagStoreFindRecord(store, epc, record) == EPC_INDEX_NOT_FOUND){
+        memset(record, 0, sizeof(TagStoreRecord));
+    }
+}
+
+//Once the store is cleared, the next drain starts the session's tags over, so a tag read again has to build its range
+//up again rather than carry on from what the session knew before the clear.
+static void readersTestClear(void)
+{
+    ReaderSession   session;
+    TagStore        store;
+    TagStoreRecord  record;
+    
+    TEST_CHECK(readerSessionInit(&session, 0, READERSTEST_QUEUE_CAPACITY) && tagStoreInit(&store), "could not set up the session");
+    
+    for(uint8_t slot=0; slot<READERSTEST_NUM_SLOTS; slot++){
+        readersTestPush(&session, 0, slot);
+        readersTestPush(&session, 1, slot);
+    }
+    readerSessionDrain(&session, &store, UINT32_MAX, NULL, NULL);
+    readersTestRecord(&store, 0, &record);
+    TEST_CHECK(record.readers[0].rangeMeters != TAG_METRICS_RANGE_INVALID, "no range before the clear");
+    
+    tagStoreClear(&store);
+    readerSessionDrain(&session, &store, UINT32_MAX, NULL, NULL);
+    TEST_CHECK(session.tagIndex.count == 0, "session still has %u tags after the store was cleared", session.tagIndex.count);
+    
+    readersTestPush(&session, 0, 3);
+    readerSessionDrain(&session, &store, UINT32_MAX, NULL, NULL);
+    readersTestRecord(&store, 0, &record);
+    TEST_CHECK(tagStoreNumTags(&store) == 1 && session.tagIndex.count == 1, "%u tags in the store, %u in the session",
+               tagStoreNumTags(&store), session.tagIndex.count);
+    TEST_CHECK(record.readers[0].numReads == 1 && record.readers[0].rangeMeters == TAG_METRICS_RANGE_INVALID,
+               "range %g from one read after the clear", record.readers[0].rangeMeters);
+    
+    readerSessionFree(&session);
+    tagStoreFree(&store);
+}
+
+//A reader that connects with the ID of one that went away mustn't be credited with what the old one saw.
+static void readersTestReusedId(void)
+{
+    ReaderSession   first, second, reused;
+    TagStore        store;
+    TagStoreRecord  record;
+    
+    TEST_CHECK(readerSessionInit(&first, 0, READERSTEST_QUEUE_CAPACITY) && readerSessionInit(&second, 1, READERSTEST_QUEUE_CAPACITY)
+               && tagStoreInit(&store), "could not set up the sessions");
+    
+    for(uint8_t slot=0; slot<READERSTEST_NUM_SLOTS; slot++){
+        readersTestPush(&first, 0, slot);
+        readersTestPush(&second, 0, slot);
+    }
+    readerSessionDrain(&first, &store, UINT32_MAX, NULL, NULL);
+    readerSessionDrain(&second, &store, UINT32_MAX, NULL, NULL);
+    readersTestRecord(&store, 0, &record);
+    TEST_CHECK(record.readerMask == 3 && record.readers[1].numReads == READERSTEST_NUM_SLOTS, "mask %x", record.readerMask);
+    
+    //Reader 1 goes away and a new reader is given its ID.
+    readerSessionFree(&second);
+    tagStoreForgetReader(&store, 1);
+    readersTestRecord(&store, 0, &record);
+    TEST_CHECK(record.readerMask == 1 && record.readers[1].numReads == 0 && record.readers[1].rangeMeters == TAG_METRICS_RANGE_INVALID
+               && tagStoreRecordNumReaders(&record) == 1 && tagStoreRecordBestReader(&record) == 0,
+               "reader 1 still has %u reads, mask %x", record.readers[1].numReads, record.readerMask);
+    TEST_CHECK(record.readers[0].numReads == READERSTEST_NUM_SLOTS, "reader 0 lost its reads");
+    
+    TEST_CHECK(readerSessionInit(&reused, 1, READERSTEST_QUEUE_CAPACITY), "could not set up the new reader");
+    readersTestPush(&reused, 0, 7);
+    readerSessionDrain(&reused, &store, UINT32_MAX, NULL, NULL);
+    readersTestRecord(&store, 0, &record);
+    TEST_CHECK(record.readerMask == 3 && record.readers[1].numReads == 1 && record.readers[1].rangeMeters == TAG_METRICS_RANGE_INVALID,
+               "new reader 1 has %u reads", record.readers[1].numReads);
+    
+    tagStoreForgetReader(&store, TAG_STORE_NO_READER);
+    
+    readerSessionFree(&first);
+    readerSessionFree(&reused);
+    tagStoreFree(&store);
+}
+
+//Only a read that went into the session's range is flagged as a new range measurement. One with no calibration data
+//leaves the range as it was, and a tracking filter fed it would take the same range twice.
+static void readersTestCaptureRangeUpdated(void *context, ReaderSession *session, uint32_t flags, const TagRead *read,
+                                           const TagStoreObservation *observation)
+{
+    uint32_t *updated = context;
+    
+    (void)session;
+    (void)read;
+    if(flags & TAG_DECODE_READ_READY){
+        *updated = (*updated << 1) | observation->rangeUpdated;
+    }
+}
+
+static void readersTestRangeUpdated(void)
+{
+    ReaderSession   session;
+    TagStore        store;
+    uint8_t         pkt1[TAG_PKT1_NUM_BYTES], pkt2[TAG_PKT2_NUM_BYTES];
+    uint32_t        updated = 0;
+    
+    TEST_CHECK(readerSessionInit(&session, 0, READERSTEST_QUEUE_CAPACITY) && tagStoreInit(&store), "could not set up the session");
+    
+    readersTestPush(&session, 0, 3);
+    readersTestPack(0, 4, (uint8_t)session.numPushed, pkt1, pkt2);
+    memset(&pkt2[4], 0, 8);
+    readerSessionPush(&session, READER_PACKET_PKT1, pkt1, sizeof(pkt1), 0);
+    readerSessionPush(&session, READER_PACKET_PKT2, pkt2, sizeof(pkt2), 0);
+    readersTestPush(&session, 0, 5);
+    readerSessionDrain(&session, &store, UINT32_MAX, readersTestCaptureRangeUpdated, &updated);
+    TEST_CHECK(updated == 5, "range updated flags %x, not 101", updated);
+    
+    readerSessionFree(&session);
+    tagStoreFree(&store);
+}
+
+int main(void)
+{
+    readersTestClear();
+    readersTestRangeUpdated();
+    readersTestReusedId();
+    readersTestScaling();
+    
+    return testCheckExit("readerstest");
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+#
+#  Builds and runs every test program in Tools on Linux/macOS, using the build line at the top of each one.
+#  Run from the top of the repository. Extra arguments are passed to cc, for example -fsanitize=address,undefined.
+#  Exits nonzero if any test fails to build or fails a check.
+#
+
+cd "$(dirname "$0")/.." || exit 1
+
+BUILD_DIR="${TMPDIR:-/tmp}/surfer-tests"
+mkdir -p "$BUILD_DIR" || exit 1
+
+failed=""
+for test in Tools/*test.c; do
+    name=$(basename "$test" .c)
+    #The build line starts at "cc" and runs on until the blank line that closes the description.
+    command=$(sed -n '/^\/\/  cc /,/^\/\/ *\/\/$/p' "$test" | sed -e 's|^//  ||' -e 's|//$||' | tr '\n' ' ')
+    command=$(echo "$command" | sed "s| -o $name | -o $BUILD_DIR/$name |")
+    echo "== $name"
+    if ! $command "$@"; then
+        failed="$failed $name(build)"
+    elif ! "$BUILD_DIR/$name"; then
+        failed="$failed $name"
+    fi
+done
+
+if [ -n "$failed" ]; then
+    echo "Failed:$failed"
+    exit 1
+fi
+echo "All tests passed"
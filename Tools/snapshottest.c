@@ -0,0 +1,334 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: snapshottest.c                                                            //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Test of TagSnapshot: every snapshot published has exactly the writer's rows,    //
+//  whether the spare was brought up to date or a new one was made, a publish only  //
+//  copies the rows edited since the spare was current, and readers on other        //
+//  threads never see a torn row or a snapshot that doesn't match its version.      //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o snapshottest Tools/snapshottest.c                     //
+//  SURFERControl/TagSnapshot.c SURFERControl/MonotonicClock.c -lpthread            //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "TagSnapshot.h"
+#include "MonotonicClock.h"
+#include "testcheck.h"
+
+#define SNAPSHOTTEST_NUM_PUBLISHES      4000
+#define SNAPSHOTTEST_EDITS_PER_PUBLISH  20
+#define SNAPSHOTTEST_CLEAR_INTERVAL     1500    //Publishes between clears of the list.
+#define SNAPSHOTTEST_NUM_READERS        3
+#define SNAPSHOTTEST_NUM_EXPECTED       1024    //Recent versions the readers can check a snapshot against.
+#define SNAPSHOTTEST_BENCH_ROWS         100000
+#define SNAPSHOTTEST_BENCH_EDITS        100
+#define SNAPSHOTTEST_BENCH_PUBLISHES    200
+
+static uint32_t snapshotTestRandom(uint32_t *state)
+{
+    *state = *state*1664525u + 1013904223u;
+    
+    return *state >> 8;
+}
+
+//Every field of a row comes from one stamp, so a row copied while it was being written shows up as a mix of two.
+static void snapshotTestWriteRow(TagSnapshotRow *row, uint32_t number, uint32_t stamp)
+{
+    snprintf(row->epc, sizeof(row->epc), "%024x", stamp);
+    memset(row->epcBytes, (int)(stamp & 0xFF), sizeof(row->epcBytes));
+    row->rangeReaderId              = (uint8_t)stamp;
+    row->numReaders                 = (uint8_t)(stamp >> 8);
+    row->rssidBm                    = (float)stamp;
+    row->rangeMeters                = -(float)stamp;
+    row->rangeConfidence            = (float)(stamp & 0xFFFF);
+    row->rangeRateMetersPerSecond   = (float)(stamp >> 16);
+    row->firstSeen                  = number;
+    row->lastSeen                   = stamp;
+}
+
+//Field by field, since the padding needn't have been copied.
+static bool snapshotTestSameRow(const TagSnapshotRow *a, const TagSnapshotRow *b)
+{
+    return !strcmp(a->epc, b->epc) && !memcmp(a->epcBytes, b->epcBytes, sizeof(a->epcBytes)) && a->rangeReaderId == b->rangeReaderId && a->numReaders == b->numReaders
+           && a->rssidBm == b->rssidBm && a->rangeMeters == b->rangeMeters && a->rangeConfidence == b->rangeConfidence
+           && a->rangeRateMetersPerSecond == b->rangeRateMetersPerSecond && a->firstSeen == b->firstSeen
+           && a->lastSeen == b->lastSeen;
+}
+
+//Returns the stamp, or UINT32_MAX if the row is torn.
+static uint32_t snapshotTestCheckRow(const TagSnapshotRow *row, uint32_t number)
+{
+    TagSnapshotRow  expected;
+    uint32_t        stamp = (uint32_t)row->lastSeen;
+    
+    snapshotTestWriteRow(&expected, number, stamp);
+    
+    return snapshotTestSameRow(row, &expected) ? stamp : UINT32_MAX;
+}
+
+//Rows are edited at random, with a new row now and then and a clear every so often, as the tag list would.
+typedef struct
+{
+    TagSnapshotPublisher    publisher;
+    uint32_t                random;
+    uint64_t                expected[SNAPSHOTTEST_NUM_EXPECTED];   //The version in the top half, the sum of its stamps below.
+    uint32_t                *stamps;
+    uint32_t                stampSum;
+    bool                    done;
+} SnapshotTestWriter;
+
+static void snapshotTestEdit(SnapshotTestWriter *writer)
+{
+    TagSnapshotPublisher    *publisher  = &writer->publisher;
+    uint32_t                stamp       = (uint32_t)publisher->current->version+1;
+    
+    if(publisher->numRows && (publisher->current->version % SNAPSHOTTEST_CLEAR_INTERVAL) == 0){
+        tagSnapshotPublisherClear(publisher);
+        writer->stampSum = 0;
+    }
+    for(uint32_t i=0; i<SNAPSHOTTEST_EDITS_PER_PUBLISH; i++){
+        uint32_t row = snapshotTestRandom(&writer->random) % (publisher->numRows+1);
+        
+        //Mostly edits, a new row now and then.
+        if(row == publisher->numRows && snapshotTestRandom(&writer->random) % 2){
+            row = publisher->numRows ? row-1 : 0;
+        }
+        if(row < publisher->numRows){
+            writer->stampSum -= writer->stamps[row];
+        }
+        snapshotTestWriteRow(tagSnapshotPublisherEditRow(publisher, row), row, stamp);
+        writer->stamps[row] = stamp;
+        writer->stampSum    += stamp;
+    }
+    __atomic_store_n(&writer->expected[stamp % SNAPSHOTTEST_NUM_EXPECTED], ((uint64_t)stamp << 32) | writer->stampSum,
+                     __ATOMIC_RELEASE);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Contents
+
+//Some snapshots are held on to for a while, so that some publishes have a spare to bring up to date and some don't.
+static void snapshotTestContents(void)
+{
+    SnapshotTestWriter  writer;
+    TagSnapshot         *held = NULL;
+    uint32_t            numWrong = 0, numHeld = 0;
+    
+    memset(&writer, 0, sizeof(writer));
+    writer.stamps = calloc(SNAPSHOTTEST_NUM_PUBLISHES*SNAPSHOTTEST_EDITS_PER_PUBLISH, sizeof(uint32_t));
+    TEST_CHECK(writer.stamps && tagSnapshotPublisherInit(&writer.publisher), "could not set up the publisher");
+    
+    for(uint32_t i=0; i<SNAPSHOTTEST_NUM_PUBLISHES; i++){
+        TagSnapshot *snapshot;
+        bool        same;
+        
+        snapshotTestEdit(&writer);
+        numWrong += !tagSnapshotPublish(&writer.publisher);
+        
+        snapshot    = tagSnapshotAcquire(&writer.publisher);
+        same        = snapshot->numRows == writer.publisher.numRows && snapshot->version == i+1;
+        for(uint32_t row=0; same && row<snapshot->numRows; row++){
+            same = snapshotTestSameRow(&snapshot->rows[row], &writer.publisher.rows[row]);
+        }
+        numWrong += !same;
+        if(snapshotTestRandom(&writer.random) % 4 == 0){
+            tagSnapshotRelease(held);
+            held = snapshot;
+            numHeld++;
+        } else {
+            tagSnapshotRelease(snapshot);
+        }
+    }
+    TEST_CHECK(numWrong == 0 && numHeld > 0, "%u of %u snapshots didn't match the writer's rows", numWrong, SNAPSHOTTEST_NUM_PUBLISHES);
+    
+    //Publishing with nothing changed keeps the snapshot.
+    uint64_t version = writer.publisher.current->version;
+    
+    TEST_CHECK(tagSnapshotPublish(&writer.publisher) && writer.publisher.current->version == version, "empty publish");
+    
+    tagSnapshotRelease(held);
+    tagSnapshotPublisherFree(&writer.publisher);
+    free(writer.stamps);
+}
+
+//With a spare to write over, a few rows edited out of a great many only costs those rows.
+static void snapshotTestCopyCost(void)
+{
+    TagSnapshotPublisher    publisher;
+    uint32_t                random = 1;
+    uint64_t                startNs, incrementalNs, fullNs, numCopied;
+    
+    TEST_CHECK(tagSnapshotPublisherInit(&publisher), "could not set up the publisher");
+    for(uint32_t row=0; row<SNAPSHOTTEST_BENCH_ROWS; row++){
+        snapshotTestWriteRow(tagSnapshotPublisherEditRow(&publisher, row), row, 1);
+    }
+    tagSnapshotPublish(&publisher);
+    
+    numCopied   = publisher.numRowsCopied;
+    startNs     = monotonicClockNs();
+    for(uint32_t i=0; i<SNAPSHOTTEST_BENCH_PUBLISHES; i++){
+        for(uint32_t e=0; e<SNAPSHOTTEST_BENCH_EDITS; e++){
+            uint32_t row = snapshotTestRandom(&random) % SNAPSHOTTEST_BENCH_ROWS;
+            
+            snapshotTestWriteRow(tagSnapshotPublisherEditRow(&publisher, row), row, i+2);
+        }
+        tagSnapshotPublish(&publisher);
+    }
+    incrementalNs   = (monotonicClockNs()-startNs)/SNAPSHOTTEST_BENCH_PUBLISHES;
+    numCopied       = publisher.numRowsCopied-numCopied;
+    
+    //The first one after the full publish has no spare yet. After that, each copies this publish's rows and the last's.
+    TEST_CHECK(numCopied <= SNAPSHOTTEST_BENCH_ROWS + 2*SNAPSHOTTEST_BENCH_EDITS*SNAPSHOTTEST_BENCH_PUBLISHES,
+               "%llu rows copied over %u publishes", (unsigned long long)numCopied, SNAPSHOTTEST_BENCH_PUBLISHES);
+    
+    //The same publishes each copying the whole list, as they would if every snapshot were still held by a reader.
+    startNs = monotonicClockNs();
+    for(uint32_t i=0; i<SNAPSHOTTEST_BENCH_PUBLISHES; i++){
+        TagSnapshot *held = tagSnapshotAcquire(&publisher);
+        
+        for(uint32_t e=0; e<SNAPSHOTTEST_BENCH_EDITS; e++){
+            uint32_t row = snapshotTestRandom(&random) % SNAPSHOTTEST_BENCH_ROWS;
+            
+            snapshotTestWriteRow(tagSnapshotPublisherEditRow(&publisher, row), row, i+2);
+        }
+        tagSnapshotPublish(&publisher);
+        tagSnapshotRelease(held);
+    }
+    fullNs = (monotonicClockNs()-startNs)/SNAPSHOTTEST_BENCH_PUBLISHES;
+    
+    printf("Publishing %u edited rows of %u: %.1f us copying only those, %.1f us copying every row\n",
+           SNAPSHOTTEST_BENCH_EDITS, SNAPSHOTTEST_BENCH_ROWS, incrementalNs/1e3, fullNs/1e3);
+    
+    tagSnapshotPublisherFree(&publisher);
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//One writer, several readers
+
+typedef struct
+{
+    SnapshotTestWriter  *writer;
+    uint32_t            numSnapshots;
+    uint32_t            numChecked;     //Against the sum of stamps the writer recorded for the version.
+    uint32_t            numTorn;
+    uint32_t            numWrong;
+} SnapshotTestReader;
+
+static void *snapshotTestRead(void *argument)
+{
+    SnapshotTestReader  *reader         = argument;
+    uint64_t            lastVersion     = 0;
+    
+    while(!__atomic_load_n(&reader->writer->done, __ATOMIC_ACQUIRE)){
+        TagSnapshot *snapshot   = tagSnapshotAcquire(&reader->writer->publisher);
+        uint32_t    stampSum    = 0;
+        uint64_t    expected;
+        
+        for(uint32_t row=0; row<snapshot->numRows; row++){
+            uint32_t stamp = snapshotTestCheckRow(&snapshot->rows[row], row);
+            
+            if(stamp == UINT32_MAX){
+                reader->numTorn++;
+            } else if(stamp > snapshot->version){
+                reader->numWrong++;     //A row from a later version than the snapshot.
+            }
+            stampSum += stamp;
+        }
+        reader->numWrong += snapshot->version < lastVersion;
+        lastVersion = snapshot->version;
+        
+        expected = __atomic_load_n(&reader->writer->expected[snapshot->version % SNAPSHOTTEST_NUM_EXPECTED], __ATOMIC_ACQUIRE);
+        if(snapshot->version && (expected >> 32) == snapshot->version){
+            reader->numWrong += (uint32_t)expected != stampSum;
+            reader->numChecked++;
+        }
+        reader->numSnapshots++;
+        
+        //Hold on now and then, so that the writer sometimes has no spare.
+        if(reader->numSnapshots % 3 == 0){
+            sched_yield();
+        }
+        tagSnapshotRelease(snapshot);
+    }
+    
+    return NULL;
+}
+
+static void snapshotTestThreads(void)
+{
+    SnapshotTestWriter  writer;
+    SnapshotTestReader  readers[SNAPSHOTTEST_NUM_READERS];
+    pthread_t           threads[SNAPSHOTTEST_NUM_READERS];
+    uint32_t            numSnapshots = 0, numChecked = 0, numTorn = 0, numWrong = 0;
+    
+    memset(&writer, 0, sizeof(writer));
+    memset(readers, 0, sizeof(readers));
+    writer.random   = 7;
+    writer.stamps   = calloc(SNAPSHOTTEST_NUM_PUBLISHES*SNAPSHOTTEST_EDITS_PER_PUBLISH, sizeof(uint32_t));
+    TEST_CHECK(writer.stamps && tagSnapshotPublisherInit(&writer.publisher), "could not set up the publisher");
+    
+    for(uint32_t r=0; r<SNAPSHOTTEST_NUM_READERS; r++){
+        readers[r].writer = &writer;
+        pthread_create(&threads[r], NULL, snapshotTestRead, &readers[r]);
+    }
+    for(uint32_t i=0; i<SNAPSHOTTEST_NUM_PUBLISHES; i++){
+        snapshotTestEdit(&writer);
+        tagSnapshotPublish(&writer.publisher);
+        if(i % 8 == 0){
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&writer.done, true, __ATOMIC_RELEASE);
+    for(uint32_t r=0; r<SNAPSHOTTEST_NUM_READERS; r++){
+        pthread_join(threads[r], NULL);
+        numSnapshots    += readers[r].numSnapshots;
+        numChecked      += readers[r].numChecked;
+        numTorn         += readers[r].numTorn;
+        numWrong        += readers[r].numWrong;
+    }
+    
+    printf("%u readers took %u snapshots, %u checked against their version\n", SNAPSHOTTEST_NUM_READERS, numSnapshots, numChecked);
+    TEST_CHECK(numTorn == 0 && numWrong == 0, "%u torn rows, %u snapshots that didn't match their version", numTorn, numWrong);
+    TEST_CHECK(numChecked > 0, "no snapshot was checked against its version");
+    
+    tagSnapshotPublisherFree(&writer.publisher);
+    free(writer.stamps);
+}
+
+int main(void)
+{
+    snapshotTestContents();
+    snapshotTestCopyCost();
+    snapshotTestThreads();
+    
+    return testCheckExit("snapshottest");
+}
@@ -0,0 +1,60 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: testcheck.h                                                               //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Checks shared by the test programs in Tools. A failed check prints where it     //
+//  was and what was expected, and the program carries on so that one run lists     //
+//  every failure. testCheckExit gives the exit status for main.                    //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef testcheck_h
+#define testcheck_h
+
+#include <stdio.h>
+#include <stdint.h>
+
+static uint32_t testCheckNumChecks;
+static uint32_t testCheckNumFailures;
+
+#define TEST_CHECK(condition, ...)                                                      \
+    do{                                                                                 \
+        testCheckNumChecks++;                                                           \
+        if(!(condition)){                                                               \
+            testCheckNumFailures++;                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #condition); \
+            fprintf(stderr, __VA_ARGS__);                                               \
+            fprintf(stderr, "\n");                                                      \
+        }                                                                               \
+    } while(0)
+
+static inline int testCheckExit(const char *name)
+{
+    printf("%s: %u checks, %u failed\n", name, testCheckNumChecks, testCheckNumFailures);
+    
+    return testCheckNumFailures ? 1 : 0;
+}
+
+#endif /* testcheck_h */
@@ -0,0 +1,598 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: tracereplay.c                                                             //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Headless replay of a BTLE trace recorded by the app (.surftrace). The trace is  //
+//  fed through the packet decoder, a C tag list built on the EPC index, and the    //
+//  RSSI, phase and PDOA range math, and throughput and per-stage CPU time are      //
+//  reported. It can also write a made-up inventory trace for benchmarking, and     //
+//  replay a trace as several readers at once merged into one tag store.            //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o tracereplay Tools/tracereplay.c                       //
+//  SURFERControl/MonotonicClock.c                                                  //
+//  SURFERControl/BTLETrace.c SURFERControl/TagPacketDecoder.c                      //
+//  SURFERControl/EPCIndex.c SURFERControl/TagMetrics.c                             //
+//  SURFERControl/TagRangeEstimator.c SURFERControl/TagStore.c                      //
+//  SURFERControl/ReaderSession.c SURFERControl/LatencyProbe.c -lm -lpthread        //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "BTLETrace.h"
+#include "MonotonicClock.h"
+#include "TagPacketDecoder.h"
+#include "EPCIndex.h"
+#include "TagMetrics.h"
+#include "TagRangeEstimator.h"
+#include "TagStore.h"
+#include "ReaderSession.h"
+
+//Reader states as sent on the read state characteristic. These mirror AppState in TableViewController.m.
+#define READER_IDLE_CONFIGURED  1
+#define READER_INVENTORYING     5
+
+typedef enum
+{
+    STAGE_DECODE    =   0,  //Reassembling PKT1/PKT2 into tag reads.
+    STAGE_TAG_LIST  =   1,  //Finding or adding the tag for each read.
+    STAGE_METRICS   =   2,  //RSSI, phase, hop/skip PDOA and the multi-frequency range.
+    NUM_STAGES      =   3
+} ReplayStage;
+
+static const char *replayStageNames[NUM_STAGES] = {"decode", "tag list", "metrics"};
+
+//The parts of the tag list's TagRecord that the ingest path fills in.
+typedef struct
+{
+    uint8_t             epc[TAG_EPC_NUM_BYTES];
+    TagPDOAMeasurement  hop;
+    TagPDOAMeasurement  skip;
+    float               rssidBm;
+    float               rangeMeters;
+    float               rangeConfidence;
+    uint32_t            numReads;
+    TagRangeEstimator   rangeEstimator;
+} ReplayTag;
+
+//Records are replayed in batches, with each stage run over the whole batch in turn.
+//That way the stage CPU times only cost three clock reads per batch rather than per read.
+#define REPLAY_BATCH_RECORDS    4096
+
+typedef struct
+{
+    TagPacketDecoder    decoder;
+    EPCIndex            epcIndex;
+    ReplayTag           *tags;
+    uint32_t            tagCapacity;
+    uint64_t            numReads;
+    uint64_t            numNotifications[BTLE_TRACE_NUM_CHANNELS];
+    uint64_t            numBytes[BTLE_TRACE_NUM_CHANNELS];
+    uint64_t            stageNs[NUM_STAGES];
+    //Per batch
+    BTLETraceRecord     *records;
+    TagRead             *reads;
+    int32_t             *rows;
+} Replay;
+
+static uint64_t replayCPUNs(void)
+{
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    
+    return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Replay
+
+static int32_t replayFindOrCreateTag(Replay *replay, const uint8_t *epc)
+{
+    bool    inserted;
+    int32_t row = epcIndexFindOrInsert(&replay->epcIndex, epc, &inserted);
+    
+    if(row == EPC_INDEX_NOT_FOUND){
+        return EPC_INDEX_NOT_FOUND;
+    }
+    
+    if((uint32_t)row >= replay->tagCapacity){
+        uint32_t    newCapacity = replay->tagCapacity ? 2*replay->tagCapacity : 256;
+        ReplayTag   *tags       = realloc(replay->tags, newCapacity*sizeof(ReplayTag));
+        
+        if(!tags){
+            return EPC_INDEX_NOT_FOUND;
+        }
+        replay->tags        = tags;
+        replay->tagCapacity = newCapacity;
+    }
+    
+    if(inserted){
+        memset(&replay->tags[row], 0, sizeof(ReplayTag));
+        memcpy(replay->tags[row].epc, epc, TAG_EPC_NUM_BYTES);
+        tagRangeEstimatorInit(&replay->tags[row].rangeEstimator);
+    }
+    return row;
+}
+
+//This follows saveTagRead: in RFIDTagList.m, which can't be built here.
+static void replaySaveRead(ReplayTag *tag, const TagRead *read)
+{
+    TagPDOAMeasurement  *measurement    =   read->hopNotSkip ? &tag->hop : &tag->skip;
+    TagRangeEstimate    estimate;
+    
+    measurement->freqMHz    = tagMetricsFreqMHzFromSlot(read->freqSlot);
+    measurement->phaseAnt   = tagMetricsPhase(read->antMagI, read->antMagQ);
+    measurement->phaseCal   = tagMetricsPhase(read->calMagI, read->calMagQ);
+    measurement->magCal     = tagMetricsRSSIdBm(read->calMagI, read->calMagQ);
+    measurement->nonce      = read->hopSkipNonce;
+    tag->rssidBm            = tagMetricsRSSIdBm(read->antMagI, read->antMagQ);
+    if(read->hopNotSkip){
+        //As in the tag list, the skip data is cleared but its nonce is kept.
+        tag->skip.freqMHz = tag->skip.phaseAnt = tag->skip.phaseCal = tag->skip.magCal = 0;
+    }
+    
+    tagRangeEstimatorUpdate(&tag->rangeEstimator, read->freqSlot, measurement->phaseAnt, measurement->phaseCal, measurement->magCal);
+    tagRangeEstimatorGetEstimate(&tag->rangeEstimator, &estimate);
+    if(estimate.rangeMeters != TAG_METRICS_RANGE_INVALID){
+        tag->rangeMeters        = estimate.rangeMeters;
+        tag->rangeConfidence    = estimate.confidence;
+    } else if(!read->hopNotSkip){
+        tagMetricsPDOARange(&tag->hop, &tag->skip, &tag->rangeMeters);
+    }
+    tag->numReads++;
+}
+
+static void replayBatch(Replay *replay, uint32_t numRecords)
+{
+    uint32_t    numReads = 0;
+    uint64_t    t0, t1, t2, t3;
+    
+    t0 = replayCPUNs();
+    for(uint32_t i=0; i<numRecords; i++){
+        const BTLETraceRecord   *record =   &replay->records[i];
+        uint32_t                flags   =   0;
+        
+        if(record->channel < BTLE_TRACE_NUM_CHANNELS){
+            replay->numNotifications[record->channel]++;
+            replay->numBytes[record->channel] += record->length;
+        }
+        if(record->channel == BTLE_TRACE_PKT1){
+            flags = tagPacketDecoderPushPkt1(&replay->decoder, record->data, record->length, &replay->reads[numReads]);
+        } else if(record->channel == BTLE_TRACE_PKT2){
+            flags = tagPacketDecoderPushPkt2(&replay->decoder, record->data, record->length, &replay->reads[numReads]);
+        }
+        if(flags & TAG_DECODE_READ_READY){
+            numReads++;
+        }
+    }
+    
+    t1 = replayCPUNs();
+    for(uint32_t i=0; i<numReads; i++){
+        replay->rows[i] = replayFindOrCreateTag(replay, replay->reads[i].epc);
+    }
+    
+    t2 = replayCPUNs();
+    for(uint32_t i=0; i<numReads; i++){
+        if(replay->rows[i] != EPC_INDEX_NOT_FOUND){
+            replaySaveRead(&replay->tags[replay->rows[i]], &replay->reads[i]);
+        }
+    }
+    t3 = replayCPUNs();
+    
+    replay->numReads                    += numReads;
+    replay->stageNs[STAGE_DECODE]       += t1-t0;
+    replay->stageNs[STAGE_TAG_LIST]     += t2-t1;
+    replay->stageNs[STAGE_METRICS]      += t3-t2;
+}
+
+static void replaySleepUntil(uint64_t deadlineNs)
+{
+    struct timespec ts;
+    
+    ts.tv_sec   = (time_t)(deadlineNs/1000000000ULL);
+    ts.tv_nsec  = (long)(deadlineNs%1000000000ULL);
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0){
+    }
+}
+
+static int replayTrace(const char *path, bool realtime, bool listTags)
+{
+    BTLETraceReader reader;
+    Replay          replay;
+    uint32_t        numRecords  =   0;
+    //At recorded pace every notification is handled as it comes in, as the app would.
+    uint32_t        batchSize   =   realtime ? 1 : REPLAY_BATCH_RECORDS;
+    uint64_t        startNs, elapsedNs, cpuStartNs, cpuNs, lastTimestampNs = 0;
+    
+    if(!btleTraceReaderOpen(&reader, path)){
+        fprintf(stderr, "Could not open %s as a BTLE trace\n", path);
+        return 1;
+    }
+    
+    memset(&replay, 0, sizeof(replay));
+    tagPacketDecoderInit(&replay.decoder);
+    replay.records  = malloc(REPLAY_BATCH_RECORDS*sizeof(BTLETraceRecord));
+    replay.reads    = malloc(REPLAY_BATCH_RECORDS*sizeof(TagRead));
+    replay.rows     = malloc(REPLAY_BATCH_RECORDS*sizeof(int32_t));
+    if(!replay.records || !replay.reads || !replay.rows || !epcIndexInit(&replay.epcIndex)){
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    startNs     = monotonicClockNs();
+    cpuStartNs  = replayCPUNs();
+    while(btleTraceReaderNext(&reader, &replay.records[numRecords])){
+        lastTimestampNs = replay.records[numRecords].timestampNs;
+        if(realtime){
+            replaySleepUntil(startNs+lastTimestampNs);
+        }
+        if(++numRecords == batchSize){
+            replayBatch(&replay, numRecords);
+            numRecords = 0;
+        }
+    }
+    replayBatch(&replay, numRecords);
+    cpuNs       = replayCPUNs()-cpuStartNs;
+    elapsedNs   = monotonicClockNs()-startNs;
+    
+    if(reader.truncated){
+        fprintf(stderr, "Trace ends partway through a record, replayed everything before it\n");
+    }
+    
+    printf("Trace: %llu notifications over %.3fs\n", (unsigned long long)reader.numRecords, lastTimestampNs/1e9);
+    for(int c=0; c<BTLE_TRACE_NUM_CHANNELS; c++){
+        if(replay.numNotifications[c]){
+            printf("  %-18s %10llu notifications %12llu bytes\n", btleTraceChannelName((uint8_t)c),
+                   (unsigned long long)replay.numNotifications[c], (unsigned long long)replay.numBytes[c]);
+        }
+    }
+    printf("Decoder: %u reads, %u sequence gaps, %u discarded packets\n",
+           replay.decoder.numReads, replay.decoder.numSequenceGaps, replay.decoder.numDiscardedPkts);
+    printf("Replay (%s): %.3fs, %u tags, %.0f reads/s, %.0f tags/s\n", realtime ? "recorded pace" : "as fast as possible",
+           elapsedNs/1e9, replay.epcIndex.count, replay.numReads/(elapsedNs/1e9), replay.epcIndex.count/(elapsedNs/1e9));
+    printf("CPU time: %.3fms total, including reading the trace\n", cpuNs/1e6);
+    for(int s=0; s<NUM_STAGES; s++){
+        printf("  %-18s %10.3fms %8.1fns/read\n", replayStageNames[s], replay.stageNs[s]/1e6,
+               replay.numReads ? (double)replay.stageNs[s]/replay.numReads : 0.0);
+    }
+    
+    if(listTags){
+        for(uint32_t row=0; row<replay.epcIndex.count; row++){
+            char        hex[TAG_EPC_HEX_STRING_LENGTH+1];
+            ReplayTag   *tag = &replay.tags[row];
+            
+            tagReadFormatEPC(tag->epc, hex);
+            printf("%s %8u reads %7.1fdBm %6.2fm (confidence %.2f)\n", hex, tag->numReads, tag->rssidBm, tag->rangeMeters, tag->rangeConfidence);
+        }
+    }
+    
+    btleTraceReaderClose(&reader);
+    epcIndexFree(&replay.epcIndex);
+    free(replay.tags);
+    free(replay.records);
+    free(replay.reads);
+    free(replay.rows);
+    
+    return 0;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Several readers at once
+
+//Each simulated reader has a thread pushing the trace's tag notifications into its session, the way the BTLE callbacks
+//would, and a thread draining the session into the tag store that all of the readers share.
+typedef struct
+{
+    ReaderSession           session;
+    TagStore                *store;
+    const ReaderPacket      *packets;
+    uint32_t                numPackets;
+    volatile bool           pushDone;
+    uint64_t                numFullWaits;
+} SimulatedReader;
+
+static void *simulatedReaderPush(void *argument)
+{
+    SimulatedReader *reader = argument;
+    
+    for(uint32_t i=0; i<reader->numPackets; i++){
+        const ReaderPacket *packet = &reader->packets[i];
+        
+        //Unlike the real link, we can wait for room rather than drop, so that every reader does the same work.
+        while(readerSessionNumQueued(&reader->session) > reader->session.queueMask){
+            reader->numFullWaits++;
+            sched_yield();
+        }
+        readerSessionPush(&reader->session, (ReaderPacketKind)packet->kind, packet->bytes, packet->length, packet->timestampNs);
+    }
+    __atomic_store_n(&reader->pushDone, true, __ATOMIC_RELEASE);
+    
+    return NULL;
+}
+
+static void *simulatedReaderDrain(void *argument)
+{
+    SimulatedReader *reader = argument;
+    
+    for(;;){
+        bool done = __atomic_load_n(&reader->pushDone, __ATOMIC_ACQUIRE);
+        
+        if(!readerSessionDrain(&reader->session, reader->store, UINT32_MAX, NULL, NULL)){
+            if(done){
+                break;
+            }
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static int replayReaders(const char *path, uint32_t numReaders)
+{
+    BTLETraceReader     traceReader;
+    BTLETraceRecord     record;
+    TagStore            store;
+    SimulatedReader     *readers    =   calloc(numReaders, sizeof(SimulatedReader));
+    pthread_t           *threads    =   calloc(2*numReaders, sizeof(pthread_t));
+    ReaderPacket        *packets    =   NULL;
+    uint32_t            numPackets  =   0, capacity = 0, numSeenByAll = 0;
+    uint64_t            startNs, elapsedNs, numReads = 0;
+    
+    if(!readers || !threads || !tagStoreInit(&store)){
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    if(!btleTraceReaderOpen(&traceReader, path)){
+        fprintf(stderr, "Could not open %s as a BTLE trace\n", path);
+        return 1;
+    }
+    
+    //Only the tag notifications are kept, so that the threads don't spend their time reading the file.
+    while(btleTraceReaderNext(&traceReader, &record)){
+        if(record.channel != BTLE_TRACE_PKT1 && record.channel != BTLE_TRACE_PKT2){
+            continue;
+        }
+        if(numPackets == capacity){
+            capacity    = capacity ? 2*capacity : 4096;
+            packets     = realloc(packets, capacity*sizeof(ReaderPacket));
+            if(!packets){
+                fprintf(stderr, "Out of memory\n");
+                return 1;
+            }
+        }
+        packets[numPackets].timestampNs = record.timestampNs;
+        packets[numPackets].kind        = record.channel == BTLE_TRACE_PKT1 ? READER_PACKET_PKT1 : READER_PACKET_PKT2;
+        packets[numPackets].length      = record.length <= TAG_PKT1_NUM_BYTES ? (uint8_t)record.length : 0;
+        memcpy(packets[numPackets].bytes, record.data, packets[numPackets].length);
+        numPackets++;
+    }
+    btleTraceReaderClose(&traceReader);
+    
+    for(uint32_t r=0; r<numReaders; r++){
+        if(!readerSessionInit(&readers[r].session, (uint8_t)r, READER_SESSION_DEFAULT_QUEUE_CAPACITY)){
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        readers[r].store        = &store;
+        readers[r].packets      = packets;
+        readers[r].numPackets   = numPackets;
+    }
+    
+    startNs = monotonicClockNs();
+    for(uint32_t r=0; r<numReaders; r++){
+        pthread_create(&threads[2*r], NULL, simulatedReaderDrain, &readers[r]);
+        pthread_create(&threads[2*r+1], NULL, simulatedReaderPush, &readers[r]);
+    }
+    for(uint32_t t=0; t<2*numReaders; t++){
+        pthread_join(threads[t], NULL);
+    }
+    elapsedNs = monotonicClockNs()-startNs;
+    
+    for(uint32_t row=0; row<tagStoreNumTags(&store); row++){
+        TagStoreRecord tag;
+        
+        if(tagStoreCopyRecord(&store, (int32_t)row, &tag) && tagStoreRecordNumReaders(&tag) == numReaders){
+            numSeenByAll++;
+        }
+    }
+    
+    printf("%u readers, %u tag notifications each\n", numReaders, numPackets);
+    for(uint32_t r=0; r<numReaders; r++){
+        printf("  reader %u: %llu reads, %llu dropped, %llu waits for a full queue\n", r,
+               (unsigned long long)readers[r].session.numReads, (unsigned long long)readers[r].session.numDropped,
+               (unsigned long long)readers[r].numFullWaits);
+        numReads += readers[r].session.numReads;
+    }
+    printf("Merged: %u tags, %u seen by every reader\n", tagStoreNumTags(&store), numSeenByAll);
+    printf("Replay: %.3fs, %.0f reads/s in total, %.0f reads/s per reader, %ld CPUs online\n", elapsedNs/1e9,
+           numReads/(elapsedNs/1e9), numReads/(elapsedNs/1e9)/numReaders, sysconf(_SC_NPROCESSORS_ONLN));
+    
+    for(uint32_t r=0; r<numReaders; r++){
+        readerSessionFree(&readers[r].session);
+    }
+    tagStoreFree(&store);
+    free(packets);
+    free(readers);
+    free(threads);
+    
+    return 0;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+//Made-up traces
+
+//I/Q magnitudes that decode to the given phase, using the same atan(-Q/I) convention as tagMetricsPhase.
+static void synthesizeMagnitudes(double phase, double amplitude, int32_t *magI, int32_t *magQ)
+{
+    *magI = (int32_t)lrint(amplitude*cos(phase));
+    *magQ = (int32_t)lrint(-amplitude*sin(phase));
+}
+
+static void synthesizePackets(const uint8_t *epc, uint8_t slot, bool hop, uint8_t nonce, double rangeMeters,
+                              uint8_t *dataId, uint8_t *pkt1, uint8_t *pkt2)
+{
+    double  phaseCal    = 0.5+2.0*rand()/RAND_MAX;
+    double  phaseTarget = fmod(4*M_PI*tagMetricsFreqMHzFromSlot(slot)*(1e6)*rangeMeters/299792458.0, M_PI);
+    //Work out what antenna phase gives the target once the calibration and known phases are taken out.
+    double  base        = tagMetricsCorrectedPhase(slot, 1.5f, (float)phaseCal);
+    double  phaseAnt    = 1.5+fmod(phaseTarget-base+2*M_PI, M_PI);
+    int32_t antMagI, antMagQ, calMagI, calMagQ;
+    
+    synthesizeMagnitudes(phaseAnt, 200000.0+rand()%20000000, &antMagI, &antMagQ);
+    synthesizeMagnitudes(phaseCal, 60000000.0, &calMagI, &calMagQ);
+    
+    memcpy(pkt1, epc, TAG_EPC_NUM_BYTES);
+    pkt1[12] = 128 | slot;
+    pkt1[13] = (uint8_t)((uint32_t)antMagI >> 24); pkt1[14] = (uint8_t)((uint32_t)antMagI >> 16); pkt1[15] = (uint8_t)((uint32_t)antMagI >> 8);
+    pkt1[16] = (uint8_t)((uint32_t)antMagQ >> 24); pkt1[17] = (uint8_t)((uint32_t)antMagQ >> 16); pkt1[18] = (uint8_t)((uint32_t)antMagQ >> 8);
+    pkt1[19] = (*dataId)++;
+    
+    memset(pkt2, 0, TAG_PKT2_NUM_BYTES);
+    pkt2[1] = (uint8_t)antMagI;
+    pkt2[2] = (uint8_t)antMagQ;
+    for(int i=0; i<4; i++){
+        pkt2[4+i] = (uint8_t)((uint32_t)calMagI >> (24-8*i));
+        pkt2[8+i] = (uint8_t)((uint32_t)calMagQ >> (24-8*i));
+    }
+    pkt2[12] = hop ? 255 : 0;
+    pkt2[14] = nonce;
+    pkt2[15] = (*dataId)++;
+}
+
+//An inventory of numTags tags at random ranges, each interrogation a hop and a skip 1 to 3 slots away.
+//Notifications are spaced as the reader sends them, about 7.5ms per connection interval with 6 packets in each.
+static int synthesizeTrace(uint32_t numTags, uint32_t numInterrogations, const char *path)
+{
+    BTLETraceWriter writer;
+    uint8_t         *epcs   = malloc((size_t)numTags*TAG_EPC_NUM_BYTES);
+    double          *ranges = malloc((size_t)numTags*sizeof(double));
+    uint8_t         pkt1[TAG_PKT1_NUM_BYTES], pkt2[TAG_PKT2_NUM_BYTES], state, dataId = 0;
+    uint64_t        timestampNs = 0;
+    const uint64_t  packetNs    = 7500000/6;
+    
+    if(!epcs || !ranges || !btleTraceWriterOpen(&writer, path)){
+        fprintf(stderr, "Could not create %s\n", path);
+        return 1;
+    }
+    
+    srand(1);
+    for(uint32_t t=0; t<numTags; t++){
+        for(int i=0; i<TAG_EPC_NUM_BYTES; i++){
+            epcs[t*TAG_EPC_NUM_BYTES+i] = (uint8_t)rand();
+        }
+        ranges[t] = 0.5+15.0*rand()/RAND_MAX;
+    }
+    
+    state = READER_INVENTORYING;
+    btleTraceWriterAppendAt(&writer, timestampNs, BTLE_TRACE_READ_STATE, &state, 1);
+    
+    for(uint32_t n=0; n<numInterrogations; n++){
+        uint32_t    t       = (uint32_t)rand()%numTags;
+        uint8_t     hopSlot = (uint8_t)(rand()%TAG_METRICS_NUM_SLOTS);
+        int         delta   = 1+rand()%3;
+        uint8_t     skipSlot= (uint8_t)(hopSlot+delta < TAG_METRICS_NUM_SLOTS ? hopSlot+delta : hopSlot-delta);
+        
+        synthesizePackets(&epcs[t*TAG_EPC_NUM_BYTES], hopSlot, true, (uint8_t)n, ranges[t], &dataId, pkt1, pkt2);
+        btleTraceWriterAppendAt(&writer, timestampNs += packetNs, BTLE_TRACE_PKT1, pkt1, sizeof(pkt1));
+        btleTraceWriterAppendAt(&writer, timestampNs += packetNs, BTLE_TRACE_PKT2, pkt2, sizeof(pkt2));
+        synthesizePackets(&epcs[t*TAG_EPC_NUM_BYTES], skipSlot, false, (uint8_t)n, ranges[t], &dataId, pkt1, pkt2);
+        btleTraceWriterAppendAt(&writer, timestampNs += packetNs, BTLE_TRACE_PKT1, pkt1, sizeof(pkt1));
+        btleTraceWriterAppendAt(&writer, timestampNs += packetNs, BTLE_TRACE_PKT2, pkt2, sizeof(pkt2));
+    }
+    
+    state = READER_IDLE_CONFIGURED;
+    btleTraceWriterAppendAt(&writer, timestampNs += packetNs, BTLE_TRACE_READ_STATE, &state, 1);
+    
+    free(epcs);
+    free(ranges);
+    if(!btleTraceWriterClose(&writer)){
+        fprintf(stderr, "Error writing %s\n", path);
+        return 1;
+    }
+    printf("Wrote %u interrogations of %u tags, %.1fs of reader time\n", numInterrogations, numTags, timestampNs/1e9);
+    return 0;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+
+static int usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [--realtime] [--tags] trace.surftrace\n", name);
+    fprintf(stderr, "       %s --readers numReaders trace.surftrace\n", name);
+    fprintf(stderr, "       %s --synthesize numTags numInterrogations trace.surftrace\n", name);
+    fprintf(stderr, "  --realtime    replay at the pace the trace was recorded instead of as fast as possible\n");
+    fprintf(stderr, "  --tags        list every tag at the end of the replay\n");
+    fprintf(stderr, "  --readers     replay the trace as that many readers at once, merged into one tag store\n");
+    return 2;
+}
+
+int main(int argc, char *argv[])
+{
+    bool    realtime    =   false;
+    bool    listTags    =   false;
+    int     arg;
+    
+    if(argc == 5 && strcmp(argv[1], "--synthesize") == 0){
+        long numTags            = strtol(argv[2], NULL, 10);
+        long numInterrogations  = strtol(argv[3], NULL, 10);
+        
+        if(numTags <= 0 || numInterrogations < 0){
+            return usage(argv[0]);
+        }
+        return synthesizeTrace((uint32_t)numTags, (uint32_t)numInterrogations, argv[4]);
+    }
+    
+    if(argc == 4 && strcmp(argv[1], "--readers") == 0){
+        long numReaders = strtol(argv[2], NULL, 10);
+        
+        if(numReaders <= 0 || numReaders > TAG_STORE_MAX_READERS){
+            return usage(argv[0]);
+        }
+        return replayReaders(argv[3], (uint32_t)numReaders);
+    }
+    
+    for(arg=1; arg<argc-1; arg++){
+        if(strcmp(argv[arg], "--realtime") == 0){
+            realtime = true;
+        } else if(strcmp(argv[arg], "--tags") == 0){
+            listTags = true;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if(arg != argc-1){
+        return usage(argv[0]);
+    }
+    
+    return replayTrace(argv[arg], realtime, listTags);
+}
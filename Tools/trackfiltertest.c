@@ -0,0 +1,130 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: trackfiltertest.c                                                         //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Test of the per-tag tracking filter. A tag moving at a steady rate is tracked   //
+//  and checked, then the gates are checked: sentinel ranges, outliers, a range     //
+//  pair taken in twice, and estimator ranges, which carry the nonce of whatever    //
+//  read they came in on and must not be turned away by it.                         //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o trackfiltertest Tools/trackfiltertest.c               //
+//  SURFERControl/TagTrackFilter.c -lm                                              //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "TagTrackFilter.h"
+#include "TagMetrics.h"
+#include "testcheck.h"
+
+#define TRACKFILTERTEST_READ_NS     50000000ULL //Time between reads.
+#define TRACKFILTERTEST_NUM_READS   100
+#define TRACKFILTERTEST_SPEED_MPS   0.5f
+
+//A tag walking away from 2m, with the range from a reader's estimator on every read.
+static void trackFilterTestMoving(const TagTrackFilterParams *params)
+{
+    TagTrackFilter  filter;
+    float           rangeMeters = 2.0f;
+    uint32_t        numAccepted = 0;
+    
+    tagTrackFilterInit(&filter);
+    for(uint32_t i = 0; i < TRACKFILTERTEST_NUM_READS; i++){
+        rangeMeters = 2.0f + TRACKFILTERTEST_SPEED_MPS*(float)(i*TRACKFILTERTEST_READ_NS)*1e-9f;
+        if(tagTrackFilterUpdateRange(&filter, params, rangeMeters, (i+1)*TRACKFILTERTEST_READ_NS) == TAG_TRACK_ACCEPTED){
+            numAccepted++;
+        }
+    }
+    
+    TEST_CHECK(numAccepted == TRACKFILTERTEST_NUM_READS-1, "accepted %u of %u", numAccepted, TRACKFILTERTEST_NUM_READS-1);
+    TEST_CHECK(fabsf(filter.range.value - rangeMeters) < 0.05f, "value %f, range %f", filter.range.value, rangeMeters);
+    TEST_CHECK(fabsf(filter.range.rate - TRACKFILTERTEST_SPEED_MPS) < 0.05f, "rate %f", filter.range.rate);
+}
+
+static void trackFilterTestGates(const TagTrackFilterParams *params)
+{
+    TagTrackFilter  filter;
+    uint64_t        timestampNs = TRACKFILTERTEST_READ_NS;
+    TagTrackResult  result;
+    
+    tagTrackFilterInit(&filter);
+    result = tagTrackFilterUpdateRange(&filter, params, TAG_METRICS_RANGE_INVALID, timestampNs);
+    TEST_CHECK(result == TAG_TRACK_REJECTED_INVALID, "sentinel range gave %d", result);
+    result = tagTrackFilterUpdateRange(&filter, params, NAN, timestampNs);
+    TEST_CHECK(result == TAG_TRACK_REJECTED_INVALID, "NaN range gave %d", result);
+    result = tagTrackFilterUpdateRSSI(&filter, params, 3.0f, timestampNs);
+    TEST_CHECK(result == TAG_TRACK_REJECTED_INVALID, "positive RSSI gave %d", result);
+    
+    //A range pair is taken in once. The next read, still of the same pair, is stale.
+    result = tagTrackFilterUpdatePairRange(&filter, params, 3.0f, 7, timestampNs);
+    TEST_CHECK(result == TAG_TRACK_STARTED, "first pair gave %d", result);
+    timestampNs += TRACKFILTERTEST_READ_NS;
+    result = tagTrackFilterUpdatePairRange(&filter, params, 3.0f, 7, timestampNs);
+    TEST_CHECK(result == TAG_TRACK_REJECTED_STALE, "same pair gave %d", result);
+    timestampNs += TRACKFILTERTEST_READ_NS;
+    result = tagTrackFilterUpdatePairRange(&filter, params, 3.05f, 8, timestampNs);
+    TEST_CHECK(result == TAG_TRACK_ACCEPTED, "next pair gave %d", result);
+    
+    //The skip read of a pair brings the estimator's new range with the same nonce as the hop read before it.
+    timestampNs += TRACKFILTERTEST_READ_NS;
+    result = tagTrackFilterUpdateRange(&filter, params, 3.05f, timestampNs);
+    TEST_CHECK(result == TAG_TRACK_ACCEPTED, "estimator range on the skip read gave %d", result);
+    timestampNs += TRACKFILTERTEST_READ_NS;
+    result = tagTrackFilterUpdateRange(&filter, params, 3.1f, timestampNs);
+    TEST_CHECK(result == TAG_TRACK_ACCEPTED, "second estimator range gave %d", result);
+    //And after estimator ranges, a pair with the old nonce is not mistaken for one already seen.
+    timestampNs += TRACKFILTERTEST_READ_NS;
+    result = tagTrackFilterUpdatePairRange(&filter, params, 3.1f, 8, timestampNs);
+    TEST_CHECK(result == TAG_TRACK_ACCEPTED, "pair after estimator ranges gave %d", result);
+    
+    //A far-off range is an outlier until there are more than maxConsecutiveRejects of them in a row.
+    for(uint8_t i = 0; i < params->range.maxConsecutiveRejects; i++){
+        timestampNs += TRACKFILTERTEST_READ_NS;
+        result = tagTrackFilterUpdateRange(&filter, params, 20.0f, timestampNs);
+        TEST_CHECK(result == TAG_TRACK_REJECTED_OUTLIER, "outlier %u gave %d", i, result);
+    }
+    timestampNs += TRACKFILTERTEST_READ_NS;
+    result = tagTrackFilterUpdateRange(&filter, params, 20.0f, timestampNs);
+    TEST_CHECK(result == TAG_TRACK_STARTED, "run of outliers gave %d", result);
+    
+    //A read after too long a gap restarts the track.
+    timestampNs += params->maxGapNs + 1;
+    result = tagTrackFilterUpdateRange(&filter, params, 20.0f, timestampNs);
+    TEST_CHECK(result == TAG_TRACK_STARTED, "read after a gap gave %d", result);
+}
+
+int main(void)
+{
+    TagTrackFilterParams params;
+    
+    tagTrackFilterDefaultParams(&params);
+    trackFilterTestMoving(&params);
+    trackFilterTestGates(&params);
+    
+    return testCheckExit("trackfiltertest");
+}
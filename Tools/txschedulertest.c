@@ -0,0 +1,294 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: txschedulertest.c                                                         //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Test of TxScheduler against a simulated BTLE link with an injected clock. The   //
+//  link takes a few packets per connection event into a small credit buffer,       //
+//  commands arrive in bursts, and no stretch of one interval may carry more than   //
+//  the budget. Merging, priorities and the service delay are checked too.          //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o txschedulertest Tools/txschedulertest.c               //
+//  SURFERControl/TxScheduler.c SURFERControl/LatencyProbe.c                        //
+//  SURFERControl/MonotonicClock.c                                                  //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "TxScheduler.h"
+#include "testcheck.h"
+
+#define TXTEST_INTERVAL_NS          TX_SCHEDULER_DEFAULT_INTERVAL_NS
+#define TXTEST_BUDGET               TX_SCHEDULER_DEFAULT_PKTS_PER_INTERVAL
+#define TXTEST_LINK_PKTS_PER_EVENT  6           //What the link moves over the air at each connection event.
+#define TXTEST_LINK_CREDITS         10          //Packets the link can hold before canWrite says no.
+#define TXTEST_NUM_COMMANDS         2000
+#define TXTEST_STEP_NS              1000000     //The simulation moves on 1ms at a time.
+#define TXTEST_MAX_SENT             (4*TXTEST_NUM_COMMANDS)
+
+typedef struct
+{
+    uint64_t    nowNs;
+    uint64_t    eventPhaseNs;                   //When in each interval the connection event falls.
+    uint32_t    numBuffered;
+    uint32_t    numOverflows;                   //Writes the link had to refuse after canWrite said yes.
+    uint32_t    numSent;
+    uint64_t    sentNs[TXTEST_MAX_SENT];
+    uint8_t     sentChannel[TXTEST_MAX_SENT];
+    uint8_t     sentBytes[TXTEST_MAX_SENT][TX_COMMAND_MAX_BYTES];
+    bool        refuseNext;                     //Refuse one write although there is room, as a link may.
+    bool        limited;                        //Whether the link has credits at all. If not, it takes every write.
+} TxTestLink;
+
+static uint64_t txTestClock(void *context)
+{
+    return ((TxTestLink *)context)->nowNs;
+}
+
+static bool txTestCanWrite(void *context)
+{
+    return ((TxTestLink *)context)->numBuffered < TXTEST_LINK_CREDITS;
+}
+
+static bool txTestWrite(void *context, TxChannel channel, const uint8_t *bytes, size_t length)
+{
+    TxTestLink *link = context;
+    
+    if(link->refuseNext){
+        link->refuseNext = false;
+        return false;
+    }
+    if(link->limited && link->numBuffered >= TXTEST_LINK_CREDITS){
+        link->numOverflows++;
+        return false;
+    }
+    if(link->numSent < TXTEST_MAX_SENT){
+        link->sentNs[link->numSent]         = link->nowNs;
+        link->sentChannel[link->numSent]    = (uint8_t)channel;
+        memset(link->sentBytes[link->numSent], 0, TX_COMMAND_MAX_BYTES);
+        memcpy(link->sentBytes[link->numSent], bytes, length);
+    }
+    link->numSent++;
+    link->numBuffered++;
+    return true;
+}
+
+static void txTestInit(TxScheduler *scheduler, TxTestLink *link, bool withCredits)
+{
+    TxTransport transport = {link, withCredits ? txTestCanWrite : NULL, txTestWrite};
+    
+    memset(link, 0, sizeof(TxTestLink));
+    link->nowNs     = 1000000000;
+    link->limited   = withCredits;
+    txSchedulerInit(scheduler, transport, txTestClock, link);
+}
+
+//The most packets sent in any stretch of one interval.
+static uint32_t txTestMaxInWindow(const TxTestLink *link)
+{
+    uint32_t    maxInWindow = 0;
+    uint32_t    first       = 0;
+    uint32_t    numSent     = link->numSent < TXTEST_MAX_SENT ? link->numSent : TXTEST_MAX_SENT;
+    
+    for(uint32_t last=0; last<numSent; last++){
+        while(link->sentNs[last] - link->sentNs[first] >= TXTEST_INTERVAL_NS){
+            first++;
+        }
+        if(last-first+1 > maxInWindow){
+            maxInWindow = last-first+1;
+        }
+    }
+    return maxInWindow;
+}
+
+//------------------------------------------------------------------------------------------------------------------
+
+//The case a fixed window gets wrong: a full budget just before it ends and another just after.
+static void txTestWindowEdge(void)
+{
+    static TxTestLink   link;
+    TxScheduler         scheduler;
+    uint8_t             epc[12] = {0};
+    
+    txTestInit(&scheduler, &link, false);
+    txSchedulerService(&scheduler);
+    
+    link.nowNs += TXTEST_INTERVAL_NS-1000000;
+    for(int n=0; n<2*TXTEST_BUDGET; n++){
+        uint8_t state = (uint8_t)n;
+        
+        txSchedulerEnqueue(&scheduler, TX_CHANNEL_STATE, TX_PRIORITY_NORMAL, &state, 1);
+    }
+    TEST_CHECK(txSchedulerService(&scheduler) == TXTEST_BUDGET, "%u sent at first", link.numSent);
+    TEST_CHECK(txSchedulerServiceDelayNs(&scheduler) == TXTEST_INTERVAL_NS, "delay %llu", (unsigned long long)txSchedulerServiceDelayNs(&scheduler));
+    
+    link.nowNs += 2000000;
+    TEST_CHECK(txSchedulerService(&scheduler) == 0, "%u sent 2ms later", link.numSent-TXTEST_BUDGET);
+    TEST_CHECK(txSchedulerServiceDelayNs(&scheduler) == TXTEST_INTERVAL_NS-2000000, "delay %llu",
+               (unsigned long long)txSchedulerServiceDelayNs(&scheduler));
+    
+    link.nowNs += TXTEST_INTERVAL_NS-2000000-1;
+    TEST_CHECK(txSchedulerService(&scheduler) == 0 && txSchedulerServiceDelayNs(&scheduler) == 1, "sent 1ns early");
+    link.nowNs += 1;
+    TEST_CHECK(txSchedulerService(&scheduler) == TXTEST_BUDGET && txSchedulerServiceDelayNs(&scheduler) == TX_SCHEDULER_NO_SERVICE,
+               "second budget not sent on time");
+    TEST_CHECK(txTestMaxInWindow(&link) == TXTEST_BUDGET, "%u packets in one interval", txTestMaxInWindow(&link));
+    
+    //Spread-out sends free up their slots one at a time.
+    link.nowNs += 10*TXTEST_INTERVAL_NS;
+    link.numSent = 0;
+    for(int n=0; n<TXTEST_BUDGET+1; n++){
+        epc[0] = (uint8_t)n;
+        txSchedulerEnqueue(&scheduler, n & 1 ? TX_CHANNEL_TARGET_EPC : TX_CHANNEL_NEW_EPC, TX_PRIORITY_NORMAL, epc, sizeof(epc));
+        txSchedulerService(&scheduler);
+        link.nowNs += 1000000;
+    }
+    TEST_CHECK(link.numSent == TXTEST_BUDGET && txSchedulerServiceDelayNs(&scheduler) == TXTEST_INTERVAL_NS-(TXTEST_BUDGET+1)*1000000,
+               "%u sent, delay %llu", link.numSent, (unsigned long long)txSchedulerServiceDelayNs(&scheduler));
+    
+    //A budget larger than the ring is cut down to it.
+    txSchedulerSetBudget(&scheduler, TXTEST_INTERVAL_NS, 1000);
+    TEST_CHECK(scheduler.pktsPerInterval == TX_SCHEDULER_MAX_PKTS_PER_INTERVAL, "budget %u", scheduler.pktsPerInterval);
+}
+
+static void txTestMerging(void)
+{
+    static TxTestLink   link;
+    TxScheduler         scheduler;
+    uint8_t             bytes[TX_COMMAND_MAX_BYTES+1] = {0};
+    char                report[256];
+    
+    txTestInit(&scheduler, &link, false);
+    
+    //Repeated state commands merge only when the same. EPC commands take the latest value.
+    bytes[0] = 1;
+    TEST_CHECK(txSchedulerEnqueue(&scheduler, TX_CHANNEL_STATE, TX_PRIORITY_NORMAL, bytes, 1) == TX_ENQUEUE_QUEUED, "state");
+    TEST_CHECK(txSchedulerEnqueue(&scheduler, TX_CHANNEL_STATE, TX_PRIORITY_NORMAL, bytes, 1) == TX_ENQUEUE_MERGED, "same state");
+    bytes[0] = 2;
+    TEST_CHECK(txSchedulerEnqueue(&scheduler, TX_CHANNEL_STATE, TX_PRIORITY_NORMAL, bytes, 1) == TX_ENQUEUE_QUEUED, "new state");
+    TEST_CHECK(txSchedulerEnqueue(&scheduler, TX_CHANNEL_TARGET_EPC, TX_PRIORITY_NORMAL, bytes, 12) == TX_ENQUEUE_QUEUED, "EPC");
+    bytes[0] = 3;
+    TEST_CHECK(txSchedulerEnqueue(&scheduler, TX_CHANNEL_TARGET_EPC, TX_PRIORITY_NORMAL, bytes, 12) == TX_ENQUEUE_MERGED, "EPC again");
+    bytes[0] = 9;
+    TEST_CHECK(txSchedulerEnqueue(&scheduler, TX_CHANNEL_STATE, TX_PRIORITY_URGENT, bytes, 1) == TX_ENQUEUE_QUEUED, "urgent");
+    TEST_CHECK(txSchedulerEnqueue(&scheduler, TX_CHANNEL_STATE, TX_PRIORITY_NORMAL, bytes, 0) == TX_ENQUEUE_TOO_LONG &&
+               txSchedulerEnqueue(&scheduler, TX_CHANNEL_NEW_EPC, TX_PRIORITY_NORMAL, bytes, TX_COMMAND_MAX_BYTES+1) == TX_ENQUEUE_TOO_LONG,
+               "bad lengths were queued");
+    
+    TEST_CHECK(txSchedulerService(&scheduler) == 4, "%u sent", link.numSent);
+    TEST_CHECK(link.sentChannel[0] == TX_CHANNEL_STATE && link.sentBytes[0][0] == 9 && link.sentBytes[1][0] == 1 &&
+               link.sentBytes[2][0] == 2 && link.sentChannel[3] == TX_CHANNEL_TARGET_EPC && link.sentBytes[3][0] == 3,
+               "sent in the wrong order or with the wrong values");
+    
+    //The queue fills up, a refused write stays queued, and clear drops what is left.
+    txSchedulerSetBudget(&scheduler, TXTEST_INTERVAL_NS, 1);
+    for(int n=0; n<TX_SCHEDULER_QUEUE_CAPACITY; n++){
+        bytes[0] = (uint8_t)n;
+        txSchedulerEnqueue(&scheduler, TX_CHANNEL_STATE, TX_PRIORITY_NORMAL, bytes, 1);
+    }
+    TEST_CHECK(txSchedulerEnqueue(&scheduler, TX_CHANNEL_NEW_EPC, TX_PRIORITY_NORMAL, bytes, 12) == TX_ENQUEUE_QUEUE_FULL, "overfilled");
+    link.refuseNext = true;
+    TEST_CHECK(txSchedulerService(&scheduler) == 0 && scheduler.numQueued == TX_SCHEDULER_QUEUE_CAPACITY, "refused write was lost");
+    TEST_CHECK(txSchedulerService(&scheduler) == 1 && link.sentBytes[4][0] == 0, "refused write not retried first");
+    txSchedulerClear(&scheduler);
+    TEST_CHECK(scheduler.numQueued == 0 && scheduler.numDropped == TX_SCHEDULER_QUEUE_CAPACITY-1 &&
+               txSchedulerServiceDelayNs(&scheduler) == TX_SCHEDULER_NO_SERVICE, "clear");
+    
+    txSchedulerFormatReport(&scheduler, report, sizeof(report));
+    TEST_CHECK(strncmp(report, "TX: 5 sent, 2 merged, 3 rejected, 31 dropped", 44) == 0, "report was: %s", report);
+}
+
+//Bursts of commands against a link with connection events at their own phase. The scheduler is serviced the way
+//SURFERPeripheral does it: on every enqueue, when the link gives credits back, and after the delay it asks for.
+static void txTestSimulatedLink(void)
+{
+    static TxTestLink   link;
+    TxScheduler         scheduler;
+    uint32_t            numEnqueued = 0, numQueueFull = 0, numOther = 0, numWrong = 0;
+    uint64_t            serviceAtNs = UINT64_MAX;
+    uint64_t            startNs;
+    uint32_t            random      = 12345;
+    
+    txTestInit(&scheduler, &link, true);
+    link.eventPhaseNs   = 7000000;
+    startNs             = link.nowNs;
+    
+    while(numEnqueued < TXTEST_NUM_COMMANDS || scheduler.numQueued || link.numBuffered){
+        bool service = false;
+        
+        //A burst of up to 20 state commands now and then, each numbered, so the order can be checked. That's about
+        //70 commands a second on average, against a budget of 200.
+        random = random*1103515245 + 12345;
+        if(numEnqueued < TXTEST_NUM_COMMANDS && (random >> 16) % 150 == 0){
+            for(uint32_t n = (random >> 8) % 20 + 1; n && numEnqueued < TXTEST_NUM_COMMANDS; n--){
+                uint8_t bytes[2] = {(uint8_t)(numEnqueued >> 8), (uint8_t)numEnqueued};
+                
+                TxEnqueueResult result = txSchedulerEnqueue(&scheduler, TX_CHANNEL_STATE, TX_PRIORITY_NORMAL, bytes, 2);
+                
+                numQueueFull   += result == TX_ENQUEUE_QUEUE_FULL;
+                numOther       += result != TX_ENQUEUE_QUEUE_FULL && result != TX_ENQUEUE_QUEUED;
+                numEnqueued++;
+            }
+            service = true;
+        }
+        if((link.nowNs - link.eventPhaseNs) % TXTEST_INTERVAL_NS < TXTEST_STEP_NS && link.numBuffered){
+            link.numBuffered = link.numBuffered > TXTEST_LINK_PKTS_PER_EVENT ? link.numBuffered-TXTEST_LINK_PKTS_PER_EVENT : 0;
+            service = true;
+        }
+        if(service || link.nowNs >= serviceAtNs){
+            uint64_t delayNs;
+            
+            txSchedulerService(&scheduler);
+            delayNs     = txSchedulerServiceDelayNs(&scheduler);
+            serviceAtNs = delayNs == TX_SCHEDULER_NO_SERVICE ? UINT64_MAX : link.nowNs + (delayNs ? delayNs : TXTEST_INTERVAL_NS);
+        }
+        link.nowNs += TXTEST_STEP_NS;
+    }
+    
+    //Bursts that land together can fill the queue. Those commands are turned away, and the rest go in order.
+    for(uint32_t n=1; n<link.numSent && n<TXTEST_MAX_SENT; n++){
+        numWrong += ((uint32_t)link.sentBytes[n][0] << 8 | link.sentBytes[n][1]) <= ((uint32_t)link.sentBytes[n-1][0] << 8 | link.sentBytes[n-1][1]);
+    }
+    TEST_CHECK(numOther == 0 && link.numSent + numQueueFull == TXTEST_NUM_COMMANDS && numWrong == 0,
+               "%u of %u sent, %u turned away, %u out of order", link.numSent, TXTEST_NUM_COMMANDS, numQueueFull, numWrong);
+    TEST_CHECK(numQueueFull < TXTEST_NUM_COMMANDS/20, "%u turned away", numQueueFull);
+    TEST_CHECK(link.numOverflows == 0, "%u writes overflowed the link", link.numOverflows);
+    TEST_CHECK(txTestMaxInWindow(&link) <= TXTEST_BUDGET, "%u packets in one interval", txTestMaxInWindow(&link));
+    TEST_CHECK(scheduler.numRejected == numQueueFull, "%llu rejected", (unsigned long long)scheduler.numRejected);
+    printf("Sent %u commands in %.2f s (%u turned away by a full queue), at most %u in any %.0f ms, p99 queueing %.1f ms\n",
+           link.numSent, (link.nowNs-startNs)/1e9, numQueueFull, txTestMaxInWindow(&link), TXTEST_INTERVAL_NS/1e6,
+           latencyHistogramPercentile(&scheduler.sendLatency, 99)/1e6);
+}
+
+int main(void)
+{
+    txTestWindowEdge();
+    txTestMerging();
+    txTestSimulatedLink();
+    
+    return testCheckExit("txschedulertest");
+}
@@ -0,0 +1,96 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: wvfm2txt.c                                                                //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Command line tool to convert a packed waveform capture (.wvfm) saved by the     //
+//  app back to the text format with one bit per line. Build from the top of the    //
+//  repository on Linux/macOS with:                                                 //
+//  cc -O2 -ISURFERControl -o wvfm2txt Tools/wvfm2txt.c                             //
+//  SURFERControl/WaveformCapture.c                                                 //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "WaveformCapture.h"
+
+int main(int argc, char *argv[])
+{
+    WaveformCaptureHeader   header;
+    FILE                    *in;
+    FILE                    *out    =   stdout;
+    
+    if(argc < 2 || argc > 3){
+        fprintf(stderr, "Usage: %s capture.wvfm [output.txt]\n", argv[0]);
+        fprintf(stderr, "Writes to standard output if no output file is given.\n");
+        return 2;
+    }
+    
+    in = fopen(argv[1], "rb");
+    if(!in){
+        fprintf(stderr, "Could not open %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+    
+    if(!waveformCaptureReadHeader(in, &header)){
+        fprintf(stderr, "%s is not a waveform capture\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+    
+    if(header.bitCount == WAVEFORM_CAPTURE_BIT_COUNT_UNKNOWN){
+        fprintf(stderr, "Capture was not closed cleanly, converting all the bits that made it to disk\n");
+    }
+    fprintf(stderr, "Hardware revision: %s, start time: %llu us, bits: %lld\n", header.hardwareRevision[0] ? header.hardwareRevision : "unknown",
+            (unsigned long long)header.timestampUs, header.bitCount == WAVEFORM_CAPTURE_BIT_COUNT_UNKNOWN ? -1LL : (long long)header.bitCount);
+    
+    if(argc == 3){
+        out = fopen(argv[2], "wb");
+        if(!out){
+            fprintf(stderr, "Could not open %s: %s\n", argv[2], strerror(errno));
+            fclose(in);
+            return 1;
+        }
+    }
+    
+    rewind(in);
+    if(!waveformCaptureConvertToText(in, out)){
+        fprintf(stderr, "Error converting %s\n", argv[1]);
+        fclose(in);
+        if(out != stdout){
+            fclose(out);
+        }
+        return 1;
+    }
+    
+    fclose(in);
+    if(out != stdout && fclose(out) != 0){
+        fprintf(stderr, "Error writing %s\n", argv[2]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,364 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: wvfmanalysistest.c                                                        //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Test and benchmark of WaveformAnalysis. Miller-encoded tag replies with known   //
+//  bits are laid into synthetic captures, plain, inverted and with bit errors, and //
+//  fed in notification-sized pieces; the replies found and their bits are checked, //
+//  as are the run statistics and what an analysis that failed to set up does. The  //
+//  benchmark reports how many Mbit/s of capture the analysis keeps up with, and    //
+//  checks that the bits it keeps stay the same size however long the capture.      //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o wvfmanalysistest Tools/wvfmanalysistest.c             //
+//  SURFERControl/WaveformAnalysis.c SURFERControl/MonotonicClock.c                 //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "WaveformAnalysis.h"
+#include "MonotonicClock.h"
+#include "testcheck.h"
+
+#define WVFMANALYSISTEST_NOTIFICATION_BYTES 20                  //Waveform data arrives 20 bytes per BLE notification.
+#define WVFMANALYSISTEST_CAPTURE_BITS       (1u << 20)
+#define WVFMANALYSISTEST_BENCH_BITS         (64u << 20)
+#define WVFMANALYSISTEST_MIN_GAP_BITS       2000                //Of idle signal between replies.
+#define WVFMANALYSISTEST_MAX_GAP_BITS       20000
+#define WVFMANALYSISTEST_ERROR_RATE         20                  //One bit in this many is flipped in the noisy capture.
+#define WVFMANALYSISTEST_MIN_MBIT_PER_S     2.0                 //Well above what the BLE link can deliver.
+#define WVFMANALYSISTEST_MAX_WINDOW_BYTES   (64u << 10)         //Of capture kept while analyzing, however long it runs.
+#define WVFMANALYSISTEST_FEW_EDGES          100
+
+typedef struct
+{
+    uint64_t    bitOffset;
+    uint32_t    numBits;
+    uint8_t     bits[WAVEFORM_ANALYSIS_MAX_SYMBOLS/8];
+} WvfmAnalysisTestReply;
+
+typedef struct
+{
+    uint8_t                 *bytes;
+    uint64_t                numBytes;
+    WvfmAnalysisTestReply   *replies;
+    uint32_t                numReplies;
+} WvfmAnalysisTestCapture;
+
+static uint32_t wvfmAnalysisTestRandomState = 12345;
+
+static uint32_t wvfmAnalysisTestRandom(void)
+{
+    wvfmAnalysisTestRandomState ^= wvfmAnalysisTestRandomState << 13;
+    wvfmAnalysisTestRandomState ^= wvfmAnalysisTestRandomState >> 17;
+    wvfmAnalysisTestRandomState ^= wvfmAnalysisTestRandomState << 5;
+    
+    return wvfmAnalysisTestRandomState;
+}
+
+//Replies of 16 to 256 random bits, a random gap apart, with idle signal (zeros) around them, up to about numBits in
+//all. Inverted captures have every bit flipped, and noisy ones one in WVFMANALYSISTEST_ERROR_RATE.
+static bool wvfmAnalysisTestBuild(WvfmAnalysisTestCapture *capture, const WaveformAnalysisParams *params, uint64_t numBits,
+                                  bool inverted, bool noisy)
+{
+    uint64_t    maxReplies  =   numBits/WVFMANALYSISTEST_MIN_GAP_BITS+1;
+    uint64_t    *words      =   calloc(numBits/64+1, sizeof(uint64_t));
+    uint64_t    offset      =   WVFMANALYSISTEST_MIN_GAP_BITS;
+    
+    memset(capture, 0, sizeof(WvfmAnalysisTestCapture));
+    capture->replies = malloc(maxReplies*sizeof(WvfmAnalysisTestReply));
+    if(!words || !capture->replies){
+        free(words);
+        return false;
+    }
+    
+    while(capture->numReplies < maxReplies){
+        WvfmAnalysisTestReply   *reply  =   &capture->replies[capture->numReplies];
+        
+        reply->numBits = 16 + wvfmAnalysisTestRandom() % (WAVEFORM_ANALYSIS_MAX_SYMBOLS-15);
+        for(uint32_t i=0; i<sizeof(reply->bits); i++){
+            reply->bits[i] = (uint8_t)wvfmAnalysisTestRandom();
+        }
+        if(reply->numBits % 8){
+            reply->bits[reply->numBits/8] &= (uint8_t)(0xff00 >> (reply->numBits % 8));
+        }
+        memset(reply->bits+(reply->numBits+7)/8, 0, sizeof(reply->bits)-(reply->numBits+7)/8);
+        if(offset + waveformAnalysisEncodeMiller(params, reply->bits, reply->numBits, true, NULL, 0)
+           + WVFMANALYSISTEST_MIN_GAP_BITS > numBits){
+            break;
+        }
+        reply->bitOffset    = offset;
+        offset             += waveformAnalysisEncodeMiller(params, reply->bits, reply->numBits, true, words, offset);
+        offset             += WVFMANALYSISTEST_MIN_GAP_BITS
+                              + wvfmAnalysisTestRandom() % (WVFMANALYSISTEST_MAX_GAP_BITS-WVFMANALYSISTEST_MIN_GAP_BITS);
+        capture->numReplies++;
+    }
+    
+    //Bytes go earliest bit in the LSB, as the reader sends them.
+    capture->numBytes   = numBits/8;
+    capture->bytes      = malloc(capture->numBytes);
+    if(!capture->bytes){
+        free(words);
+        return false;
+    }
+    for(uint64_t i=0; i<capture->numBytes; i++){
+        uint8_t byte = (uint8_t)(words[i/8] >> (8*(i % 8)));
+        
+        if(noisy){
+            for(int bit=0; bit<8; bit++){
+                if(wvfmAnalysisTestRandom() % WVFMANALYSISTEST_ERROR_RATE == 0){
+                    byte ^= (uint8_t)(1 << bit);
+                }
+            }
+        }
+        capture->bytes[i] = inverted ? (uint8_t)~byte : byte;
+    }
+    free(words);
+    
+    return true;
+}
+
+static void wvfmAnalysisTestFreeCapture(WvfmAnalysisTestCapture *capture)
+{
+    free(capture->bytes);
+    free(capture->replies);
+}
+
+static bool wvfmAnalysisTestFeed(WaveformAnalysis *analysis, const WvfmAnalysisTestCapture *capture, size_t pieceBytes)
+{
+    bool ok = true;
+    
+    for(uint64_t n=0; ok && n<capture->numBytes; n+=pieceBytes){
+        ok = waveformAnalysisAppend(analysis, capture->bytes+n,
+                                    capture->numBytes-n < pieceBytes ? (size_t)(capture->numBytes-n) : pieceBytes);
+    }
+    waveformAnalysisFinish(analysis);
+    
+    return ok;
+}
+
+static uint32_t wvfmAnalysisTestNumWrongReplies(const WaveformAnalysis *analysis, const WvfmAnalysisTestCapture *capture,
+                                                int polarity)
+{
+    uint32_t numWrong = 0;
+    
+    for(uint32_t i=0; i<analysis->numPackets && i<capture->numReplies; i++){
+        const WaveformPacket        *packet =   &analysis->packets[i];
+        const WvfmAnalysisTestReply *reply  =   &capture->replies[i];
+        
+        numWrong += packet->bitOffset != reply->bitOffset || packet->numSymbols != reply->numBits
+                    || memcmp(packet->bits, reply->bits, sizeof(reply->bits)) != 0 || polarity*packet->preambleScore < 0;
+    }
+    return numWrong;
+}
+
+//Every reply is found where it was put, with the right bits, however the capture is split into pieces.
+static void wvfmAnalysisTestReplies(void)
+{
+    const uint32_t  halfCycles[]    = {12, 7, 1};
+    const uint32_t  millerMs[]      = {8, 4, 2};
+    const size_t    pieceSizes[]    = {1, WVFMANALYSISTEST_NOTIFICATION_BYTES, 4093};
+    
+    for(size_t h=0; h<sizeof(halfCycles)/sizeof(halfCycles[0]); h++){
+        for(size_t m=0; m<sizeof(millerMs)/sizeof(millerMs[0]); m++){
+            for(int kind=0; kind<3; kind++){
+                WaveformAnalysisParams  params;
+                WvfmAnalysisTestCapture capture;
+                bool                    inverted    = kind == 1;
+                bool                    noisy       = kind == 2;
+                
+                waveformAnalysisDefaultParams(&params);
+                params.samplesPerHalfCycle  = halfCycles[h];
+                params.millerM              = millerMs[m];
+                //A half cycle of one bit can't take errors; every flipped bit is a whole half cycle gone.
+                if(noisy && halfCycles[h] < 4){
+                    continue;
+                }
+                if(!wvfmAnalysisTestBuild(&capture, &params, WVFMANALYSISTEST_CAPTURE_BITS, inverted, noisy)){
+                    TEST_CHECK(false, "could not build a capture");
+                    continue;
+                }
+                for(size_t p=0; p<sizeof(pieceSizes)/sizeof(pieceSizes[0]); p++){
+                    WaveformAnalysis    analysis;
+                    bool                ok = waveformAnalysisInit(&analysis, &params);
+                    
+                    ok = ok && wvfmAnalysisTestFeed(&analysis, &capture, pieceSizes[p]);
+                    TEST_CHECK(ok, "analysis failed");
+                    TEST_CHECK(analysis.numBits == 8*capture.numBytes, "analyzed %llu bits of %llu",
+                               (unsigned long long)analysis.numBits, (unsigned long long)(8*capture.numBytes));
+                    TEST_CHECK(analysis.numPackets == capture.numReplies, "found %u replies of %u, half cycle %u, "
+                               "Miller-%u, kind %d", analysis.numPackets, capture.numReplies, halfCycles[h], millerMs[m], kind);
+                    TEST_CHECK(wvfmAnalysisTestNumWrongReplies(&analysis, &capture, inverted ? -1 : 1) == 0,
+                               "%u replies were wrong, half cycle %u, Miller-%u, kind %d in %zu byte pieces",
+                               wvfmAnalysisTestNumWrongReplies(&analysis, &capture, inverted ? -1 : 1), halfCycles[h],
+                               millerMs[m], kind, pieceSizes[p]);
+                    waveformAnalysisFree(&analysis);
+                }
+                wvfmAnalysisTestFreeCapture(&capture);
+            }
+        }
+    }
+}
+
+//The statistics match a plain walk over the bits.
+static void wvfmAnalysisTestStatistics(void)
+{
+    WaveformAnalysisParams  params;
+    WaveformAnalysis        analysis;
+    WvfmAnalysisTestCapture capture;
+    uint64_t                numOnes     = 0;
+    uint64_t                numEdges    = 0;
+    uint64_t                numRuns     = 0;
+    uint32_t                numEdgesWrong = 0;
+    
+    waveformAnalysisDefaultParams(&params);
+    if(!wvfmAnalysisTestBuild(&capture, &params, WVFMANALYSISTEST_CAPTURE_BITS, false, false)){
+        TEST_CHECK(false, "could not build a capture");
+        return;
+    }
+    TEST_CHECK(waveformAnalysisInit(&analysis, &params) && wvfmAnalysisTestFeed(&analysis, &capture, WVFMANALYSISTEST_NOTIFICATION_BYTES),
+               "analysis failed");
+    
+    for(uint64_t bit=0; bit<8*capture.numBytes; bit++){
+        int value = (capture.bytes[bit/8] >> (bit % 8)) & 1;
+        
+        numOnes += (uint64_t)value;
+        if(bit && value != ((capture.bytes[(bit-1)/8] >> ((bit-1) % 8)) & 1)){
+            if(numEdges < analysis.numEdgesStored && analysis.edges[numEdges] != bit){
+                numEdgesWrong++;
+            }
+            numEdges++;
+        }
+    }
+    for(int value=0; value<2; value++){
+        for(uint32_t length=0; length<WAVEFORM_ANALYSIS_RUN_BINS; length++){
+            numRuns += analysis.runHistogram[value][length];
+        }
+    }
+    TEST_CHECK(analysis.numOnes == numOnes, "%llu ones, should be %llu", (unsigned long long)analysis.numOnes,
+               (unsigned long long)numOnes);
+    TEST_CHECK(analysis.numEdges == numEdges && analysis.numEdgesStored == numEdges && numEdgesWrong == 0,
+               "%llu edges, %u stored, %u wrong, should be %llu", (unsigned long long)analysis.numEdges,
+               analysis.numEdgesStored, numEdgesWrong, (unsigned long long)numEdges);
+    TEST_CHECK(numRuns == numEdges+1, "%llu runs for %llu edges", (unsigned long long)numRuns, (unsigned long long)numEdges);
+    TEST_CHECK(analysis.edgeCapacity < 2*numEdges, "edge list has room for %u edges, for %llu", analysis.edgeCapacity,
+               (unsigned long long)numEdges);
+    //Most of a reply is plain subcarrier, a half cycle high then a half cycle low.
+    TEST_CHECK(waveformAnalysisMostCommonRun(&analysis, 0) == params.samplesPerHalfCycle &&
+               waveformAnalysisMostCommonRun(&analysis, 1) == params.samplesPerHalfCycle,
+               "most common runs %u and %u", waveformAnalysisMostCommonRun(&analysis, 0), waveformAnalysisMostCommonRun(&analysis, 1));
+    TEST_CHECK(analysis.longestRun[0] >= WVFMANALYSISTEST_MIN_GAP_BITS, "longest run of zeros %llu is shorter than a gap",
+               (unsigned long long)analysis.longestRun[0]);
+    
+    //Reset starts over on the same memory, with nothing left from before.
+    waveformAnalysisReset(&analysis);
+    TEST_CHECK(wvfmAnalysisTestFeed(&analysis, &capture, 4096) && analysis.numPackets == capture.numReplies &&
+               analysis.numOnes == numOnes && analysis.numEdges == numEdges &&
+               wvfmAnalysisTestNumWrongReplies(&analysis, &capture, 1) == 0, "analysis after a reset differed");
+    waveformAnalysisFree(&analysis);
+    
+    //With fewer edges kept than there are, the first ones are kept, the list grows no further, and the rest are counted.
+    params.maxEdges = WVFMANALYSISTEST_FEW_EDGES;
+    TEST_CHECK(waveformAnalysisInit(&analysis, &params) && wvfmAnalysisTestFeed(&analysis, &capture, WVFMANALYSISTEST_NOTIFICATION_BYTES),
+               "analysis failed");
+    TEST_CHECK(analysis.numEdges == numEdges && analysis.numEdgesStored == WVFMANALYSISTEST_FEW_EDGES &&
+               analysis.edgeCapacity == WVFMANALYSISTEST_FEW_EDGES, "%llu edges, %u stored in room for %u, with %u kept",
+               (unsigned long long)analysis.numEdges, analysis.numEdgesStored, analysis.edgeCapacity, WVFMANALYSISTEST_FEW_EDGES);
+    
+    waveformAnalysisFree(&analysis);
+    wvfmAnalysisTestFreeCapture(&capture);
+}
+
+//An analysis that failed to set up takes nothing, and everything else leaves it alone.
+static void wvfmAnalysisTestFailedSetup(void)
+{
+    WaveformAnalysisParams  params;
+    WaveformAnalysis        analysis;
+    const uint8_t           bytes[WVFMANALYSISTEST_NOTIFICATION_BYTES] = {0x55};
+    
+    waveformAnalysisDefaultParams(&params);
+    params.millerM = 3;
+    TEST_CHECK(!waveformAnalysisInit(&analysis, &params), "set up with an odd Miller M");
+    TEST_CHECK(!waveformAnalysisAppend(&analysis, bytes, sizeof(bytes)), "appended to an analysis that failed to set up");
+    waveformAnalysisFinish(&analysis);
+    waveformAnalysisReset(&analysis);
+    TEST_CHECK(analysis.numBits == 0 && analysis.numPackets == 0 && waveformAnalysisDutyCycle(&analysis) == 0,
+               "an analysis that failed to set up has results");
+    waveformAnalysisFree(&analysis);
+    
+    //One that was only ever zeroed is the same.
+    memset(&analysis, 0, sizeof(analysis));
+    TEST_CHECK(!waveformAnalysisAppend(&analysis, bytes, sizeof(bytes)), "appended to a zeroed analysis");
+    waveformAnalysisFinish(&analysis);
+    waveformAnalysisFree(&analysis);
+}
+
+static void wvfmAnalysisTestBenchmark(void)
+{
+    WaveformAnalysisParams  params;
+    WaveformAnalysis        analysis;
+    WvfmAnalysisTestCapture capture;
+    uint64_t                startNs;
+    uint64_t                elapsedNs;
+    double                  mbitPerS;
+    bool                    ok;
+    
+    waveformAnalysisDefaultParams(&params);
+    if(!wvfmAnalysisTestBuild(&capture, &params, WVFMANALYSISTEST_BENCH_BITS, false, true)){
+        TEST_CHECK(false, "could not build the benchmark capture");
+        return;
+    }
+    ok          = waveformAnalysisInit(&analysis, &params);
+    startNs     = monotonicClockNs();
+    ok          = ok && wvfmAnalysisTestFeed(&analysis, &capture, WVFMANALYSISTEST_NOTIFICATION_BYTES);
+    elapsedNs   = monotonicClockNs()-startNs;
+    mbitPerS    = 8*capture.numBytes/1e6/(elapsedNs/1e9);
+    
+    TEST_CHECK(ok, "benchmark analysis failed");
+    TEST_CHECK(analysis.numPackets == capture.numReplies && wvfmAnalysisTestNumWrongReplies(&analysis, &capture, 1) == 0,
+               "benchmark found %u replies of %u, %u wrong", analysis.numPackets, capture.numReplies,
+               wvfmAnalysisTestNumWrongReplies(&analysis, &capture, 1));
+    TEST_CHECK(mbitPerS >= WVFMANALYSISTEST_MIN_MBIT_PER_S, "analysis ran at %.1f Mbit/s", mbitPerS);
+    TEST_CHECK(analysis.wordCapacity*sizeof(uint64_t) <= WVFMANALYSISTEST_MAX_WINDOW_BYTES, "kept %zu bytes of capture",
+               analysis.wordCapacity*sizeof(uint64_t));
+    printf("Analyzed %llu Mbit of noisy Miller-%u capture in %d byte notifications at %.1f Mbit/s, %u replies, keeping %zu kB\n",
+           (unsigned long long)(8*capture.numBytes >> 20), params.millerM, WVFMANALYSISTEST_NOTIFICATION_BYTES, mbitPerS,
+           analysis.numPackets, analysis.wordCapacity*sizeof(uint64_t) >> 10);
+    
+    waveformAnalysisFree(&analysis);
+    wvfmAnalysisTestFreeCapture(&capture);
+}
+
+int main(void)
+{
+    wvfmAnalysisTestReplies();
+    wvfmAnalysisTestStatistics();
+    wvfmAnalysisTestFailedSetup();
+    wvfmAnalysisTestBenchmark();
+    
+    return testCheckExit("wvfmanalysistest");
+}
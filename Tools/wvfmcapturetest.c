@@ -0,0 +1,231 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: wvfmcapturetest.c                                                         //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Test and benchmark of WaveformCapture. Captures are written in notification-    //
+//  sized pieces and read back, the text conversion is checked against the old      //
+//  one-bit-per-line expansion, and a long capture is timed while its peak memory   //
+//  is checked to stay at a chunk or so rather than growing with the capture.       //
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o wvfmcapturetest Tools/wvfmcapturetest.c               //
+//  SURFERControl/WaveformCapture.c SURFERControl/MonotonicClock.c                  //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "WaveformCapture.h"
+#include "MonotonicClock.h"
+#include "testcheck.h"
+
+#define WVFMCAPTURETEST_NOTIFICATION_BYTES  20                  //Waveform data arrives 20 bytes per BLE notification.
+#define WVFMCAPTURETEST_BENCH_BYTES         (32*1024*1024)
+#define WVFMCAPTURETEST_MAX_PEAK_GROWTH     (1024*1024)         //Bytes of RSS the long capture may add.
+
+static char wvfmCaptureTestPath[256];
+
+static uint8_t wvfmCaptureTestByte(uint64_t n)
+{
+    return (uint8_t)((n*2654435761u) >> 13);
+}
+
+//Peak resident set size in bytes. Linux reports it in kB, macOS in bytes.
+static uint64_t wvfmCaptureTestPeakBytes(void)
+{
+    struct rusage usage;
+    
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss;
+#else
+    return 1024*(uint64_t)usage.ru_maxrss;
+#endif
+}
+
+static bool wvfmCaptureTestWrite(uint64_t numBytes, size_t pieceBytes, bool close)
+{
+    static WaveformCapture  capture;
+    uint8_t                 piece[WAVEFORM_CAPTURE_CHUNK_BYTES+1];
+    bool                    ok;
+    
+    ok = waveformCaptureOpen(&capture, wvfmCaptureTestPath, "SURFER rev 3.1", 1234567890123ULL);
+    for(uint64_t n=0; ok && n<numBytes; n+=pieceBytes){
+        size_t length = numBytes-n < pieceBytes ? (size_t)(numBytes-n) : pieceBytes;
+        
+        for(size_t i=0; i<length; i++){
+            piece[i] = wvfmCaptureTestByte(n+i);
+        }
+        ok = waveformCaptureAppend(&capture, piece, length);
+    }
+    if(close){
+        ok = waveformCaptureClose(&capture) && ok;
+    } else {
+        //Leave it as a crash would. The file is closed without the header being rewritten.
+        fclose(capture.file);
+        capture.file = NULL;
+    }
+    return ok;
+}
+
+//Returns the number of payload bytes that match what was written, or UINT64_MAX if any don't.
+static uint64_t wvfmCaptureTestCheckPayload(FILE *file)
+{
+    uint8_t     bytes[WAVEFORM_CAPTURE_CHUNK_BYTES];
+    uint64_t    numBytes = 0;
+    size_t      numRead;
+    
+    while((numRead = fread(bytes, 1, sizeof(bytes), file)) > 0){
+        for(size_t i=0; i<numRead; i++, numBytes++){
+            if(bytes[i] != wvfmCaptureTestByte(numBytes)){
+                return UINT64_MAX;
+            }
+        }
+    }
+    return numBytes;
+}
+
+static void wvfmCaptureTestRoundTrip(void)
+{
+    const size_t    pieceSizes[]    = {1, 7, WVFMCAPTURETEST_NOTIFICATION_BYTES, WAVEFORM_CAPTURE_CHUNK_BYTES, WAVEFORM_CAPTURE_CHUNK_BYTES+1};
+    const uint64_t  lengths[]       = {0, 1, WAVEFORM_CAPTURE_CHUNK_BYTES-1, WAVEFORM_CAPTURE_CHUNK_BYTES, 5*WAVEFORM_CAPTURE_CHUNK_BYTES+123};
+    
+    for(size_t p=0; p<sizeof(pieceSizes)/sizeof(pieceSizes[0]); p++){
+        for(size_t l=0; l<sizeof(lengths)/sizeof(lengths[0]); l++){
+            WaveformCaptureHeader   header;
+            FILE                    *file;
+            bool                    ok = wvfmCaptureTestWrite(lengths[l], pieceSizes[p], true);
+            
+            TEST_CHECK(ok, "writing %llu bytes in %zu byte pieces failed", (unsigned long long)lengths[l], pieceSizes[p]);
+            file = fopen(wvfmCaptureTestPath, "rb");
+            TEST_CHECK(file && waveformCaptureReadHeader(file, &header), "could not read back the header");
+            if(!file){
+                continue;
+            }
+            TEST_CHECK(header.version == WAVEFORM_CAPTURE_VERSION && header.chunkBytes == WAVEFORM_CAPTURE_CHUNK_BYTES &&
+                       header.timestampUs == 1234567890123ULL && strcmp(header.hardwareRevision, "SURFER rev 3.1") == 0,
+                       "header fields did not round trip");
+            TEST_CHECK(header.bitCount == 8*lengths[l], "bit count %llu for %llu bytes", (unsigned long long)header.bitCount,
+                       (unsigned long long)lengths[l]);
+            TEST_CHECK(wvfmCaptureTestCheckPayload(file) == lengths[l], "payload of %llu bytes in %zu byte pieces did not match",
+                       (unsigned long long)lengths[l], pieceSizes[p]);
+            fclose(file);
+        }
+    }
+}
+
+//A capture that was never closed has every full chunk on disk, and says its length is unknown.
+static void wvfmCaptureTestUnclosed(void)
+{
+    WaveformCaptureHeader   header;
+    FILE                    *file;
+    
+    wvfmCaptureTestWrite(3*WAVEFORM_CAPTURE_CHUNK_BYTES+100, WVFMCAPTURETEST_NOTIFICATION_BYTES, false);
+    file = fopen(wvfmCaptureTestPath, "rb");
+    TEST_CHECK(file && waveformCaptureReadHeader(file, &header), "could not read an unclosed capture");
+    if(file){
+        TEST_CHECK(header.bitCount == WAVEFORM_CAPTURE_BIT_COUNT_UNKNOWN, "unclosed bit count %llu", (unsigned long long)header.bitCount);
+        TEST_CHECK(wvfmCaptureTestCheckPayload(file) == 3*WAVEFORM_CAPTURE_CHUNK_BYTES, "unclosed payload was not the full chunks");
+        fclose(file);
+    }
+    
+    //Closing a capture that isn't open, and opening one where it can't be written, both fail cleanly.
+    WaveformCapture capture;
+    
+    memset(&capture, 0, sizeof(capture));
+    TEST_CHECK(!waveformCaptureClose(&capture) && !waveformCaptureIsOpen(&capture), "closed a capture that wasn't open");
+    TEST_CHECK(!waveformCaptureOpen(&capture, "/nonexistent/dir/capture.wvfm", NULL, 0), "opened in a missing directory");
+    TEST_CHECK(!waveformCaptureAppend(&capture, (const uint8_t *)"x", 1), "appended to a capture that failed to open");
+}
+
+//The text form is the old in-app expansion: every bit, earliest first, as '0' or '1' and CR LF.
+static void wvfmCaptureTestText(void)
+{
+    const uint64_t  numBytes    = 2*WAVEFORM_CAPTURE_CHUNK_BYTES+77;
+    FILE            *in, *out;
+    char            *text       = NULL;
+    size_t          textBytes   = 0;
+    uint64_t        numWrong    = 0;
+    
+    wvfmCaptureTestWrite(numBytes, WVFMCAPTURETEST_NOTIFICATION_BYTES, true);
+    in  = fopen(wvfmCaptureTestPath, "rb");
+    out = open_memstream(&text, &textBytes);
+    TEST_CHECK(in && out && waveformCaptureConvertToText(in, out), "conversion failed");
+    if(in){
+        fclose(in);
+    }
+    if(out){
+        fclose(out);
+    }
+    TEST_CHECK(textBytes == 3*8*numBytes, "text is %zu bytes for %llu bits", textBytes, (unsigned long long)(8*numBytes));
+    for(uint64_t bit=0; bit<8*numBytes && 3*bit+2 < textBytes; bit++){
+        numWrong += text[3*bit] != '0'+((wvfmCaptureTestByte(bit/8) >> (bit%8)) & 1) || text[3*bit+1] != '\r' || text[3*bit+2] != '\n';
+    }
+    TEST_CHECK(numWrong == 0, "%llu bits were wrong in the text", (unsigned long long)numWrong);
+    free(text);
+}
+
+static void wvfmCaptureTestBenchmark(void)
+{
+    uint64_t    peakBefore  = wvfmCaptureTestPeakBytes();
+    uint64_t    startNs     = monotonicClockNs();
+    bool        ok          = wvfmCaptureTestWrite(WVFMCAPTURETEST_BENCH_BYTES, WVFMCAPTURETEST_NOTIFICATION_BYTES, true);
+    uint64_t    elapsedNs   = monotonicClockNs()-startNs;
+    uint64_t    peakAfter   = wvfmCaptureTestPeakBytes();
+    FILE        *file;
+    
+    TEST_CHECK(ok, "benchmark capture failed");
+    file = fopen(wvfmCaptureTestPath, "rb");
+    if(file){
+        fseek(file, 0, SEEK_END);
+        TEST_CHECK((uint64_t)ftell(file) == WAVEFORM_CAPTURE_HEADER_BYTES+WVFMCAPTURETEST_BENCH_BYTES, "file is %ld bytes", ftell(file));
+        fclose(file);
+    }
+    TEST_CHECK(peakAfter-peakBefore < WVFMCAPTURETEST_MAX_PEAK_GROWTH, "peak memory grew by %llu bytes",
+               (unsigned long long)(peakAfter-peakBefore));
+    printf("Captured %d MB (%d Mbit) in %d byte notifications at %.1f MB/s; peak RSS %.1f MB, grew %llu kB"
+           " (the old text buffer would have needed %d MB)\n", WVFMCAPTURETEST_BENCH_BYTES >> 20, WVFMCAPTURETEST_BENCH_BYTES >> 17,
+           WVFMCAPTURETEST_NOTIFICATION_BYTES, WVFMCAPTURETEST_BENCH_BYTES/1e6/(elapsedNs/1e9), peakAfter/1048576.0,
+           (unsigned long long)(peakAfter-peakBefore)/1024, 3*8*(WVFMCAPTURETEST_BENCH_BYTES >> 20));
+}
+
+int main(void)
+{
+    const char *directory = getenv("TMPDIR");
+    
+    snprintf(wvfmCaptureTestPath, sizeof(wvfmCaptureTestPath), "%s/wvfmcapturetest-%d.wvfm", directory ? directory : "/tmp", (int)getpid());
+    
+    //The benchmark goes first, so that the peak memory it sees is not that of the other tests.
+    wvfmCaptureTestBenchmark();
+    wvfmCaptureTestRoundTrip();
+    wvfmCaptureTestUnclosed();
+    wvfmCaptureTestText();
+    remove(wvfmCaptureTestPath);
+    
+    return testCheckExit("wvfmcapturetest");
+}
@@ -0,0 +1,131 @@
+//////////////////////////////////////////////////////////////////////////////////////
+//                                                                                  //
+//  Module: SURFERControl                                                           //
+//                                                                                  //
+//  File: wvfmstat.c                                                                //
+//  Creation date: 10/17/2026                                                       //
+//  Author: Edward Keehr                                                            //
+//                                                                                  //
+//                                                                                  //
+//    Copyright 2021 Superlative Semiconductor LLC                                  //
+//                                                                                  //
+//    Licensed under the Apache License, Version 2.0 (the "License");               //
+//    you may not use this file except in compliance with the License.              //
+//    You may obtain a copy of the License at                                       //
+//                                                                                  //
+//       http://www.apache.org/licenses/LICENSE-2.0                                 //
+//                                                                                  //
+//    Unless required by applicable law or agreed to in writing, software           //
+//    distributed under the License is distributed on an "AS IS" BASIS,             //
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.      //
+//    See the License for the specific language governing permissions and           //
+//    limitations under the License.                                                //
+//                                                                                  //
+//                                                                                  //
+//  Description:                                                                    //
+//  Analyzes a waveform capture (.wvfm) the same way the app does as the capture    //
+//  comes in: duty cycle, edges, run lengths, and the Miller-encoded tag replies    //
+//  found in it, with their decoded bits. It also reports how fast the analysis ran.//
+//  Build from the top of the repository on Linux/macOS with:                       //
+//  cc -O2 -ISURFERControl -o wvfmstat Tools/wvfmstat.c                             //
+//  SURFERControl/WaveformCapture.c SURFERControl/WaveformAnalysis.c                //
+//  SURFERControl/MonotonicClock.c                                                  //
+//                                                                                  //
+//////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "WaveformCapture.h"
+#include "WaveformAnalysis.h"
+#include "MonotonicClock.h"
+
+static void wvfmstatPrintRuns(const WaveformAnalysis *analysis, int value)
+{
+    printf("Runs of %d, length: count\n", value);
+    for(uint32_t length=1; length<WAVEFORM_ANALYSIS_RUN_BINS; length++){
+        if(analysis->runHistogram[value][length]){
+            printf("  %s%u: %llu\n", length == WAVEFORM_ANALYSIS_RUN_BINS-1 ? ">=" : "", length,
+                   (unsigned long long)analysis->runHistogram[value][length]);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    WaveformCaptureHeader   header;
+    WaveformAnalysisParams  params;
+    WaveformAnalysis        analysis;
+    uint8_t                 chunk[WAVEFORM_CAPTURE_CHUNK_BYTES];
+    size_t                  length;
+    uint64_t                startNs, finishNs, endNs;
+    FILE                    *in;
+    
+    if(argc < 2 || argc > 3){
+        fprintf(stderr, "Usage: %s capture.wvfm [samples_per_half_cycle]\n", argv[0]);
+        fprintf(stderr, "The capture is taken to have %d samples per half cycle of Miller-%d subcarrier unless told otherwise.\n",
+                WAVEFORM_ANALYSIS_DEFAULT_HALF_CYCLE, WAVEFORM_ANALYSIS_DEFAULT_MILLER_M);
+        return 2;
+    }
+    
+    waveformAnalysisDefaultParams(&params);
+    if(argc == 3){
+        params.samplesPerHalfCycle = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+    if(!waveformAnalysisInit(&analysis, &params)){
+        fprintf(stderr, "Could not set up the analysis, check the samples per half cycle\n");
+        return 2;
+    }
+    
+    in = fopen(argv[1], "rb");
+    if(!in){
+        fprintf(stderr, "Could not open %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+    if(!waveformCaptureReadHeader(in, &header)){
+        fprintf(stderr, "%s is not a waveform capture\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+    
+    //Fed a chunk at a time, as the app is fed a notification at a time, so the finish time is what the app would see.
+    startNs = monotonicClockNs();
+    while((length = fread(chunk, 1, sizeof(chunk), in)) > 0){
+        if(!waveformAnalysisAppend(&analysis, chunk, length)){
+            fprintf(stderr, "Out of memory\n");
+            fclose(in);
+            return 1;
+        }
+    }
+    finishNs = monotonicClockNs();
+    waveformAnalysisFinish(&analysis);
+    endNs = monotonicClockNs();
+    fclose(in);
+    
+    printf("Bits: %llu, duty cycle: %.2f%%, edges: %llu, longest runs: %llu zeros, %llu ones\n",
+           (unsigned long long)analysis.numBits, 100*waveformAnalysisDutyCycle(&analysis), (unsigned long long)analysis.numEdges,
+           (unsigned long long)analysis.longestRun[0], (unsigned long long)analysis.longestRun[1]);
+    printf("Analyzed at %.1f Mbit/s, %.3f ms of it after the last chunk\n",
+           endNs > startNs ? analysis.numBits/1e6/((endNs-startNs)/1e9) : 0, (endNs-finishNs)/1e6);
+    wvfmstatPrintRuns(&analysis, 0);
+    wvfmstatPrintRuns(&analysis, 1);
+    
+    printf("Miller-%u replies: %u\n", params.millerM, analysis.numPackets);
+    for(uint32_t i=0; i<analysis.numPackets; i++){
+        const WaveformPacket *packet = &analysis.packets[i];
+        
+        printf("  bit %llu, preamble %.2f, %u symbols, weakest %.2f: ", (unsigned long long)packet->bitOffset,
+               packet->preambleScore, packet->numSymbols, packet->minSymbolScore);
+        for(uint32_t bit=0; bit<packet->numSymbols; bit++){
+            putchar('0' + ((packet->bits[bit >> 3] >> (7 - (bit & 7))) & 1));
+        }
+        putchar('\n');
+    }
+    
+    waveformAnalysisFree(&analysis);
+    return 0;
+}